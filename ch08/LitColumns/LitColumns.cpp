@@ -492,14 +492,27 @@ void LitColumns::BuildShadersAndInputLayout()
 	};
 }
 
+// Fills our Vertex (position and normal) from the generator's full vertex.
+struct ShapeVertexLayout
+{
+	using Vertex = ::Vertex;
+
+	static void Encode(const GeometryGenerator::Vertex& in, Vertex& out)
+	{
+		out.Pos = in.Position;
+		//￪ʼеColor滻Normal
+		out.Normal = in.Normal;
+	}
+};
+
 //
 void LitColumns::BuildShapesGeometry()
 {
 	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(1.5f, 0.5f, 1.5f, 3);
-	GeometryGenerator::MeshData grid = geoGen.CreateGrid(20.0f, 30.0f, 60, 40);
-	GeometryGenerator::MeshData sphere = geoGen.CreateSphere(0.5f, 20, 20);
-	GeometryGenerator::MeshData cylinder = geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
+	GeometryGenerator::MeshSize box = geoGen.GetBoxSize(3);
+	GeometryGenerator::MeshSize grid = geoGen.GetGridSize(60, 40);
+	GeometryGenerator::MeshSize sphere = geoGen.GetSphereSize(20, 20);
+	GeometryGenerator::MeshSize cylinder = geoGen.GetCylinderSize(20, 20);
 
 	//
 	// We are concatenating all the geometry into one big vertex/index buffer.  So
@@ -508,87 +521,55 @@ void LitColumns::BuildShapesGeometry()
 
 	// Cache the vertex offsets to each object in the concatenated vertex buffer.
 	UINT boxVertexOffset = 0;
-	UINT gridVertexOffset = (UINT)box.Vertices.size();
-	UINT sphereVertexOffset = gridVertexOffset + (UINT)grid.Vertices.size();
-	UINT cylinderVertexOffset = sphereVertexOffset + (UINT)sphere.Vertices.size();
+	UINT gridVertexOffset = box.VertexCount;
+	UINT sphereVertexOffset = gridVertexOffset + grid.VertexCount;
+	UINT cylinderVertexOffset = sphereVertexOffset + sphere.VertexCount;
 
 	// Cache the starting index for each object in the concatenated index buffer.
 	UINT boxIndexOffset = 0;
-	UINT gridIndexOffset = (UINT)box.Indices32.size();
-	UINT sphereIndexOffset = gridIndexOffset + (UINT)grid.Indices32.size();
-	UINT cylinderIndexOffset = sphereIndexOffset + (UINT)sphere.Indices32.size();
+	UINT gridIndexOffset = box.IndexCount;
+	UINT sphereIndexOffset = gridIndexOffset + grid.IndexCount;
+	UINT cylinderIndexOffset = sphereIndexOffset + sphere.IndexCount;
 
 	// Define the SubmeshGeometry that cover different 
 	// regions of the vertex/index buffers.
 
 	SubmeshGeometry boxSubmesh;
-	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
+	boxSubmesh.IndexCount = box.IndexCount;
 	boxSubmesh.StartIndexLocation = boxIndexOffset;
 	boxSubmesh.BaseVertexLocation = boxVertexOffset;
 
 	SubmeshGeometry gridSubmesh;
-	gridSubmesh.IndexCount = (UINT)grid.Indices32.size();
+	gridSubmesh.IndexCount = grid.IndexCount;
 	gridSubmesh.StartIndexLocation = gridIndexOffset;
 	gridSubmesh.BaseVertexLocation = gridVertexOffset;
 
 	SubmeshGeometry sphereSubmesh;
-	sphereSubmesh.IndexCount = (UINT)sphere.Indices32.size();
+	sphereSubmesh.IndexCount = sphere.IndexCount;
 	sphereSubmesh.StartIndexLocation = sphereIndexOffset;
 	sphereSubmesh.BaseVertexLocation = sphereVertexOffset;
 
 	SubmeshGeometry cylinderSubmesh;
-	cylinderSubmesh.IndexCount = (UINT)cylinder.Indices32.size();
+	cylinderSubmesh.IndexCount = cylinder.IndexCount;
 	cylinderSubmesh.StartIndexLocation = cylinderIndexOffset;
 	cylinderSubmesh.BaseVertexLocation = cylinderVertexOffset;
 
 	//
-	// Extract the vertex elements we are interested in and pack the
-	// vertices of all the meshes into one vertex buffer.
+	// Generate every mesh straight into its region of the shared vertex/index
+	// arrays, keeping only the vertex elements we are interested in.
 	//
 
-	auto totalVertexCount =
-		box.Vertices.size() +
-		grid.Vertices.size() +
-		sphere.Vertices.size() +
-		cylinder.Vertices.size();
-
-	std::vector<Vertex> vertices(totalVertexCount);
-
-	UINT k = 0;
-	//￪ʼеColor滻Normal
-	for (size_t i = 0; i < box.Vertices.size(); ++i, ++k)
-	{
-		vertices[k].Pos = box.Vertices[i].Position;
-		//vertices[k].Color = XMFLOAT4(DirectX::Colors::DarkGreen);
-		vertices[k].Normal = box.Vertices[i].Normal;
-	}
-
-	for (size_t i = 0; i < grid.Vertices.size(); ++i, ++k)
-	{
-		vertices[k].Pos = grid.Vertices[i].Position;
-		//vertices[k].Color = XMFLOAT4(DirectX::Colors::ForestGreen);
-		vertices[k].Normal = grid.Vertices[i].Normal;
-	}
-
-	for (size_t i = 0; i < sphere.Vertices.size(); ++i, ++k)
-	{
-		vertices[k].Pos = sphere.Vertices[i].Position;
-		//vertices[k].Color = XMFLOAT4(DirectX::Colors::Crimson);
-		vertices[k].Normal = sphere.Vertices[i].Normal;
-	}
-
-	for (size_t i = 0; i < cylinder.Vertices.size(); ++i, ++k)
-	{
-		vertices[k].Pos = cylinder.Vertices[i].Position;
-		//vertices[k].Color = XMFLOAT4(DirectX::Colors::SteelBlue);
-		vertices[k].Normal = cylinder.Vertices[i].Normal;
-	}
-
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
-	indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
-	indices.insert(indices.end(), std::begin(sphere.GetIndices16()), std::end(sphere.GetIndices16()));
-	indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
+	std::vector<Vertex> vertices(cylinderVertexOffset + cylinder.VertexCount);
+	std::vector<std::uint16_t> indices(cylinderIndexOffset + cylinder.IndexCount);
+
+	geoGen.CreateBox<ShapeVertexLayout>(1.5f, 0.5f, 1.5f, 3,
+		&vertices[boxVertexOffset], &indices[boxIndexOffset]);
+	geoGen.CreateGrid<ShapeVertexLayout>(20.0f, 30.0f, 60, 40,
+		&vertices[gridVertexOffset], &indices[gridIndexOffset]);
+	geoGen.CreateSphere<ShapeVertexLayout>(0.5f, 20, 20,
+		&vertices[sphereVertexOffset], &indices[sphereIndexOffset]);
+	geoGen.CreateCylinder<ShapeVertexLayout>(0.5f, 0.3f, 3.0f, 20, 20,
+		&vertices[cylinderVertexOffset], &indices[cylinderIndexOffset]);
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
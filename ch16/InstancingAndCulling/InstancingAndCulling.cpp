@@ -5,6 +5,7 @@
 
 #include "../../QuizCommonHeader.h"
 #include "FrameResource.h"
+#include "../../d3d12book-master/Common/MeshSimplifier.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -48,6 +49,11 @@ struct RenderItem
 	BoundingBox Bounds;	//AABB
 	std::vector<InstanceData> Instances;
 
+	// LOD chain of the mesh, finest first; empty if it has a single level.  The
+	// visible instances are grouped by LOD each frame, LodInstanceCount per level.
+	std::vector<MeshSimplifier::Lod> Lods;
+	std::vector<UINT> LodInstanceCount;
+
     // DrawIndexedInstanced parameters.
     UINT IndexCount = 0;
 	//ch16. add InstanceCount
@@ -126,6 +132,9 @@ private:
 
 	//ch16. add InstanceCount
 	UINT mInstanceCount = 0;
+	std::vector<MeshSimplifier::Lod> mSkullLods;
+	// Visible instances of the frame, in instance buffer order.
+	std::vector<InstanceData> mStagedInstances;
 	//ch16. add CamFrustum and bool for whether enable culling
 	bool mFrustumCullingEnabled = true;
 	BoundingFrustum mCamFrustum;
@@ -389,11 +398,15 @@ void InstancingAndCulling::UpdateInstanceData(const GameTimer& gt)
 	for (auto& e : mAllRitems)
 	{
 		const auto& instanceData = e->Instances;
-		int visibleInstanceCount = 0;
+		UINT lodCount = (UINT)e->Lods.size();
+		float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&e->Bounds.Extents)));
+
+		// Visible instances and the LOD picked for each.
+		std::vector<std::pair<UINT, UINT>> visible;
+		e->LodInstanceCount.assign(lodCount, 0);
 		for (UINT i = 0; i < (UINT)instanceData.size(); ++i)
 		{
 			XMMATRIX world = XMLoadFloat4x4(&instanceData[i].World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&instanceData[i].TexTransform);
 
 			XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(world), world);
 
@@ -403,16 +416,44 @@ void InstancingAndCulling::UpdateInstanceData(const GameTimer& gt)
 
 			if (mFrustumCullingEnabled == false || localSpaceFrustum.Contains(e->Bounds) != DirectX::DISJOINT)
 			{
-				InstanceData data;
-				XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
-				XMStoreFloat4x4(&data.TexTransform, XMMatrixTranspose(texTransform));
-				data.MaterialIndex = instanceData[i].MaterialIndex;
-
-				currInstanceBuffer->CopyData(visibleInstanceCount++, data);
+				UINT lod = 0;
+				if (lodCount > 1)
+				{
+					XMVECTOR centerW = XMVector3TransformCoord(XMLoadFloat3(&e->Bounds.Center), world);
+					float scale = XMVectorGetX(XMVectorMax(XMVector3Length(world.r[0]),
+						XMVectorMax(XMVector3Length(world.r[1]), XMVector3Length(world.r[2]))));
+					float size = MeshSimplifier::ProjectedSize(mCamera, centerW, radius * scale);
+					lod = MeshSimplifier::SelectLod(e->Lods.data(), lodCount, size, radius, (float)mClientHeight);
+					e->LodInstanceCount[lod]++;
+				}
+
+				visible.push_back(std::make_pair(i, lod));
 			}
 		}
 
-		e->InstanceCount = visibleInstanceCount;
+		// Instances of the same LOD are stored together so each LOD is one draw.
+		std::vector<UINT> lodStart(lodCount + 1, 0);
+		for (UINT lod = 0; lod + 1 < lodCount; ++lod)
+			lodStart[lod + 1] = lodStart[lod] + e->LodInstanceCount[lod];
+
+		// The slots are filled out of order, so build them in system memory and upload
+		// them with one sequential copy.
+		mStagedInstances.resize(visible.size());
+		for (size_t k = 0; k < visible.size(); ++k)
+		{
+			const InstanceData& instance = instanceData[visible[k].first];
+			XMMATRIX world = XMLoadFloat4x4(&instance.World);
+			XMMATRIX texTransform = XMLoadFloat4x4(&instance.TexTransform);
+
+			UINT slot = lodCount > 1 ? lodStart[visible[k].second]++ : (UINT)k;
+			InstanceData& data = mStagedInstances[slot];
+			XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
+			XMStoreFloat4x4(&data.TexTransform, XMMatrixTranspose(texTransform));
+			data.MaterialIndex = instance.MaterialIndex;
+		}
+		currInstanceBuffer->CopyData(0, mStagedInstances.data(), (UINT)mStagedInstances.size());
+
+		e->InstanceCount = (UINT)visible.size();
 
 		std::wostringstream outs;
 		outs.precision(6);
@@ -782,6 +823,18 @@ void InstancingAndCulling::BuildSkullGeometry()
 
 	fin.close();
 
+	// The LODs share the vertex buffer; their index ranges follow LOD 0 in the index buffer.
+	MeshSimplifier::VertexFormat format;
+	format.Stride = sizeof(Vertex);
+	format.PositionOffset = offsetof(Vertex, Pos);
+	format.NormalOffset = offsetof(Vertex, Normal);
+	format.TexCOffset = offsetof(Vertex, TexC);
+
+	std::vector<std::int32_t> lodIndices;
+	MeshSimplifier::BuildLodChain(vertices.data(), 0, vcount, format, indices.data(), (UINT)indices.size(),
+		MeshSimplifier::Settings(), lodIndices, mSkullLods);
+	indices.swap(lodIndices);
+
 	//
 	// Pack the indices of all the meshes into one index buffer.
 	//
@@ -811,7 +864,7 @@ void InstancingAndCulling::BuildSkullGeometry()
 	geo->IndexBufferByteSize = ibByteSize;
 
 	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
+	submesh.IndexCount = mSkullLods[0].IndexCount;
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 	submesh.Bounds = bounds;
@@ -948,6 +1001,7 @@ void InstancingAndCulling::BuildRenderItems()
 	skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
 	skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
 	skullRitem->Bounds = skullRitem->Geo->DrawArgs["skull"].Bounds;
+	skullRitem->Lods = mSkullLods;
 
 	//Generate instance data
 	const int n = 5;
@@ -1005,6 +1059,26 @@ void InstancingAndCulling::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, c
 
         //D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
 		auto instanceBuffer = mCurrFrameResource->InstanceBuffer->Resource();
+
+		if (ri->Lods.size() > 1)
+		{
+			// SV_InstanceID restarts at 0 in every draw, so point the instance buffer at
+			// the first instance of each LOD instead of using StartInstanceLocation.
+			UINT firstInstance = 0;
+			for (size_t lod = 0; lod < ri->Lods.size(); ++lod)
+			{
+				UINT count = ri->LodInstanceCount[lod];
+				if (count == 0)
+					continue;
+
+				cmdList->SetGraphicsRootShaderResourceView(0, instanceBuffer->GetGPUVirtualAddress() + firstInstance * sizeof(InstanceData));
+				cmdList->DrawIndexedInstanced(ri->Lods[lod].IndexCount, count,
+					ri->StartIndexLocation + ri->Lods[lod].StartIndex, ri->BaseVertexLocation, 0);
+				firstInstance += count;
+			}
+			continue;
+		}
+
 		cmdList->SetGraphicsRootShaderResourceView(0, instanceBuffer->GetGPUVirtualAddress());
 
 		//现在InstanceCount不再是1了
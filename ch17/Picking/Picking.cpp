@@ -5,6 +5,8 @@
 
 #include "../../QuizCommonHeader.h"
 #include "FrameResource.h"
+#include "../../d3d12book-master/Common/MeshBvh.h"
+#include "../../d3d12book-master/Common/MeshletBuilder.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -31,6 +33,11 @@ struct RenderItem
     // and scale of the object in the world.
     XMFLOAT4X4 World = MathHelper::Identity4x4();
 
+	//ch17. World的逆矩阵和世界空间下的包围盒, 供射线检测使用.
+	//它们只在RayDataDirty为true时才重新计算, 因此修改World后必须同时设置RayDataDirty = true
+	XMFLOAT4X4 InvWorld = MathHelper::Identity4x4();
+	BoundingBox WorldBounds;
+	bool RayDataDirty = true;
 
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 
@@ -46,6 +53,14 @@ struct RenderItem
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 
+	//ch17. 该物体所用网格的BVH, 拾取时使用. 为空时不可被拾取
+	MeshBvh* Bvh = nullptr;
+
+	//ch17. 该物体所用网格的meshlet. 不为空时每帧按meshlet做视锥体和背面剔除,
+	//只绘制VisibleRanges中的索引范围(相对于StartIndexLocation)
+	const MeshletBuilder::MeshletData* Meshlets = nullptr;
+	std::vector<MeshletBuilder::IndexRange> VisibleRanges;
+
     // Primitive topology.
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -55,6 +70,14 @@ struct RenderItem
     int BaseVertexLocation = 0;
 };
 
+//ch17. 世界空间射线检测的结果
+struct RayHit
+{
+	RenderItem* Ritem = nullptr;
+	//TriangleIndex是相对于Ritem->StartIndexLocation的三角形序号, Distance是世界空间下的距离
+	MeshBvh::Hit Hit;
+};
+
 enum class RenderLayer : int
 {
 	Opaque = 0,
@@ -100,6 +123,11 @@ private:
     void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
 	//ch17, 添加Pick方法
 	void Pick(int sx, int sy);
+	//ch17. 场景级的射线检测, 射线始终在世界空间中, 返回所有物体中最近的交点
+	bool RayCast(FXMVECTOR rayOriginW, FXMVECTOR rayDirW, RayHit& result);
+	void UpdateRayQueryData();
+	//ch17. 每帧剔除各物体的meshlet
+	void UpdateVisibleMeshlets();
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
@@ -120,6 +148,9 @@ private:
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
+	//ch17. 每个submesh一棵BVH, 在加载几何体时构建一次
+	std::unordered_map<std::string, std::unique_ptr<MeshBvh>> mMeshBvhs;
+	std::unordered_map<std::string, std::unique_ptr<MeshletBuilder::MeshletData>> mMeshlets;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
  
@@ -136,6 +167,7 @@ private:
 
 	//ch15, 添加一个相机类
 	Camera mCamera;
+	BoundingFrustum mCamFrustum;
 
     POINT mLastMousePos;
 };
@@ -217,6 +249,8 @@ void Picking::OnResize()
     D3DApp::OnResize();
 
 	mCamera.SetLens(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
+
+	BoundingFrustum::CreateFromMatrix(mCamFrustum, mCamera.GetProj());
 }
 
 void Picking::Update(const GameTimer& gt)
@@ -239,6 +273,7 @@ void Picking::Update(const GameTimer& gt)
     }
 
 	AnimateMaterials(gt);
+	UpdateVisibleMeshlets();
 	UpdateObjectCBs(gt);
 	UpdateMaterialBuffer(gt);
 	UpdateMainPassCB(gt);
@@ -642,6 +677,14 @@ void Picking::BuildCarGeometry()
 
 	fin.close();
 
+	//ch17. 按meshlet重排索引, 每个meshlet的三角形在索引缓冲中是连续的. BVH也用重排后的索引构建
+	auto meshlets = std::make_unique<MeshletBuilder::MeshletData>();
+	std::vector<std::int32_t> clusterIndices;
+	MeshletBuilder::Build(&vertices[0].Pos, sizeof(Vertex), vcount, indices.data(), (UINT)indices.size(),
+		*meshlets, clusterIndices);
+	indices.swap(clusterIndices);
+	mMeshlets["car"] = std::move(meshlets);
+
 	//
 	// Pack the indices of all the meshes into one index buffer.
 	//
@@ -678,6 +721,12 @@ void Picking::BuildCarGeometry()
 
 	geo->DrawArgs["car"] = submesh;
 
+	//ch17. 为car构建BVH, 拾取时就不必再逐个三角形地遍历VertexBufferCPU/IndexBufferCPU了
+	auto bvh = std::make_unique<MeshBvh>();
+	bvh->Build(&vertices[0].Pos, sizeof(Vertex),
+		reinterpret_cast<const std::uint32_t*>(indices.data()), (UINT)indices.size());
+	mMeshBvhs["car"] = std::move(bvh);
+
 	mGeometries[geo->Name] = std::move(geo);
 
 }
@@ -781,6 +830,8 @@ void Picking::BuildRenderItems()
 	carRitem->IndexCount = carRitem->Geo->DrawArgs["car"].IndexCount;
 	carRitem->StartIndexLocation = carRitem->Geo->DrawArgs["car"].StartIndexLocation;
 	carRitem->BaseVertexLocation = carRitem->Geo->DrawArgs["car"].BaseVertexLocation;
+	carRitem->Bvh = mMeshBvhs["car"].get();
+	carRitem->Meshlets = mMeshlets["car"].get();
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(carRitem.get());
 
 	//ch17. 选中的物体
@@ -825,6 +876,15 @@ void Picking::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vec
         D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
 
 		cmdList->SetGraphicsRootConstantBufferView(0, objCBAddress);
+
+		//ch17. 有meshlet的物体只绘制剔除后剩下的索引范围
+		if (ri->Meshlets != nullptr)
+		{
+			for (const auto& range : ri->VisibleRanges)
+				cmdList->DrawIndexedInstanced(range.IndexCount, 1, ri->StartIndexLocation + range.StartIndex, ri->BaseVertexLocation, 0);
+			continue;
+		}
+
 		//现在InstanceCount不再是1了
         cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
     }
@@ -841,62 +901,119 @@ void Picking::Pick(int sx, int sy)
 	//定义观察空间中的向量
 	XMVECTOR rayOrigin = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
 	XMVECTOR rayDir = XMVectorSet(vx, vy, 1.0f, 0.0f);
-	//计算观察矩阵的逆矩阵
+	//计算观察矩阵的逆矩阵, 并将射线转换到世界空间. 射线不会再被逐个物体地原地修改了
 	XMMATRIX V = mCamera.GetView();
 	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(V), V);
+
+	XMVECTOR rayOriginW = XMVector3TransformCoord(rayOrigin, invView);
+	XMVECTOR rayDirW = XMVector3Normalize(XMVector3TransformNormal(rayDir, invView));
+
 	//先假定没有物体被选中
 	mPickedRitem->Visible = false;
-	//检测是否有被选中的物体
-	for (auto ri : mRitemLayer[(int)RenderLayer::Opaque])
+
+	RayHit hit;
+	if (RayCast(rayOriginW, rayDirW, hit))
 	{
-		auto geo = ri->Geo;
-		//跳过不可见的对象
-		if (ri->Visible == false) continue;
+		RenderItem* ri = hit.Ritem;
+
+		mPickedRitem->Visible = true;
+		mPickedRitem->IndexCount = 3;
+		mPickedRitem->BaseVertexLocation = ri->BaseVertexLocation;
+
+		mPickedRitem->World = ri->World;
+		mPickedRitem->NumFramesDirty = gNumFrameResources;
+		mPickedRitem->StartIndexLocation = ri->StartIndexLocation + 3 * hit.Hit.TriangleIndex;
+	}
+}
+
+//ch17. 仅为World改变过的物体重新计算逆矩阵和世界空间包围盒
+void Picking::UpdateRayQueryData()
+{
+	for (auto& ri : mAllRitems)
+	{
+		if (ri->RayDataDirty == false) continue;
 
-		//将拾取曲线转到局部空间
 		XMMATRIX W = XMLoadFloat4x4(&ri->World);
 		XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(W), W);
-		XMMATRIX toLocal = XMMatrixMultiply(invView, invWorld);
+		XMStoreFloat4x4(&ri->InvWorld, invWorld);
 
-		rayOrigin = XMVector3TransformCoord(rayOrigin, toLocal);
-		rayDir = XMVector3TransformNormal(rayDir, toLocal);
+		ri->Bounds.Transform(ri->WorldBounds, W);
 
-		rayDir = XMVector3Normalize(rayDir);
+		ri->RayDataDirty = false;
+	}
+}
 
-		//如果我们碰到了物体，则我们检索我们实际碰撞的面
-		float tmin = 0.0f;
-		if (ri->Bounds.Intersects(rayOrigin, rayDir, tmin))
+//ch17. 将视锥体和相机位置转到每个物体的局部空间, 剔除其meshlet
+void Picking::UpdateVisibleMeshlets()
+{
+	UpdateRayQueryData();
+
+	XMMATRIX view = mCamera.GetView();
+	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+
+	for (auto& ri : mAllRitems)
+	{
+		if (ri->Meshlets == nullptr) continue;
+
+		XMMATRIX invWorld = XMLoadFloat4x4(&ri->InvWorld);
+		BoundingFrustum localSpaceFrustum;
+		mCamFrustum.Transform(localSpaceFrustum, XMMatrixMultiply(invView, invWorld));
+
+		XMVECTOR eyeL = XMVector3TransformCoord(mCamera.GetPosition(), invWorld);
+		MeshletBuilder::Cull(*ri->Meshlets, localSpaceFrustum, eyeL, ri->VisibleRanges);
+	}
+}
+
+//ch17. 场景级射线检测
+//粗检测: 在世界空间中用射线与每个物体的包围盒求交, 并按进入包围盒的距离排序
+//细检测: 按顺序将射线用缓存的InvWorld转到局部空间, 再用BVH求最近的三角形. 一旦包围盒比当前最近交点还远即可停止
+bool Picking::RayCast(FXMVECTOR rayOriginW, FXMVECTOR rayDirW, RayHit& result)
+{
+	UpdateRayQueryData();
+
+	struct Candidate
+	{
+		RenderItem* Ritem;
+		float BoxDistance;
+	};
+	std::vector<Candidate> candidates;
+
+	for (auto ri : mRitemLayer[(int)RenderLayer::Opaque])
+	{
+		//跳过不可见或没有BVH的对象
+		if (ri->Visible == false || ri->Bvh == nullptr) continue;
+
+		float boxDistance = 0.0f;
+		if (ri->WorldBounds.Intersects(rayOriginW, rayDirW, boxDistance))
+			candidates.push_back({ ri, boxDistance });
+	}
+
+	std::sort(candidates.begin(), candidates.end(),
+		[](const Candidate& a, const Candidate& b) { return a.BoxDistance < b.BoxDistance; });
+
+	bool found = false;
+	float closest = MathHelper::Infinity;
+	for (auto& c : candidates)
+	{
+		if (c.BoxDistance > closest) break;
+
+		//方向不做归一化, 这样局部空间中的t与世界空间中的距离相同, 不同物体的交点可以直接比较
+		XMMATRIX invWorld = XMLoadFloat4x4(&c.Ritem->InvWorld);
+		XMVECTOR rayOriginL = XMVector3TransformCoord(rayOriginW, invWorld);
+		XMVECTOR rayDirL = XMVector3TransformNormal(rayDirW, invWorld);
+
+		MeshBvh::Hit hit;
+		if (c.Ritem->Bvh->IntersectClosest(rayOriginL, rayDirL, hit, closest))
 		{
-			auto vertices = (Vertex*)geo->VertexBufferCPU->GetBufferPointer();
-			auto indices = (std::uint32_t*)geo->IndexBufferCPU->GetBufferPointer();
-			UINT triCount = ri->IndexCount / 3;
-
-			tmin = MathHelper::Infinity;
-			for (UINT i = 0; i < triCount; ++i)
-			{
-				UINT i0 = indices[i * 3 + 0], i1 = indices[i * 3 + 1], i2 = indices[i * 3 + 2];
-				XMVECTOR v0 = XMLoadFloat3(&vertices[i0].Pos), v1 = XMLoadFloat3(&vertices[i1].Pos), v2 = XMLoadFloat3(&vertices[i2].Pos);
-
-				float t = 0.0f;
-				if (TriangleTests::Intersects(rayOrigin, rayDir, v0, v1, v2, t))
-				{
-					if (t < tmin)
-					{
-						tmin = t;
-						UINT pickedTriangle = i;
-
-						mPickedRitem->Visible = true;
-						mPickedRitem->IndexCount = 3;
-						mPickedRitem->BaseVertexLocation = 0;
-
-						mPickedRitem->World = ri->World;
-						mPickedRitem->NumFramesDirty = gNumFrameResources;
-						mPickedRitem->StartIndexLocation = 3 * pickedTriangle;
-					}
-				}
-			}
+			closest = hit.Distance;
+			found = true;
+
+			result.Ritem = c.Ritem;
+			result.Hit = hit;
 		}
 	}
+
+	return found;
 }
 
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> Picking::GetStaticSamplers()
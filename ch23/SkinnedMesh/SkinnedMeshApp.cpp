@@ -5,6 +5,7 @@
 #include "../../d3d12book-master/Common/UploadBuffer.h"
 #include "../../d3d12book-master/Common/GeometryGenerator.h"
 #include "../../d3d12book-master/Common/Camera.h"
+#include "../../d3d12book-master/Common/MeshOptimizer.h"
 #include "FrameResource.h"
 #include "ShadowMap.h"
 #include "Ssao.h"
@@ -1103,6 +1104,14 @@ void SkinnedMeshApp::LoadSkinnedModel()
 	M3DLoader m3dLoader;
 	m3dLoader.LoadM3d(mSkinnedModelFilename, vertices, indices, mSkinnedSubsets, mSkinnedMats, mSkinnedInfo);	//让M3D加载类加载对应的蒙皮, 并将submesh, mat, skinnedInfo保存在指定的位置
 
+	// Reorder each subset for the vertex cache, overdraw and vertex fetch.  Subsets keep
+	// their face and vertex ranges, so the submeshes below are unchanged.
+	for(const auto& subset : mSkinnedSubsets)
+	{
+		MeshOptimizer::OptimizeSubmesh(vertices.data(), subset.VertexStart, subset.VertexCount,
+			&indices[subset.FaceStart*3], subset.FaceCount*3, &M3DLoader::SkinnedVertex::Pos);
+	}
+
 	mSkinnedModelInst = std::make_unique<SkinnedModelInstance>();	//创建我们的实际的蒙皮模型的实例
 	mSkinnedModelInst->SkinnedInfo = &mSkinnedInfo;	//其蒙皮信息为mSkinnedInfo
 	mSkinnedModelInst->TimePos = 0.0f;	//其默认时间戳为0
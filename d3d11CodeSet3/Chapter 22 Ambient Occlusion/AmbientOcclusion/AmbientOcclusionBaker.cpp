@@ -0,0 +1,258 @@
+//***************************************************************************************
+// AmbientOcclusionBaker.cpp
+//***************************************************************************************
+
+#include "AmbientOcclusionBaker.h"
+#include "Octree.h"
+#include <atomic>
+#include <thread>
+
+namespace
+{
+	// Bump when the baking method changes so old cache files are rebuilt.
+	const UINT BakerVersion = 1;
+
+	const UINT CacheMagic = 0x4f414b42; // "BKAO"
+
+	// Triangles handed to a worker at a time.
+	const UINT TrianglesPerTask = 256;
+
+	// Integer hash (lowbias32); with a counter as input it serves as a stateless RNG,
+	// so any thread can produce the random numbers of any triangle.
+	UINT HashUInt(UINT x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352d;
+		x ^= x >> 15;
+		x *= 0x846ca68b;
+		x ^= x >> 16;
+		return x;
+	}
+
+	// Uniform float in [0, 1) from the top 24 bits.
+	float UnitFloat(UINT x)
+	{
+		return (x >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// Van der Corput sequence in base 2.
+	float RadicalInverse(UINT i)
+	{
+		i = (i << 16) | (i >> 16);
+		i = ((i & 0x00ff00ff) << 8) | ((i & 0xff00ff00) >> 8);
+		i = ((i & 0x0f0f0f0f) << 4) | ((i & 0xf0f0f0f0) >> 4);
+		i = ((i & 0x33333333) << 2) | ((i & 0xcccccccc) >> 2);
+		i = ((i & 0x55555555) << 1) | ((i & 0xaaaaaaaa) >> 1);
+		return UnitFloat(i);
+	}
+
+	float Wrap01(float x)
+	{
+		return x >= 1.0f ? x - 1.0f : x;
+	}
+
+	void HashBytes(UINT64& hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for(size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	// Ambient access of one triangle, or a negative value for a degenerate triangle.
+	float TriangleAmbientAccess(const Octree& octree, const std::vector<XMFLOAT3>& positions,
+		const std::vector<UINT>& indices, UINT tri, const AmbientOcclusionBaker::Settings& settings)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&positions[indices[tri*3+0]]);
+		XMVECTOR v1 = XMLoadFloat3(&positions[indices[tri*3+1]]);
+		XMVECTOR v2 = XMLoadFloat3(&positions[indices[tri*3+2]]);
+
+		XMVECTOR cross = XMVector3Cross(v1 - v0, v2 - v0);
+		if(XMVectorGetX(XMVector3LengthSq(cross)) <= 0.0f)
+			return -1.0f;
+
+		XMVECTOR normal = XMVector3Normalize(cross);
+
+		// Offset to avoid self intersection.
+		XMVECTOR centroid = (v0 + v1 + v2)/3.0f + settings.SurfaceOffset*normal;
+
+		// Orthonormal basis around the normal (Duff et al. 2017).
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, normal);
+		float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+		float a = -1.0f / (sign + n.z);
+		float b = n.x*n.y*a;
+		XMVECTOR tangent   = XMVectorSet(1.0f + sign*n.x*n.x*a, sign*b, -sign*n.x, 0.0f);
+		XMVECTOR bitangent = XMVectorSet(b, sign + n.y*n.y*a, -n.y, 0.0f);
+
+		// Cranley-Patterson rotation of the Hammersley set, different for each triangle.
+		UINT counter = HashUInt(settings.Seed) + 2*tri;
+		float offsetU = UnitFloat(HashUInt(counter + 0));
+		float offsetV = UnitFloat(HashUInt(counter + 1));
+
+		UINT numUnoccluded = 0;
+		for(UINT j = 0; j < settings.SampleCount; ++j)
+		{
+			// Uniform over the hemisphere, as MathHelper::RandHemisphereUnitVec3.
+			float cosTheta = Wrap01((j + 0.5f) / settings.SampleCount + offsetU);
+			float sinTheta = sqrtf(MathHelper::Max(0.0f, 1.0f - cosTheta*cosTheta));
+			float phi = 2.0f*MathHelper::Pi*Wrap01(RadicalInverse(j) + offsetV);
+
+			XMVECTOR dir = (sinTheta*cosf(phi))*tangent + (sinTheta*sinf(phi))*bitangent + cosTheta*normal;
+
+			if( !octree.RayOctreeIntersect(centroid, dir, settings.MaxDistance) )
+				numUnoccluded++;
+		}
+
+		return (float)numUnoccluded / settings.SampleCount;
+	}
+}
+
+AmbientOcclusionBaker::Settings::Settings()
+	: SampleCount(32),
+	  MaxDistance(MathHelper::Infinity),
+	  SurfaceOffset(0.001f),
+	  Seed(0),
+	  ThreadCount(0)
+{
+}
+
+void AmbientOcclusionBaker::Bake(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices,
+	const Settings& settings, std::vector<float>& ambientAccess)
+{
+	UINT vcount = (UINT)positions.size();
+	UINT tcount = (UINT)(indices.size() / 3);
+
+	Octree octree;
+	octree.Build(positions, indices);
+
+	// Each task owns a range of triangles and writes only their entries, so the workers
+	// need no locking and the result is the same for any thread count.
+	std::vector<float> triangleAccess(tcount);
+	std::atomic<UINT> nextTask(0);
+	UINT taskCount = (tcount + TrianglesPerTask - 1) / TrianglesPerTask;
+
+	auto worker = [&]()
+	{
+		for(UINT task = nextTask++; task < taskCount; task = nextTask++)
+		{
+			UINT end = MathHelper::Min(tcount, (task + 1)*TrianglesPerTask);
+			for(UINT i = task*TrianglesPerTask; i < end; ++i)
+				triangleAccess[i] = TriangleAmbientAccess(octree, positions, indices, i, settings);
+		}
+	};
+
+	UINT threadCount = settings.ThreadCount;
+	if(threadCount == 0)
+		threadCount = MathHelper::Max(1u, std::thread::hardware_concurrency());
+	threadCount = MathHelper::Min(threadCount, MathHelper::Max(1u, taskCount));
+
+	std::vector<std::thread> threads;
+	for(UINT i = 1; i < threadCount; ++i)
+		threads.push_back(std::thread(worker));
+	worker();
+	for(size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+
+	// Average with vertices that share this face.
+	std::vector<float> sum(vcount, 0.0f);
+	std::vector<UINT> vertexSharedCount(vcount, 0);
+	for(UINT i = 0; i < tcount; ++i)
+	{
+		if(triangleAccess[i] < 0.0f)
+			continue;
+
+		for(UINT k = 0; k < 3; ++k)
+		{
+			sum[indices[i*3+k]] += triangleAccess[i];
+			vertexSharedCount[indices[i*3+k]]++;
+		}
+	}
+
+	ambientAccess.resize(vcount);
+	for(UINT i = 0; i < vcount; ++i)
+		ambientAccess[i] = vertexSharedCount[i] > 0 ? sum[i] / vertexSharedCount[i] : 1.0f;
+}
+
+bool AmbientOcclusionBaker::BakeCached(const std::string& cacheFile,
+	const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices,
+	const Settings& settings, std::vector<float>& ambientAccess)
+{
+	UINT64 key = HashMesh(positions, indices, settings);
+
+	if(LoadCache(cacheFile, key, (UINT)positions.size(), ambientAccess))
+		return true;
+
+	Bake(positions, indices, settings, ambientAccess);
+	SaveCache(cacheFile, key, ambientAccess);
+	return false;
+}
+
+UINT64 AmbientOcclusionBaker::HashMesh(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices,
+	const Settings& settings)
+{
+	UINT64 hash = 14695981039346656037ULL;
+
+	UINT vcount = (UINT)positions.size();
+	UINT icount = (UINT)indices.size();
+	HashBytes(hash, &BakerVersion, sizeof(BakerVersion));
+	HashBytes(hash, &vcount, sizeof(vcount));
+	HashBytes(hash, &icount, sizeof(icount));
+	if(vcount > 0)
+		HashBytes(hash, &positions[0], vcount*sizeof(XMFLOAT3));
+	if(icount > 0)
+		HashBytes(hash, &indices[0], icount*sizeof(UINT));
+
+	HashBytes(hash, &settings.SampleCount, sizeof(settings.SampleCount));
+	HashBytes(hash, &settings.MaxDistance, sizeof(settings.MaxDistance));
+	HashBytes(hash, &settings.SurfaceOffset, sizeof(settings.SurfaceOffset));
+	HashBytes(hash, &settings.Seed, sizeof(settings.Seed));
+
+	return hash;
+}
+
+bool AmbientOcclusionBaker::LoadCache(const std::string& cacheFile, UINT64 key, UINT vertexCount,
+	std::vector<float>& ambientAccess)
+{
+	std::ifstream fin(cacheFile.c_str(), std::ios::binary);
+	if(!fin)
+		return false;
+
+	UINT magic = 0;
+	UINT64 fileKey = 0;
+	UINT fileVertexCount = 0;
+	fin.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	fin.read(reinterpret_cast<char*>(&fileKey), sizeof(fileKey));
+	fin.read(reinterpret_cast<char*>(&fileVertexCount), sizeof(fileVertexCount));
+
+	if(!fin || magic != CacheMagic || fileKey != key || fileVertexCount != vertexCount)
+		return false;
+
+	std::vector<float> data(vertexCount);
+	if(vertexCount > 0)
+		fin.read(reinterpret_cast<char*>(&data[0]), vertexCount*sizeof(float));
+
+	if(!fin)
+		return false;
+
+	ambientAccess.swap(data);
+	return true;
+}
+
+void AmbientOcclusionBaker::SaveCache(const std::string& cacheFile, UINT64 key,
+	const std::vector<float>& ambientAccess)
+{
+	// A cache that cannot be written just means we bake again next time.
+	std::ofstream fout(cacheFile.c_str(), std::ios::binary | std::ios::trunc);
+	if(!fout)
+		return;
+
+	UINT vertexCount = (UINT)ambientAccess.size();
+	fout.write(reinterpret_cast<const char*>(&CacheMagic), sizeof(CacheMagic));
+	fout.write(reinterpret_cast<const char*>(&key), sizeof(key));
+	fout.write(reinterpret_cast<const char*>(&vertexCount), sizeof(vertexCount));
+	if(vertexCount > 0)
+		fout.write(reinterpret_cast<const char*>(&ambientAccess[0]), vertexCount*sizeof(float));
+}
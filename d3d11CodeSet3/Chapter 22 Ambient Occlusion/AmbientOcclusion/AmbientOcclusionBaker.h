@@ -0,0 +1,75 @@
+//***************************************************************************************
+// AmbientOcclusionBaker.h
+//
+// Precomputes per-vertex ambient occlusion by ray casting against an Octree.
+//
+// Every triangle casts SampleCount rays over the hemisphere around its normal from a
+// point just above its centroid.  The directions are a Hammersley point set rotated
+// by a per-triangle offset taken from a counter-based hash of (Seed, triangle), so the
+// result does not depend on how the triangles are spread over the worker threads and
+// is the same on every run.  The per-triangle results are averaged into the vertices
+// on the calling thread, in triangle order.
+//
+// BakeCached stores the result in a small binary file keyed by a hash of the mesh and
+// the settings, so the bake only runs again when either changes.
+//***************************************************************************************
+
+#ifndef AMBIENT_OCCLUSION_BAKER_H
+#define AMBIENT_OCCLUSION_BAKER_H
+
+#include "d3dUtil.h"
+
+class AmbientOcclusionBaker
+{
+public:
+	struct Settings
+	{
+		Settings();
+
+		// Rays cast per triangle.
+		UINT SampleCount;
+
+		// Hits farther than this from the surface do not count as occluding.
+		float MaxDistance;
+
+		// Distance the ray origin is pushed along the face normal to avoid
+		// self intersection.
+		float SurfaceOffset;
+
+		// Changing the seed gives a different (but again reproducible) sample pattern.
+		UINT Seed;
+
+		// Worker threads; 0 uses one per hardware thread.
+		UINT ThreadCount;
+	};
+
+	///<summary>
+	/// Computes the ambient access (1 = fully open, 0 = fully occluded) of every vertex.
+	/// Vertices not used by any triangle get 1.
+	///</summary>
+	static void Bake(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices,
+		const Settings& settings, std::vector<float>& ambientAccess);
+
+	///<summary>
+	/// Loads the ambient access from cacheFile if it was baked from the same mesh with the
+	/// same settings; otherwise bakes it and writes cacheFile.  Returns true on a cache hit.
+	///</summary>
+	static bool BakeCached(const std::string& cacheFile,
+		const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices,
+		const Settings& settings, std::vector<float>& ambientAccess);
+
+	///<summary>
+	/// 64-bit FNV-1a hash of the positions, indices and the settings that affect the
+	/// result.  ThreadCount is left out since it does not change the output.
+	///</summary>
+	static UINT64 HashMesh(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices,
+		const Settings& settings);
+
+private:
+	static bool LoadCache(const std::string& cacheFile, UINT64 key, UINT vertexCount,
+		std::vector<float>& ambientAccess);
+	static void SaveCache(const std::string& cacheFile, UINT64 key,
+		const std::vector<float>& ambientAccess);
+};
+
+#endif // AMBIENT_OCCLUSION_BAKER_H
@@ -17,7 +17,10 @@
 #include "Effects.h"
 #include "Vertex.h"
 #include "Camera.h"
+#include "AmbientOcclusionBaker.h"
 #include "Octree.h"
+#include <chrono>
+#include <cstdio>
 
 class AmbientOcclusionApp : public D3DApp 
 {
@@ -55,6 +58,230 @@ private:
 	POINT mLastMousePos;
 };
 
+// Reads the positions and indices of Models/skull.txt.  Returns false if the file is
+// missing.
+static bool LoadSkullTriangles(std::vector<XMFLOAT3>& positions, std::vector<UINT>& indices)
+{
+	std::ifstream fin("Models/skull.txt");
+	if(!fin)
+		return false;
+
+	UINT vcount = 0;
+	UINT tcount = 0;
+	std::string ignore;
+
+	fin >> ignore >> vcount;
+	fin >> ignore >> tcount;
+	fin >> ignore >> ignore >> ignore >> ignore;
+
+	positions.resize(vcount);
+	for(UINT i = 0; i < vcount; ++i)
+	{
+		XMFLOAT3 normal;
+		fin >> positions[i].x >> positions[i].y >> positions[i].z;
+		fin >> normal.x >> normal.y >> normal.z;
+	}
+
+	fin >> ignore;
+	fin >> ignore;
+	fin >> ignore;
+
+	indices.resize(3*tcount);
+	for(UINT i = 0; i < 3*tcount; ++i)
+		fin >> indices[i];
+
+	return !fin.fail();
+}
+
+// Returns the path of fileName in the demo's per-user cache directory,
+// %LOCALAPPDATA%\AmbientOcclusionDemo, creating the directory if needed.  Falls back to
+// the working directory if LOCALAPPDATA is not set.
+static std::string GetCacheFilePath(const std::string& fileName)
+{
+	char localAppData[MAX_PATH];
+	DWORD length = GetEnvironmentVariableA("LOCALAPPDATA", localAppData, MAX_PATH);
+	if(length == 0 || length >= MAX_PATH)
+		return fileName;
+
+	std::string dir = std::string(localAppData) + "\\AmbientOcclusionDemo";
+	CreateDirectoryA(dir.c_str(), 0);
+	return dir + "\\" + fileName;
+}
+
+// The demo is a windowed app, so the benchmark writes to the console it was started
+// from, or to a new one.
+static void OpenBenchmarkConsole()
+{
+	if(!AttachConsole(ATTACH_PARENT_PROCESS))
+		AllocConsole();
+
+	FILE* stream = 0;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+}
+
+// Builds the octree of skull.txt and traces AO style rays through it: rays leave a
+// random triangle just above its centroid, into the hemisphere around its normal.
+// A sample of the rays is checked against XNA::IntersectRayTriangle on every triangle,
+// then the build and the any-hit and closest-hit queries are timed on one thread.
+// Prints the results and returns false if the octree disagrees with the brute force.
+// Runs without a window or device.
+static bool RunOctreeBenchmark()
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<UINT> indices;
+	if(!LoadSkullTriangles(positions, indices))
+	{
+		printf("Models/skull.txt not found\n");
+		return false;
+	}
+
+	const UINT triCount = (UINT)(indices.size() / 3);
+	const UINT buildCount = 5;
+	const UINT rayCount = 200000;
+	const UINT checkedRayCount = 1000;
+	const float maxDistance = 3.0f;
+
+	Octree octree;
+	auto start = std::chrono::steady_clock::now();
+	for(UINT i = 0; i < buildCount; ++i)
+		octree.Build(positions, indices);
+	std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+
+	std::vector<XMFLOAT3> origins;
+	std::vector<XMFLOAT3> dirs;
+	origins.reserve(rayCount);
+	dirs.reserve(rayCount);
+	while(origins.size() < rayCount)
+	{
+		UINT tri = (UINT)(MathHelper::RandF()*triCount) % triCount;
+		XMVECTOR v0 = XMLoadFloat3(&positions[indices[tri*3+0]]);
+		XMVECTOR v1 = XMLoadFloat3(&positions[indices[tri*3+1]]);
+		XMVECTOR v2 = XMLoadFloat3(&positions[indices[tri*3+2]]);
+
+		XMVECTOR cross = XMVector3Cross(v1 - v0, v2 - v0);
+		if(XMVectorGetX(XMVector3LengthSq(cross)) <= 0.0f)
+			continue;
+
+		XMVECTOR normal = XMVector3Normalize(cross);
+
+		XMFLOAT3 origin, dir;
+		XMStoreFloat3(&origin, (v0 + v1 + v2)/3.0f + 0.001f*normal);
+		XMStoreFloat3(&dir, MathHelper::RandHemisphereUnitVec3(normal));
+		origins.push_back(origin);
+		dirs.push_back(dir);
+	}
+
+	//
+	// Agreement with the brute force.  The octree's SIMD leaf test and the scalar test
+	// round differently, so hits within a rounding error of maxDistance are not counted.
+	//
+
+	UINT anyMismatches = 0;
+	UINT closestMismatches = 0;
+	for(UINT i = 0; i < checkedRayCount; ++i)
+	{
+		XMVECTOR origin = XMLoadFloat3(&origins[i]);
+		XMVECTOR dir = XMLoadFloat3(&dirs[i]);
+
+		float nearest = MathHelper::Infinity;
+		for(UINT tri = 0; tri < triCount; ++tri)
+		{
+			XMVECTOR v0 = XMLoadFloat3(&positions[indices[tri*3+0]]);
+			XMVECTOR v1 = XMLoadFloat3(&positions[indices[tri*3+1]]);
+			XMVECTOR v2 = XMLoadFloat3(&positions[indices[tri*3+2]]);
+
+			float dist = 0.0f;
+			if(XNA::IntersectRayTriangle(origin, dir, v0, v1, v2, &dist) && dist > 0.0f)
+				nearest = MathHelper::Min(nearest, dist);
+		}
+
+		bool occluded = octree.RayOctreeIntersect(origin, dir, maxDistance);
+		if(fabsf(nearest - maxDistance) > 1.0e-4f*maxDistance && occluded != (nearest < maxDistance))
+			anyMismatches++;
+
+		float dist = 0.0f;
+		bool hit = octree.RayOctreeIntersectClosest(origin, dir, &dist);
+		if(hit != (nearest != MathHelper::Infinity) ||
+			(hit && fabsf(dist - nearest) > 1.0e-4f*MathHelper::Max(1.0f, nearest)))
+		{
+			closestMismatches++;
+		}
+	}
+
+	//
+	// Timing.
+	//
+
+	UINT occludedCount = 0;
+	start = std::chrono::steady_clock::now();
+	for(UINT i = 0; i < rayCount; ++i)
+	{
+		if(octree.RayOctreeIntersect(XMLoadFloat3(&origins[i]), XMLoadFloat3(&dirs[i]), maxDistance))
+			occludedCount++;
+	}
+	std::chrono::duration<double> anyTime = std::chrono::steady_clock::now() - start;
+
+	UINT hitCount = 0;
+	start = std::chrono::steady_clock::now();
+	for(UINT i = 0; i < rayCount; ++i)
+	{
+		float dist = 0.0f;
+		if(octree.RayOctreeIntersectClosest(XMLoadFloat3(&origins[i]), XMLoadFloat3(&dirs[i]), &dist))
+			hitCount++;
+	}
+	std::chrono::duration<double> closestTime = std::chrono::steady_clock::now() - start;
+
+	printf("Octree, skull.txt, %u triangles\n", triCount);
+	printf("    build:        %.3f ms, %u nodes, %u triangle references\n",
+		buildTime.count() / buildCount, octree.NodeCount(), octree.TriangleRefCount());
+	printf("    any hit:      %.3f Mrays/s, %u of %u occluded within %g\n",
+		rayCount / anyTime.count() / 1.0e6, occludedCount, rayCount, maxDistance);
+	printf("    closest hit:  %.3f Mrays/s, %u hit\n",
+		rayCount / closestTime.count() / 1.0e6, hitCount);
+	printf("    brute force check of %u rays: %u any-hit and %u closest-hit mismatches\n",
+		checkedRayCount, anyMismatches, closestMismatches);
+
+	return anyMismatches == 0 && closestMismatches == 0;
+}
+
+// Times a whole bake of skull.txt with the demo's settings on all hardware threads and
+// checks that a single threaded bake gives the same result bit for bit.  Prints the
+// results and returns false if the two bakes differ.
+static bool RunBakeBenchmark()
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<UINT> indices;
+	if(!LoadSkullTriangles(positions, indices))
+	{
+		printf("Models/skull.txt not found\n");
+		return false;
+	}
+
+	AmbientOcclusionBaker::Settings settings;
+	settings.SampleCount = 64;
+	settings.MaxDistance = 3.0f;
+
+	std::vector<float> ambientAccess;
+	auto start = std::chrono::steady_clock::now();
+	AmbientOcclusionBaker::Bake(positions, indices, settings, ambientAccess);
+	std::chrono::duration<double, std::milli> bakeTime = std::chrono::steady_clock::now() - start;
+
+	std::vector<float> singleThreaded;
+	settings.ThreadCount = 1;
+	start = std::chrono::steady_clock::now();
+	AmbientOcclusionBaker::Bake(positions, indices, settings, singleThreaded);
+	std::chrono::duration<double, std::milli> singleTime = std::chrono::steady_clock::now() - start;
+
+	bool same = ambientAccess == singleThreaded;
+
+	printf("Bake, %u rays per triangle\n", settings.SampleCount);
+	printf("    all threads:  %.1f ms\n", bakeTime.count());
+	printf("    one thread:   %.1f ms, %s\n", singleTime.count(),
+		same ? "same result" : "DIFFERENT result");
+
+	return same;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 				   PSTR cmdLine, int showCmd)
 {
@@ -63,6 +290,16 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
 #endif
 
+	// -benchmark checks and times the octree and the baker instead of starting the
+	// demo.  The exit code is 1 if a check fails.
+	if(strstr(cmdLine, "-benchmark") != 0)
+	{
+		OpenBenchmarkConsole();
+		bool octreeOk = RunOctreeBenchmark();
+		bool bakeOk = RunBakeBenchmark();
+		return octreeOk && bakeOk ? 0 : 1;
+	}
+
 	AmbientOcclusionApp theApp(hInstance);
 	
 	if( !theApp.Init() )
@@ -215,67 +452,25 @@ void AmbientOcclusionApp::BuildVertexAmbientOcclusion(
 	const std::vector<UINT>& indices)
 {
 	UINT vcount = vertices.size();
-	UINT tcount = indices.size()/3;
 
 	std::vector<XMFLOAT3> positions(vcount);
 	for(UINT i = 0; i < vcount; ++i)
 		positions[i] = vertices[i].Pos;
 
-	Octree octree;
-	octree.Build(positions, indices);
+	// Only occluders within a few units of the surface (the skull is about 7 units
+	// tall) darken it; a wall on the far side of the head should not.
+	AmbientOcclusionBaker::Settings settings;
+	settings.SampleCount = 64;
+	settings.MaxDistance = 3.0f;
 
-	// For each vertex, count how many triangles contain the vertex.
-	std::vector<int> vertexSharedCount(vcount);
-	for(UINT i = 0; i < tcount; ++i)
-	{
-		UINT i0 = indices[i*3+0];
-		UINT i1 = indices[i*3+1];
-		UINT i2 = indices[i*3+2];
-
-		XMVECTOR v0 = XMLoadFloat3(&vertices[i0].Pos);
-		XMVECTOR v1 = XMLoadFloat3(&vertices[i1].Pos);
-		XMVECTOR v2 = XMLoadFloat3(&vertices[i2].Pos);
-
-		XMVECTOR edge0 = v1 - v0;
-		XMVECTOR edge1 = v2 - v0;
-
-		XMVECTOR normal = XMVector3Normalize(XMVector3Cross(edge0, edge1));
-
-		XMVECTOR centroid = (v0 + v1 + v2)/3.0f;
-
-		// Offset to avoid self intersection.
-		centroid += 0.001f*normal;
-
-		const int NumSampleRays = 32;
-		float numUnoccluded = 0;
-		for(int j = 0; j < NumSampleRays; ++j)
-		{
-			XMVECTOR randomDir = MathHelper::RandHemisphereUnitVec3(normal);
-
-			// TODO: Technically we should not count intersections that are far 
-			// away as occluding the triangle, but this is OK for demo.
-			if( !octree.RayOctreeIntersect(centroid, randomDir) )
-			{
-				numUnoccluded++;
-			}
-		}
-		
-		float ambientAccess = numUnoccluded / NumSampleRays;
-
-		// Average with vertices that share this face.
-		vertices[i0].AmbientAccess += ambientAccess;
-		vertices[i1].AmbientAccess += ambientAccess;
-		vertices[i2].AmbientAccess += ambientAccess;
-
-		vertexSharedCount[i0]++;
-		vertexSharedCount[i1]++;
-		vertexSharedCount[i2]++;
-	}
+	// Baking only runs when the cache is missing or was made from a different mesh or
+	// different settings.
+	std::vector<float> ambientAccess;
+	AmbientOcclusionBaker::BakeCached(GetCacheFilePath("skull.ao"), positions, indices, settings, ambientAccess);
 
-	// Finish average by dividing by the number of samples we added.
 	for(UINT i = 0; i < vcount; ++i)
 	{
-		vertices[i].AmbientAccess /= vertexSharedCount[i];
+		vertices[i].AmbientAccess = ambientAccess[i];
 	}
 }
 
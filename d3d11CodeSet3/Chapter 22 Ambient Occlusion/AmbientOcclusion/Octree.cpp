@@ -3,147 +3,494 @@
 //***************************************************************************************
 
 #include "Octree.h"
+#include <future>
 
+namespace
+{
+	// Nodes with this many triangles or fewer are not split.
+	const UINT MaxLeafTriangles = 16;
+
+	// The root is at depth 0; nodes at MaxDepth are always leaves.
+	const UINT MaxDepth = 10;
+
+	// A split is rejected when the triangles straddling the octant planes would make the
+	// children reference more than this many times the triangles of the parent.
+	const float MaxRefGrowth = 2.0f;
+
+	// Meshes with fewer triangles are built on the calling thread.
+	const UINT ParallelBuildThreshold = 4096;
+
+	// Every interior node pops one entry and pushes at most 8.
+	const UINT MaxStackSize = 7*MaxDepth + 1;
+
+	// Octant i covers the upper half of the x/y/z axis when bit 0/1/2 of i is set.  For
+	// a ray going in the +x+y+z direction, visiting the octants by increasing number of
+	// set bits visits every octant after the ones in front of it; XOR with the direction
+	// sign mask gives the same order for the other seven directions.
+	const UINT NearToFarOrder[8] = { 0, 1, 2, 4, 3, 5, 6, 7 };
+
+	UINT DirectionMask(const XMFLOAT3& d)
+	{
+		return (d.x < 0.0f ? 1 : 0) | (d.y < 0.0f ? 2 : 0) | (d.z < 0.0f ? 4 : 0);
+	}
+
+	// Children are stored compactly, so the child of an octant is found by counting the
+	// octants below it that are present.
+	UINT ChildOffset(UINT childMask, UINT octant)
+	{
+		UINT bits = childMask & ((1u << octant) - 1);
+
+		UINT count = 0;
+		for(; bits != 0; bits &= bits - 1)
+			++count;
+
+		return count;
+	}
+}
 
 Octree::Octree()
-	: mRoot(0)
+	: mTriangleRefCount(0)
 {
 }
 
 Octree::~Octree()
 {
-	SafeDelete(mRoot);
 }
 
 void Octree::Build(const std::vector<XMFLOAT3>& vertices, const std::vector<UINT>& indices)
 {
-	// Cache a copy of the vertices.
-	mVertices = vertices;
-
-	// Build AABB to contain the scene mesh.
-	XNA::AxisAlignedBox sceneBounds = BuildAABB();
-	
-	// Allocate the root node and set its AABB to contain the scene mesh.
-	mRoot = new OctreeNode();
-	mRoot->Bounds = sceneBounds;
+	mNodes.clear();
+	mBlocks.clear();
+	mTriangleRefCount = 0;
 
-	BuildOctree(mRoot, indices);
-}
+	UINT triCount = (UINT)(indices.size() / 3);
+	if(triCount == 0)
+		return;
 
-bool Octree::RayOctreeIntersect(FXMVECTOR rayPos, FXMVECTOR rayDir)
-{
-	return RayOctreeIntersect(mRoot, rayPos, rayDir);
-}
+	// Gather the triangles and their bounds once; the build only works with triangle
+	// IDs after this.
+	mBuildTris.resize(triCount);
 
-XNA::AxisAlignedBox Octree::BuildAABB()
-{
 	XMVECTOR vmin = XMVectorReplicate(+MathHelper::Infinity);
 	XMVECTOR vmax = XMVectorReplicate(-MathHelper::Infinity);
-	for(size_t i = 0; i < mVertices.size(); ++i)
+	std::vector<UINT> tris(triCount);
+	for(UINT i = 0; i < triCount; ++i)
+	{
+		BuildTriangle& tri = mBuildTris[i];
+
+		XMVECTOR v0 = XMLoadFloat3(&vertices[indices[i*3+0]]);
+		XMVECTOR v1 = XMLoadFloat3(&vertices[indices[i*3+1]]);
+		XMVECTOR v2 = XMLoadFloat3(&vertices[indices[i*3+2]]);
+
+		XMStoreFloat3(&tri.V[0], v0);
+		XMStoreFloat3(&tri.V[1], v1);
+		XMStoreFloat3(&tri.V[2], v2);
+
+		XMVECTOR triMin = XMVectorMin(XMVectorMin(v0, v1), v2);
+		XMVECTOR triMax = XMVectorMax(XMVectorMax(v0, v1), v2);
+		XMStoreFloat3(&tri.BoxMin, triMin);
+		XMStoreFloat3(&tri.BoxMax, triMax);
+
+		vmin = XMVectorMin(vmin, triMin);
+		vmax = XMVectorMax(vmax, triMax);
+
+		tris[i] = i;
+	}
+
+	OctreeNode root;
+	XMStoreFloat3(&root.BoxMin, vmin);
+	XMStoreFloat3(&root.BoxMax, vmax);
+	root.First = 0;
+	root.Count = 0;
+
+	std::vector<UINT> childTris[8];
+	OctreeNode childNodes[8];
+
+	if(triCount < ParallelBuildThreshold || !SplitNode(root, tris, childTris, childNodes))
 	{
-		XMVECTOR P = XMLoadFloat3(&mVertices[i]);
+		Subtree tree;
+		tree.Nodes.push_back(root);
+		BuildSubtree(tree, 0, tris, 0);
 
-		vmin = XMVectorMin(vmin, P);
-		vmax = XMVectorMax(vmax, P);
+		mNodes.swap(tree.Nodes);
+		mBlocks.swap(tree.Blocks);
+		mTriangleRefCount = tree.TriangleRefCount;
 	}
+	else
+	{
+		std::vector<UINT>().swap(tris);
+
+		// Build the subtree of every top level octant on its own thread.  The workers
+		// only read mBuildTris and write to their own Subtree.
+		Subtree trees[8];
+		std::vector<std::future<void>> jobs;
+
+		UINT childMask = 0;
+		for(UINT c = 0; c < 8; ++c)
+		{
+			if(childTris[c].empty())
+				continue;
+
+			childMask |= 1 << c;
+			trees[c].Nodes.push_back(childNodes[c]);
 
-	XNA::AxisAlignedBox bounds;
-	XMVECTOR C = 0.5f*(vmin + vmax);
-	XMVECTOR E = 0.5f*(vmax - vmin); 
+			Subtree* tree = &trees[c];
+			std::vector<UINT>* subTris = &childTris[c];
+			jobs.push_back(std::async(std::launch::async,
+				[this, tree, subTris]() { BuildSubtree(*tree, 0, *subTris, 1); }));
+		}
+
+		for(size_t i = 0; i < jobs.size(); ++i)
+			jobs[i].get();
 
-	XMStoreFloat3(&bounds.Center, C); 
-	XMStoreFloat3(&bounds.Extents, E); 
+		// Root, then the top level children, then the rest of each subtree in turn.
+		root.First = 1;
+		root.Count = OctreeNode::InteriorFlag | childMask;
+		mNodes.push_back(root);
+		mNodes.resize(1 + jobs.size());
 
-	return bounds;
+		UINT slot = 1;
+		for(UINT c = 0; c < 8; ++c)
+		{
+			if(childMask & (1 << c))
+				Splice(trees[c], slot++);
+		}
+	}
+
+	std::vector<BuildTriangle>().swap(mBuildTris);
 }
 
-void Octree::BuildOctree(OctreeNode* parent, const std::vector<UINT>& indices)
+bool Octree::SplitNode(const OctreeNode& node, const std::vector<UINT>& tris,
+	std::vector<UINT> childTris[8], OctreeNode childNodes[8])const
 {
-	size_t triCount = indices.size() / 3;
+	XMFLOAT3 boxMin[2] = { node.BoxMin, XMFLOAT3() };
+	XMFLOAT3 boxMax[2] = { XMFLOAT3(), node.BoxMax };
+	boxMin[1] = boxMax[0] = XMFLOAT3(
+		0.5f*(node.BoxMin.x + node.BoxMax.x),
+		0.5f*(node.BoxMin.y + node.BoxMax.y),
+		0.5f*(node.BoxMin.z + node.BoxMax.z));
+	const XMFLOAT3& center = boxMin[1];
 
-	if(triCount < 60) 
+	XMVECTOR childMin[8];
+	XMVECTOR childMax[8];
+	XNA::AxisAlignedBox octantBox[8];
+	for(UINT c = 0; c < 8; ++c)
 	{
-		parent->IsLeaf = true;
-		parent->Indices = indices;
+		childTris[c].clear();
+		childMin[c] = XMVectorReplicate(+MathHelper::Infinity);
+		childMax[c] = XMVectorReplicate(-MathHelper::Infinity);
+
+		XMVECTOR omin = XMVectorSet(boxMin[c & 1].x, boxMin[(c >> 1) & 1].y, boxMin[(c >> 2) & 1].z, 0.0f);
+		XMVECTOR omax = XMVectorSet(boxMax[c & 1].x, boxMax[(c >> 1) & 1].y, boxMax[(c >> 2) & 1].z, 0.0f);
+		XMStoreFloat3(&octantBox[c].Center, 0.5f*(omin + omax));
+		XMStoreFloat3(&octantBox[c].Extents, 0.5f*(omax - omin));
 	}
-	else
+
+	size_t refCount = 0;
+	for(size_t i = 0; i < tris.size(); ++i)
 	{
-		parent->IsLeaf = false;
+		const BuildTriangle& tri = mBuildTris[tris[i]];
 
-		XNA::AxisAlignedBox subbox[8];
-		parent->Subdivide(subbox);
+		// Octants overlapped by the triangle bounds on each axis.
+		UINT lo[3] = { tri.BoxMin.x >= center.x, tri.BoxMin.y >= center.y, tri.BoxMin.z >= center.z };
+		UINT hi[3] = { tri.BoxMax.x >= center.x, tri.BoxMax.y >= center.y, tri.BoxMax.z >= center.z };
 
-		for(int i = 0; i < 8; ++i)
+		UINT candidates[8];
+		UINT candidateCount = 0;
+		for(UINT z = lo[2]; z <= hi[2]; ++z)
+			for(UINT y = lo[1]; y <= hi[1]; ++y)
+				for(UINT x = lo[0]; x <= hi[0]; ++x)
+					candidates[candidateCount++] = x | (y << 1) | (z << 2);
+
+		// A triangle whose bounds fall in one octant needs no exact test.  Otherwise keep
+		// the octants the triangle really crosses; if round-off rejects all of them, keep
+		// every candidate rather than lose the triangle.
+		UINT accepted[8];
+		UINT acceptedCount = 0;
+		if(candidateCount == 1)
+		{
+			accepted[acceptedCount++] = candidates[0];
+		}
+		else
 		{
-			// Allocate a new subnode.
-			parent->Children[i] = new OctreeNode();
-			parent->Children[i]->Bounds = subbox[i];
+			XMVECTOR v0 = XMLoadFloat3(&tri.V[0]);
+			XMVECTOR v1 = XMLoadFloat3(&tri.V[1]);
+			XMVECTOR v2 = XMLoadFloat3(&tri.V[2]);
+			for(UINT j = 0; j < candidateCount; ++j)
+			{
+				if(XNA::IntersectTriangleAxisAlignedBox(v0, v1, v2, &octantBox[candidates[j]]))
+					accepted[acceptedCount++] = candidates[j];
+			}
 
-			// Find triangles that intersect this node's bounding box.
-			std::vector<UINT> intersectedTriangleIndices;
-			for(size_t j = 0; j < triCount; ++j)
+			if(acceptedCount == 0)
 			{
-				UINT i0 = indices[j*3+0];
-				UINT i1 = indices[j*3+1];
-				UINT i2 = indices[j*3+2];
+				for(UINT j = 0; j < candidateCount; ++j)
+					accepted[acceptedCount++] = candidates[j];
+			}
+		}
+
+		XMVECTOR triMin = XMLoadFloat3(&tri.BoxMin);
+		XMVECTOR triMax = XMLoadFloat3(&tri.BoxMax);
+		for(UINT j = 0; j < acceptedCount; ++j)
+		{
+			UINT c = accepted[j];
+			childTris[c].push_back(tris[i]);
+			childMin[c] = XMVectorMin(childMin[c], triMin);
+			childMax[c] = XMVectorMax(childMax[c], triMax);
+		}
 
-				XMVECTOR v0 = XMLoadFloat3(&mVertices[i0]);
-				XMVECTOR v1 = XMLoadFloat3(&mVertices[i1]);
-				XMVECTOR v2 = XMLoadFloat3(&mVertices[i2]);
+		refCount += acceptedCount;
+	}
 
-				if(XNA::IntersectTriangleAxisAlignedBox(v0, v1, v2, &subbox[i]))
-				{
-					intersectedTriangleIndices.push_back(i0);
-					intersectedTriangleIndices.push_back(i1);
-					intersectedTriangleIndices.push_back(i2);
-				}
-			}
+	if(refCount > MaxRefGrowth*tris.size())
+		return false;
+
+	// Shrink each child box to the part of its octant covered by its triangles.
+	for(UINT c = 0; c < 8; ++c)
+	{
+		if(childTris[c].empty())
+			continue;
+
+		XMVECTOR omin = XMLoadFloat3(&octantBox[c].Center) - XMLoadFloat3(&octantBox[c].Extents);
+		XMVECTOR omax = XMLoadFloat3(&octantBox[c].Center) + XMLoadFloat3(&octantBox[c].Extents);
 
-			// Recurse.
-			BuildOctree(parent->Children[i], intersectedTriangleIndices);
+		XMStoreFloat3(&childNodes[c].BoxMin, XMVectorMax(omin, childMin[c]));
+		XMStoreFloat3(&childNodes[c].BoxMax, XMVectorMin(omax, childMax[c]));
+		childNodes[c].First = 0;
+		childNodes[c].Count = 0;
+	}
+
+	return true;
+}
+
+void Octree::BuildSubtree(Subtree& tree, UINT nodeIndex, std::vector<UINT>& tris, UINT depth)const
+{
+	if(tris.size() <= MaxLeafTriangles || depth >= MaxDepth)
+	{
+		MakeLeaf(tree, nodeIndex, tris);
+		return;
+	}
+
+	std::vector<UINT> childTris[8];
+	OctreeNode childNodes[8];
+	if(!SplitNode(tree.Nodes[nodeIndex], tris, childTris, childNodes))
+	{
+		MakeLeaf(tree, nodeIndex, tris);
+		return;
+	}
+
+	// The children own the triangle lists from here on.
+	std::vector<UINT>().swap(tris);
+
+	UINT first = (UINT)tree.Nodes.size();
+	UINT childMask = 0;
+	for(UINT c = 0; c < 8; ++c)
+	{
+		if(!childTris[c].empty())
+		{
+			childMask |= 1 << c;
+			tree.Nodes.push_back(childNodes[c]);
 		}
 	}
+
+	tree.Nodes[nodeIndex].First = first;
+	tree.Nodes[nodeIndex].Count = OctreeNode::InteriorFlag | childMask;
+
+	UINT child = first;
+	for(UINT c = 0; c < 8; ++c)
+	{
+		if(childMask & (1 << c))
+			BuildSubtree(tree, child++, childTris[c], depth + 1);
+	}
 }
 
-bool Octree::RayOctreeIntersect(OctreeNode* parent, FXMVECTOR rayPos, FXMVECTOR rayDir)
+void Octree::MakeLeaf(Subtree& tree, UINT nodeIndex, const std::vector<UINT>& tris)const
 {
-	// Recurs until we find a leaf node (all the triangles are in the leaves).
-	if( !parent->IsLeaf )
+	UINT first = (UINT)tree.Blocks.size();
+	UINT count = (UINT)tris.size();
+
+	tree.Nodes[nodeIndex].First = first;
+	tree.Nodes[nodeIndex].Count = count;
+	tree.TriangleRefCount += count;
+
+	tree.Blocks.resize(first + (count + 3) / 4);
+	for(UINT i = 0; i < count; ++i)
+	{
+		RayTriangleSimd::TriangleBlock4& block = tree.Blocks[first + i/4];
+		if(i % 4 == 0)
+			RayTriangleSimd::ClearBlock(block);
+
+		const BuildTriangle& tri = mBuildTris[tris[i]];
+		RayTriangleSimd::SetTriangle(block, i % 4, &tri.V[0].x, &tri.V[1].x, &tri.V[2].x);
+	}
+}
+
+void Octree::Splice(const Subtree& tree, UINT slot)
+{
+	// Node 0 of the subtree goes to the reserved slot, the others are appended, so a
+	// local index j > 0 becomes nodeBase + j - 1.
+	UINT nodeBase = (UINT)mNodes.size();
+	UINT blockBase = (UINT)mBlocks.size();
+
+	for(size_t j = 0; j < tree.Nodes.size(); ++j)
 	{
-		for(int i = 0; i < 8; ++i)
+		OctreeNode node = tree.Nodes[j];
+		if(node.IsLeaf())
+			node.First += blockBase;
+		else
+			node.First = nodeBase + node.First - 1;
+
+		if(j == 0)
+			mNodes[slot] = node;
+		else
+			mNodes.push_back(node);
+	}
+
+	mBlocks.insert(mBlocks.end(), tree.Blocks.begin(), tree.Blocks.end());
+	mTriangleRefCount += tree.TriangleRefCount;
+}
+
+bool Octree::IntersectBox(const OctreeNode& node, FXMVECTOR rayPos, FXMVECTOR invDir,
+	float maxDist, float* pEntry)
+{
+	// Slab test.
+	XMVECTOR t0 = (XMLoadFloat3(&node.BoxMin) - rayPos)*invDir;
+	XMVECTOR t1 = (XMLoadFloat3(&node.BoxMax) - rayPos)*invDir;
+
+	XMFLOAT3 tNear, tFar;
+	XMStoreFloat3(&tNear, XMVectorMin(t0, t1));
+	XMStoreFloat3(&tFar, XMVectorMax(t0, t1));
+
+	float tMin = MathHelper::Max(MathHelper::Max(tNear.x, tNear.y), MathHelper::Max(tNear.z, 0.0f));
+	float tMax = MathHelper::Min(MathHelper::Min(tFar.x, tFar.y), MathHelper::Min(tFar.z, maxDist));
+
+	*pEntry = tMin;
+	return tMin <= tMax;
+}
+
+bool Octree::RayOctreeIntersect(FXMVECTOR rayPos, FXMVECTOR rayDir, float maxDist)const
+{
+	if(mNodes.empty())
+		return false;
+
+	XMVECTOR invDir = XMVectorReciprocal(rayDir);
+
+	XMFLOAT3 pos, dir;
+	XMStoreFloat3(&pos, rayPos);
+	XMStoreFloat3(&dir, rayDir);
+	RayTriangleSimd::Ray4 ray = RayTriangleSimd::BroadcastRay(&pos.x, &dir.x);
+	UINT dirMask = DirectionMask(dir);
+
+	float tEntry;
+	if(!IntersectBox(mNodes[0], rayPos, invDir, maxDist, &tEntry))
+		return false;
+
+	UINT stack[MaxStackSize];
+	UINT stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while(stackSize > 0)
+	{
+		const OctreeNode& node = mNodes[stack[--stackSize]];
+
+		if(node.IsLeaf())
 		{
-			// Recurse down this node if the ray hit the child's box.
-			float t;
-			if( XNA::IntersectRayAxisAlignedBox(rayPos, rayDir, &parent->Children[i]->Bounds, &t) )
+			// Any hit will do, so we can bail out on the first one.
+			UINT blockCount = (node.Count + 3) / 4;
+			for(UINT b = 0; b < blockCount; ++b)
 			{
-				// If we hit a triangle down this branch, we can bail out that we hit a triangle.
-				if( RayOctreeIntersect(parent->Children[i], rayPos, rayDir) )
+				if(RayTriangleSimd::IntersectRayAny4(ray, mBlocks[node.First + b], maxDist))
 					return true;
 			}
+			continue;
 		}
 
-		// If we get here. then we did not hit any triangles.
-		return false;
+		// Push far to near so the nearest child is popped first.
+		UINT childMask = node.ChildMask();
+		for(int i = 7; i >= 0; --i)
+		{
+			UINT octant = NearToFarOrder[i] ^ dirMask;
+			if((childMask & (1 << octant)) == 0)
+				continue;
+
+			UINT child = node.First + ChildOffset(childMask, octant);
+			if(IntersectBox(mNodes[child], rayPos, invDir, maxDist, &tEntry))
+				stack[stackSize++] = child;
+		}
 	}
-	else
+
+	return false;
+}
+
+bool Octree::RayOctreeIntersectClosest(FXMVECTOR rayPos, FXMVECTOR rayDir, float* pDist, float maxDist)const
+{
+	if(mNodes.empty())
+		return false;
+
+	XMVECTOR invDir = XMVectorReciprocal(rayDir);
+
+	XMFLOAT3 pos, dir;
+	XMStoreFloat3(&pos, rayPos);
+	XMStoreFloat3(&dir, rayDir);
+	RayTriangleSimd::Ray4 ray = RayTriangleSimd::BroadcastRay(&pos.x, &dir.x);
+	UINT dirMask = DirectionMask(dir);
+
+	float closest = maxDist;
+	bool hit = false;
+
+	float tEntry;
+	if(!IntersectBox(mNodes[0], rayPos, invDir, closest, &tEntry))
+		return false;
+
+	UINT stack[MaxStackSize];
+	float stackEntry[MaxStackSize];
+	UINT stackSize = 0;
+	stack[stackSize] = 0;
+	stackEntry[stackSize++] = tEntry;
+
+	while(stackSize > 0)
 	{
-		size_t triCount = parent->Indices.size() / 3;
+		--stackSize;
 
-		for(size_t i = 0; i < triCount; ++i)
-		{
-			UINT i0 = parent->Indices[i*3+0];
-			UINT i1 = parent->Indices[i*3+1];
-			UINT i2 = parent->Indices[i*3+2];
+		// Skip nodes that start behind a hit found since they were pushed.
+		if(stackEntry[stackSize] > closest)
+			continue;
 
-			XMVECTOR v0 = XMLoadFloat3(&mVertices[i0]);
-			XMVECTOR v1 = XMLoadFloat3(&mVertices[i1]);
-			XMVECTOR v2 = XMLoadFloat3(&mVertices[i2]);
+		const OctreeNode& node = mNodes[stack[stackSize]];
 
-			float t;
-			if( XNA::IntersectRayTriangle(rayPos, rayDir, v0, v1, v2, &t) )
-				return true;
+		if(node.IsLeaf())
+		{
+			UINT blockCount = (node.Count + 3) / 4;
+			for(UINT b = 0; b < blockCount; ++b)
+			{
+				float t, u, v;
+				if(RayTriangleSimd::IntersectRayClosest4(ray, mBlocks[node.First + b], closest, t, u, v) >= 0)
+				{
+					closest = t;
+					hit = true;
+				}
+			}
+			continue;
 		}
 
-		return false;
+		UINT childMask = node.ChildMask();
+		for(int i = 7; i >= 0; --i)
+		{
+			UINT octant = NearToFarOrder[i] ^ dirMask;
+			if((childMask & (1 << octant)) == 0)
+				continue;
+
+			UINT child = node.First + ChildOffset(childMask, octant);
+			if(IntersectBox(mNodes[child], rayPos, invDir, closest, &tEntry))
+			{
+				stack[stackSize] = child;
+				stackEntry[stackSize++] = tEntry;
+			}
+		}
 	}
-}
\ No newline at end of file
+
+	if(hit)
+		*pDist = closest;
+
+	return hit;
+}
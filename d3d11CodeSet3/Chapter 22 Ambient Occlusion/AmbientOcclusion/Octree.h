@@ -1,7 +1,18 @@
 //***************************************************************************************
 // Octree.h by Frank Luna (C) 2011 All Rights Reserved.
-//   
-// Simple octree for doing ray/triangle intersection queries.
+//
+// Octree for doing ray/triangle intersection queries.
+//
+// The nodes are stored in one flat array (no pointers): the non-empty children of an
+// interior node are stored next to each other, so a node only needs the index of its
+// first child and an 8-bit mask saying which octants are present.  Each node box is
+// its octant clipped to the triangles it holds.
+//
+// A leaf references each triangle once and keeps its triangles in SoA blocks of 4 in
+// the precomputed (v0, e1, e2) layout of RayTriangleSimd.h, so the leaf test does not
+// go back to the vertex/index buffers.
+//
+// The eight top level subtrees are built in parallel and then spliced into the array.
 //***************************************************************************************
 
 #ifndef OCTREE_H
@@ -9,8 +20,27 @@
 
 #include "d3dUtil.h"
 #include "XnaCollision.h"
+#include "../../../d3d12book-master/Common/RayTriangleSimd.h"
 
-struct OctreeNode;
+struct OctreeNode
+{
+	XMFLOAT3 BoxMin;
+
+	// Interior: index of the first child.  Leaf: index of the first triangle block.
+	UINT First;
+
+	XMFLOAT3 BoxMax;
+
+	// Interior: InteriorFlag | child mask (bit i set if octant i has a child).
+	// Leaf: number of triangles.
+	UINT Count;
+
+	static const UINT InteriorFlag = 0x80000000;
+
+	bool IsLeaf()const      { return (Count & InteriorFlag) == 0; }
+	UINT ChildMask()const   { return Count & 0xff; }
+	UINT TriCount()const    { return IsLeaf() ? Count : 0; }
+};
 
 class Octree
 {
@@ -19,108 +49,59 @@ public:
 	~Octree();
 
 	void Build(const std::vector<XMFLOAT3>& vertices, const std::vector<UINT>& indices);
-	bool RayOctreeIntersect(FXMVECTOR rayPos, FXMVECTOR rayDir);
 
-private:
-	XNA::AxisAlignedBox BuildAABB();
-	void BuildOctree(OctreeNode* parent, const std::vector<UINT>& indices);
-	bool RayOctreeIntersect(OctreeNode* parent, FXMVECTOR rayPos, FXMVECTOR rayDir);
-private:
-	OctreeNode* mRoot;
- 
-	std::vector<XMFLOAT3> mVertices;
-};
+	///<summary>
+	/// Occlusion query: returns true as soon as any triangle is hit with
+	/// 0 < t < maxDist, where t is in units of the rayDir length.
+	///</summary>
+	bool RayOctreeIntersect(FXMVECTOR rayPos, FXMVECTOR rayDir, float maxDist = MathHelper::Infinity)const;
 
-struct OctreeNode
-{
-	#pragma region Properties
-	XNA::AxisAlignedBox Bounds;
+	///<summary>
+	/// Finds the nearest hit with 0 < t < maxDist.  Children are visited front to back,
+	/// so subtrees behind the current nearest hit are skipped.
+	///</summary>
+	bool RayOctreeIntersectClosest(FXMVECTOR rayPos, FXMVECTOR rayDir, float* pDist,
+		float maxDist = MathHelper::Infinity)const;
 
-	// This will be empty except for leaf nodes.
-	std::vector<UINT> Indices;
+	UINT NodeCount()const { return (UINT)mNodes.size(); }
+	UINT TriangleRefCount()const { return mTriangleRefCount; }
 
-	OctreeNode* Children[8];
+private:
+	struct BuildTriangle
+	{
+		XMFLOAT3 V[3];
+		XMFLOAT3 BoxMin;
+		XMFLOAT3 BoxMax;
+	};
+
+	// Nodes and blocks of one subtree built on a worker thread.  Indices are local to
+	// the subtree until it is spliced into the octree.
+	struct Subtree
+	{
+		std::vector<OctreeNode> Nodes;
+		std::vector<RayTriangleSimd::TriangleBlock4> Blocks;
+		UINT TriangleRefCount;
 
-	bool IsLeaf;
-	#pragma endregion
+		Subtree() : TriangleRefCount(0) {}
+	};
 
-	OctreeNode()
-	{
-		for(int i = 0; i < 8; ++i)
-			Children[i] = 0;
+	bool SplitNode(const OctreeNode& node, const std::vector<UINT>& tris,
+		std::vector<UINT> childTris[8], OctreeNode childNodes[8])const;
+	void BuildSubtree(Subtree& tree, UINT nodeIndex, std::vector<UINT>& tris, UINT depth)const;
+	void MakeLeaf(Subtree& tree, UINT nodeIndex, const std::vector<UINT>& tris)const;
+	void Splice(const Subtree& tree, UINT slot);
 
-		Bounds.Center  = XMFLOAT3(0.0f, 0.0f, 0.0f);
-		Bounds.Extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	static bool IntersectBox(const OctreeNode& node, FXMVECTOR rayPos, FXMVECTOR invDir,
+		float maxDist, float* pEntry);
 
-		IsLeaf = false;
-	}
+private:
+	std::vector<OctreeNode> mNodes;
+	std::vector<RayTriangleSimd::TriangleBlock4> mBlocks;
 
-	~OctreeNode()
-	{
-		for(int i = 0; i < 8; ++i)
-			SafeDelete(Children[i]);
-	}
+	// Only used while building.
+	std::vector<BuildTriangle> mBuildTris;
 
-	///<summary>
-	/// Subdivides the bounding box of this node into eight subboxes (vMin[i], vMax[i]) for i = 0:7.
-	///</summary>
-	void Subdivide(XNA::AxisAlignedBox box[8])
-	{
-		XMFLOAT3 halfExtent(
-			0.5f*Bounds.Extents.x,
-			0.5f*Bounds.Extents.y,
-			0.5f*Bounds.Extents.z);
-
-		// "Top" four quadrants.
-		box[0].Center  = XMFLOAT3(
-			Bounds.Center.x + halfExtent.x,
-			Bounds.Center.y + halfExtent.y,
-			Bounds.Center.z + halfExtent.z);
-		box[0].Extents = halfExtent;
-
-		box[1].Center  = XMFLOAT3(
-			Bounds.Center.x - halfExtent.x,
-			Bounds.Center.y + halfExtent.y,
-			Bounds.Center.z + halfExtent.z);
-		box[1].Extents = halfExtent;
-
-		box[2].Center  = XMFLOAT3(
-			Bounds.Center.x - halfExtent.x,
-			Bounds.Center.y + halfExtent.y,
-			Bounds.Center.z - halfExtent.z);
-		box[2].Extents = halfExtent;
-
-		box[3].Center  = XMFLOAT3(
-			Bounds.Center.x + halfExtent.x,
-			Bounds.Center.y + halfExtent.y,
-			Bounds.Center.z - halfExtent.z);
-		box[3].Extents = halfExtent;
-
-		// "Bottom" four quadrants.
-		box[4].Center  = XMFLOAT3(
-			Bounds.Center.x + halfExtent.x,
-			Bounds.Center.y - halfExtent.y,
-			Bounds.Center.z + halfExtent.z);
-		box[4].Extents = halfExtent;
-
-		box[5].Center  = XMFLOAT3(
-			Bounds.Center.x - halfExtent.x,
-			Bounds.Center.y - halfExtent.y,
-			Bounds.Center.z + halfExtent.z);
-		box[5].Extents = halfExtent;
-
-		box[6].Center  = XMFLOAT3(
-			Bounds.Center.x - halfExtent.x,
-			Bounds.Center.y - halfExtent.y,
-			Bounds.Center.z - halfExtent.z);
-		box[6].Extents = halfExtent;
-
-		box[7].Center  = XMFLOAT3(
-			Bounds.Center.x + halfExtent.x,
-			Bounds.Center.y - halfExtent.y,
-			Bounds.Center.z - halfExtent.z);
-		box[7].Extents = halfExtent;
-	}
+	UINT mTriangleRefCount;
 };
 
-#endif // OCTREE_H
\ No newline at end of file
+#endif // OCTREE_H
@@ -7,6 +7,9 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/JobSystem.h"
+#include "../../Common/FrameGraph.h"
+#include "../../Common/D3D12CommandBackend.h"
 #include "FrameResource.h"
 #include "CubeRenderTarget.h"
 
@@ -102,8 +105,11 @@ private:
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
+    void BuildFrameGraph();
     void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
-	void DrawSceneToCubeMap();
+	void SetSceneRootArguments(ID3D12GraphicsCommandList* cmdList);
+	void DrawSceneToCubeFace(ID3D12GraphicsCommandList* cmdList, int face);
+	void DrawSceneToBackBuffer(ID3D12GraphicsCommandList* cmdList);
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 	void BuildCubeFaceCamera(float x, float y, float z);
@@ -142,6 +148,12 @@ private:
 	std::unique_ptr<CubeRenderTarget> mDynamicCubeMap = nullptr;
 	CD3DX12_CPU_DESCRIPTOR_HANDLE mCubeDSV;
 
+	// The six cube map faces and the main view are recorded in parallel, each pass
+	// into its own command list.
+	std::unique_ptr<JobSystem> mJobs;
+	std::unique_ptr<D3D12CommandBackend> mCommandBackend;
+	std::unique_ptr<FrameGraph<D3D12CommandBackend>> mFrameGraph;
+
     PassConstants mMainPassCB;
 
 	Camera mCamera;
@@ -210,6 +222,7 @@ bool DynamicCubeMapApp::Initialize()
     BuildRenderItems();
     BuildFrameResources();
     BuildPSOs();
+    BuildFrameGraph();
 
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
@@ -292,85 +305,10 @@ void DynamicCubeMapApp::Update(const GameTimer& gt)
 
 void DynamicCubeMapApp::Draw(const GameTimer& gt)
 {
-    auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
-
-    // Reuse the memory associated with command recording.
-    // We can only reset when the associated command lists have finished execution on the GPU.
-    ThrowIfFailed(cmdListAlloc->Reset());
-
-    // A command list can be reset after it has been added to the command queue via ExecuteCommandList.
-    // Reusing the command list reuses memory.
-    ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
-
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
-	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
-	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
-
-	// Bind all the materials used in this scene.  For structured buffers, we can bypass the heap and 
-	// set as a root descriptor.
-	auto matBuffer = mCurrFrameResource->MaterialBuffer->Resource();
-	mCommandList->SetGraphicsRootShaderResourceView(2, matBuffer->GetGPUVirtualAddress());
-
-	// Bind the sky cube map.  For our demos, we just use one "world" cube map representing the environment
-	// from far away, so all objects will use the same cube map and we only need to set it once per-frame.  
-	// If we wanted to use "local" cube maps, we would have to change them per-object, or dynamically
-	// index into an array of cube maps.
-
-	CD3DX12_GPU_DESCRIPTOR_HANDLE skyTexDescriptor(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-	skyTexDescriptor.Offset(mSkyTexHeapIndex, mCbvSrvUavDescriptorSize);
-	mCommandList->SetGraphicsRootDescriptorTable(3, skyTexDescriptor);
-
-	// Bind all the textures used in this scene.  Observe
-	// that we only have to specify the first descriptor in the table.  
-	// The root signature knows how many descriptors are expected in the table.
-	mCommandList->SetGraphicsRootDescriptorTable(4, mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-
-	DrawSceneToCubeMap();
- 
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
-
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
-
-    // Clear the back buffer and depth buffer.
-    mCommandList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
-    mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
-
-    // Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
-
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
-
-
-	// Use the dynamic cube map for the dynamic reflectors layer.
-	CD3DX12_GPU_DESCRIPTOR_HANDLE dynamicTexDescriptor(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-	dynamicTexDescriptor.Offset(mSkyTexHeapIndex + 1, mCbvSrvUavDescriptorSize);
-	mCommandList->SetGraphicsRootDescriptorTable(3, dynamicTexDescriptor);
-
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::OpaqueDynamicReflectors]);
-
-	// Use the static "background" cube map for the other objects (including the sky)
-	mCommandList->SetGraphicsRootDescriptorTable(3, skyTexDescriptor);
-
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
-
-	mCommandList->SetPipelineState(mPSOs["sky"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Sky]);
-
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
-
-    // Done recording commands.
-    ThrowIfFailed(mCommandList->Close());
-
-    // Add the command list to the queue for execution.
-    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+    // Record the passes in parallel and submit them in one ExecuteCommandLists.
+    // The frame graph keeps command allocators per frame resource, and Update has
+    // waited for the GPU to finish with this one.
+    mFrameGraph->Execute(mCurrFrameResourceIndex);
 
     // Swap the back and front buffers
     ThrowIfFailed(mSwapChain->Present(0, 0));
@@ -1052,6 +990,26 @@ void DynamicCubeMapApp::BuildFrameResources()
     }
 }
 
+void DynamicCubeMapApp::BuildFrameGraph()
+{
+	mJobs = std::make_unique<JobSystem>();
+	mCommandBackend = std::make_unique<D3D12CommandBackend>(md3dDevice.Get(), mCommandQueue.Get());
+	mFrameGraph = std::make_unique<FrameGraph<D3D12CommandBackend>>(*mCommandBackend, *mJobs, gNumFrameResources);
+
+	for(int i = 0; i < 6; ++i)
+	{
+		mFrameGraph->AddPass("cube face " + std::to_string(i), [this, i](D3D12CommandBackend::CommandList& cmdList)
+		{
+			DrawSceneToCubeFace(cmdList.Get(), i);
+		});
+	}
+
+	mFrameGraph->AddPass("main", [this](D3D12CommandBackend::CommandList& cmdList)
+	{
+		DrawSceneToBackBuffer(cmdList.Get());
+	});
+}
+
 void DynamicCubeMapApp::BuildMaterials()
 {
     auto bricks0 = std::make_unique<Material>();
@@ -1265,44 +1223,120 @@ void DynamicCubeMapApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, cons
     }
 }
 
-void DynamicCubeMapApp::DrawSceneToCubeMap()
+void DynamicCubeMapApp::SetSceneRootArguments(ID3D12GraphicsCommandList* cmdList)
 {
-	mCommandList->RSSetViewports(1, &mDynamicCubeMap->Viewport());
-	mCommandList->RSSetScissorRects(1, &mDynamicCubeMap->ScissorRect());
+	// Every pass records into its own command list, which starts with no state set.
 
-	// Change to RENDER_TARGET.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mDynamicCubeMap->Resource(),
-		D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
+	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
+	cmdList->SetGraphicsRootSignature(mRootSignature.Get());
 
-	// For each cube map face.
-	for(int i = 0; i < 6; ++i)
+	// Bind all the materials used in this scene.  For structured buffers, we can bypass the heap and 
+	// set as a root descriptor.
+	auto matBuffer = mCurrFrameResource->MaterialBuffer->Resource();
+	cmdList->SetGraphicsRootShaderResourceView(2, matBuffer->GetGPUVirtualAddress());
+
+	// Bind the sky cube map.  For our demos, we just use one "world" cube map representing the environment
+	// from far away, so all objects will use the same cube map and we only need to set it once per-frame.  
+	// If we wanted to use "local" cube maps, we would have to change them per-object, or dynamically
+	// index into an array of cube maps.
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE skyTexDescriptor(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	skyTexDescriptor.Offset(mSkyTexHeapIndex, mCbvSrvUavDescriptorSize);
+	cmdList->SetGraphicsRootDescriptorTable(3, skyTexDescriptor);
+
+	// Bind all the textures used in this scene.  Observe
+	// that we only have to specify the first descriptor in the table.  
+	// The root signature knows how many descriptors are expected in the table.
+	cmdList->SetGraphicsRootDescriptorTable(4, mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+
+	// Only at() and find() are safe to call on the map from several threads.
+	cmdList->SetPipelineState(mPSOs.at("opaque").Get());
+}
+
+void DynamicCubeMapApp::DrawSceneToCubeFace(ID3D12GraphicsCommandList* cmdList, int face)
+{
+	SetSceneRootArguments(cmdList);
+
+	cmdList->RSSetViewports(1, &mDynamicCubeMap->Viewport());
+	cmdList->RSSetScissorRects(1, &mDynamicCubeMap->ScissorRect());
+
+	// The face lists run in order, so the first changes the cube map to RENDER_TARGET
+	// and the last changes it back to GENERIC_READ so we can read the texture in a shader.
+	if(face == 0)
 	{
-		// Clear the back buffer and depth buffer.
-		mCommandList->ClearRenderTargetView(mDynamicCubeMap->Rtv(i), Colors::LightSteelBlue, 0, nullptr);
-		mCommandList->ClearDepthStencilView(mCubeDSV, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mDynamicCubeMap->Resource(),
+			D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	}
+
+	// Clear the back buffer and depth buffer.
+	cmdList->ClearRenderTargetView(mDynamicCubeMap->Rtv(face), Colors::LightSteelBlue, 0, nullptr);
+	cmdList->ClearDepthStencilView(mCubeDSV, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-		// Specify the buffers we are going to render to.
-		mCommandList->OMSetRenderTargets(1, &mDynamicCubeMap->Rtv(i), true, &mCubeDSV);
+	// Specify the buffers we are going to render to.
+	cmdList->OMSetRenderTargets(1, &mDynamicCubeMap->Rtv(face), true, &mCubeDSV);
 
-		// Bind the pass constant buffer for this cube map face so we use 
-		// the right view/proj matrix for this cube face.
-		auto passCB = mCurrFrameResource->PassCB->Resource();
-		D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = passCB->GetGPUVirtualAddress() + (1+i)*passCBByteSize;
-		mCommandList->SetGraphicsRootConstantBufferView(1, passCBAddress);
+	// Bind the pass constant buffer for this cube map face so we use 
+	// the right view/proj matrix for this cube face.
+	UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
+	auto passCB = mCurrFrameResource->PassCB->Resource();
+	D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = passCB->GetGPUVirtualAddress() + (1+face)*passCBByteSize;
+	cmdList->SetGraphicsRootConstantBufferView(1, passCBAddress);
 
-		DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+	DrawRenderItems(cmdList, mRitemLayer[(int)RenderLayer::Opaque]);
 
-		mCommandList->SetPipelineState(mPSOs["sky"].Get());
-		DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Sky]);
+	cmdList->SetPipelineState(mPSOs.at("sky").Get());
+	DrawRenderItems(cmdList, mRitemLayer[(int)RenderLayer::Sky]);
 
-		mCommandList->SetPipelineState(mPSOs["opaque"].Get());
+	if(face == 5)
+	{
+		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mDynamicCubeMap->Resource(),
+			D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_GENERIC_READ));
 	}
+}
 
-	// Change back to GENERIC_READ so we can read the texture in a shader.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mDynamicCubeMap->Resource(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_GENERIC_READ));
+void DynamicCubeMapApp::DrawSceneToBackBuffer(ID3D12GraphicsCommandList* cmdList)
+{
+	SetSceneRootArguments(cmdList);
+
+    cmdList->RSSetViewports(1, &mScreenViewport);
+    cmdList->RSSetScissorRects(1, &mScissorRect);
+
+    // Indicate a state transition on the resource usage.
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
+		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+
+    // Clear the back buffer and depth buffer.
+    cmdList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
+    cmdList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+
+    // Specify the buffers we are going to render to.
+    cmdList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+
+	auto passCB = mCurrFrameResource->PassCB->Resource();
+	cmdList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
+
+	// Use the dynamic cube map for the dynamic reflectors layer.
+	CD3DX12_GPU_DESCRIPTOR_HANDLE dynamicTexDescriptor(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	dynamicTexDescriptor.Offset(mSkyTexHeapIndex + 1, mCbvSrvUavDescriptorSize);
+	cmdList->SetGraphicsRootDescriptorTable(3, dynamicTexDescriptor);
+
+	DrawRenderItems(cmdList, mRitemLayer[(int)RenderLayer::OpaqueDynamicReflectors]);
+
+	// Use the static "background" cube map for the other objects (including the sky)
+	CD3DX12_GPU_DESCRIPTOR_HANDLE skyTexDescriptor(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	skyTexDescriptor.Offset(mSkyTexHeapIndex, mCbvSrvUavDescriptorSize);
+	cmdList->SetGraphicsRootDescriptorTable(3, skyTexDescriptor);
+
+	DrawRenderItems(cmdList, mRitemLayer[(int)RenderLayer::Opaque]);
+
+	cmdList->SetPipelineState(mPSOs.at("sky").Get());
+	DrawRenderItems(cmdList, mRitemLayer[(int)RenderLayer::Sky]);
+
+    // Indicate a state transition on the resource usage.
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
+		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 }
 
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> DynamicCubeMapApp::GetStaticSamplers()
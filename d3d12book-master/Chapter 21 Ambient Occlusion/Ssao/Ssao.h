@@ -27,6 +27,10 @@ public:
 
     static const int MaxBlurRadius = 5;
 
+    // Descriptors BuildDescriptors expects at hCpuSrv/hGpuSrv and at hCpuRtv.
+    static const UINT SrvCount = 5;
+    static const UINT RtvCount = 3;
+
 	UINT SsaoMapWidth()const;
     UINT SsaoMapHeight()const;
 
@@ -7,6 +7,12 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/JobSystem.h"
+#include "../../Common/FrameGraph.h"
+#include "../../Common/D3D12CommandBackend.h"
+#include "../../Common/DescriptorHeap.h"
+#include "../../Common/D3D12ShaderCompiler.h"
+#include "../../Common/PipelineCache.h"
 #include "FrameResource.h"
 #include "ShadowMap.h"
 #include "Ssao.h"
@@ -17,6 +23,16 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
+// Root parameter 3 reads the sky cube map, the shadow map and the SSAO map from
+// consecutive descriptors, so they are allocated as one range, with the rest of the
+// Ssao descriptors after the SSAO map.  The null range mirrors it for the passes that
+// draw without them.
+const UINT gSkySrv = 0;
+const UINT gShadowMapSrv = 1;
+const UINT gSsaoSrvStart = 2;
+const UINT gSceneSrvCount = gSsaoSrvStart + Ssao::SrvCount;
+const UINT gNullSrvCount = 3;
+
 // Lightweight structure stores parameters to draw a shape.  This will
 // vary from app-to-app.
 struct RenderItem
@@ -100,12 +116,13 @@ private:
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
+    void BuildFrameGraph();
     void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
-    void DrawSceneToShadowMap();
-	void DrawNormalsAndDepth();
+    void SetSceneRootArguments(ID3D12GraphicsCommandList* cmdList);
+    void DrawSceneToShadowMap(ID3D12GraphicsCommandList* cmdList);
+	void DrawNormalsAndDepth(ID3D12GraphicsCommandList* cmdList);
+    void DrawSceneToBackBuffer(ID3D12GraphicsCommandList* cmdList);
 
-    CD3DX12_CPU_DESCRIPTOR_HANDLE GetCpuSrv(int index)const;
-    CD3DX12_GPU_DESCRIPTOR_HANDLE GetGpuSrv(int index)const;
     CD3DX12_CPU_DESCRIPTOR_HANDLE GetDsv(int index)const;
     CD3DX12_CPU_DESCRIPTOR_HANDLE GetRtv(int index)const;
 
@@ -120,13 +137,18 @@ private:
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
     ComPtr<ID3D12RootSignature> mSsaoRootSignature = nullptr;
 
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
+	std::unique_ptr<DescriptorHeap> mSrvHeap;
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
-	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
-	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
+
+    // Shaders and PSOs are built in parallel on mJobs, and kept on disk between runs.
+    D3D12ShaderCompiler mShaderCompiler;
+    std::unique_ptr<BlobCache> mShaderDiskCache;
+    std::unique_ptr<BlobCache> mPipelineDiskCache;
+    std::unique_ptr<ShaderCache> mShaders;
+    std::unique_ptr<PipelineCache> mPSOs;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
  
@@ -136,16 +158,9 @@ private:
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
-	UINT mSkyTexHeapIndex = 0;
-    UINT mShadowMapHeapIndex = 0;
-    UINT mSsaoHeapIndexStart = 0;
-    UINT mSsaoAmbientMapIndex = 0;
-
-    UINT mNullCubeSrvIndex = 0;
-    UINT mNullTexSrvIndex1 = 0;
-    UINT mNullTexSrvIndex2 = 0;
-
-    CD3DX12_GPU_DESCRIPTOR_HANDLE mNullSrv;
+    DescriptorRangeHandle mTextureSrvs;
+    DescriptorRangeHandle mSceneSrvs;
+    DescriptorRangeHandle mNullSrvs;
 
     PassConstants mMainPassCB;  // index 0 of pass cbuffer.
     PassConstants mShadowPassCB;// index 1 of pass cbuffer.
@@ -156,6 +171,12 @@ private:
 
     std::unique_ptr<Ssao> mSsao;
 
+    // The shadow, normal/depth, SSAO and main passes are recorded in parallel, each
+    // into its own command list.  Startup compiles the shaders and PSOs on it too.
+    std::unique_ptr<JobSystem> mJobs;
+    std::unique_ptr<D3D12CommandBackend> mCommandBackend;
+    std::unique_ptr<FrameGraph<D3D12CommandBackend>> mFrameGraph;
+
     DirectX::BoundingSphere mSceneBounds;
 
     float mLightNearZ = 0.0f;
@@ -176,6 +197,22 @@ private:
     POINT mLastMousePos;
 };
 
+// Returns the path of the cache folder name in the demo's per-user folder,
+// %LOCALAPPDATA%\SsaoDemo, creating that folder if needed, so the caches are neither
+// written into the source tree nor shared with other demos.  Falls back to the working
+// directory if LOCALAPPDATA is not set.
+static std::string GetCacheDirectory(const std::string& name)
+{
+    char localAppData[MAX_PATH];
+    DWORD length = GetEnvironmentVariableA("LOCALAPPDATA", localAppData, MAX_PATH);
+    if(length == 0 || length >= MAX_PATH)
+        return name;
+
+    std::string dir = std::string(localAppData) + "\\SsaoDemo";
+    CreateDirectoryA(dir.c_str(), nullptr);
+    return dir + "\\" + name;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     PSTR cmdLine, int showCmd)
 {
@@ -224,6 +261,13 @@ bool SsaoApp::Initialize()
     // Reset the command list to prep for initialization commands.
     ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
+    mJobs = std::make_unique<JobSystem>();
+
+    mShaderDiskCache = std::make_unique<BlobCache>(GetCacheDirectory("ShaderCache"));
+    mPipelineDiskCache = std::make_unique<BlobCache>(GetCacheDirectory("PipelineCache"));
+    mShaders = std::make_unique<ShaderCache>(mShaderCompiler, mShaderDiskCache.get());
+    mPSOs = std::make_unique<PipelineCache>(md3dDevice.Get(), mPipelineDiskCache.get());
+
 	mCamera.SetPosition(0.0f, 2.0f, -15.0f);
  
     mShadowMap = std::make_unique<ShadowMap>(md3dDevice.Get(),
@@ -246,7 +290,9 @@ bool SsaoApp::Initialize()
     BuildFrameResources();
     BuildPSOs();
 
-    mSsao->SetPSOs(mPSOs["ssao"].Get(), mPSOs["ssaoBlur"].Get());
+    mSsao->SetPSOs(mPSOs->Get("ssao"), mPSOs->Get("ssaoBlur"));
+
+    BuildFrameGraph();
 
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
@@ -263,7 +309,7 @@ void SsaoApp::CreateRtvAndDsvDescriptorHeaps()
 {
     // Add +1 for screen normal map, +2 for ambient maps.
     D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc;
-    rtvHeapDesc.NumDescriptors = SwapChainBufferCount + 3;
+    rtvHeapDesc.NumDescriptors = SwapChainBufferCount + Ssao::RtvCount;
     rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
     rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
     rtvHeapDesc.NodeMask = 0;
@@ -338,119 +384,10 @@ void SsaoApp::Update(const GameTimer& gt)
 
 void SsaoApp::Draw(const GameTimer& gt)
 {
-    auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
-
-    // Reuse the memory associated with command recording.
-    // We can only reset when the associated command lists have finished execution on the GPU.
-    ThrowIfFailed(cmdListAlloc->Reset());
-
-    // A command list can be reset after it has been added to the command queue via ExecuteCommandList.
-    // Reusing the command list reuses memory.
-    ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
-
-    ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
-    mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
-    mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
-
-	//
-	// Shadow map pass.
-	//
-
-    // Bind all the materials used in this scene.  For structured buffers, we can bypass the heap and 
-    // set as a root descriptor.
-    auto matBuffer = mCurrFrameResource->MaterialBuffer->Resource();
-    mCommandList->SetGraphicsRootShaderResourceView(2, matBuffer->GetGPUVirtualAddress());
-	
-    // Bind null SRV for shadow map pass.
-    mCommandList->SetGraphicsRootDescriptorTable(3, mNullSrv);	 
-
-    // Bind all the textures used in this scene.  Observe
-    // that we only have to specify the first descriptor in the table.  
-    // The root signature knows how many descriptors are expected in the table.
-    mCommandList->SetGraphicsRootDescriptorTable(4, mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-
-    DrawSceneToShadowMap();
-
-	//
-	// Normal/depth pass.
-	//
-	
-	DrawNormalsAndDepth();
-	
-	//
-	// Compute SSAO.
-	// 
-	
-    mCommandList->SetGraphicsRootSignature(mSsaoRootSignature.Get());
-    mSsao->ComputeSsao(mCommandList.Get(), mCurrFrameResource, 3);
-	
-	//
-	// Main rendering pass.
-	//
-	
-    mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
-
-    // Rebind state whenever graphics root signature changes.
-
-    // Bind all the materials used in this scene.  For structured buffers, we can bypass the heap and 
-    // set as a root descriptor.
-    matBuffer = mCurrFrameResource->MaterialBuffer->Resource();
-    mCommandList->SetGraphicsRootShaderResourceView(2, matBuffer->GetGPUVirtualAddress());
-
-
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
-
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
-
-    // Clear the back buffer.
-    mCommandList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
-
-    // WE ALREADY WROTE THE DEPTH INFO TO THE DEPTH BUFFER IN DrawNormalsAndDepth,
-    // SO DO NOT CLEAR DEPTH.
-
-    // Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
-
-	// Bind all the textures used in this scene.  Observe
-    // that we only have to specify the first descriptor in the table.  
-    // The root signature knows how many descriptors are expected in the table.
-    mCommandList->SetGraphicsRootDescriptorTable(4, mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-	
-    auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
-
-    // Bind the sky cube map.  For our demos, we just use one "world" cube map representing the environment
-    // from far away, so all objects will use the same cube map and we only need to set it once per-frame.  
-    // If we wanted to use "local" cube maps, we would have to change them per-object, or dynamically
-    // index into an array of cube maps.
-
-    CD3DX12_GPU_DESCRIPTOR_HANDLE skyTexDescriptor(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-    skyTexDescriptor.Offset(mSkyTexHeapIndex, mCbvSrvUavDescriptorSize);
-    mCommandList->SetGraphicsRootDescriptorTable(3, skyTexDescriptor);
-
-    mCommandList->SetPipelineState(mPSOs["opaque"].Get());
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
-
-    mCommandList->SetPipelineState(mPSOs["debug"].Get());
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Debug]);
-
-	mCommandList->SetPipelineState(mPSOs["sky"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Sky]);
-
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
-
-    // Done recording commands.
-    ThrowIfFailed(mCommandList->Close());
-
-    // Add the command list to the queue for execution.
-    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+    // Record the passes in parallel and submit them in one ExecuteCommandLists.
+    // The frame graph keeps command allocators per frame resource, and Update has
+    // waited for the GPU to finish with this one.
+    mFrameGraph->Execute(mCurrFrameResourceIndex);
 
     // Swap the back and front buffers
     ThrowIfFailed(mSwapChain->Present(0, 0));
@@ -803,6 +740,8 @@ void SsaoApp::BuildRootSignature()
         serializedRootSig->GetBufferPointer(),
         serializedRootSig->GetBufferSize(),
         IID_PPV_ARGS(mRootSignature.GetAddressOf())));
+
+    mPSOs->AddRootSignature(mRootSignature.Get(), serializedRootSig.Get());
 }
 
 void SsaoApp::BuildSsaoRootSignature()
@@ -881,24 +820,12 @@ void SsaoApp::BuildSsaoRootSignature()
         serializedRootSig->GetBufferPointer(),
         serializedRootSig->GetBufferSize(),
         IID_PPV_ARGS(mSsaoRootSignature.GetAddressOf())));
+
+    mPSOs->AddRootSignature(mSsaoRootSignature.Get(), serializedRootSig.Get());
 }
 
 void SsaoApp::BuildDescriptorHeaps()
 {
-	//
-	// Create the SRV heap.
-	//
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 18;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
-
-	//
-	// Fill out the heap with actual descriptors.
-	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
 	std::vector<ComPtr<ID3D12Resource>> tex2DList = 
 	{
 		mTextures["bricksDiffuseMap"]->Resource,
@@ -911,6 +838,19 @@ void SsaoApp::BuildDescriptorHeaps()
 	
 	auto skyCubeMap = mTextures["skyCubeMap"]->Resource;
 
+	//
+	// Create the SRV heap and allocate its ranges.
+	//
+	mSrvHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+		(UINT)tex2DList.size() + gSceneSrvCount + gNullSrvCount, 0, true);
+
+	mTextureSrvs = mSrvHeap->Allocate((UINT)tex2DList.size());
+	mSceneSrvs = mSrvHeap->Allocate(gSceneSrvCount);
+	mNullSrvs = mSrvHeap->Allocate(gNullSrvCount);
+
+	//
+	// Fill out the heap with actual descriptors.
+	//
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
@@ -921,10 +861,7 @@ void SsaoApp::BuildDescriptorHeaps()
 	{
 		srvDesc.Format = tex2DList[i]->GetDesc().Format;
 		srvDesc.Texture2D.MipLevels = tex2DList[i]->GetDesc().MipLevels;
-		md3dDevice->CreateShaderResourceView(tex2DList[i].Get(), &srvDesc, hDescriptor);
-
-		// next descriptor
-		hDescriptor.Offset(1, mCbvSrvUavDescriptorSize);
+		md3dDevice->CreateShaderResourceView(tex2DList[i].Get(), &srvDesc, mSrvHeap->CpuHandle(mTextureSrvs, i));
 	}
 	
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
@@ -932,41 +869,29 @@ void SsaoApp::BuildDescriptorHeaps()
 	srvDesc.TextureCube.MipLevels = skyCubeMap->GetDesc().MipLevels;
 	srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
 	srvDesc.Format = skyCubeMap->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(skyCubeMap.Get(), &srvDesc, hDescriptor);
-	
-	mSkyTexHeapIndex = (UINT)tex2DList.size();
-    mShadowMapHeapIndex = mSkyTexHeapIndex + 1;
-    mSsaoHeapIndexStart = mShadowMapHeapIndex + 1;
-    mSsaoAmbientMapIndex = mSsaoHeapIndexStart + 3;
-    mNullCubeSrvIndex = mSsaoHeapIndexStart + 5;
-    mNullTexSrvIndex1 = mNullCubeSrvIndex + 1;
-    mNullTexSrvIndex2 = mNullTexSrvIndex1 + 1;
+	md3dDevice->CreateShaderResourceView(skyCubeMap.Get(), &srvDesc, mSrvHeap->CpuHandle(mSceneSrvs, gSkySrv));
 
-    auto nullSrv = GetCpuSrv(mNullCubeSrvIndex);
-    mNullSrv = GetGpuSrv(mNullCubeSrvIndex);
-
-    md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, nullSrv);
-    nullSrv.Offset(1, mCbvSrvUavDescriptorSize);
+    md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, mSrvHeap->CpuHandle(mNullSrvs, 0));
 
     srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
     srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
     srvDesc.Texture2D.MostDetailedMip = 0;
     srvDesc.Texture2D.MipLevels = 1;
     srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-    md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, nullSrv);
-
-    nullSrv.Offset(1, mCbvSrvUavDescriptorSize);
-    md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, nullSrv);
+    md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, mSrvHeap->CpuHandle(mNullSrvs, 1));
+    md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, mSrvHeap->CpuHandle(mNullSrvs, 2));
 
     mShadowMap->BuildDescriptors(
-        GetCpuSrv(mShadowMapHeapIndex),
-        GetGpuSrv(mShadowMapHeapIndex),
+        mSrvHeap->CpuHandle(mSceneSrvs, gShadowMapSrv),
+        mSrvHeap->GpuHandle(mSceneSrvs, gShadowMapSrv),
         GetDsv(1));
 
+    // The SSAO descriptors keep their slots, so Ssao::OnResize rewrites the views in
+    // place through RebuildDescriptors.
     mSsao->BuildDescriptors(
         mDepthStencilBuffer.Get(),
-        GetCpuSrv(mSsaoHeapIndexStart),
-        GetGpuSrv(mSsaoHeapIndexStart),
+        mSrvHeap->CpuHandle(mSceneSrvs, gSsaoSrvStart),
+        mSrvHeap->GpuHandle(mSceneSrvs, gSsaoSrvStart),
         GetRtv(SwapChainBufferCount),
         mCbvSrvUavDescriptorSize,
         mRtvDescriptorSize);
@@ -974,33 +899,39 @@ void SsaoApp::BuildDescriptorHeaps()
 
 void SsaoApp::BuildShadersAndInputLayout()
 {
-	const D3D_SHADER_MACRO alphaTestDefines[] =
+	const std::vector<std::pair<std::string, std::string>> alphaTestDefines =
 	{
-		"ALPHA_TEST", "1",
-		NULL, NULL
+		{ "ALPHA_TEST", "1" }
 	};
 
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
+	mShaders->Add("standardVS", { "Shaders\\Default.hlsl", {}, "VS", "vs_5_1" });
+	mShaders->Add("opaquePS", { "Shaders\\Default.hlsl", {}, "PS", "ps_5_1" });
 
-    mShaders["shadowVS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["shadowOpaquePS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "PS", "ps_5_1");
-    mShaders["shadowAlphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", alphaTestDefines, "PS", "ps_5_1");
+    mShaders->Add("shadowVS", { "Shaders\\Shadows.hlsl", {}, "VS", "vs_5_1" });
+    mShaders->Add("shadowOpaquePS", { "Shaders\\Shadows.hlsl", {}, "PS", "ps_5_1" });
+    mShaders->Add("shadowAlphaTestedPS", { "Shaders\\Shadows.hlsl", alphaTestDefines, "PS", "ps_5_1" });
 	
-    mShaders["debugVS"] = d3dUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["debugPS"] = d3dUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "PS", "ps_5_1");
+    mShaders->Add("debugVS", { "Shaders\\ShadowDebug.hlsl", {}, "VS", "vs_5_1" });
+    mShaders->Add("debugPS", { "Shaders\\ShadowDebug.hlsl", {}, "PS", "ps_5_1" });
+
+    mShaders->Add("drawNormalsVS", { "Shaders\\DrawNormals.hlsl", {}, "VS", "vs_5_1" });
+    mShaders->Add("drawNormalsPS", { "Shaders\\DrawNormals.hlsl", {}, "PS", "ps_5_1" });
 
-    mShaders["drawNormalsVS"] = d3dUtil::CompileShader(L"Shaders\\DrawNormals.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["drawNormalsPS"] = d3dUtil::CompileShader(L"Shaders\\DrawNormals.hlsl", nullptr, "PS", "ps_5_1");
+    mShaders->Add("ssaoVS", { "Shaders\\Ssao.hlsl", {}, "VS", "vs_5_1" });
+    mShaders->Add("ssaoPS", { "Shaders\\Ssao.hlsl", {}, "PS", "ps_5_1" });
 
-    mShaders["ssaoVS"] = d3dUtil::CompileShader(L"Shaders\\Ssao.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["ssaoPS"] = d3dUtil::CompileShader(L"Shaders\\Ssao.hlsl", nullptr, "PS", "ps_5_1");
+    mShaders->Add("ssaoBlurVS", { "Shaders\\SsaoBlur.hlsl", {}, "VS", "vs_5_1" });
+    mShaders->Add("ssaoBlurPS", { "Shaders\\SsaoBlur.hlsl", {}, "PS", "ps_5_1" });
 
-    mShaders["ssaoBlurVS"] = d3dUtil::CompileShader(L"Shaders\\SsaoBlur.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["ssaoBlurPS"] = d3dUtil::CompileShader(L"Shaders\\SsaoBlur.hlsl", nullptr, "PS", "ps_5_1");
+	mShaders->Add("skyVS", { "Shaders\\Sky.hlsl", {}, "VS", "vs_5_1" });
+	mShaders->Add("skyPS", { "Shaders\\Sky.hlsl", {}, "PS", "ps_5_1" });
 
-	mShaders["skyVS"] = d3dUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["skyPS"] = d3dUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "PS", "ps_5_1");
+    ShaderCache::Stats stats = mShaders->Build(*mJobs);
+
+    std::wstring text = L"Shaders: " + std::to_wstring(stats.ShaderCount) + L" built, " +
+        std::to_wstring(stats.CompileCount) + L" compiled, " +
+        std::to_wstring(stats.DiskHitCount) + L" from disk\n";
+    ::OutputDebugString(text.c_str());
 
     mInputLayout =
     {
@@ -1278,16 +1209,8 @@ void SsaoApp::BuildPSOs()
     ZeroMemory(&basePsoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
     basePsoDesc.InputLayout = { mInputLayout.data(), (UINT)mInputLayout.size() };
     basePsoDesc.pRootSignature = mRootSignature.Get();
-    basePsoDesc.VS =
-	{ 
-		reinterpret_cast<BYTE*>(mShaders["standardVS"]->GetBufferPointer()), 
-		mShaders["standardVS"]->GetBufferSize()
-	};
-    basePsoDesc.PS =
-	{ 
-		reinterpret_cast<BYTE*>(mShaders["opaquePS"]->GetBufferPointer()),
-		mShaders["opaquePS"]->GetBufferSize()
-	};
+    basePsoDesc.VS = ShaderBytecode(*mShaders, "standardVS");
+    basePsoDesc.PS = ShaderBytecode(*mShaders, "opaquePS");
     basePsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     basePsoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
     basePsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
@@ -1306,7 +1229,7 @@ void SsaoApp::BuildPSOs()
     D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc = basePsoDesc;
     opaquePsoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL;
     opaquePsoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["opaque"])));
+    mPSOs->Add("opaque", opaquePsoDesc);
 
     //
     // PSO for shadow map pass.
@@ -1316,58 +1239,34 @@ void SsaoApp::BuildPSOs()
     smapPsoDesc.RasterizerState.DepthBiasClamp = 0.0f;
     smapPsoDesc.RasterizerState.SlopeScaledDepthBias = 1.0f;
     smapPsoDesc.pRootSignature = mRootSignature.Get();
-    smapPsoDesc.VS =
-    {
-        reinterpret_cast<BYTE*>(mShaders["shadowVS"]->GetBufferPointer()),
-        mShaders["shadowVS"]->GetBufferSize()
-    };
-    smapPsoDesc.PS =
-    {
-        reinterpret_cast<BYTE*>(mShaders["shadowOpaquePS"]->GetBufferPointer()),
-        mShaders["shadowOpaquePS"]->GetBufferSize()
-    };
+    smapPsoDesc.VS = ShaderBytecode(*mShaders, "shadowVS");
+    smapPsoDesc.PS = ShaderBytecode(*mShaders, "shadowOpaquePS");
     
     // Shadow map pass does not have a render target.
     smapPsoDesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
     smapPsoDesc.NumRenderTargets = 0;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&smapPsoDesc, IID_PPV_ARGS(&mPSOs["shadow_opaque"])));
+    mPSOs->Add("shadow_opaque", smapPsoDesc);
 
     //
     // PSO for debug layer.
     //
     D3D12_GRAPHICS_PIPELINE_STATE_DESC debugPsoDesc = basePsoDesc;
     debugPsoDesc.pRootSignature = mRootSignature.Get();
-    debugPsoDesc.VS =
-    {
-        reinterpret_cast<BYTE*>(mShaders["debugVS"]->GetBufferPointer()),
-        mShaders["debugVS"]->GetBufferSize()
-    };
-    debugPsoDesc.PS =
-    {
-        reinterpret_cast<BYTE*>(mShaders["debugPS"]->GetBufferPointer()),
-        mShaders["debugPS"]->GetBufferSize()
-    };
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&debugPsoDesc, IID_PPV_ARGS(&mPSOs["debug"])));
+    debugPsoDesc.VS = ShaderBytecode(*mShaders, "debugVS");
+    debugPsoDesc.PS = ShaderBytecode(*mShaders, "debugPS");
+    mPSOs->Add("debug", debugPsoDesc);
 
     //
     // PSO for drawing normals.
     //
     D3D12_GRAPHICS_PIPELINE_STATE_DESC drawNormalsPsoDesc = basePsoDesc;
-    drawNormalsPsoDesc.VS =
-    {
-        reinterpret_cast<BYTE*>(mShaders["drawNormalsVS"]->GetBufferPointer()),
-        mShaders["drawNormalsVS"]->GetBufferSize()
-    };
-    drawNormalsPsoDesc.PS =
-    {
-        reinterpret_cast<BYTE*>(mShaders["drawNormalsPS"]->GetBufferPointer()),
-        mShaders["drawNormalsPS"]->GetBufferSize()
-    };
+    drawNormalsPsoDesc.VS = ShaderBytecode(*mShaders, "drawNormalsVS");
+    drawNormalsPsoDesc.PS = ShaderBytecode(*mShaders, "drawNormalsPS");
     drawNormalsPsoDesc.RTVFormats[0] = Ssao::NormalMapFormat;
     drawNormalsPsoDesc.SampleDesc.Count = 1;
     drawNormalsPsoDesc.SampleDesc.Quality = 0;
     drawNormalsPsoDesc.DSVFormat = mDepthStencilFormat;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&drawNormalsPsoDesc, IID_PPV_ARGS(&mPSOs["drawNormals"])));
+    mPSOs->Add("drawNormals", drawNormalsPsoDesc);
 
     //
     // PSO for SSAO.
@@ -1375,16 +1274,8 @@ void SsaoApp::BuildPSOs()
     D3D12_GRAPHICS_PIPELINE_STATE_DESC ssaoPsoDesc = basePsoDesc;
     ssaoPsoDesc.InputLayout = { nullptr, 0 };
     ssaoPsoDesc.pRootSignature = mSsaoRootSignature.Get();
-    ssaoPsoDesc.VS =
-    {
-        reinterpret_cast<BYTE*>(mShaders["ssaoVS"]->GetBufferPointer()),
-        mShaders["ssaoVS"]->GetBufferSize()
-    };
-    ssaoPsoDesc.PS =
-    {
-        reinterpret_cast<BYTE*>(mShaders["ssaoPS"]->GetBufferPointer()),
-        mShaders["ssaoPS"]->GetBufferSize()
-    };
+    ssaoPsoDesc.VS = ShaderBytecode(*mShaders, "ssaoVS");
+    ssaoPsoDesc.PS = ShaderBytecode(*mShaders, "ssaoPS");
 
     // SSAO effect does not need the depth buffer.
     ssaoPsoDesc.DepthStencilState.DepthEnable = false;
@@ -1393,23 +1284,15 @@ void SsaoApp::BuildPSOs()
     ssaoPsoDesc.SampleDesc.Count = 1;
     ssaoPsoDesc.SampleDesc.Quality = 0;
     ssaoPsoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&ssaoPsoDesc, IID_PPV_ARGS(&mPSOs["ssao"])));
+    mPSOs->Add("ssao", ssaoPsoDesc);
 
     //
     // PSO for SSAO blur.
     //
     D3D12_GRAPHICS_PIPELINE_STATE_DESC ssaoBlurPsoDesc = ssaoPsoDesc;
-    ssaoBlurPsoDesc.VS =
-    {
-        reinterpret_cast<BYTE*>(mShaders["ssaoBlurVS"]->GetBufferPointer()),
-        mShaders["ssaoBlurVS"]->GetBufferSize()
-    };
-    ssaoBlurPsoDesc.PS =
-    {
-        reinterpret_cast<BYTE*>(mShaders["ssaoBlurPS"]->GetBufferPointer()),
-        mShaders["ssaoBlurPS"]->GetBufferSize()
-    };
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&ssaoBlurPsoDesc, IID_PPV_ARGS(&mPSOs["ssaoBlur"])));
+    ssaoBlurPsoDesc.VS = ShaderBytecode(*mShaders, "ssaoBlurVS");
+    ssaoBlurPsoDesc.PS = ShaderBytecode(*mShaders, "ssaoBlurPS");
+    mPSOs->Add("ssaoBlur", ssaoBlurPsoDesc);
 
 	//
 	// PSO for sky.
@@ -1424,18 +1307,16 @@ void SsaoApp::BuildPSOs()
 	// fail the depth test if the depth buffer was cleared to 1.
 	skyPsoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
 	skyPsoDesc.pRootSignature = mRootSignature.Get();
-	skyPsoDesc.VS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["skyVS"]->GetBufferPointer()),
-		mShaders["skyVS"]->GetBufferSize()
-	};
-	skyPsoDesc.PS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["skyPS"]->GetBufferPointer()),
-		mShaders["skyPS"]->GetBufferSize()
-	};
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&skyPsoDesc, IID_PPV_ARGS(&mPSOs["sky"])));
+	skyPsoDesc.VS = ShaderBytecode(*mShaders, "skyVS");
+	skyPsoDesc.PS = ShaderBytecode(*mShaders, "skyPS");
+	mPSOs->Add("sky", skyPsoDesc);
+
+    PipelineCache::Stats stats = mPSOs->Build(*mJobs);
 
+    std::wstring text = L"PSOs: " + std::to_wstring(stats.PipelineCount) + L" built, " +
+        std::to_wstring(stats.CreateCount) + L" created, " +
+        std::to_wstring(stats.DiskHitCount) + L" from disk\n";
+    ::OutputDebugString(text.c_str());
 }
 
 void SsaoApp::BuildFrameResources()
@@ -1447,6 +1328,42 @@ void SsaoApp::BuildFrameResources()
     }
 }
 
+void SsaoApp::BuildFrameGraph()
+{
+    mCommandBackend = std::make_unique<D3D12CommandBackend>(md3dDevice.Get(), mCommandQueue.Get());
+    mFrameGraph = std::make_unique<FrameGraph<D3D12CommandBackend>>(*mCommandBackend, *mJobs, gNumFrameResources);
+
+    // The lists run in the order the passes are added, so each pass sees the
+    // results of the ones before.
+
+    mFrameGraph->AddPass("shadow", [this](D3D12CommandBackend::CommandList& cmdList)
+    {
+        SetSceneRootArguments(cmdList.Get());
+        DrawSceneToShadowMap(cmdList.Get());
+    });
+
+    mFrameGraph->AddPass("normals and depth", [this](D3D12CommandBackend::CommandList& cmdList)
+    {
+        SetSceneRootArguments(cmdList.Get());
+        DrawNormalsAndDepth(cmdList.Get());
+    });
+
+    mFrameGraph->AddPass("ssao", [this](D3D12CommandBackend::CommandList& cmdList)
+    {
+        ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvHeap->Heap() };
+        cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+
+        cmdList->SetGraphicsRootSignature(mSsaoRootSignature.Get());
+        mSsao->ComputeSsao(cmdList.Get(), mCurrFrameResource, 3);
+    });
+
+    mFrameGraph->AddPass("main", [this](D3D12CommandBackend::CommandList& cmdList)
+    {
+        SetSceneRootArguments(cmdList.Get());
+        DrawSceneToBackBuffer(cmdList.Get());
+    });
+}
+
 void SsaoApp::BuildMaterials()
 {
     auto bricks0 = std::make_unique<Material>();
@@ -1640,6 +1557,29 @@ void SsaoApp::BuildRenderItems()
 	}
 }
 
+void SsaoApp::SetSceneRootArguments(ID3D12GraphicsCommandList* cmdList)
+{
+    // Every pass records into its own command list, which starts with no state set.
+
+    ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvHeap->Heap() };
+    cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+
+    cmdList->SetGraphicsRootSignature(mRootSignature.Get());
+
+    // Bind all the materials used in this scene.  For structured buffers, we can bypass the heap and 
+    // set as a root descriptor.
+    auto matBuffer = mCurrFrameResource->MaterialBuffer->Resource();
+    cmdList->SetGraphicsRootShaderResourceView(2, matBuffer->GetGPUVirtualAddress());
+
+    // Bind null SRV for the cube map; the main pass binds the sky instead.
+    cmdList->SetGraphicsRootDescriptorTable(3, mSrvHeap->GpuHandle(mNullSrvs));
+
+    // Bind all the textures used in this scene.  Observe
+    // that we only have to specify the first descriptor in the table.  
+    // The root signature knows how many descriptors are expected in the table.
+    cmdList->SetGraphicsRootDescriptorTable(4, mSrvHeap->GpuHandle(mTextureSrvs));
+}
+
 void SsaoApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
@@ -1663,82 +1603,110 @@ void SsaoApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vec
     }
 }
 
-void SsaoApp::DrawSceneToShadowMap()
+void SsaoApp::DrawSceneToShadowMap(ID3D12GraphicsCommandList* cmdList)
 {
-    mCommandList->RSSetViewports(1, &mShadowMap->Viewport());
-    mCommandList->RSSetScissorRects(1, &mShadowMap->ScissorRect());
+    cmdList->RSSetViewports(1, &mShadowMap->Viewport());
+    cmdList->RSSetScissorRects(1, &mShadowMap->ScissorRect());
 
     // Change to DEPTH_WRITE.
-    mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
+    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
         D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE));
 
     // Clear the back buffer and depth buffer.
-    mCommandList->ClearDepthStencilView(mShadowMap->Dsv(), 
+    cmdList->ClearDepthStencilView(mShadowMap->Dsv(), 
         D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
     // Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(0, nullptr, false, &mShadowMap->Dsv());
+    cmdList->OMSetRenderTargets(0, nullptr, false, &mShadowMap->Dsv());
 
     // Bind the pass constant buffer for the shadow map pass.
     UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
     auto passCB = mCurrFrameResource->PassCB->Resource();
     D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = passCB->GetGPUVirtualAddress() + 1*passCBByteSize;
-    mCommandList->SetGraphicsRootConstantBufferView(1, passCBAddress);
+    cmdList->SetGraphicsRootConstantBufferView(1, passCBAddress);
 
-    mCommandList->SetPipelineState(mPSOs["shadow_opaque"].Get());
+    cmdList->SetPipelineState(mPSOs->Get("shadow_opaque"));
 
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+    DrawRenderItems(cmdList, mRitemLayer[(int)RenderLayer::Opaque]);
 
     // Change back to GENERIC_READ so we can read the texture in a shader.
-    mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
+    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
         D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_GENERIC_READ));
 }
  
-void SsaoApp::DrawNormalsAndDepth()
+void SsaoApp::DrawNormalsAndDepth(ID3D12GraphicsCommandList* cmdList)
 {
-	mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
+	cmdList->RSSetViewports(1, &mScreenViewport);
+    cmdList->RSSetScissorRects(1, &mScissorRect);
 
 	auto normalMap = mSsao->NormalMap();
 	auto normalMapRtv = mSsao->NormalMapRtv();
 	
     // Change to RENDER_TARGET.
-    mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(normalMap,
+    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(normalMap,
         D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_RENDER_TARGET));
 
 	// Clear the screen normal map and depth buffer.
 	float clearValue[] = {0.0f, 0.0f, 1.0f, 0.0f};
-    mCommandList->ClearRenderTargetView(normalMapRtv, clearValue, 0, nullptr);
-    mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+    cmdList->ClearRenderTargetView(normalMapRtv, clearValue, 0, nullptr);
+    cmdList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
 	// Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(1, &normalMapRtv, true, &DepthStencilView());
+    cmdList->OMSetRenderTargets(1, &normalMapRtv, true, &DepthStencilView());
 
     // Bind the constant buffer for this pass.
     auto passCB = mCurrFrameResource->PassCB->Resource();
-    mCommandList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
+    cmdList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
 
-    mCommandList->SetPipelineState(mPSOs["drawNormals"].Get());
+    cmdList->SetPipelineState(mPSOs->Get("drawNormals"));
 
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+    DrawRenderItems(cmdList, mRitemLayer[(int)RenderLayer::Opaque]);
 
     // Change back to GENERIC_READ so we can read the texture in a shader.
-    mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(normalMap,
+    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(normalMap,
         D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_GENERIC_READ));
 }
 
-CD3DX12_CPU_DESCRIPTOR_HANDLE SsaoApp::GetCpuSrv(int index)const
+void SsaoApp::DrawSceneToBackBuffer(ID3D12GraphicsCommandList* cmdList)
 {
-    auto srv = CD3DX12_CPU_DESCRIPTOR_HANDLE(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-    srv.Offset(index, mCbvSrvUavDescriptorSize);
-    return srv;
-}
+    cmdList->RSSetViewports(1, &mScreenViewport);
+    cmdList->RSSetScissorRects(1, &mScissorRect);
 
-CD3DX12_GPU_DESCRIPTOR_HANDLE SsaoApp::GetGpuSrv(int index)const
-{
-    auto srv = CD3DX12_GPU_DESCRIPTOR_HANDLE(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-    srv.Offset(index, mCbvSrvUavDescriptorSize);
-    return srv;
+    // Indicate a state transition on the resource usage.
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
+		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+
+    // Clear the back buffer.
+    cmdList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
+
+    // WE ALREADY WROTE THE DEPTH INFO TO THE DEPTH BUFFER IN DrawNormalsAndDepth,
+    // SO DO NOT CLEAR DEPTH.
+
+    // Specify the buffers we are going to render to.
+    cmdList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+
+    auto passCB = mCurrFrameResource->PassCB->Resource();
+	cmdList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
+
+    // Bind the sky cube map.  For our demos, we just use one "world" cube map representing the environment
+    // from far away, so all objects will use the same cube map and we only need to set it once per-frame.  
+    // If we wanted to use "local" cube maps, we would have to change them per-object, or dynamically
+    // index into an array of cube maps.
+
+    cmdList->SetGraphicsRootDescriptorTable(3, mSrvHeap->GpuHandle(mSceneSrvs, gSkySrv));
+
+    cmdList->SetPipelineState(mPSOs->Get("opaque"));
+    DrawRenderItems(cmdList, mRitemLayer[(int)RenderLayer::Opaque]);
+
+    cmdList->SetPipelineState(mPSOs->Get("debug"));
+    DrawRenderItems(cmdList, mRitemLayer[(int)RenderLayer::Debug]);
+
+	cmdList->SetPipelineState(mPSOs->Get("sky"));
+	DrawRenderItems(cmdList, mRitemLayer[(int)RenderLayer::Sky]);
+
+    // Indicate a state transition on the resource usage.
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
+		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 }
 
 CD3DX12_CPU_DESCRIPTOR_HANDLE SsaoApp::GetDsv(int index)const
@@ -2,12 +2,14 @@
 // LandAndWavesApp.cpp by Frank Luna (C) 2015 All Rights Reserved.
 //
 // Hold down '1' key to view scene in wireframe mode.
+// Use the WASD keys to move over the terrain.
 //***************************************************************************************
 
 #include "../../Common/d3dApp.h"
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/ChunkedTerrain.h"
 #include "FrameResource.h"
 #include "Waves.h"
 
@@ -28,17 +30,15 @@ struct RenderItem
 	// and scale of the object in the world.
 	XMFLOAT4X4 World = MathHelper::Identity4x4();
 
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
-
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
+	// Index into the frame's object constants corresponding to the ObjectCB for this
+	// render item.  The object constants are written to the upload ring every frame.
 	UINT ObjCBIndex = -1;
 
 	MeshGeometry* Geo = nullptr;
 
+	// If set, used instead of Geo's vertex buffer for this frame.
+	D3D12_GPU_VIRTUAL_ADDRESS DynamicVertices = 0;
+
 	// Primitive topology.
 	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -78,6 +78,8 @@ private:
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 	void UpdateWaves(const GameTimer& gt);
+	void UpdateTerrain(const GameTimer& gt);
+	UploadRing::Allocation AllocateFrameUpload(UINT64 byteSize, UINT64 alignment);
 
     void BuildRootSignature();
     void BuildShadersAndInputLayout();
@@ -87,9 +89,12 @@ private:
     void BuildFrameResources();
     void BuildRenderItems();
 	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void DrawTerrain(ID3D12GraphicsCommandList* cmdList);
 
     float GetHillsHeight(float x, float z)const;
+    XMVECTOR GetHillsHeight(FXMVECTOR x, FXMVECTOR z)const;
     XMFLOAT3 GetHillsNormal(float x, float z)const;
+    XMFLOAT4 GetHillsColor(float y)const;
 
 private:
 
@@ -107,8 +112,23 @@ private:
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
+	// Constants and wave vertices of the frames in flight, recycled by fence value.
+	std::unique_ptr<UploadRingBuffer> mFrameUploads;
+
 	RenderItem* mWavesRitem = nullptr;
 
+	// Supplies the object constants and the shared index buffer of the terrain chunks.
+	RenderItem* mLandRitem = nullptr;
+
+	std::unique_ptr<ChunkedTerrain> mTerrain;
+
+	// Vertex buffers of the resident terrain chunks.
+	std::unordered_map<ChunkedTerrain::ChunkKey, std::unique_ptr<UploadBuffer<Vertex>>> mTerrainVBs;
+
+	// Vertex buffers of evicted chunks, with the fence value of the last frame that may
+	// have drawn them.
+	std::vector<std::pair<UINT64, std::unique_ptr<UploadBuffer<Vertex>>>> mRetiredTerrainVBs;
+
 	// List of all the render items.
 	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
 
@@ -129,6 +149,9 @@ private:
     float mPhi = XM_PIDIV2 - 0.1f;
     float mRadius = 50.0f;
 
+	// Point the camera orbits, moved over the terrain with WASD.
+	XMFLOAT3 mTarget = { 0.0f, 0.0f, 0.0f };
+
 	float mSunTheta = 1.25f*XM_PI;
 	float mSunPhi = XM_PIDIV4;
 
@@ -227,9 +250,12 @@ void LandAndWavesApp::Update(const GameTimer& gt)
 		CloseHandle(eventHandle);
 	}
 
+	mFrameUploads->Ring().Reclaim(mFence->GetCompletedValue());
+
 	UpdateObjectCBs(gt);
 	UpdateMainPassCB(gt);
 	UpdateWaves(gt);
+	UpdateTerrain(gt);
 }
 
 void LandAndWavesApp::Draw(const GameTimer& gt)
@@ -268,10 +294,10 @@ void LandAndWavesApp::Draw(const GameTimer& gt)
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
     // Bind per-pass constant buffer.  We only need to do this once per-pass.
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
+	mCommandList->SetGraphicsRootConstantBufferView(1, mCurrFrameResource->PassCB);
 
 	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+	DrawTerrain(mCommandList.Get());
 
 	// Indicate a state transition on the resource usage.
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
@@ -290,6 +316,7 @@ void LandAndWavesApp::Draw(const GameTimer& gt)
 
 	// Advance the fence value to mark commands up to this fence point.
 	mCurrFrameResource->Fence = ++mCurrentFence;
+	mFrameUploads->Ring().FinishFrame(mCurrentFence);
 
 	// Add an instruction to the command queue to set a new fence point. 
     // Because we are on the GPU timeline, the new fence point won't be 
@@ -335,7 +362,7 @@ void LandAndWavesApp::OnMouseMove(WPARAM btnState, int x, int y)
         mRadius += dx - dy;
 
         // Restrict the radius.
-        mRadius = MathHelper::Clamp(mRadius, 5.0f, 150.0f);
+        mRadius = MathHelper::Clamp(mRadius, 5.0f, 400.0f);
     }
 
     mLastMousePos.x = x;
@@ -348,18 +375,47 @@ void LandAndWavesApp::OnKeyboardInput(const GameTimer& gt)
         mIsWireframe = true;
     else
         mIsWireframe = false;
+
+	// Move the orbit target along the ground, relative to the view direction, faster
+	// when zoomed out.
+	float speed = 2.0f*mRadius*gt.DeltaTime();
+	float forwardX = -cosf(mTheta);
+	float forwardZ = -sinf(mTheta);
+
+	if(GetAsyncKeyState('W') & 0x8000)
+	{
+		mTarget.x += speed*forwardX;
+		mTarget.z += speed*forwardZ;
+	}
+	if(GetAsyncKeyState('S') & 0x8000)
+	{
+		mTarget.x -= speed*forwardX;
+		mTarget.z -= speed*forwardZ;
+	}
+	if(GetAsyncKeyState('A') & 0x8000)
+	{
+		mTarget.x -= speed*forwardZ;
+		mTarget.z += speed*forwardX;
+	}
+	if(GetAsyncKeyState('D') & 0x8000)
+	{
+		mTarget.x += speed*forwardZ;
+		mTarget.z -= speed*forwardX;
+	}
+
+	mTarget.y = MathHelper::Max(GetHillsHeight(mTarget.x, mTarget.z), 0.0f);
 }
 
 void LandAndWavesApp::UpdateCamera(const GameTimer& gt)
 {
 	// Convert Spherical to Cartesian coordinates.
-	mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
-	mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
-	mEyePos.y = mRadius*cosf(mPhi);
+	mEyePos.x = mTarget.x + mRadius*sinf(mPhi)*cosf(mTheta);
+	mEyePos.z = mTarget.z + mRadius*sinf(mPhi)*sinf(mTheta);
+	mEyePos.y = mTarget.y + mRadius*cosf(mPhi);
 
 	// Build the view matrix.
 	XMVECTOR pos = XMVectorSet(mEyePos.x, mEyePos.y, mEyePos.z, 1.0f);
-	XMVECTOR target = XMVectorZero();
+	XMVECTOR target = XMLoadFloat3(&mTarget);
 	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
 
 	XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
@@ -368,24 +424,22 @@ void LandAndWavesApp::UpdateCamera(const GameTimer& gt)
 
 void LandAndWavesApp::UpdateObjectCBs(const GameTimer& gt)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
+	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+
+	// The ring memory of a frame is fresh, so every object is written every frame.
+	auto objectCBs = AllocateFrameUpload(mAllRitems.size()*objCBByteSize, UploadRing::ConstantBufferAlignment);
+
 	for(auto& e : mAllRitems)
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if(e->NumFramesDirty > 0)
-		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
+		XMMATRIX world = XMLoadFloat4x4(&e->World);
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
+		ObjectConstants objConstants;
+		XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
-
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
-		}
+		memcpy(objectCBs.CpuAddress + e->ObjCBIndex*objCBByteSize, &objConstants, sizeof(ObjectConstants));
 	}
+
+	mCurrFrameResource->ObjectCB = objectCBs.GpuAddress;
 }
 
 void LandAndWavesApp::UpdateMainPassCB(const GameTimer& gt)
@@ -412,8 +466,11 @@ void LandAndWavesApp::UpdateMainPassCB(const GameTimer& gt)
 	mMainPassCB.TotalTime = gt.TotalTime();
 	mMainPassCB.DeltaTime = gt.DeltaTime();
 
-	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
+	UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
+	auto passCB = AllocateFrameUpload(passCBByteSize, UploadRing::ConstantBufferAlignment);
+	memcpy(passCB.CpuAddress, &mMainPassCB, sizeof(PassConstants));
+
+	mCurrFrameResource->PassCB = passCB.GpuAddress;
 }
 
 void LandAndWavesApp::UpdateWaves(const GameTimer& gt)
@@ -436,19 +493,82 @@ void LandAndWavesApp::UpdateWaves(const GameTimer& gt)
 	mWaves->Update(gt.DeltaTime());
 
 	// Update the wave vertex buffer with the new solution.
-	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	auto wavesVB = AllocateFrameUpload(mWaves->VertexCount()*sizeof(Vertex), 16);
+
+	Vertex* vertices = wavesVB.Data<Vertex>();
 	for(int i = 0; i < mWaves->VertexCount(); ++i)
 	{
-		Vertex v;
+		vertices[i].Pos = mWaves->Position(i);
+        vertices[i].Color = XMFLOAT4(DirectX::Colors::Blue);
+	}
 
-		v.Pos = mWaves->Position(i);
-        v.Color = XMFLOAT4(DirectX::Colors::Blue);
+	// Set the dynamic VB of the wave renderitem to the current frame VB.
+	mWavesRitem->DynamicVertices = wavesVB.GpuAddress;
+}
+
+UploadRing::Allocation LandAndWavesApp::AllocateFrameUpload(UINT64 byteSize, UINT64 alignment)
+{
+	auto allocation = mFrameUploads->Ring().Allocate(byteSize, alignment);
 
-		currWavesVB->CopyData(i, v);
+	// The ring is sized for the frames in flight, so this only happens if it was
+	// outgrown.  Let the GPU catch up so every earlier frame's memory is reclaimed,
+	// then try once more.
+	if(!allocation.IsValid())
+	{
+		FlushCommandQueue();
+		mFrameUploads->Ring().Reclaim(mFence->GetCompletedValue());
+		allocation = mFrameUploads->Ring().Allocate(byteSize, alignment);
+
+		if(!allocation.IsValid())
+			throw DxException(E_OUTOFMEMORY, L"UploadRing::Allocate", AnsiToWString(__FILE__), __LINE__);
 	}
 
-	// Set the dynamic VB of the wave renderitem to the current frame VB.
-	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
+	return allocation;
+}
+
+void LandAndWavesApp::UpdateTerrain(const GameTimer& gt)
+{
+	mTerrain->Update(XMLoadFloat3(&mEyePos));
+
+	// Upload the chunks that finished building.  The upload heap is slower for the GPU
+	// to read than a default heap, but needs no copy commands.
+	std::vector<ChunkedTerrain::BuiltChunk> built;
+	mTerrain->TakeBuiltChunks(built);
+	for(auto& chunk : built)
+	{
+		UINT vertexCount = mTerrain->GetChunkVertexCount();
+		auto vb = std::make_unique<UploadBuffer<Vertex>>(md3dDevice.Get(), vertexCount, false);
+
+		const Vertex* vertices = reinterpret_cast<const Vertex*>(chunk.Vertices.data());
+		for(UINT i = 0; i < vertexCount; ++i)
+			vb->CopyData(i, vertices[i]);
+
+		mTerrainVBs[chunk.Key] = std::move(vb);
+	}
+
+	// Frames up to mCurrentFence may still draw the evicted chunks.
+	std::vector<ChunkedTerrain::ChunkKey> evicted;
+	mTerrain->TakeEvictedChunks(evicted);
+	for(auto key : evicted)
+	{
+		auto it = mTerrainVBs.find(key);
+		mRetiredTerrainVBs.push_back(std::make_pair(mCurrentFence, std::move(it->second)));
+		mTerrainVBs.erase(it);
+	}
+
+	UINT64 completedFence = mFence->GetCompletedValue();
+	for(size_t i = 0; i < mRetiredTerrainVBs.size(); )
+	{
+		if(mRetiredTerrainVBs[i].first <= completedFence)
+		{
+			mRetiredTerrainVBs[i] = std::move(mRetiredTerrainVBs.back());
+			mRetiredTerrainVBs.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
 }
 
 void LandAndWavesApp::BuildRootSignature()
@@ -496,82 +616,52 @@ void LandAndWavesApp::BuildShadersAndInputLayout()
 
 void LandAndWavesApp::BuildLandGeometry()
 {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData grid = geoGen.CreateGrid(160.0f, 160.0f, 50, 50);
-
 	//
-	// Extract the vertex elements we are interested and apply the height function to
-	// each vertex.  In addition, color the vertices based on their height so we have
-	// sandy looking beaches, grassy low hills, and snow mountain peaks.
+	// The land is streamed in chunks around the camera (see UpdateTerrain).  Each
+	// chunk gets its own vertex buffer; the index buffer of every level of detail and
+	// stitching variant is shared by all of them and built here.
 	//
 
-	std::vector<Vertex> vertices(grid.Vertices.size());
-	for(size_t i = 0; i < grid.Vertices.size(); ++i)
-	{
-		auto& p = grid.Vertices[i].Position;
-		vertices[i].Pos = p;
-		vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
-
-        // Color the vertex based on its height.
-        if(vertices[i].Pos.y < -10.0f)
-        {
-            // Sandy beach color.
-            vertices[i].Color = XMFLOAT4(1.0f, 0.96f, 0.62f, 1.0f);
-        }
-        else if(vertices[i].Pos.y < 5.0f)
-        {
-            // Light yellow-green.
-            vertices[i].Color = XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f);
-        }
-        else if(vertices[i].Pos.y < 12.0f)
-        {
-            // Dark yellow-green.
-            vertices[i].Color = XMFLOAT4(0.1f, 0.48f, 0.19f, 1.0f);
-        }
-        else if(vertices[i].Pos.y < 20.0f)
-        {
-            // Dark brown.
-            vertices[i].Color = XMFLOAT4(0.45f, 0.39f, 0.34f, 1.0f);
-        }
-        else
-        {
-            // White snow.
-            vertices[i].Color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-        }
-	}
-    
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
+	ChunkedTerrain::Settings settings;
+	settings.ChunkSize = 64.0f;
+	settings.ChunkQuads = 64;
+	settings.LodCount = 5;
+	settings.LodDistance = 100.0f;
+	settings.LoadRadius = 800.0f;
+	settings.MemoryBudget = 64 << 20;
+	settings.VertexStride = sizeof(Vertex);
+
+	mTerrain = std::make_unique<ChunkedTerrain>(settings,
+		[this](const XMVECTOR& x, const XMVECTOR& z) { return GetHillsHeight(x, z); },
+		[this](const GeometryGenerator::Vertex& in, void* out)
+		{
+			// Color the vertex based on its height.
+			Vertex* v = static_cast<Vertex*>(out);
+			v->Pos = in.Position;
+			v->Color = GetHillsColor(in.Position.y);
+		});
 
-	std::vector<std::uint16_t> indices = grid.GetIndices16();
+	const std::vector<std::uint16_t>& indices = mTerrain->GetIndices();
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "landGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+	// Set per chunk.
+	geo->VertexBufferCPU = nullptr;
+	geo->VertexBufferGPU = nullptr;
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
 	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
 		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
 
 	geo->VertexByteStride = sizeof(Vertex);
-	geo->VertexBufferByteSize = vbByteSize;
+	geo->VertexBufferByteSize = mTerrain->GetChunkVertexCount() * sizeof(Vertex);
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
 
-	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
-	submesh.StartIndexLocation = 0;
-	submesh.BaseVertexLocation = 0;
-
-	geo->DrawArgs["grid"] = submesh;
-
 	mGeometries["landGeo"] = std::move(geo);
 }
 
@@ -676,9 +766,16 @@ void LandAndWavesApp::BuildFrameResources()
 {
     for(int i = 0; i < gNumFrameResources; ++i)
     {
-        mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            1, (UINT)mAllRitems.size(), mWaves->VertexCount()));
+        mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get()));
     }
+
+    // Room for the frames in flight plus the current one, and one more for the space
+    // skipped when a frame's data wraps around the end of the ring.
+    UINT64 frameBytes =
+        d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants)) +
+        mAllRitems.size()*d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants)) +
+        mWaves->VertexCount()*sizeof(Vertex) + UploadRing::ConstantBufferAlignment;
+    mFrameUploads = std::make_unique<UploadRingBuffer>(md3dDevice.Get(), (gNumFrameResources + 1)*frameBytes);
 }
 
 void LandAndWavesApp::BuildRenderItems()
@@ -696,16 +793,14 @@ void LandAndWavesApp::BuildRenderItems()
 
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(wavesRitem.get());
 
+	// Drawn chunk by chunk in DrawTerrain, so not in a layer.
 	auto gridRitem = std::make_unique<RenderItem>();
 	gridRitem->World = MathHelper::Identity4x4();
 	gridRitem->ObjCBIndex = 1;
 	gridRitem->Geo = mGeometries["landGeo"].get();
 	gridRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
-	gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-	gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
 
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(gridRitem.get());
+	mLandRitem = gridRitem.get();
 
 	mAllRitems.push_back(std::move(wavesRitem));
 	mAllRitems.push_back(std::move(gridRitem));
@@ -715,18 +810,28 @@ void LandAndWavesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const
 {
 	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
-
 	// For each render item...
 	for(size_t i = 0; i < ritems.size(); ++i)
 	{
 		auto ri = ritems[i];
 
-		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
+		D3D12_VERTEX_BUFFER_VIEW vbv;
+		if(ri->DynamicVertices != 0)
+		{
+			vbv.BufferLocation = ri->DynamicVertices;
+			vbv.StrideInBytes = ri->Geo->VertexByteStride;
+			vbv.SizeInBytes = ri->Geo->VertexBufferByteSize;
+		}
+		else
+		{
+			vbv = ri->Geo->VertexBufferView();
+		}
+
+		cmdList->IASetVertexBuffers(0, 1, &vbv);
 		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
 		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
-        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress();
+        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = mCurrFrameResource->ObjectCB;
         objCBAddress += ri->ObjCBIndex*objCBByteSize;
 
 		cmdList->SetGraphicsRootConstantBufferView(0, objCBAddress);
@@ -735,11 +840,47 @@ void LandAndWavesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const
 	}
 }
 
+void LandAndWavesApp::DrawTerrain(ID3D12GraphicsCommandList* cmdList)
+{
+	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+
+	auto ri = mLandRitem;
+
+	cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
+	cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+
+	D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = mCurrFrameResource->ObjectCB;
+	objCBAddress += ri->ObjCBIndex*objCBByteSize;
+
+	cmdList->SetGraphicsRootConstantBufferView(0, objCBAddress);
+
+	// The chunk vertices are in world space, so only the vertex buffer and the index
+	// range of the chunk's level and stitching change between draws.
+	for(const auto& chunk : mTerrain->GetDrawItems())
+	{
+		D3D12_VERTEX_BUFFER_VIEW vbv;
+		vbv.BufferLocation = mTerrainVBs[chunk.Key]->Resource()->GetGPUVirtualAddress();
+		vbv.StrideInBytes = ri->Geo->VertexByteStride;
+		vbv.SizeInBytes = ri->Geo->VertexBufferByteSize;
+
+		cmdList->IASetVertexBuffers(0, 1, &vbv);
+		cmdList->DrawIndexedInstanced(chunk.Indices.IndexCount, 1, chunk.Indices.StartIndex, 0, 0);
+	}
+}
+
 float LandAndWavesApp::GetHillsHeight(float x, float z)const
 {
     return 0.3f*(z*sinf(0.1f*x) + x*cosf(0.1f*z));
 }
 
+XMVECTOR LandAndWavesApp::GetHillsHeight(FXMVECTOR x, FXMVECTOR z)const
+{
+	// Four points at a time, for the terrain chunk builders.
+	XMVECTOR zSinX = XMVectorMultiply(z, XMVectorSin(XMVectorScale(x, 0.1f)));
+	XMVECTOR xCosZ = XMVectorMultiply(x, XMVectorCos(XMVectorScale(z, 0.1f)));
+	return XMVectorScale(XMVectorAdd(zSinX, xCosZ), 0.3f);
+}
+
 XMFLOAT3 LandAndWavesApp::GetHillsNormal(float x, float z)const
 {
     // n = (-df/dx, 1, -df/dz)
@@ -753,3 +894,33 @@ XMFLOAT3 LandAndWavesApp::GetHillsNormal(float x, float z)const
 
     return n;
 }
+
+XMFLOAT4 LandAndWavesApp::GetHillsColor(float y)const
+{
+    // Color the vertex based on its height.
+    if(y < -10.0f)
+    {
+        // Sandy beach color.
+        return XMFLOAT4(1.0f, 0.96f, 0.62f, 1.0f);
+    }
+    else if(y < 5.0f)
+    {
+        // Light yellow-green.
+        return XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f);
+    }
+    else if(y < 12.0f)
+    {
+        // Dark yellow-green.
+        return XMFLOAT4(0.1f, 0.48f, 0.19f, 1.0f);
+    }
+    else if(y < 20.0f)
+    {
+        // Dark brown.
+        return XMFLOAT4(0.45f, 0.39f, 0.34f, 1.0f);
+    }
+    else
+    {
+        // White snow.
+        return XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+}
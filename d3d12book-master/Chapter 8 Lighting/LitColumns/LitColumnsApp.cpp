@@ -6,6 +6,8 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/DrawQueue.h"
+#include "../../Common/InstanceBatcher.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -30,18 +32,16 @@ struct RenderItem
 
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
-
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
-	UINT ObjCBIndex = -1;
+	// The transforms are copied to the instance buffer every frame, in the order of the
+	// instanced draws that mInstanceBatcher groups the render items into.
 
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 
+	// Id of Geo and PrimitiveType in the draw sort keys: items with the same id share
+	// vertex/index buffers and topology.
+	UINT GeoId = 0;
+
     // Primitive topology.
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -51,6 +51,13 @@ struct RenderItem
     int BaseVertexLocation = 0;
 };
 
+// Render items with the same batch key draw the same submesh with the same material,
+// so they can be instances of one draw.
+static UINT64 MakeBatchKey(const RenderItem* ri)
+{
+	return (UINT64)ri->GeoId << 48 | (UINT64)ri->Mat->MatCBIndex << 32 | ri->StartIndexLocation;
+}
+
 class LitColumnsApp : public D3DApp
 {
 public:
@@ -73,7 +80,7 @@ private:
     void OnKeyboardInput(const GameTimer& gt);
 	void UpdateCamera(const GameTimer& gt);
 	void AnimateMaterials(const GameTimer& gt);
-	void UpdateObjectCBs(const GameTimer& gt);
+	void UpdateInstanceBuffer(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 
@@ -85,7 +92,8 @@ private:
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
-    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems,
+        const InstanceBatcher& batcher);
  
 private:
 
@@ -114,6 +122,14 @@ private:
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mOpaqueRitems;
 
+	// Instanced draws of mOpaqueRitems, by index.
+	InstanceBatcher mInstanceBatcher;
+
+	// Draws of the frame, sorted to share state, and what submitting them cost as last
+	// shown in the window caption.
+	DrawQueue mDrawQueue;
+	DrawQueue::Stats mDrawStats;
+
     PassConstants mMainPassCB;
 
 	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
@@ -222,7 +238,7 @@ void LitColumnsApp::Update(const GameTimer& gt)
     }
 
 	AnimateMaterials(gt);
-	UpdateObjectCBs(gt);
+	UpdateInstanceBuffer(gt);
 	UpdateMaterialCBs(gt);
 	UpdateMainPassCB(gt);
 }
@@ -258,7 +274,7 @@ void LitColumnsApp::Draw(const GameTimer& gt)
 	auto passCB = mCurrFrameResource->PassCB->Resource();
 	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
 
-    DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
+    DrawRenderItems(mCommandList.Get(), mOpaqueRitems, mInstanceBatcher);
 
     // Indicate a state transition on the resource usage.
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
@@ -354,27 +370,25 @@ void LitColumnsApp::AnimateMaterials(const GameTimer& gt)
 	
 }
 
-void LitColumnsApp::UpdateObjectCBs(const GameTimer& gt)
+void LitColumnsApp::UpdateInstanceBuffer(const GameTimer& gt)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
-	for(auto& e : mAllRitems)
+	// Items only move between draws when they are added, removed or change mesh or
+	// material.  Then the caption is rebuilt with the new item and draw counts.
+	if(mInstanceBatcher.Rebatch())
+		mDrawStats = DrawQueue::Stats();
+
+	// The transforms of every instance, in draw order.
+	auto currInstanceBuffer = mCurrFrameResource->InstanceBuffer->Map();
+	const std::vector<UINT>& instanceItems = mInstanceBatcher.GetInstanceItems();
+	for(size_t i = 0; i < instanceItems.size(); ++i)
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if(e->NumFramesDirty > 0)
-		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
+		auto ri = mOpaqueRitems[instanceItems[i]];
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+		XMMATRIX world = XMLoadFloat4x4(&ri->World);
+		XMMATRIX texTransform = XMLoadFloat4x4(&ri->TexTransform);
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
-
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
-		}
+		XMStoreFloat4x4(&currInstanceBuffer[i].World, XMMatrixTranspose(world));
+		XMStoreFloat4x4(&currInstanceBuffer[i].TexTransform, XMMatrixTranspose(texTransform));
 	}
 }
 
@@ -445,7 +459,7 @@ void LitColumnsApp::BuildRootSignature()
 	CD3DX12_ROOT_PARAMETER slotRootParameter[3];
 
 	// Create root CBV.
-	slotRootParameter[0].InitAsConstantBufferView(0);
+	slotRootParameter[0].InitAsShaderResourceView(0);
 	slotRootParameter[1].InitAsConstantBufferView(1);
 	slotRootParameter[2].InitAsConstantBufferView(2);
 
@@ -772,7 +786,6 @@ void LitColumnsApp::BuildRenderItems()
 	auto boxRitem = std::make_unique<RenderItem>();
 	XMStoreFloat4x4(&boxRitem->World, XMMatrixScaling(2.0f, 2.0f, 2.0f)*XMMatrixTranslation(0.0f, 0.5f, 0.0f));
 	XMStoreFloat4x4(&boxRitem->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	boxRitem->ObjCBIndex = 0;
 	boxRitem->Mat = mMaterials["stone0"].get();
 	boxRitem->Geo = mGeometries["shapeGeo"].get();
 	boxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -784,7 +797,6 @@ void LitColumnsApp::BuildRenderItems()
     auto gridRitem = std::make_unique<RenderItem>();
     gridRitem->World = MathHelper::Identity4x4();
 	XMStoreFloat4x4(&gridRitem->TexTransform, XMMatrixScaling(8.0f, 8.0f, 1.0f));
-	gridRitem->ObjCBIndex = 1;
 	gridRitem->Mat = mMaterials["tile0"].get();
 	gridRitem->Geo = mGeometries["shapeGeo"].get();
 	gridRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -796,9 +808,9 @@ void LitColumnsApp::BuildRenderItems()
 	auto skullRitem = std::make_unique<RenderItem>();
 	XMStoreFloat4x4(&skullRitem->World, XMMatrixScaling(0.5f, 0.5f, 0.5f)*XMMatrixTranslation(0.0f, 1.0f, 0.0f));
 	skullRitem->TexTransform = MathHelper::Identity4x4();
-	skullRitem->ObjCBIndex = 2;
 	skullRitem->Mat = mMaterials["skullMat"].get();
 	skullRitem->Geo = mGeometries["skullGeo"].get();
+	skullRitem->GeoId = 1;
 	skullRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	skullRitem->IndexCount = skullRitem->Geo->DrawArgs["skull"].IndexCount;
 	skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
@@ -806,7 +818,6 @@ void LitColumnsApp::BuildRenderItems()
 	mAllRitems.push_back(std::move(skullRitem));
 
 	XMMATRIX brickTexTransform = XMMatrixScaling(1.0f, 1.0f, 1.0f);
-	UINT objCBIndex = 3;
 	for(int i = 0; i < 5; ++i)
 	{
 		auto leftCylRitem = std::make_unique<RenderItem>();
@@ -822,7 +833,6 @@ void LitColumnsApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&leftCylRitem->World, rightCylWorld);
 		XMStoreFloat4x4(&leftCylRitem->TexTransform, brickTexTransform);
-		leftCylRitem->ObjCBIndex = objCBIndex++;
 		leftCylRitem->Mat = mMaterials["bricks0"].get();
 		leftCylRitem->Geo = mGeometries["shapeGeo"].get();
 		leftCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -832,7 +842,6 @@ void LitColumnsApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&rightCylRitem->World, leftCylWorld);
 		XMStoreFloat4x4(&rightCylRitem->TexTransform, brickTexTransform);
-		rightCylRitem->ObjCBIndex = objCBIndex++;
 		rightCylRitem->Mat = mMaterials["bricks0"].get();
 		rightCylRitem->Geo = mGeometries["shapeGeo"].get();
 		rightCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -842,7 +851,6 @@ void LitColumnsApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&leftSphereRitem->World, leftSphereWorld);
 		leftSphereRitem->TexTransform = MathHelper::Identity4x4();
-		leftSphereRitem->ObjCBIndex = objCBIndex++;
 		leftSphereRitem->Mat = mMaterials["stone0"].get();
 		leftSphereRitem->Geo = mGeometries["shapeGeo"].get();
 		leftSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -852,7 +860,6 @@ void LitColumnsApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&rightSphereRitem->World, rightSphereWorld);
 		rightSphereRitem->TexTransform = MathHelper::Identity4x4();
-		rightSphereRitem->ObjCBIndex = objCBIndex++;
 		rightSphereRitem->Mat = mMaterials["stone0"].get();
 		rightSphereRitem->Geo = mGeometries["shapeGeo"].get();
 		rightSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -868,32 +875,101 @@ void LitColumnsApp::BuildRenderItems()
 
 	// All the render items are opaque.
 	for(auto& e : mAllRitems)
+	{
+		mInstanceBatcher.Add((UINT)mOpaqueRitems.size(), MakeBatchKey(e.get()));
 		mOpaqueRitems.push_back(e.get());
+	}
 }
 
-void LitColumnsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+void LitColumnsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems,
+    const InstanceBatcher& batcher)
 {
-    UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-    UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
- 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
-	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+    // Binds the state of the draws on the command list as the draw queue asks for it.
+    // The queue's items are batches; the first instance of a batch stands for it.
+    struct CommandListRecorder
+    {
+        ID3D12GraphicsCommandList* CmdList;
+        const std::vector<RenderItem*>& Ritems;
+        const InstanceBatcher& Batcher;
+        ID3D12PipelineState* PSO;
+        D3D12_GPU_VIRTUAL_ADDRESS InstanceBuffer;
+        D3D12_GPU_VIRTUAL_ADDRESS MatCB;
+
+        RenderItem* BatchRitem(UINT batch)const
+        {
+            UINT firstInstance = Batcher.GetBatches()[batch].FirstInstance;
+            return Ritems[Batcher.GetInstanceItems()[firstInstance]];
+        }
+
+        void SetPipelineState(UINT pipeline, UINT batch)
+        {
+            CmdList->SetPipelineState(PSO);
+        }
+
+        void SetMaterial(UINT material, UINT batch)
+        {
+            UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+            CmdList->SetGraphicsRootConstantBufferView(1, MatCB + material*matCBByteSize);
+        }
+
+        void SetGeometry(UINT geometry, UINT batch)
+        {
+            auto ri = BatchRitem(batch);
+            CmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
+            CmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
+            CmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+        }
+
+        void Draw(UINT batch)
+        {
+            const InstanceBatcher::Batch& b = Batcher.GetBatches()[batch];
+            auto ri = BatchRitem(batch);
+
+            CmdList->SetGraphicsRootShaderResourceView(0, InstanceBuffer + b.FirstInstance*sizeof(InstanceData));
+            CmdList->DrawIndexedInstanced(ri->IndexCount, b.InstanceCount, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+        }
+    };
 
-    // For each render item...
-    for(size_t i = 0; i < ritems.size(); ++i)
+    // Sort the batches by material and mesh so that runs of them share state, the one
+    // with the nearest instance first within a run.
+    XMMATRIX view = XMLoadFloat4x4(&mView);
+    const std::vector<InstanceBatcher::Batch>& batches = batcher.GetBatches();
+    const std::vector<UINT>& instanceItems = batcher.GetInstanceItems();
+
+    mDrawQueue.Clear();
+    for(size_t i = 0; i < batches.size(); ++i)
     {
-        auto ri = ritems[i];
+        float nearestZ = mMainPassCB.FarZ;
+        for(UINT j = 0; j < batches[i].InstanceCount; ++j)
+        {
+            auto ri = ritems[instanceItems[batches[i].FirstInstance + j]];
+
+            XMVECTOR posW = XMVectorSet(ri->World(3, 0), ri->World(3, 1), ri->World(3, 2), 1.0f);
+            nearestZ = MathHelper::Min(nearestZ, XMVectorGetZ(XMVector3TransformCoord(posW, view)));
+        }
 
-        cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-        cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-        cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+        auto ri = ritems[instanceItems[batches[i].FirstInstance]];
+        UINT depth = SortKey::FrontToBack(nearestZ, mMainPassCB.NearZ, mMainPassCB.FarZ);
 
-        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
+        mDrawQueue.Add(SortKey::Make(0, 0, ri->Mat->MatCBIndex, ri->GeoId, depth), (UINT)i);
+    }
+    mDrawQueue.Sort();
 
-        cmdList->SetGraphicsRootConstantBufferView(0, objCBAddress);
-		cmdList->SetGraphicsRootConstantBufferView(1, matCBAddress);
+    CommandListRecorder recorder = { cmdList, ritems, batcher, mOpaquePSO.Get(),
+        mCurrFrameResource->InstanceBuffer->Resource()->GetGPUVirtualAddress(),
+        mCurrFrameResource->MaterialCB->Resource()->GetGPUVirtualAddress() };
 
-        cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+    DrawQueue::Stats stats = mDrawQueue.Submit(recorder);
+
+    // Show the draws and state changes in the window caption, next to the frame stats.
+    // They only change with the scene, so the caption is only rebuilt then.
+    if(stats.Draws != mDrawStats.Draws || stats.StateChanges() != mDrawStats.StateChanges())
+    {
+        std::wostringstream outs;
+        outs << L"Lit Columns Demo" <<
+            L"    draws: " << stats.Draws << L" for " << batcher.GetItemCount() << L" render items" <<
+            L"   state changes: " << stats.StateChanges();
+        mMainWndCaption = outs.str();
     }
+    mDrawStats = stats;
 }
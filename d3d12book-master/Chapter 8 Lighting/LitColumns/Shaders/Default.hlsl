@@ -22,11 +22,16 @@
 
 // Constant data that varies per frame.
 
-cbuffer cbPerObject : register(b0)
+struct InstanceData
 {
-    float4x4 gWorld;
+	float4x4 World;
+	float4x4 TexTransform;
 };
 
+// Instances of the current draw.  The root SRV points at the draw's first instance,
+// so SV_InstanceID indexes it directly.
+StructuredBuffer<InstanceData> gInstanceData : register(t0);
+
 cbuffer cbMaterial : register(b1)
 {
 	float4 gDiffuseAlbedo;
@@ -74,16 +79,18 @@ struct VertexOut
     float3 NormalW : NORMAL;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
 	VertexOut vout = (VertexOut)0.0f;
+
+	float4x4 world = gInstanceData[instanceID].World;
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(vin.PosL, 1.0f), world);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul(vin.NormalL, (float3x3)world);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
@@ -9,6 +9,7 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/ParametricSurface.h"
 #include "FrameResource.h"
 #include "Waves.h"
 
@@ -55,6 +56,45 @@ struct RenderItem
 	int BaseVertexLocation = 0;
 };
 
+// Height of the hills, h(x,z) = 0.3(z*sin(0.1x) + x*cos(0.1z)), for four points at a time.
+struct HillsHeight
+{
+	XMVECTOR operator()(FXMVECTOR x, FXMVECTOR z)const
+	{
+		XMVECTOR zSinX = XMVectorMultiply(z, XMVectorSin(XMVectorScale(x, 0.1f)));
+		XMVECTOR xCosZ = XMVectorMultiply(x, XMVectorCos(XMVectorScale(z, 0.1f)));
+		return XMVectorScale(XMVectorAdd(zSinX, xCosZ), 0.3f);
+	}
+};
+
+// Partial derivatives of HillsHeight, from which ParametricSurface builds the normals.
+struct HillsGradient
+{
+	void operator()(FXMVECTOR x, FXMVECTOR z, XMVECTOR& dhdx, XMVECTOR& dhdz)const
+	{
+		XMVECTOR sinX, cosX, sinZ, cosZ;
+		XMVectorSinCos(&sinX, &cosX, XMVectorScale(x, 0.1f));
+		XMVectorSinCos(&sinZ, &cosZ, XMVectorScale(z, 0.1f));
+
+		// dh/dx = 0.03z*cos(0.1x) + 0.3cos(0.1z)
+		// dh/dz = 0.3sin(0.1x) - 0.03x*sin(0.1z)
+		dhdx = XMVectorMultiplyAdd(XMVectorScale(z, 0.03f), cosX, XMVectorScale(cosZ, 0.3f));
+		dhdz = XMVectorSubtract(XMVectorScale(sinX, 0.3f), XMVectorMultiply(XMVectorScale(x, 0.03f), sinZ));
+	}
+};
+
+// Writes the position and normal of a generated vertex into our Vertex.
+struct LandVertexLayout
+{
+	using Vertex = ::Vertex;
+
+	static void Encode(const GeometryGenerator::Vertex& in, Vertex& out)
+	{
+		out.Pos = in.Position;
+		out.Normal = in.Normal;
+	}
+};
+
 enum class RenderLayer : int
 {
 	Opaque = 0,
@@ -97,8 +137,6 @@ private:
     void BuildRenderItems();
 	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
 
-    float GetHillsHeight(float x, float z)const;
-    XMFLOAT3 GetHillsNormal(float x, float z)const;
 
 private:
 
@@ -487,14 +525,11 @@ void LitWavesApp::UpdateWaves(const GameTimer& gt)
 
 	// Update the wave vertex buffer with the new solution.
 	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	auto vertices = currWavesVB->Map();
 	for(int i = 0; i < mWaves->VertexCount(); ++i)
 	{
-		Vertex v;
-
-		v.Pos = mWaves->Position(i);
-		v.Normal = mWaves->Normal(i);
-
-		currWavesVB->CopyData(i, v);
+		vertices[i].Pos = mWaves->Position(i);
+		vertices[i].Normal = mWaves->Normal(i);
 	}
 
 	// Set the dynamic VB of the wave renderitem to the current frame VB.
@@ -547,27 +582,27 @@ void LitWavesApp::BuildShadersAndInputLayout()
 
 void LitWavesApp::BuildLandGeometry()
 {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData grid = geoGen.CreateGrid(160.0f, 160.0f, 50, 50);
-
 	//
-	// Extract the vertex elements we are interested and apply the height function to
-	// each vertex.  In addition, color the vertices based on their height so we have
-	// sandy looking beaches, grassy low hills, and snow mountain peaks.
+	// Evaluate the height function over the same 160x160, 50x50 vertex grid that
+	// CreateGrid makes, four vertices at a time, with the normals from its analytic
+	// gradient.
 	//
 
-	std::vector<Vertex> vertices(grid.Vertices.size());
-	for(size_t i = 0; i < grid.Vertices.size(); ++i)
-	{
-		auto& p = grid.Vertices[i].Position;
-		vertices[i].Pos = p;
-		vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
-		vertices[i].Normal = GetHillsNormal(p.x, p.z);
-	}
+	ParametricSurface::Domain domain = ParametricSurface::HeightFieldDomain(160.0f, 160.0f, 50, 50);
+	GeometryGenerator::MeshSize size = ParametricSurface::GetSize(domain);
+
+	std::vector<Vertex> vertices(size.VertexCount);
+	std::vector<std::uint16_t> indices(size.IndexCount);
+
+	HillsHeight height;
+	HillsGradient gradient;
+	ParametricSurface::Create<LandVertexLayout>(domain,
+		ParametricSurface::HeightFieldSurface<HillsHeight>(height),
+		ParametricSurface::HeightFieldPartials<HillsGradient>(gradient),
+		vertices.data(), indices.data());
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 
-	std::vector<std::uint16_t> indices = grid.GetIndices16();
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
@@ -778,22 +813,3 @@ void LitWavesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std:
 		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
 	}
 }
-
-float LitWavesApp::GetHillsHeight(float x, float z)const
-{
-    return 0.3f*(z*sinf(0.1f*x) + x*cosf(0.1f*z));
-}
-
-XMFLOAT3 LitWavesApp::GetHillsNormal(float x, float z)const
-{
-    // n = (-df/dx, 1, -df/dz)
-    XMFLOAT3 n(
-        -0.03f*z*cosf(0.1f*x) - 0.3f*cosf(0.1f*z),
-        1.0f,
-        -0.3f*sinf(0.1f*x) + 0.03f*x*sinf(0.1f*z));
-
-    XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-    XMStoreFloat3(&n, unitNormal);
-
-    return n;
-}
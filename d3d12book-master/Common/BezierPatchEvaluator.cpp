@@ -0,0 +1,252 @@
+//***************************************************************************************
+// BezierPatchEvaluator.cpp
+//***************************************************************************************
+
+#include "BezierPatchEvaluator.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = BezierPatchEvaluator::uint32;
+
+	// Derivatives are taken this far inside the patch edges.  Along a collapsed edge (a
+	// row of equal control points, as at the top of the teapot) the derivative along the
+	// edge is zero, but not next to it, so the normals stay defined.
+	const float DerivativeInset = 1e-3f;
+
+	// Patches evaluated together, one per SIMD lane.
+	const uint32 LaneCount = 4;
+
+	XMFLOAT4 BernsteinBasis(float t)
+	{
+		float invT = 1.0f - t;
+		return XMFLOAT4(invT*invT*invT, 3.0f*t*invT*invT, 3.0f*t*t*invT, t*t*t);
+	}
+
+	XMFLOAT4 dBernsteinBasis(float t)
+	{
+		float invT = 1.0f - t;
+		return XMFLOAT4(-3.0f*invT*invT, 3.0f*invT*invT - 6.0f*t*invT, 6.0f*t*invT - 3.0f*t*t, 3.0f*t*t);
+	}
+
+	// Normalizes three SoA vectors; zero vectors stay zero.
+	void Normalize3(XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+	{
+		XMVECTOR lengthSq = XMVectorMultiplyAdd(x, x, XMVectorMultiplyAdd(y, y, XMVectorMultiply(z, z)));
+		XMVECTOR invLength = XMVectorReciprocal(XMVectorSqrt(XMVectorMax(lengthSq, XMVectorReplicate(1e-30f))));
+		x = XMVectorMultiply(x, invLength);
+		y = XMVectorMultiply(y, invLength);
+		z = XMVectorMultiply(z, invLength);
+	}
+
+	// sum over k of w_k*p[k*stride], for the three SoA coordinates.
+	void WeightedSum(const XMFLOAT4& w, const XMVECTOR (*p)[3], uint32 stride, XMVECTOR out[3])
+	{
+		XMVECTOR w0 = XMVectorReplicate(w.x);
+		XMVECTOR w1 = XMVectorReplicate(w.y);
+		XMVECTOR w2 = XMVectorReplicate(w.z);
+		XMVECTOR w3 = XMVectorReplicate(w.w);
+
+		for(int a = 0; a < 3; ++a)
+		{
+			XMVECTOR sum = XMVectorMultiply(w0, p[0][a]);
+			sum = XMVectorMultiplyAdd(w1, p[stride][a], sum);
+			sum = XMVectorMultiplyAdd(w2, p[2*stride][a], sum);
+			out[a] = XMVectorMultiplyAdd(w3, p[3*stride][a], sum);
+		}
+	}
+}
+
+uint32 BezierPatchEvaluator::SegmentsForTolerance(const Patch& patch, float tolerance)
+{
+	// A cubic Bezier curve is within 3*2/8 * max|P[i] - 2P[i+1] + P[i+2]| / n^2 of its
+	// n-segment polyline.
+	float maxSecondDiff = 0.0f;
+	for(int r = 0; r < 4; ++r)
+	{
+		for(int k = 0; k < 2; ++k)
+		{
+			XMVECTOR du = XMLoadFloat3(&patch.ControlPoints[r*4 + k]) - 2.0f*XMLoadFloat3(&patch.ControlPoints[r*4 + k + 1]) +
+				XMLoadFloat3(&patch.ControlPoints[r*4 + k + 2]);
+			XMVECTOR dv = XMLoadFloat3(&patch.ControlPoints[k*4 + r]) - 2.0f*XMLoadFloat3(&patch.ControlPoints[(k + 1)*4 + r]) +
+				XMLoadFloat3(&patch.ControlPoints[(k + 2)*4 + r]);
+
+			maxSecondDiff = fmaxf(maxSecondDiff, XMVectorGetX(XMVector3Length(du)));
+			maxSecondDiff = fmaxf(maxSecondDiff, XMVectorGetX(XMVector3Length(dv)));
+		}
+	}
+
+	float n = ceilf(sqrtf(0.75f*maxSecondDiff / tolerance));
+	return n < 1.0f ? 1 : n > (float)MaxSegments ? MaxSegments : (uint32)n;
+}
+
+const BezierPatchEvaluator::BasisTable& BezierPatchEvaluator::GetBasis(uint32 segments)
+{
+	if(mBasis.size() <= segments)
+		mBasis.resize(segments + 1);
+
+	BasisTable& table = mBasis[segments];
+	if(table.B.empty())
+	{
+		table.B.resize(segments + 1);
+		table.BInset.resize(segments + 1);
+		table.dB.resize(segments + 1);
+		for(uint32 k = 0; k <= segments; ++k)
+		{
+			float t = (float)k / segments;
+			float tInset = fminf(fmaxf(t, DerivativeInset), 1.0f - DerivativeInset);
+			table.B[k] = BernsteinBasis(t);
+			table.BInset[k] = BernsteinBasis(tInset);
+			table.dB[k] = dBernsteinBasis(tInset);
+		}
+	}
+
+	return table;
+}
+
+void BezierPatchEvaluator::Tessellate(const Patch* patches, uint32 patchCount, uint32 segments,
+	GeometryGenerator::MeshData& meshData)
+{
+	std::vector<uint32> levels(patchCount, segments);
+	Tessellate(patches, patchCount, levels.data(), meshData);
+}
+
+void BezierPatchEvaluator::Tessellate(const Patch* patches, uint32 patchCount, const uint32* segments,
+	GeometryGenerator::MeshData& meshData)
+{
+	// Where each patch goes in the output.
+	std::vector<uint32> vertexStarts(patchCount);
+	uint32 vertexCount = 0;
+	uint32 indexCount = 0;
+	for(uint32 p = 0; p < patchCount; ++p)
+	{
+		assert(segments[p] >= 1 && segments[p] <= MaxSegments);
+
+		vertexStarts[p] = vertexCount;
+		vertexCount += (segments[p] + 1)*(segments[p] + 1);
+		indexCount += segments[p]*segments[p]*6;
+	}
+
+	meshData.Vertices.resize(vertexCount);
+	meshData.Indices32.resize(indexCount);
+
+	// Patches of each level, evaluated LaneCount at a time.
+	std::vector<std::vector<uint32>> byLevel(MaxSegments + 1);
+	for(uint32 p = 0; p < patchCount; ++p)
+		byLevel[segments[p]].push_back(p);
+
+	for(uint32 level = 1; level <= MaxSegments; ++level)
+	{
+		const std::vector<uint32>& group = byLevel[level];
+		for(size_t first = 0; first < group.size(); first += LaneCount)
+		{
+			uint32 count = (uint32)(group.size() - first < LaneCount ? group.size() - first : LaneCount);
+
+			const Patch* lanes[LaneCount];
+			uint32 starts[LaneCount];
+			for(uint32 k = 0; k < count; ++k)
+			{
+				lanes[k] = &patches[group[first + k]];
+				starts[k] = vertexStarts[group[first + k]];
+			}
+
+			EvaluatePatches(lanes, starts, count, level, meshData.Vertices.data());
+		}
+	}
+
+	// Same grid layout and winding as GeometryGenerator::CreateGrid, so the front face
+	// is on the side of dP/du x dP/dv.
+	uint32* indices = meshData.Indices32.MutableData();
+	uint32 k = 0;
+	for(uint32 p = 0; p < patchCount; ++p)
+	{
+		uint32 n = segments[p] + 1;
+		uint32 base = vertexStarts[p];
+		for(uint32 i = 0; i < n - 1; ++i)
+		{
+			for(uint32 j = 0; j < n - 1; ++j)
+			{
+				indices[k++] = base + i*n + j;
+				indices[k++] = base + i*n + j + 1;
+				indices[k++] = base + (i + 1)*n + j;
+
+				indices[k++] = base + (i + 1)*n + j;
+				indices[k++] = base + i*n + j + 1;
+				indices[k++] = base + (i + 1)*n + j + 1;
+			}
+		}
+	}
+}
+
+void BezierPatchEvaluator::EvaluatePatches(const Patch* const* patches, const uint32* vertexStarts, uint32 count,
+	uint32 segments, GeometryGenerator::Vertex* vertices)
+{
+	const BasisTable& basis = GetBasis(segments);
+
+	// Control points in SoA form, lane k holding patch k.  Unused lanes repeat patch 0.
+	XMVECTOR cp[16][3];
+	for(int c = 0; c < 16; ++c)
+	{
+		const XMFLOAT3* p[LaneCount];
+		for(uint32 k = 0; k < LaneCount; ++k)
+			p[k] = &patches[k < count ? k : 0]->ControlPoints[c];
+
+		cp[c][0] = XMVectorSet(p[0]->x, p[1]->x, p[2]->x, p[3]->x);
+		cp[c][1] = XMVectorSet(p[0]->y, p[1]->y, p[2]->y, p[3]->y);
+		cp[c][2] = XMVectorSet(p[0]->z, p[1]->z, p[2]->z, p[3]->z);
+	}
+
+	uint32 n = segments + 1;
+	for(uint32 i = 0; i < n; ++i)
+	{
+		// The cubic curve of this row, P(u) = sum_c Bu[c]*q[c], the curve just inside it
+		// for dP/du, and its derivative in v.
+		XMVECTOR q[4][3];
+		XMVECTOR qInset[4][3];
+		XMVECTOR dq[4][3];
+		for(int c = 0; c < 4; ++c)
+		{
+			WeightedSum(basis.B[i], &cp[c], 4, q[c]);
+			WeightedSum(basis.BInset[i], &cp[c], 4, qInset[c]);
+			WeightedSum(basis.dB[i], &cp[c], 4, dq[c]);
+		}
+
+		for(uint32 j = 0; j < n; ++j)
+		{
+			XMVECTOR p[3], dPdu[3], dPdv[3];
+			WeightedSum(basis.B[j], q, 1, p);
+			WeightedSum(basis.dB[j], qInset, 1, dPdu);
+			WeightedSum(basis.BInset[j], dq, 1, dPdv);
+
+			// n = dP/du x dP/dv
+			XMVECTOR nx = XMVectorSubtract(XMVectorMultiply(dPdu[1], dPdv[2]), XMVectorMultiply(dPdu[2], dPdv[1]));
+			XMVECTOR ny = XMVectorSubtract(XMVectorMultiply(dPdu[2], dPdv[0]), XMVectorMultiply(dPdu[0], dPdv[2]));
+			XMVECTOR nz = XMVectorSubtract(XMVectorMultiply(dPdu[0], dPdv[1]), XMVectorMultiply(dPdu[1], dPdv[0]));
+			Normalize3(nx, ny, nz);
+			Normalize3(dPdu[0], dPdu[1], dPdu[2]);
+
+			XMFLOAT4 px, py, pz, nxs, nys, nzs, tx, ty, tz;
+			XMStoreFloat4(&px, p[0]);
+			XMStoreFloat4(&py, p[1]);
+			XMStoreFloat4(&pz, p[2]);
+			XMStoreFloat4(&nxs, nx);
+			XMStoreFloat4(&nys, ny);
+			XMStoreFloat4(&nzs, nz);
+			XMStoreFloat4(&tx, dPdu[0]);
+			XMStoreFloat4(&ty, dPdu[1]);
+			XMStoreFloat4(&tz, dPdu[2]);
+
+			XMFLOAT2 texC((float)j / segments, (float)i / segments);
+			for(uint32 k = 0; k < count; ++k)
+			{
+				GeometryGenerator::Vertex& v = vertices[vertexStarts[k] + i*n + j];
+				v.Position = XMFLOAT3((&px.x)[k], (&py.x)[k], (&pz.x)[k]);
+				v.Normal = XMFLOAT3((&nxs.x)[k], (&nys.x)[k], (&nzs.x)[k]);
+				v.TangentU = XMFLOAT3((&tx.x)[k], (&ty.x)[k], (&tz.x)[k]);
+				v.TexC = texC;
+			}
+		}
+	}
+}
@@ -0,0 +1,71 @@
+//***************************************************************************************
+// BezierPatchEvaluator.h
+//
+// Tessellates bicubic Bezier patches on the CPU into a MeshData, matching the surface
+// the BezierTessellation.hlsl domain shader draws, so tools, picking and collision can
+// work with the same geometry.
+//
+// The Bernstein weights and their derivatives at the sample parameters are tabulated
+// once per tessellation level and reused by every patch at that level.  Patches of the
+// same level are evaluated four at a time, one per SIMD lane: each row first reduces
+// the 4x4 control net to a cubic curve for that v, which is then sampled across u.
+//
+// Patches may use different levels (see SegmentsForTolerance).  Neighbouring patches at
+// different levels meet with T-junctions, so pass a single level where the mesh must be
+// watertight.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+
+class BezierPatchEvaluator
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+
+	// Control point (row r, column c) is ControlPoints[r*4 + c], the order of the 16
+	// point patch list.  u runs along a row and v down the columns.
+	struct Patch
+	{
+		DirectX::XMFLOAT3 ControlPoints[16];
+	};
+
+	static const uint32 MaxSegments = 64;
+
+	///<summary>
+	/// Segments per side for the tessellation to stay within tolerance of the surface,
+	/// from the largest second difference of the control net along u and v.
+	///</summary>
+	static uint32 SegmentsForTolerance(const Patch& patch, float tolerance);
+
+	///<summary>
+	/// Replaces meshData with the patches tessellated into grids of segments x segments
+	/// quads each, in patch order.  TexC holds the patch's (u, v).
+	///</summary>
+	void Tessellate(const Patch* patches, uint32 patchCount, uint32 segments, GeometryGenerator::MeshData& meshData);
+
+	///<summary>
+	/// Same as above with a level per patch.
+	///</summary>
+	void Tessellate(const Patch* patches, uint32 patchCount, const uint32* segments, GeometryGenerator::MeshData& meshData);
+
+private:
+	// Bernstein weights B at t = k/segments, k = 0..segments.  The derivatives dB, and
+	// the weights BInset that go with them, are taken slightly inside [0, 1].
+	struct BasisTable
+	{
+		std::vector<DirectX::XMFLOAT4> B;
+		std::vector<DirectX::XMFLOAT4> BInset;
+		std::vector<DirectX::XMFLOAT4> dB;
+	};
+
+	const BasisTable& GetBasis(uint32 segments);
+
+	// Evaluates up to four patches of the same level, writing each to its own vertex range.
+	void EvaluatePatches(const Patch* const* patches, const uint32* vertexStarts, uint32 count,
+		uint32 segments, GeometryGenerator::Vertex* vertices);
+
+	std::vector<BasisTable> mBasis; // indexed by segments
+};
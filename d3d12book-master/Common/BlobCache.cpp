@@ -0,0 +1,131 @@
+//***************************************************************************************
+// BlobCache.cpp
+//***************************************************************************************
+
+#include "BlobCache.h"
+#include "ContentHash.h"
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	// Bumped when the file layout changes, so old files are misses.
+	const std::uint32_t FileMagic = 0x43424c42; // "BLBC"
+	const std::uint32_t FileVersion = 1;
+
+	struct FileHeader
+	{
+		std::uint32_t Magic = 0;
+		std::uint32_t Version = 0;
+		std::uint64_t Key = 0;
+		std::uint64_t Size = 0;
+		std::uint64_t Hash = 0;
+	};
+
+	void MakeDirectory(const std::string& directory)
+	{
+		// Fails harmlessly if the directory exists.
+#ifdef _WIN32
+		_mkdir(directory.c_str());
+#else
+		mkdir(directory.c_str(), 0755);
+#endif
+	}
+}
+
+BlobCache::BlobCache(const std::string& directory)
+	: mDirectory(directory)
+{
+	MakeDirectory(mDirectory);
+}
+
+bool BlobCache::Load(uint64 key, Blob& blob)const
+{
+	std::ifstream fin(GetPath(key), std::ios::binary);
+	if(!fin)
+		return false;
+
+	FileHeader header;
+	if(!fin.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return false;
+
+	if(header.Magic != FileMagic || header.Version != FileVersion || header.Key != key)
+		return false;
+
+	// Check the size against the file before allocating it, so a damaged header
+	// is a miss rather than a huge allocation.
+	std::streamoff dataStart = fin.tellg();
+	if(!fin.seekg(0, std::ios::end))
+		return false;
+	std::streamoff dataSize = fin.tellg() - dataStart;
+	if(dataStart < 0 || dataSize < 0 || header.Size != (uint64)dataSize || !fin.seekg(dataStart))
+		return false;
+
+	blob.resize((size_t)header.Size);
+	if(!fin.read(reinterpret_cast<char*>(blob.data()), (std::streamsize)blob.size()) ||
+		ContentHash::Of(blob.data(), blob.size()) != header.Hash)
+	{
+		blob.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool BlobCache::Store(uint64 key, const Blob& blob)
+{
+	std::string path = GetPath(key);
+	std::string tempPath = path + ".tmp";
+
+	FileHeader header;
+	header.Magic = FileMagic;
+	header.Version = FileVersion;
+	header.Key = key;
+	header.Size = blob.size();
+	header.Hash = ContentHash::Of(blob.data(), blob.size());
+
+	{
+		std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+		fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		fout.write(reinterpret_cast<const char*>(blob.data()), (std::streamsize)blob.size());
+		if(!fout)
+		{
+			fout.close();
+			std::remove(tempPath.c_str());
+			return false;
+		}
+	}
+
+	// rename does not replace an existing file on Windows.
+	std::remove(path.c_str());
+	if(std::rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void BlobCache::Remove(uint64 key)
+{
+	std::remove(GetPath(key).c_str());
+}
+
+const std::string& BlobCache::GetDirectory()const
+{
+	return mDirectory;
+}
+
+std::string BlobCache::GetPath(uint64 key)const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+	return mDirectory + name;
+}
@@ -0,0 +1,55 @@
+//***************************************************************************************
+// BlobCache.h
+//
+// Stores binary blobs on disk under 64-bit keys, one file per key in a directory, so
+// compiled shaders and pipeline states survive between runs.  Each file starts with a
+// header holding the key, the blob's size and a hash of its contents, and Load rejects
+// a file whose header does not match, so a truncated or stale file is a cache miss,
+// never a bad blob.
+//
+// Store writes a temporary file and renames it, so a reader never sees a file half
+// written.  Load and Store may be called from several threads at once for different
+// keys.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class BlobCache
+{
+public:
+	using uint64 = std::uint64_t;
+	using Blob = std::vector<std::uint8_t>;
+
+	///<summary>
+	/// Uses the directory, creating it if needed.  The directory's parent must exist.
+	///</summary>
+	explicit BlobCache(const std::string& directory);
+	BlobCache(const BlobCache& rhs) = delete;
+	BlobCache& operator=(const BlobCache& rhs) = delete;
+
+	///<summary>
+	/// Reads the blob stored under key into blob.  Returns false if there is none or
+	/// its file is damaged.
+	///</summary>
+	bool Load(uint64 key, Blob& blob)const;
+
+	///<summary>
+	/// Writes blob under key, replacing what was there.  Returns false if the file
+	/// could not be written; the cache then just misses next time.
+	///</summary>
+	bool Store(uint64 key, const Blob& blob);
+
+	void Remove(uint64 key);
+
+	const std::string& GetDirectory()const;
+
+private:
+	std::string GetPath(uint64 key)const;
+
+private:
+	std::string mDirectory;
+};
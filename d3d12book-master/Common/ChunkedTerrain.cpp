@@ -0,0 +1,495 @@
+//***************************************************************************************
+// ChunkedTerrain.cpp
+//***************************************************************************************
+
+#include "ChunkedTerrain.h"
+#include "MathHelper.h"
+#include "ParametricSurface.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = ChunkedTerrain::uint32;
+	using uint16 = ChunkedTerrain::uint16;
+
+	const uint32 StitchMaskCount = 16;
+
+	// Encodes the vertices of a chunk into its byte array and tracks the height range
+	// for the bounding box.
+	class EncodingVertexSink : public GeometryGenerator::VertexSink
+	{
+	public:
+		EncodingVertexSink(const ChunkedTerrain::VertexEncoder& encoder, std::uint8_t* vertices, uint32 stride)
+			: mEncoder(encoder), mVertices(vertices), mStride(stride) {}
+
+		void Write(uint32 index, const GeometryGenerator::Vertex& v) override
+		{
+			mEncoder(v, mVertices + index*mStride);
+
+			MinY = MathHelper::Min(MinY, v.Position.y);
+			MaxY = MathHelper::Max(MaxY, v.Position.y);
+		}
+
+		float MinY = +MathHelper::Infinity;
+		float MaxY = -MathHelper::Infinity;
+
+	private:
+		const ChunkedTerrain::VertexEncoder& mEncoder;
+		std::uint8_t* mVertices;
+		uint32 mStride;
+	};
+
+	// Appends the triangles of a (q+1)x(q+1) vertex grid using every step-th vertex.
+	// On the sides in stitchMask, vertices between multiples of 2*step are moved onto
+	// the previous multiple, which turns the side into the edge of the next coarser
+	// level; the triangles that become degenerate are dropped.
+	void AppendLevel(uint32 q, uint32 step, uint32 stitchMask, std::vector<uint16>& indices)
+	{
+		uint32 n = q + 1;
+		uint32 coarse = 2*step;
+
+		auto vertex = [&](uint32 i, uint32 j) -> uint32
+		{
+			if(i == 0 && (stitchMask & ChunkedTerrain::North))
+				j -= j % coarse;
+			else if(i == q && (stitchMask & ChunkedTerrain::South))
+				j -= j % coarse;
+
+			if(j == 0 && (stitchMask & ChunkedTerrain::West))
+				i -= i % coarse;
+			else if(j == q && (stitchMask & ChunkedTerrain::East))
+				i -= i % coarse;
+
+			return i*n + j;
+		};
+
+		auto triangle = [&](uint32 a, uint32 b, uint32 c)
+		{
+			if(a == b || b == c || c == a)
+				return;
+
+			indices.push_back((uint16)a);
+			indices.push_back((uint16)b);
+			indices.push_back((uint16)c);
+		};
+
+		// Same diagonal and winding as GeometryGenerator::CreateGrid.
+		for(uint32 i = 0; i < q; i += step)
+		{
+			for(uint32 j = 0; j < q; j += step)
+			{
+				uint32 v00 = vertex(i, j);
+				uint32 v01 = vertex(i, j + step);
+				uint32 v10 = vertex(i + step, j);
+				uint32 v11 = vertex(i + step, j + step);
+
+				triangle(v00, v01, v10);
+				triangle(v10, v01, v11);
+			}
+		}
+	}
+}
+
+ChunkedTerrain::ChunkedTerrain(const Settings& settings, HeightFunction height, VertexEncoder encoder)
+	: mSettings(settings), mHeight(height), mEncoder(encoder)
+{
+	assert(mSettings.ChunkQuads >= 2 && mSettings.ChunkQuads <= 128 &&
+		(mSettings.ChunkQuads & (mSettings.ChunkQuads - 1)) == 0);
+
+	mSettings.LodCount = MathHelper::Max(1u, mSettings.LodCount);
+	while(mSettings.LodCount > 1 && (1u << mSettings.LodCount) > mSettings.ChunkQuads)
+		mSettings.LodCount--;
+
+	BuildIndices();
+
+	uint32 threadCount = mSettings.ThreadCount;
+	if(threadCount == 0)
+		threadCount = MathHelper::Max(2u, std::thread::hardware_concurrency()) - 1;
+
+	for(uint32 i = 0; i < threadCount; ++i)
+		mWorkers.push_back(std::thread(&ChunkedTerrain::WorkerMain, this));
+}
+
+ChunkedTerrain::~ChunkedTerrain()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWorkAvailable.notify_all();
+
+	for(size_t i = 0; i < mWorkers.size(); ++i)
+		mWorkers[i].join();
+}
+
+ChunkedTerrain::ChunkKey ChunkedTerrain::MakeKey(int x, int z)
+{
+	return ((ChunkKey)(std::uint32_t)x << 32) | (std::uint32_t)z;
+}
+
+int ChunkedTerrain::KeyX(ChunkKey key)
+{
+	return (int)(std::int32_t)(key >> 32);
+}
+
+int ChunkedTerrain::KeyZ(ChunkKey key)
+{
+	return (int)(std::int32_t)(key & 0xffffffff);
+}
+
+const std::vector<ChunkedTerrain::uint16>& ChunkedTerrain::GetIndices()const
+{
+	return mIndices;
+}
+
+ChunkedTerrain::IndexRange ChunkedTerrain::GetIndexRange(uint32 lod, uint32 stitchMask)const
+{
+	return mIndexRanges[lod*StitchMaskCount + stitchMask];
+}
+
+ChunkedTerrain::uint32 ChunkedTerrain::GetChunkVertexCount()const
+{
+	return (mSettings.ChunkQuads + 1)*(mSettings.ChunkQuads + 1);
+}
+
+size_t ChunkedTerrain::GetResidentBytes()const
+{
+	return (size_t)mResidentCount*GetChunkVertexCount()*mSettings.VertexStride;
+}
+
+ChunkedTerrain::uint32 ChunkedTerrain::GetResidentCount()const
+{
+	return mResidentCount;
+}
+
+ChunkedTerrain::uint32 ChunkedTerrain::GetQueuedCount()const
+{
+	return (uint32)mChunks.size() - mResidentCount;
+}
+
+const std::vector<ChunkedTerrain::DrawItem>& ChunkedTerrain::GetDrawItems()const
+{
+	return mDrawItems;
+}
+
+void ChunkedTerrain::TakeBuiltChunks(std::vector<BuiltChunk>& built)
+{
+	built.clear();
+	built.swap(mBuilt);
+}
+
+void ChunkedTerrain::TakeEvictedChunks(std::vector<ChunkKey>& evicted)
+{
+	evicted.clear();
+	evicted.swap(mEvicted);
+}
+
+void ChunkedTerrain::BuildIndices()
+{
+	mIndices.clear();
+	mIndexRanges.resize(mSettings.LodCount*StitchMaskCount);
+
+	for(uint32 lod = 0; lod < mSettings.LodCount; ++lod)
+	{
+		for(uint32 mask = 0; mask < StitchMaskCount; ++mask)
+		{
+			IndexRange& range = mIndexRanges[lod*StitchMaskCount + mask];
+			range.StartIndex = (uint32)mIndices.size();
+			AppendLevel(mSettings.ChunkQuads, 1u << lod, mask, mIndices);
+			range.IndexCount = (uint32)mIndices.size() - range.StartIndex;
+		}
+	}
+}
+
+void ChunkedTerrain::BuildChunk(ChunkKey key, BuildResult& result)const
+{
+	float size = mSettings.ChunkSize;
+	float x = KeyX(key)*size;
+	float z = KeyZ(key)*size;
+
+	// Row 0 is the north (+z) edge, as in CreateGrid.
+	ParametricSurface::Domain domain;
+	domain.U0 = x;
+	domain.U1 = x + size;
+	domain.V0 = z + size;
+	domain.V1 = z;
+	domain.M = mSettings.ChunkQuads + 1;
+	domain.N = mSettings.ChunkQuads + 1;
+
+	result.Key = key;
+	result.Vertices.resize((size_t)GetChunkVertexCount()*mSettings.VertexStride);
+
+	EncodingVertexSink sink(mEncoder, result.Vertices.data(), mSettings.VertexStride);
+	ParametricSurface::CreateVertices(domain, ParametricSurface::HeightFieldSurface<HeightFunction>(mHeight), sink);
+
+	result.MinY = sink.MinY;
+	result.MaxY = sink.MaxY;
+}
+
+void ChunkedTerrain::WorkerMain()
+{
+	for(;;)
+	{
+		QueuedBuild build;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWorkAvailable.wait(lock, [this]() { return mStopping || !mQueue.empty(); });
+			if(mStopping)
+				return;
+
+			auto nearest = std::min_element(mQueue.begin(), mQueue.end(),
+				[](const QueuedBuild& a, const QueuedBuild& b) { return a.Distance < b.Distance; });
+
+			build = *nearest;
+			*nearest = mQueue.back();
+			mQueue.pop_back();
+		}
+
+		BuildResult result;
+		result.Generation = build.Generation;
+		BuildChunk(build.Key, result);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFinished.push_back(std::move(result));
+	}
+}
+
+float ChunkedTerrain::DistanceXZ(ChunkKey key, float x, float z)const
+{
+	float size = mSettings.ChunkSize;
+	float x0 = KeyX(key)*size;
+	float z0 = KeyZ(key)*size;
+
+	float dx = MathHelper::Max(0.0f, MathHelper::Max(x0 - x, x - (x0 + size)));
+	float dz = MathHelper::Max(0.0f, MathHelper::Max(z0 - z, z - (z0 + size)));
+	return sqrtf(dx*dx + dz*dz);
+}
+
+void ChunkedTerrain::Evict(ChunkKey key)
+{
+	auto it = mChunks.find(key);
+	if(it->second.State == ChunkState::Resident)
+	{
+		mEvicted.push_back(key);
+		mResidentCount--;
+	}
+
+	// A queued chunk may already be building; its result is dropped when it arrives.
+	mChunks.erase(it);
+}
+
+void ChunkedTerrain::Update(FXMVECTOR eyeW)
+{
+	float ex = XMVectorGetX(eyeW);
+	float ez = XMVectorGetZ(eyeW);
+	float size = mSettings.ChunkSize;
+	float loadRadius = mSettings.LoadRadius;
+	float keepRadius = loadRadius + size;
+
+	std::vector<BuildResult> finished;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		finished.swap(mFinished);
+	}
+
+	for(BuildResult& result : finished)
+	{
+		// Evicted while it was building, or evicted and queued again: the new request
+		// has a new generation and waits for its own build.
+		auto it = mChunks.find(result.Key);
+		if(it == mChunks.end() || it->second.Generation != result.Generation)
+			continue;
+
+		assert(it->second.State == ChunkState::Queued);
+
+		Chunk& chunk = it->second;
+		chunk.State = ChunkState::Resident;
+		chunk.Bounds.Center = XMFLOAT3((KeyX(result.Key) + 0.5f)*size, 0.5f*(result.MinY + result.MaxY), (KeyZ(result.Key) + 0.5f)*size);
+		chunk.Bounds.Extents = XMFLOAT3(0.5f*size, 0.5f*(result.MaxY - result.MinY), 0.5f*size);
+		mResidentCount++;
+
+		BuiltChunk built;
+		built.Key = result.Key;
+		built.Vertices = std::move(result.Vertices);
+		mBuilt.push_back(std::move(built));
+	}
+
+	//
+	// The chunks we want are the ones we have within keepRadius plus the missing ones
+	// within loadRadius, nearest first, as many as the memory budget holds.
+	//
+
+	std::vector<QueuedBuild> wanted;
+	std::vector<ChunkKey> evict;
+	for(auto& e : mChunks)
+	{
+		float d = DistanceXZ(e.first, ex, ez);
+		if(d <= keepRadius)
+			wanted.push_back({ d, e.first });
+		else
+			evict.push_back(e.first);
+	}
+
+	int x0 = (int)floorf((ex - loadRadius) / size);
+	int x1 = (int)floorf((ex + loadRadius) / size);
+	int z0 = (int)floorf((ez - loadRadius) / size);
+	int z1 = (int)floorf((ez + loadRadius) / size);
+	for(int z = z0; z <= z1; ++z)
+	{
+		for(int x = x0; x <= x1; ++x)
+		{
+			ChunkKey key = MakeKey(x, z);
+			float d = DistanceXZ(key, ex, ez);
+			if(d <= loadRadius && mChunks.find(key) == mChunks.end())
+				wanted.push_back({ d, key });
+		}
+	}
+
+	std::sort(wanted.begin(), wanted.end(),
+		[](const QueuedBuild& a, const QueuedBuild& b) { return a.Distance < b.Distance; });
+
+	size_t chunkBytes = (size_t)GetChunkVertexCount()*mSettings.VertexStride;
+	size_t maxChunks = MathHelper::Max((size_t)1, mSettings.MemoryBudget / chunkBytes);
+	for(size_t i = maxChunks; i < wanted.size(); ++i)
+	{
+		if(mChunks.find(wanted[i].Key) != mChunks.end())
+			evict.push_back(wanted[i].Key);
+	}
+	wanted.resize(MathHelper::Min(wanted.size(), maxChunks));
+
+	for(ChunkKey key : evict)
+		Evict(key);
+
+	std::vector<QueuedBuild> added;
+	for(const QueuedBuild& w : wanted)
+	{
+		if(mChunks.find(w.Key) == mChunks.end())
+		{
+			Chunk& chunk = mChunks[w.Key];
+			chunk.Generation = mNextGeneration++;
+
+			QueuedBuild build = w;
+			build.Generation = chunk.Generation;
+			added.push_back(build);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// Drop the evicted chunks from the queue and refresh the distances of the rest.
+		for(size_t i = 0; i < mQueue.size(); )
+		{
+			if(mChunks.find(mQueue[i].Key) == mChunks.end())
+			{
+				mQueue[i] = mQueue.back();
+				mQueue.pop_back();
+			}
+			else
+			{
+				mQueue[i].Distance = DistanceXZ(mQueue[i].Key, ex, ez);
+				++i;
+			}
+		}
+
+		mQueue.insert(mQueue.end(), added.begin(), added.end());
+	}
+
+	if(!added.empty())
+		mWorkAvailable.notify_all();
+
+	SelectLods(eyeW);
+}
+
+void ChunkedTerrain::SelectLods(FXMVECTOR eyeW)
+{
+	XMFLOAT3 eye;
+	XMStoreFloat3(&eye, eyeW);
+
+	// Level by the distance from the eye to the chunk's box.
+	for(auto& e : mChunks)
+	{
+		Chunk& chunk = e.second;
+		if(chunk.State != ChunkState::Resident)
+			continue;
+
+		const XMFLOAT3& c = chunk.Bounds.Center;
+		const XMFLOAT3& r = chunk.Bounds.Extents;
+		float dx = MathHelper::Max(0.0f, fabsf(eye.x - c.x) - r.x);
+		float dy = MathHelper::Max(0.0f, fabsf(eye.y - c.y) - r.y);
+		float dz = MathHelper::Max(0.0f, fabsf(eye.z - c.z) - r.z);
+		float d = sqrtf(dx*dx + dy*dy + dz*dz);
+
+		chunk.Lod = 0;
+		for(float limit = mSettings.LodDistance; chunk.Lod + 1 < mSettings.LodCount && d >= limit; limit *= 2.0f)
+			chunk.Lod++;
+	}
+
+	const int offsetX[4] = { 0, 1, 0, -1 };
+	const int offsetZ[4] = { 1, 0, -1, 0 };
+	const uint32 sides[4] = { North, East, South, West };
+
+	auto neighbour = [&](ChunkKey key, int side) -> const Chunk*
+	{
+		auto it = mChunks.find(MakeKey(KeyX(key) + offsetX[side], KeyZ(key) + offsetZ[side]));
+		return it != mChunks.end() && it->second.State == ChunkState::Resident ? &it->second : nullptr;
+	};
+
+	// Refine chunks until no two neighbours are more than one level apart, so a side
+	// never has to stitch to anything but the next coarser level.
+	for(bool changed = true; changed; )
+	{
+		changed = false;
+		for(auto& e : mChunks)
+		{
+			Chunk& chunk = e.second;
+			if(chunk.State != ChunkState::Resident)
+				continue;
+
+			for(int side = 0; side < 4; ++side)
+			{
+				const Chunk* n = neighbour(e.first, side);
+				if(n != nullptr && chunk.Lod > n->Lod + 1)
+				{
+					chunk.Lod = n->Lod + 1;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	mDrawItems.clear();
+	for(auto& e : mChunks)
+	{
+		const Chunk& chunk = e.second;
+		if(chunk.State != ChunkState::Resident)
+			continue;
+
+		DrawItem item;
+		item.Key = e.first;
+		item.Lod = chunk.Lod;
+		item.Bounds = chunk.Bounds;
+
+		for(int side = 0; side < 4; ++side)
+		{
+			const Chunk* n = neighbour(e.first, side);
+			if(n != nullptr && n->Lod > chunk.Lod)
+				item.StitchMask |= sides[side];
+		}
+
+		item.Indices = GetIndexRange(item.Lod, item.StitchMask);
+		mDrawItems.push_back(item);
+	}
+
+	// Front to back, for early depth rejection.
+	XMVECTOR eyeV = XMLoadFloat3(&eye);
+	std::sort(mDrawItems.begin(), mDrawItems.end(), [&](const DrawItem& a, const DrawItem& b)
+	{
+		return XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&a.Bounds.Center) - eyeV)) <
+			XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&b.Bounds.Center) - eyeV));
+	});
+}
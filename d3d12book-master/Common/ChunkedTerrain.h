@@ -0,0 +1,209 @@
+//***************************************************************************************
+// ChunkedTerrain.h
+//
+// Streams a height field terrain of any extent as square chunks built on worker threads
+// around the viewer, and draws them with geomipmapping.
+//
+// Every chunk has the same (ChunkQuads+1)^2 vertex grid, so one 16-bit index buffer
+// serves all of them: for each level of detail it holds the grid using every 2^l-th
+// vertex, once per combination of sides that border a coarser neighbour.  On such a
+// side the odd vertices of the finer level are collapsed onto their even neighbours, so
+// the edge matches the neighbour's exactly and no cracks open.  Levels are picked by
+// distance and then relaxed until neighbours differ by at most one.
+//
+// Chunks within LoadRadius are queued nearest first; chunks beyond LoadRadius plus a
+// chunk of hysteresis are evicted, and when the resident vertex data would exceed
+// MemoryBudget the farthest chunks are evicted or not built.  The terrain does not own
+// GPU memory: the app takes the vertices of newly built chunks to upload them, and
+// the keys of evicted chunks to release their buffers.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <condition_variable>
+#include <DirectXCollision.h>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+class ChunkedTerrain
+{
+public:
+
+	using uint16 = GeometryGenerator::uint16;
+	using uint32 = GeometryGenerator::uint32;
+	using ChunkKey = std::uint64_t;
+
+	// Height of the terrain at four points at a time.  Called from the worker threads,
+	// and also one vertex beyond each chunk edge for the normals.
+	using HeightFunction = std::function<DirectX::XMVECTOR(const DirectX::XMVECTOR& x, const DirectX::XMVECTOR& z)>;
+
+	// Converts a generated vertex to the app's format (VertexStride bytes at out).
+	// Called from the worker threads.
+	using VertexEncoder = std::function<void(const GeometryGenerator::Vertex& in, void* out)>;
+
+	// Sides of a chunk, as bits of a stitch mask.  North is +z.
+	enum Side : uint32
+	{
+		North = 1,
+		East = 2,
+		South = 4,
+		West = 8
+	};
+
+	struct Settings
+	{
+		// World size of a chunk along x and z, and its quads per side at full detail (a
+		// power of two, at most 128).  ChunkSize/ChunkQuads should be exact in binary so
+		// neighbours sample their shared edge at identical coordinates.
+		float ChunkSize = 64.0f;
+		uint32 ChunkQuads = 64;
+
+		// Level l uses every 2^l-th vertex and is picked from distance LodDistance*2^(l-1)
+		// on.  Clamped so the coarsest level still has two quads per side.
+		uint32 LodCount = 5;
+		float LodDistance = 100.0f;
+
+		float LoadRadius = 800.0f;
+		size_t MemoryBudget = 64 << 20;
+
+		uint32 VertexStride = sizeof(GeometryGenerator::Vertex);
+
+		// 0 uses one thread per hardware thread, less one for the caller.
+		uint32 ThreadCount = 0;
+	};
+
+	struct IndexRange
+	{
+		uint32 StartIndex = 0;
+		uint32 IndexCount = 0;
+	};
+
+	struct DrawItem
+	{
+		ChunkKey Key = 0;
+		uint32 Lod = 0;
+		uint32 StitchMask = 0;
+		IndexRange Indices;
+		DirectX::BoundingBox Bounds;
+	};
+
+	struct BuiltChunk
+	{
+		ChunkKey Key = 0;
+		std::vector<std::uint8_t> Vertices;
+	};
+
+	ChunkedTerrain(const Settings& settings, HeightFunction height, VertexEncoder encoder);
+	ChunkedTerrain(const ChunkedTerrain& rhs) = delete;
+	ChunkedTerrain& operator=(const ChunkedTerrain& rhs) = delete;
+	~ChunkedTerrain();
+
+	static ChunkKey MakeKey(int x, int z);
+	static int KeyX(ChunkKey key);
+	static int KeyZ(ChunkKey key);
+
+	///<summary>
+	/// Shared index buffer of all levels and stitch masks.
+	///</summary>
+	const std::vector<uint16>& GetIndices()const;
+	IndexRange GetIndexRange(uint32 lod, uint32 stitchMask)const;
+
+	uint32 GetChunkVertexCount()const;
+	size_t GetResidentBytes()const;
+	uint32 GetResidentCount()const;
+	uint32 GetQueuedCount()const;
+
+	///<summary>
+	/// Call once per frame with the viewer position: collects finished chunks, queues
+	/// and evicts chunks, and picks the levels of the draw items.
+	///</summary>
+	void Update(DirectX::FXMVECTOR eyeW);
+
+	///<summary>
+	/// Moves out the chunks built since the last call.  The terrain keeps no CPU copy.
+	///</summary>
+	void TakeBuiltChunks(std::vector<BuiltChunk>& built);
+
+	///<summary>
+	/// Moves out the keys of chunks evicted since the last call.  Their GPU buffers can
+	/// go once the GPU has finished the frames that drew them.
+	///</summary>
+	void TakeEvictedChunks(std::vector<ChunkKey>& evicted);
+
+	///<summary>
+	/// Resident chunks with their levels and index ranges, as of the last Update.
+	///</summary>
+	const std::vector<DrawItem>& GetDrawItems()const;
+
+private:
+	enum class ChunkState
+	{
+		Queued,
+		Resident
+	};
+
+	struct Chunk
+	{
+		ChunkState State = ChunkState::Queued;
+		DirectX::BoundingBox Bounds;
+		uint32 Lod = 0;
+
+		// Identifies this stay of the chunk in mChunks.  A chunk that is evicted and
+		// queued again gets a new one, so a build started before the eviction is not
+		// taken for the new request.
+		uint32 Generation = 0;
+	};
+
+	struct BuildResult
+	{
+		ChunkKey Key = 0;
+		uint32 Generation = 0;
+		std::vector<std::uint8_t> Vertices;
+		float MinY = 0.0f;
+		float MaxY = 0.0f;
+	};
+
+	struct QueuedBuild
+	{
+		float Distance = 0.0f;
+		ChunkKey Key = 0;
+		uint32 Generation = 0;
+	};
+
+	void BuildIndices();
+	void BuildChunk(ChunkKey key, BuildResult& result)const;
+	void WorkerMain();
+
+	void Evict(ChunkKey key);
+	void SelectLods(DirectX::FXMVECTOR eyeW);
+
+	float DistanceXZ(ChunkKey key, float x, float z)const;
+
+private:
+	Settings mSettings;
+	HeightFunction mHeight;
+	VertexEncoder mEncoder;
+
+	std::vector<uint16> mIndices;
+	std::vector<IndexRange> mIndexRanges; // [lod*16 + stitchMask]
+
+	// Main thread only.
+	std::unordered_map<ChunkKey, Chunk> mChunks;
+	std::vector<BuiltChunk> mBuilt;
+	std::vector<ChunkKey> mEvicted;
+	std::vector<DrawItem> mDrawItems;
+	uint32 mResidentCount = 0;
+	uint32 mNextGeneration = 0;
+
+	// Shared with the workers, guarded by mMutex.
+	std::mutex mMutex;
+	std::condition_variable mWorkAvailable;
+	std::vector<QueuedBuild> mQueue;
+	std::vector<BuildResult> mFinished;
+	bool mStopping = false;
+
+	std::vector<std::thread> mWorkers;
+};
@@ -0,0 +1,72 @@
+//***************************************************************************************
+// ContentHash.h
+//
+// 64-bit FNV-1a hash of a stream of values, for keying caches by content.  Strings and
+// byte arrays are hashed with their length first, so the split between consecutive
+// values is part of the hash: ("ab", "c") and ("a", "bc") differ.
+//
+// Structs must be hashed member by member rather than with AddValue: their padding
+// bytes are not set by the constructors, and pointer members hash the address instead
+// of what it points to.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class ContentHash
+{
+public:
+	using uint64 = std::uint64_t;
+
+	ContentHash& AddBytes(const void* data, std::size_t size)
+	{
+		const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+		for(std::size_t i = 0; i < size; ++i)
+		{
+			mHash ^= bytes[i];
+			mHash *= 0x100000001b3ull;
+		}
+
+		return *this;
+	}
+
+	///<summary>
+	/// Adds a scalar, an enum or a struct without padding or pointers.
+	///</summary>
+	template<typename T>
+	ContentHash& AddValue(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "hash the members instead");
+		return AddBytes(&value, sizeof(T));
+	}
+
+	ContentHash& AddString(const std::string& s)
+	{
+		AddValue((uint64)s.size());
+		return AddBytes(s.data(), s.size());
+	}
+
+	ContentHash& AddArray(const void* data, std::size_t size)
+	{
+		AddValue((uint64)size);
+		return AddBytes(data, size);
+	}
+
+	uint64 Get()const
+	{
+		return mHash;
+	}
+
+	static uint64 Of(const void* data, std::size_t size)
+	{
+		return ContentHash().AddBytes(data, size).Get();
+	}
+
+private:
+	uint64 mHash = 0xcbf29ce484222325ull;
+};
@@ -0,0 +1,58 @@
+//***************************************************************************************
+// D3D12CommandBackend.cpp
+//***************************************************************************************
+
+#include "D3D12CommandBackend.h"
+
+D3D12CommandBackend::D3D12CommandBackend(ID3D12Device* device, ID3D12CommandQueue* commandQueue)
+	: md3dDevice(device), mCommandQueue(commandQueue)
+{
+}
+
+D3D12CommandBackend::CommandAllocator D3D12CommandBackend::CreateCommandAllocator()
+{
+	CommandAllocator allocator;
+	ThrowIfFailed(md3dDevice->CreateCommandAllocator(
+		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		IID_PPV_ARGS(allocator.GetAddressOf())));
+
+	return allocator;
+}
+
+D3D12CommandBackend::CommandList D3D12CommandBackend::CreateCommandList(CommandAllocator& allocator)
+{
+	CommandList list;
+	ThrowIfFailed(md3dDevice->CreateCommandList(
+		0,
+		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		allocator.Get(),
+		nullptr,
+		IID_PPV_ARGS(list.GetAddressOf())));
+
+	ThrowIfFailed(list->Close());
+	return list;
+}
+
+void D3D12CommandBackend::ResetCommandAllocator(CommandAllocator& allocator)
+{
+	ThrowIfFailed(allocator->Reset());
+}
+
+void D3D12CommandBackend::ResetCommandList(CommandList& list, CommandAllocator& allocator)
+{
+	ThrowIfFailed(list->Reset(allocator.Get(), nullptr));
+}
+
+void D3D12CommandBackend::CloseCommandList(CommandList& list)
+{
+	ThrowIfFailed(list->Close());
+}
+
+void D3D12CommandBackend::ExecuteCommandLists(CommandList* lists, uint32 count)
+{
+	mSubmitLists.resize(count);
+	for(uint32 i = 0; i < count; ++i)
+		mSubmitLists[i] = lists[i].Get();
+
+	mCommandQueue->ExecuteCommandLists(count, mSubmitLists.data());
+}
@@ -0,0 +1,41 @@
+//***************************************************************************************
+// D3D12CommandBackend.h
+//
+// FrameGraph backend that records real D3D12 command lists and submits them to a
+// direct command queue.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class D3D12CommandBackend
+{
+public:
+	using uint32 = std::uint32_t;
+	using CommandList = Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>;
+	using CommandAllocator = Microsoft::WRL::ComPtr<ID3D12CommandAllocator>;
+
+	D3D12CommandBackend(ID3D12Device* device, ID3D12CommandQueue* commandQueue);
+	D3D12CommandBackend(const D3D12CommandBackend& rhs) = delete;
+	D3D12CommandBackend& operator=(const D3D12CommandBackend& rhs) = delete;
+
+	CommandAllocator CreateCommandAllocator();
+
+	///<summary>
+	/// Creates a command list on the allocator and closes it, so that it can be reset
+	/// onto any allocator for recording.
+	///</summary>
+	CommandList CreateCommandList(CommandAllocator& allocator);
+
+	void ResetCommandAllocator(CommandAllocator& allocator);
+	void ResetCommandList(CommandList& list, CommandAllocator& allocator);
+	void CloseCommandList(CommandList& list);
+	void ExecuteCommandLists(CommandList* lists, uint32 count);
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+	ID3D12CommandQueue* mCommandQueue = nullptr;
+
+	std::vector<ID3D12CommandList*> mSubmitLists;
+};
@@ -0,0 +1,55 @@
+//***************************************************************************************
+// D3D12FrameFence.cpp
+//***************************************************************************************
+
+#include "D3D12FrameFence.h"
+
+D3D12FrameFence::D3D12FrameFence(ID3D12CommandQueue* commandQueue, ID3D12Fence* fence, UINT64& lastValue)
+	: mCommandQueue(commandQueue), mFence(fence), mLastValue(lastValue)
+{
+}
+
+D3D12FrameFence::~D3D12FrameFence()
+{
+	for(size_t i = 0; i < mEvents.size(); ++i)
+		CloseHandle(mEvents[i]);
+}
+
+D3D12FrameFence::uint64 D3D12FrameFence::Signal()
+{
+	// Add an instruction to the command queue to set a new fence point.  Because we 
+	// are on the GPU timeline, the new fence point won't be set until the GPU finishes
+	// processing all the commands prior to this Signal().
+	ThrowIfFailed(mCommandQueue->Signal(mFence, ++mLastValue));
+	return mLastValue;
+}
+
+D3D12FrameFence::uint64 D3D12FrameFence::GetCompletedValue()
+{
+	return mFence->GetCompletedValue();
+}
+
+void D3D12FrameFence::SetWaitSlotCount(uint32 count)
+{
+	while(mEvents.size() < count)
+	{
+		HANDLE eventHandle = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+		if(eventHandle == nullptr)
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
+		mEvents.push_back(eventHandle);
+	}
+}
+
+bool D3D12FrameFence::Wait(uint32 slot, uint64 value, uint32 timeoutMs)
+{
+	if(mFence->GetCompletedValue() >= value)
+		return true;
+
+	// Fire the slot's event when the GPU hits the fence point.  If an earlier wait
+	// timed out, the event may already be set from it, and this wait returns early.
+	ThrowIfFailed(mFence->SetEventOnCompletion(value, mEvents[slot]));
+
+	return WaitForSingleObject(mEvents[slot], timeoutMs) == WAIT_OBJECT_0 &&
+		mFence->GetCompletedValue() >= value;
+}
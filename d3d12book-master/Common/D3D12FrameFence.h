@@ -0,0 +1,36 @@
+//***************************************************************************************
+// D3D12FrameFence.h
+//
+// FrameFence over an ID3D12Fence signaled on a command queue.  Each wait slot owns one
+// event, which SetEventOnCompletion re-arms for every wait.
+//
+// The fence values come from a counter the fence shares with its owner (D3DApp's
+// mCurrentFence), so code that still signals the fence itself, with ++mCurrentFence,
+// keeps the values increasing.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "FrameFence.h"
+
+class D3D12FrameFence : public FrameFence
+{
+public:
+	D3D12FrameFence(ID3D12CommandQueue* commandQueue, ID3D12Fence* fence, UINT64& lastValue);
+	D3D12FrameFence(const D3D12FrameFence& rhs) = delete;
+	D3D12FrameFence& operator=(const D3D12FrameFence& rhs) = delete;
+	~D3D12FrameFence();
+
+	virtual uint64 Signal()override;
+	virtual uint64 GetCompletedValue()override;
+	virtual void SetWaitSlotCount(uint32 count)override;
+	virtual bool Wait(uint32 slot, uint64 value, uint32 timeoutMs)override;
+
+private:
+	ID3D12CommandQueue* mCommandQueue = nullptr;
+	ID3D12Fence* mFence = nullptr;
+	UINT64& mLastValue;
+
+	std::vector<HANDLE> mEvents;
+};
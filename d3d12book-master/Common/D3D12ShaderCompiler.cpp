@@ -0,0 +1,74 @@
+//***************************************************************************************
+// D3D12ShaderCompiler.cpp
+//***************************************************************************************
+
+#include "D3D12ShaderCompiler.h"
+#include <iterator>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// Null terminated macro array for the D3D compiler.  Points into request.
+	std::vector<D3D_SHADER_MACRO> MakeMacros(const ShaderRequest& request)
+	{
+		std::vector<D3D_SHADER_MACRO> macros;
+		for(auto& define : request.Defines)
+			macros.push_back({ define.first.c_str(), define.second.c_str() });
+
+		macros.push_back({ nullptr, nullptr });
+		return macros;
+	}
+}
+
+std::string D3D12ShaderCompiler::GetVersion()
+{
+	// The flags d3dUtil::CompileShader compiles with.
+	UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)
+	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+	return std::string(D3DCOMPILER_DLL_A) + " flags " + std::to_string(compileFlags);
+}
+
+std::string D3D12ShaderCompiler::Preprocess(const ShaderRequest& request)
+{
+	std::ifstream fin(request.Filename, std::ios::binary);
+	if(!fin)
+		ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+
+	std::string source((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+
+	// Includes are found relative to the source name, as D3DCompileFromFile finds them.
+	std::vector<D3D_SHADER_MACRO> macros = MakeMacros(request);
+
+	ComPtr<ID3DBlob> text;
+	ComPtr<ID3DBlob> errors;
+	HRESULT hr = D3DPreprocess(source.data(), source.size(), request.Filename.c_str(), macros.data(),
+		D3D_COMPILE_STANDARD_FILE_INCLUDE, &text, &errors);
+
+	if(errors != nullptr)
+		OutputDebugStringA((char*)errors->GetBufferPointer());
+
+	ThrowIfFailed(hr);
+
+	return std::string((const char*)text->GetBufferPointer(), text->GetBufferSize());
+}
+
+ShaderCompiler::Blob D3D12ShaderCompiler::Compile(const ShaderRequest& request)
+{
+	std::vector<D3D_SHADER_MACRO> macros = MakeMacros(request);
+
+	ComPtr<ID3DBlob> byteCode = d3dUtil::CompileShader(AnsiToWString(request.Filename), macros.data(),
+		request.EntryPoint, request.Target);
+
+	const std::uint8_t* data = (const std::uint8_t*)byteCode->GetBufferPointer();
+	return Blob(data, data + byteCode->GetBufferSize());
+}
+
+D3D12_SHADER_BYTECODE ShaderBytecode(const ShaderCache& cache, const std::string& name)
+{
+	const ShaderCache::Blob& blob = cache.Get(name);
+	return { blob.data(), blob.size() };
+}
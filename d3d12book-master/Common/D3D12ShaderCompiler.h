@@ -0,0 +1,26 @@
+//***************************************************************************************
+// D3D12ShaderCompiler.h
+//
+// ShaderCompiler over the D3D compiler.  Preprocess runs D3DPreprocess with the
+// standard include handler, and Compile goes through d3dUtil::CompileShader, so shaders
+// built by a ShaderCache compile exactly as the apps compiled them before.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+
+class D3D12ShaderCompiler : public ShaderCompiler
+{
+public:
+	virtual std::string GetVersion()override;
+	virtual std::string Preprocess(const ShaderRequest& request)override;
+	virtual Blob Compile(const ShaderRequest& request)override;
+};
+
+///<summary>
+/// Bytecode of a shader built by cache, for a pipeline state description.
+///</summary>
+D3D12_SHADER_BYTECODE ShaderBytecode(const ShaderCache& cache, const std::string& name);
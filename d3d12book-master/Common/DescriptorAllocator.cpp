@@ -0,0 +1,187 @@
+//***************************************************************************************
+// DescriptorAllocator.cpp
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+#include <cassert>
+
+const DescriptorAllocator::uint32 DescriptorAllocator::InvalidOffset;
+
+DescriptorAllocator::DescriptorAllocator(uint32 persistentCount, uint32 transientCount)
+	: mPersistent(persistentCount)
+{
+	mPersistentCount = persistentCount;
+	mTransientCount = transientCount;
+}
+
+DescriptorRangeHandle DescriptorAllocator::Allocate(uint32 count)
+{
+	DescriptorRangeHandle handle;
+	if(count == 0)
+		return handle;
+
+	uint32 offset = mPersistent.Allocate(count);
+	if(offset == FreeListAllocator::InvalidOffset)
+		return handle;
+
+	uint32 index;
+	if(!mFreeRanges.empty())
+	{
+		index = mFreeRanges.back();
+		mFreeRanges.pop_back();
+	}
+	else
+	{
+		index = (uint32)mRanges.size();
+		mRanges.push_back(Range());
+	}
+
+	Range& range = mRanges[index];
+	range.Offset = offset;
+	range.Count = count;
+	range.Live = true;
+
+	handle.Index = index;
+	handle.Generation = range.Generation;
+	return handle;
+}
+
+void DescriptorAllocator::Free(DescriptorRangeHandle handle, uint64 fenceValue)
+{
+	assert(IsValid(handle));
+	if(!IsValid(handle))
+		return;
+
+	Range& range = mRanges[handle.Index];
+	if(fenceValue == 0)
+	{
+		mPersistent.Free(range.Offset, range.Count);
+	}
+	else
+	{
+		PendingFree pending;
+		pending.FenceValue = fenceValue;
+		pending.Offset = range.Offset;
+		pending.Count = range.Count;
+		mPendingFrees.push_back(pending);
+	}
+
+	range.Live = false;
+	++range.Generation;
+	mFreeRanges.push_back(handle.Index);
+}
+
+bool DescriptorAllocator::IsValid(DescriptorRangeHandle handle)const
+{
+	return handle.Index < mRanges.size() && mRanges[handle.Index].Live &&
+		mRanges[handle.Index].Generation == handle.Generation;
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::GetOffset(DescriptorRangeHandle handle)const
+{
+	assert(IsValid(handle));
+	return mRanges[handle.Index].Offset;
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::GetCount(DescriptorRangeHandle handle)const
+{
+	assert(IsValid(handle));
+	return mRanges[handle.Index].Count;
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::AllocateTransient(uint32 count)
+{
+	if(count == 0 || count > mTransientCount)
+		return InvalidOffset;
+
+	if(mTransientUsed == 0)
+		mTransientTail = 0;
+
+	// A range that would run past the end of the ring starts over at the front, and
+	// the descriptors skipped count as used by this frame.
+	uint32 offset = mTransientTail;
+	uint32 padding = 0;
+	if(offset + count > mTransientCount)
+	{
+		padding = mTransientCount - offset;
+		offset = 0;
+	}
+
+	// The free descriptors are the mTransientCount - mTransientUsed ones after the
+	// tail, wrapping around the end.
+	if(padding + count > mTransientCount - mTransientUsed)
+		return InvalidOffset;
+
+	mTransientTail = offset + count;
+	mTransientUsed += padding + count;
+	mFrameCount += padding + count;
+
+	return mPersistentCount + offset;
+}
+
+void DescriptorAllocator::FinishFrame(uint64 fenceValue)
+{
+	assert(mFrames.empty() || mFrames.back().FenceValue <= fenceValue);
+
+	Frame frame;
+	frame.FenceValue = fenceValue;
+	frame.Count = mFrameCount;
+	mFrames.push_back(frame);
+
+	mPeakFrameCount = mFrameCount > mPeakFrameCount ? mFrameCount : mPeakFrameCount;
+	mFrameCount = 0;
+}
+
+void DescriptorAllocator::Reclaim(uint64 completedFenceValue)
+{
+	while(!mFrames.empty() && mFrames.front().FenceValue <= completedFenceValue)
+	{
+		mTransientUsed -= mFrames.front().Count;
+		mFrames.pop_front();
+	}
+
+	// Frees are not always made in fence order, so check them all.
+	for(size_t i = 0; i < mPendingFrees.size();)
+	{
+		if(mPendingFrees[i].FenceValue <= completedFenceValue)
+		{
+			mPersistent.Free(mPendingFrees[i].Offset, mPendingFrees[i].Count);
+			mPendingFrees[i] = mPendingFrees.back();
+			mPendingFrees.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::GetPersistentCount()const
+{
+	return mPersistentCount;
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::GetTransientCount()const
+{
+	return mTransientCount;
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::GetFreePersistentCount()const
+{
+	return mPersistent.GetFreeCount();
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::GetUsedTransientCount()const
+{
+	return mTransientUsed;
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::GetPeakFrameTransientCount()const
+{
+	return mPeakFrameCount;
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::GetPendingFreeCount()const
+{
+	return (uint32)mPendingFrees.size();
+}
@@ -0,0 +1,133 @@
+//***************************************************************************************
+// DescriptorAllocator.h
+//
+// Hands out descriptor slots of one heap, so apps allocate the views they need instead
+// of laying the heap out by hand with fixed offsets.  The heap's index space is split
+// in two:
+//
+//     [0, persistentCount)                                   persistent ranges
+//     [persistentCount, persistentCount + transientCount)    transient ring
+//
+// Persistent ranges are for views that live across frames: textures, shadow and SSAO
+// maps.  They come from a FreeListAllocator and are named by handles with a generation,
+// so a handle kept after Free is caught instead of silently reading whatever view took
+// its place.  Free takes the fence value of the last frame using the range, and the
+// range only goes back to the free list once Reclaim sees that value completed.
+//
+// Transient ranges are for views written every frame, such as the CBVs of the visible
+// objects.  They are bumped off a ring like UploadRing: FinishFrame tags everything
+// allocated since the last call with the frame's fence value, and Reclaim frees it.
+//
+// The allocator only does the bookkeeping, in descriptor indices; DescriptorHeap turns
+// them into CPU and GPU handles of a D3D12 heap.
+//***************************************************************************************
+
+#pragma once
+
+#include "FreeListAllocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct DescriptorRangeHandle
+{
+	std::uint32_t Index = UINT32_MAX;
+	std::uint32_t Generation = 0;
+};
+
+class DescriptorAllocator
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	static const uint32 InvalidOffset = UINT32_MAX;
+
+	DescriptorAllocator(uint32 persistentCount, uint32 transientCount);
+	DescriptorAllocator(const DescriptorAllocator& rhs) = delete;
+	DescriptorAllocator& operator=(const DescriptorAllocator& rhs) = delete;
+
+	///<summary>
+	/// Allocates count contiguous persistent descriptors.  Returns an invalid handle if
+	/// no free range is large enough.
+	///</summary>
+	DescriptorRangeHandle Allocate(uint32 count);
+
+	///<summary>
+	/// Invalidates the handle at once, and frees its range when Reclaim sees fenceValue
+	/// completed.  A fenceValue of 0 frees the range at once, for ranges the GPU has
+	/// never used.
+	///</summary>
+	void Free(DescriptorRangeHandle handle, uint64 fenceValue);
+
+	bool IsValid(DescriptorRangeHandle handle)const;
+
+	// Index of the first descriptor of the range, and its length.
+	uint32 GetOffset(DescriptorRangeHandle handle)const;
+	uint32 GetCount(DescriptorRangeHandle handle)const;
+
+	///<summary>
+	/// Returns the index of count contiguous transient descriptors, valid until the
+	/// frame is reclaimed, or InvalidOffset if the frames in flight leave no room.
+	///</summary>
+	uint32 AllocateTransient(uint32 count);
+
+	///<summary>
+	/// Everything allocated with AllocateTransient since the last call is in use until
+	/// fenceValue completes.
+	///</summary>
+	void FinishFrame(uint64 fenceValue);
+
+	///<summary>
+	/// Frees the transient frames and the persistent ranges whose fence values are at
+	/// most completedFenceValue.
+	///</summary>
+	void Reclaim(uint64 completedFenceValue);
+
+	uint32 GetPersistentCount()const;
+	uint32 GetTransientCount()const;
+	uint32 GetFreePersistentCount()const;
+	uint32 GetUsedTransientCount()const;
+	uint32 GetPeakFrameTransientCount()const;
+	uint32 GetPendingFreeCount()const;
+
+private:
+	struct Range
+	{
+		uint32 Offset = 0;
+		uint32 Count = 0;
+		uint32 Generation = 0;
+		bool Live = false;
+	};
+
+	struct PendingFree
+	{
+		uint64 FenceValue = 0;
+		uint32 Offset = 0;
+		uint32 Count = 0;
+	};
+
+	struct Frame
+	{
+		uint64 FenceValue = 0;
+		uint32 Count = 0; // Descriptors the frame took, padding at the end of the ring included.
+	};
+
+private:
+	FreeListAllocator mPersistent;
+	std::vector<Range> mRanges;
+	std::vector<uint32> mFreeRanges;
+	std::vector<PendingFree> mPendingFrees;
+
+	// The transient ring is [mPersistentCount, mPersistentCount + mTransientCount).
+	// Frames are reclaimed in order, so the descriptors in use are the mTransientUsed
+	// ones before mTransientTail, wrapping around the end.
+	uint32 mPersistentCount = 0;
+	uint32 mTransientCount = 0;
+	uint32 mTransientTail = 0;
+	uint32 mTransientUsed = 0;
+	uint32 mFrameCount = 0;
+	uint32 mPeakFrameCount = 0;
+	std::deque<Frame> mFrames;
+};
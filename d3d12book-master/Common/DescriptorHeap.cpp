@@ -0,0 +1,96 @@
+//***************************************************************************************
+// DescriptorHeap.cpp
+//***************************************************************************************
+
+#include "DescriptorHeap.h"
+
+DescriptorHeap::DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type,
+	UINT persistentCount, UINT transientCount, bool shaderVisible)
+	: mAllocator(persistentCount, transientCount)
+{
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = persistentCount + transientCount;
+	heapDesc.Type = type;
+	heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	heapDesc.NodeMask = 0;
+	ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+
+	mDescriptorSize = device->GetDescriptorHandleIncrementSize(type);
+	mShaderVisible = shaderVisible;
+}
+
+ID3D12DescriptorHeap* DescriptorHeap::Heap()const
+{
+	return mHeap.Get();
+}
+
+UINT DescriptorHeap::DescriptorSize()const
+{
+	return mDescriptorSize;
+}
+
+DescriptorAllocator& DescriptorHeap::Allocator()
+{
+	return mAllocator;
+}
+
+const DescriptorAllocator& DescriptorHeap::Allocator()const
+{
+	return mAllocator;
+}
+
+DescriptorRangeHandle DescriptorHeap::Allocate(UINT count)
+{
+	DescriptorRangeHandle range = mAllocator.Allocate(count);
+	assert(mAllocator.IsValid(range));
+
+	return range;
+}
+
+void DescriptorHeap::Free(DescriptorRangeHandle range, UINT64 fenceValue)
+{
+	mAllocator.Free(range, fenceValue);
+}
+
+CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::CpuHandle(DescriptorRangeHandle range, UINT i)const
+{
+	assert(i < mAllocator.GetCount(range));
+	return CpuHandle(mAllocator.GetOffset(range) + i);
+}
+
+CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::GpuHandle(DescriptorRangeHandle range, UINT i)const
+{
+	assert(i < mAllocator.GetCount(range));
+	return GpuHandle(mAllocator.GetOffset(range) + i);
+}
+
+UINT DescriptorHeap::AllocateTransient(UINT count)
+{
+	return mAllocator.AllocateTransient(count);
+}
+
+CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::CpuHandle(UINT index)const
+{
+	auto handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart());
+	handle.Offset(index, mDescriptorSize);
+	return handle;
+}
+
+CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::GpuHandle(UINT index)const
+{
+	assert(mShaderVisible);
+
+	auto handle = CD3DX12_GPU_DESCRIPTOR_HANDLE(mHeap->GetGPUDescriptorHandleForHeapStart());
+	handle.Offset(index, mDescriptorSize);
+	return handle;
+}
+
+void DescriptorHeap::FinishFrame(UINT64 fenceValue)
+{
+	mAllocator.FinishFrame(fenceValue);
+}
+
+void DescriptorHeap::Reclaim(UINT64 completedFenceValue)
+{
+	mAllocator.Reclaim(completedFenceValue);
+}
@@ -0,0 +1,66 @@
+//***************************************************************************************
+// DescriptorHeap.h
+//
+// A D3D12 descriptor heap sized for a DescriptorAllocator, which turns the allocator's
+// descriptor indices into CPU and GPU descriptor handles.  The heap is created with
+// persistentCount + transientCount descriptors; see DescriptorAllocator.h for how the
+// two parts are used.
+//
+// Handles of ranges that were freed are caught by an assert instead of addressing
+// whatever range took their place.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "DescriptorAllocator.h"
+
+class DescriptorHeap
+{
+public:
+	DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type,
+		UINT persistentCount, UINT transientCount, bool shaderVisible);
+	DescriptorHeap(const DescriptorHeap& rhs) = delete;
+	DescriptorHeap& operator=(const DescriptorHeap& rhs) = delete;
+
+	ID3D12DescriptorHeap* Heap()const;
+	UINT DescriptorSize()const;
+
+	DescriptorAllocator& Allocator();
+	const DescriptorAllocator& Allocator()const;
+
+	///<summary>
+	/// Allocates count contiguous persistent descriptors, and asserts they fit.
+	///</summary>
+	DescriptorRangeHandle Allocate(UINT count);
+
+	///<summary>
+	/// Frees the range once Reclaim sees fenceValue completed.
+	///</summary>
+	void Free(DescriptorRangeHandle range, UINT64 fenceValue);
+
+	// Handles of descriptor i of a persistent range.
+	CD3DX12_CPU_DESCRIPTOR_HANDLE CpuHandle(DescriptorRangeHandle range, UINT i = 0)const;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE GpuHandle(DescriptorRangeHandle range, UINT i = 0)const;
+
+	///<summary>
+	/// Allocates count contiguous transient descriptors for this frame.  Returns the
+	/// index of the first one, for CpuHandle and GpuHandle, or InvalidOffset if the
+	/// frames in flight leave no room.
+	///</summary>
+	UINT AllocateTransient(UINT count);
+
+	// Handles of the descriptor at an index of the heap.
+	CD3DX12_CPU_DESCRIPTOR_HANDLE CpuHandle(UINT index)const;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE GpuHandle(UINT index)const;
+
+	void FinishFrame(UINT64 fenceValue);
+	void Reclaim(UINT64 completedFenceValue);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
+	UINT mDescriptorSize = 0;
+	bool mShaderVisible = false;
+
+	DescriptorAllocator mAllocator;
+};
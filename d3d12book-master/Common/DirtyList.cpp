@@ -0,0 +1,72 @@
+//***************************************************************************************
+// DirtyList.cpp
+//***************************************************************************************
+
+#include "DirtyList.h"
+#include <algorithm>
+#include <cassert>
+
+DirtyList::DirtyList(uint32 queueCount, uint32 itemCount)
+{
+	Resize(queueCount, itemCount);
+}
+
+void DirtyList::Resize(uint32 queueCount, uint32 itemCount)
+{
+	mItemCount = itemCount;
+	mQueues.assign(queueCount, std::vector<uint32>());
+	mQueued.assign((size_t)queueCount*itemCount, 0);
+}
+
+void DirtyList::MarkDirty(uint32 item)
+{
+	assert(item < mItemCount);
+
+	for(size_t q = 0; q < mQueues.size(); ++q)
+	{
+		std::uint8_t& queued = mQueued[q*mItemCount + item];
+		if(!queued)
+		{
+			queued = 1;
+			mQueues[q].push_back(item);
+		}
+	}
+}
+
+void DirtyList::MarkAllDirty()
+{
+	for(size_t q = 0; q < mQueues.size(); ++q)
+	{
+		mQueues[q].resize(mItemCount);
+		for(uint32 i = 0; i < mItemCount; ++i)
+			mQueues[q][i] = i;
+	}
+
+	std::fill(mQueued.begin(), mQueued.end(), (std::uint8_t)1);
+}
+
+void DirtyList::Take(uint32 queue, std::vector<uint32>& items)
+{
+	assert(queue < mQueues.size());
+
+	items.clear();
+	items.swap(mQueues[queue]);
+	if(items.empty())
+		return;
+
+	std::sort(items.begin(), items.end());
+
+	std::uint8_t* queued = &mQueued[(size_t)queue*mItemCount];
+	for(uint32 item : items)
+		queued[item] = 0;
+}
+
+DirtyList::uint32 DirtyList::GetDirtyCount(uint32 queue)const
+{
+	return (uint32)mQueues[queue].size();
+}
+
+DirtyList::uint32 DirtyList::GetItemCount()const
+{
+	return mItemCount;
+}
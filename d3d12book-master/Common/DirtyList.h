@@ -0,0 +1,52 @@
+//***************************************************************************************
+// DirtyList.h
+//
+// Change tracking for per-object data kept once per frame resource, such as object
+// constants.  Marking an item queues it for every frame resource; each frame takes the
+// queue of its frame resource and updates only those items.  The cost of the updates
+// then follows the number of changes, not the number of items.
+//
+// Nothing is noticed by itself: whatever changes an item's data must call MarkDirty, or
+// the frame resources keep the old data.  RenderItemStore does this in its setters, so
+// data changed only through them cannot be missed.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class DirtyList
+{
+public:
+	using uint32 = std::uint32_t;
+
+	DirtyList(uint32 queueCount = 0, uint32 itemCount = 0);
+
+	///<summary>
+	/// Sets the number of queues (frame resources) and items.  Clears every queue.
+	///</summary>
+	void Resize(uint32 queueCount, uint32 itemCount);
+
+	///<summary>
+	/// Queues item on every queue it is not already on.
+	///</summary>
+	void MarkDirty(uint32 item);
+	void MarkAllDirty();
+
+	///<summary>
+	/// Moves the items queued on queue to items, in ascending order so the writes into
+	/// a buffer indexed by item go front to back.
+	///</summary>
+	void Take(uint32 queue, std::vector<uint32>& items);
+
+	uint32 GetDirtyCount(uint32 queue)const;
+	uint32 GetItemCount()const;
+
+private:
+	uint32 mItemCount = 0;
+	std::vector<std::vector<uint32>> mQueues;
+
+	// mQueued[queue*mItemCount + item] is 1 while item is on queue.
+	std::vector<std::uint8_t> mQueued;
+};
@@ -0,0 +1,71 @@
+//***************************************************************************************
+// DrawQueue.cpp
+//***************************************************************************************
+
+#include "DrawQueue.h"
+#include <utility>
+
+void DrawQueue::Clear()
+{
+	mPackets.clear();
+}
+
+void DrawQueue::Add(uint64 key, uint32 item)
+{
+	Packet p;
+	p.Key = key;
+	p.Item = item;
+	mPackets.push_back(p);
+}
+
+void DrawQueue::Sort()
+{
+	const int DigitCount = 8;
+	const std::size_t n = mPackets.size();
+	if(n < 2)
+		return;
+
+	// Histograms of all eight bytes in one pass over the keys.
+	uint32 counts[DigitCount][256] = {};
+	for(const Packet& p : mPackets)
+	{
+		for(int d = 0; d < DigitCount; ++d)
+			counts[d][(p.Key >> (8*d)) & 0xff]++;
+	}
+
+	mScratch.resize(n);
+	Packet* src = mPackets.data();
+	Packet* dst = mScratch.data();
+
+	// Least significant byte first; each pass is stable, so the result is sorted.
+	for(int d = 0; d < DigitCount; ++d)
+	{
+		uint32* count = counts[d];
+
+		// Bytes that every key shares (unused layers, a single pipeline state) leave
+		// the order as it is.
+		if(count[(src[0].Key >> (8*d)) & 0xff] == n)
+			continue;
+
+		uint32 offset = 0;
+		for(int b = 0; b < 256; ++b)
+		{
+			uint32 c = count[b];
+			count[b] = offset;
+			offset += c;
+		}
+
+		for(std::size_t i = 0; i < n; ++i)
+			dst[count[(src[i].Key >> (8*d)) & 0xff]++] = src[i];
+
+		std::swap(src, dst);
+	}
+
+	if(src != mPackets.data())
+		mPackets.swap(mScratch);
+}
+
+const std::vector<DrawQueue::Packet>& DrawQueue::GetPackets()const
+{
+	return mPackets;
+}
@@ -0,0 +1,165 @@
+//***************************************************************************************
+// DrawQueue.h
+//
+// Draw submission ordered by sort keys.  Each draw is a packet of a 64-bit key and the
+// index of the render item to draw.  The key packs, from the most significant bits
+// down, the render layer, pipeline state, material, geometry and depth, so sorting the
+// packets puts the layers in order and, within a layer, groups the draws that share a
+// pipeline state, then a material, then vertex/index buffers.
+//
+// Submit walks the sorted packets and sets a state only when its field of the key
+// differs from the previous draw's, so a run of draws that share a material binds it
+// once.  It counts the state changes it makes.
+//
+// Submit records through a Recorder template parameter instead of a command list:
+//
+//	void SetPipelineState(uint32 pipeline, uint32 item);
+//	void SetMaterial(uint32 material, uint32 item);
+//	void SetGeometry(uint32 geometry, uint32 item);
+//	void Draw(uint32 item);
+//
+// where item is the first draw that needs the new state.  The app's recorder binds
+// the item's state on its ID3D12GraphicsCommandList; a stub that just counts the
+// calls lets the sort and the submission be timed without a device.
+//***************************************************************************************
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SortKey
+{
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	const uint32 DepthBits = 20;
+	const uint32 GeometryBits = 16;
+	const uint32 MaterialBits = 16;
+	const uint32 PipelineBits = 8;
+	const uint32 LayerBits = 4;
+
+	const uint32 DepthShift = 0;
+	const uint32 GeometryShift = DepthShift + DepthBits;
+	const uint32 MaterialShift = GeometryShift + GeometryBits;
+	const uint32 PipelineShift = MaterialShift + MaterialBits;
+	const uint32 LayerShift = PipelineShift + PipelineBits;
+
+	const uint32 MaxDepth = (1u << DepthBits) - 1;
+
+	inline uint64 Make(uint32 layer, uint32 pipeline, uint32 material, uint32 geometry, uint32 depth)
+	{
+		assert(layer < (1u << LayerBits) && pipeline < (1u << PipelineBits));
+		assert(material < (1u << MaterialBits) && geometry < (1u << GeometryBits) && depth <= MaxDepth);
+
+		return (uint64)layer << LayerShift | (uint64)pipeline << PipelineShift |
+			(uint64)material << MaterialShift | (uint64)geometry << GeometryShift | (uint64)depth << DepthShift;
+	}
+
+	inline uint32 Layer(uint64 key)    { return (uint32)(key >> LayerShift) & ((1u << LayerBits) - 1); }
+	inline uint32 Pipeline(uint64 key) { return (uint32)(key >> PipelineShift) & ((1u << PipelineBits) - 1); }
+	inline uint32 Material(uint64 key) { return (uint32)(key >> MaterialShift) & ((1u << MaterialBits) - 1); }
+	inline uint32 Geometry(uint64 key) { return (uint32)(key >> GeometryShift) & ((1u << GeometryBits) - 1); }
+	inline uint32 Depth(uint64 key)    { return (uint32)(key >> DepthShift) & MaxDepth; }
+
+	///<summary>
+	/// Quantizes a view space depth in [nearZ, farZ] for the depth field: front to
+	/// back, which suits opaque draws.
+	///</summary>
+	inline uint32 FrontToBack(float viewZ, float nearZ, float farZ)
+	{
+		float t = (viewZ - nearZ) / (farZ - nearZ);
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		return (uint32)(t*MaxDepth);
+	}
+
+	///<summary>
+	/// Back to front, for blended draws.
+	///</summary>
+	inline uint32 BackToFront(float viewZ, float nearZ, float farZ)
+	{
+		return MaxDepth - FrontToBack(viewZ, nearZ, farZ);
+	}
+}
+
+class DrawQueue
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	struct Packet
+	{
+		uint64 Key = 0;
+		uint32 Item = 0;
+	};
+
+	struct Stats
+	{
+		uint32 Draws = 0;
+		uint32 PipelineChanges = 0;
+		uint32 MaterialChanges = 0;
+		uint32 GeometryChanges = 0;
+
+		uint32 StateChanges()const { return PipelineChanges + MaterialChanges + GeometryChanges; }
+	};
+
+	void Clear();
+	void Add(uint64 key, uint32 item);
+
+	///<summary>
+	/// Sorts the packets by key with a radix sort, which is linear in the number of
+	/// packets and skips the bytes every key shares.  Packets with equal keys keep the
+	/// order they were added in.
+	///</summary>
+	void Sort();
+
+	///<summary>
+	/// Records the packets in order, setting only the states that change between
+	/// consecutive draws.  Every state is set for the first draw.
+	///</summary>
+	template<typename Recorder>
+	Stats Submit(Recorder& recorder)const
+	{
+		Stats stats;
+		for(std::size_t i = 0; i < mPackets.size(); ++i)
+		{
+			const Packet& p = mPackets[i];
+			uint64 prevKey = i > 0 ? mPackets[i - 1].Key : 0;
+
+			uint32 pipeline = SortKey::Pipeline(p.Key);
+			if(i == 0 || pipeline != SortKey::Pipeline(prevKey))
+			{
+				recorder.SetPipelineState(pipeline, p.Item);
+				stats.PipelineChanges++;
+			}
+
+			uint32 material = SortKey::Material(p.Key);
+			if(i == 0 || material != SortKey::Material(prevKey))
+			{
+				recorder.SetMaterial(material, p.Item);
+				stats.MaterialChanges++;
+			}
+
+			uint32 geometry = SortKey::Geometry(p.Key);
+			if(i == 0 || geometry != SortKey::Geometry(prevKey))
+			{
+				recorder.SetGeometry(geometry, p.Item);
+				stats.GeometryChanges++;
+			}
+
+			recorder.Draw(p.Item);
+			stats.Draws++;
+		}
+
+		return stats;
+	}
+
+	const std::vector<Packet>& GetPackets()const;
+
+private:
+	std::vector<Packet> mPackets;
+	std::vector<Packet> mScratch;
+};
@@ -0,0 +1,47 @@
+//***************************************************************************************
+// FrameFence.h
+//
+// What FramePacer needs of a GPU fence: signal it after the work submitted so far, read
+// how far the GPU has got, and block until it gets somewhere.  D3D12FrameFence wraps an
+// ID3D12Fence; SimulatedFrameFence stands in for the GPU with a thread, for exercising
+// the pacing without a device.
+//
+// Waits go through wait slots, each owning one wait primitive that is created once and
+// reused, instead of creating an event every time the CPU has to wait.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+class FrameFence
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	// Timeout of Wait that never expires.
+	static const uint32 InfiniteWait = 0xffffffff;
+
+	virtual ~FrameFence() = default;
+
+	///<summary>
+	/// Signals the fence after all the work submitted so far.  Returns the value that
+	/// completes when the GPU gets there.
+	///</summary>
+	virtual uint64 Signal() = 0;
+
+	virtual uint64 GetCompletedValue() = 0;
+
+	///<summary>
+	/// Creates the wait primitives of count slots, keeping those already made.
+	///</summary>
+	virtual void SetWaitSlotCount(uint32 count) = 0;
+
+	///<summary>
+	/// Blocks on the primitive of the slot until value completes or timeoutMs passes.
+	/// Returns true if value completed.  May also return early, so callers check the
+	/// completed value again.
+	///</summary>
+	virtual bool Wait(uint32 slot, uint64 value, uint32 timeoutMs) = 0;
+};
@@ -0,0 +1,170 @@
+//***************************************************************************************
+// FrameGraph.h
+//
+// Records the passes of a frame in parallel and submits them together.  Each pass gets
+// its own command list and records it in a job of the JobSystem; when all the passes
+// are recorded, their lists go to the queue in one ExecuteCommandLists, in the order the
+// passes were added, so the GPU runs them in that order whatever thread recorded them.
+//
+// Command allocators are kept per frame resource and per job thread, so a thread only
+// records from its own allocator and no locking is needed.  Execute resets the
+// allocators of the frame resource it is given, so the app must have waited for the
+// GPU to finish that frame resource's previous frame first, as it does before
+// reusing the frame resource's constant buffers.
+//
+// The graph is a template over the backend that creates and submits the command lists.
+// D3D12CommandBackend is the real one; RecordingCommandBackend only logs the calls and
+// checks them against the D3D12 rules, for testing the scheduling without a device.
+// A backend provides:
+//
+//     typename CommandList;
+//     typename CommandAllocator;
+//     CommandAllocator CreateCommandAllocator();
+//     CommandList CreateCommandList(CommandAllocator& allocator);   // Returned closed.
+//     void ResetCommandAllocator(CommandAllocator& allocator);
+//     void ResetCommandList(CommandList& list, CommandAllocator& allocator);
+//     void CloseCommandList(CommandList& list);
+//     void ExecuteCommandLists(CommandList* lists, uint32 count);
+//
+// ResetCommandList and CloseCommandList are called from the job threads, at the same
+// time for different lists and allocators.
+//***************************************************************************************
+
+#pragma once
+
+#include "JobSystem.h"
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+template<typename Backend>
+class FrameGraph
+{
+public:
+	using uint32 = std::uint32_t;
+	using CommandList = typename Backend::CommandList;
+	using CommandAllocator = typename Backend::CommandAllocator;
+
+	///<summary>
+	/// Records the commands of a pass into cmdList, which is open.  The list starts
+	/// with no state set, so the pass sets whatever it uses.
+	///</summary>
+	using RecordFunc = std::function<void(CommandList& cmdList)>;
+
+	struct Stats
+	{
+		uint32 PassCount = 0;
+
+		// Number of different threads that recorded passes.
+		uint32 ThreadsUsed = 0;
+	};
+
+	FrameGraph(Backend& backend, JobSystem& jobs, uint32 frameResourceCount)
+		: mBackend(backend), mJobs(jobs), mThreadCount(jobs.GetThreadCount()),
+		mFrameResourceCount(frameResourceCount)
+	{
+		for(uint32 i = 0; i < mFrameResourceCount*mThreadCount; ++i)
+			mAllocators.push_back(mBackend.CreateCommandAllocator());
+	}
+
+	FrameGraph(const FrameGraph& rhs) = delete;
+	FrameGraph& operator=(const FrameGraph& rhs) = delete;
+
+	///<summary>
+	/// Adds a pass after the ones already added.  Returns its index.
+	///</summary>
+	uint32 AddPass(const std::string& name, RecordFunc record)
+	{
+		Pass pass;
+		pass.Name = name;
+		pass.Record = std::move(record);
+		mPasses.push_back(std::move(pass));
+
+		mLists.push_back(mBackend.CreateCommandList(mAllocators[0]));
+		return (uint32)mPasses.size() - 1;
+	}
+
+	///<summary>
+	/// Records every pass using the allocators of the given frame resource, and submits
+	/// the lists.
+	///</summary>
+	Stats Execute(uint32 frameResource)
+	{
+		assert(frameResource < mFrameResourceCount);
+
+		CommandAllocator* allocators = &mAllocators[frameResource*mThreadCount];
+		for(uint32 i = 0; i < mThreadCount; ++i)
+			mBackend.ResetCommandAllocator(allocators[i]);
+
+		JobSystem::Group group;
+		for(uint32 i = 0; i < (uint32)mPasses.size(); ++i)
+		{
+			mJobs.Submit(group, [this, i, allocators](uint32 thread)
+			{
+				CommandList& cmdList = mLists[i];
+				mBackend.ResetCommandList(cmdList, allocators[thread]);
+				mPasses[i].Record(cmdList);
+				mBackend.CloseCommandList(cmdList);
+
+				mPasses[i].Thread = thread;
+			});
+		}
+		mJobs.Wait(group);
+
+		mBackend.ExecuteCommandLists(mLists.data(), (uint32)mLists.size());
+
+		Stats stats;
+		stats.PassCount = (uint32)mPasses.size();
+
+		std::vector<bool> threadUsed(mThreadCount, false);
+		for(size_t i = 0; i < mPasses.size(); ++i)
+		{
+			if(!threadUsed[mPasses[i].Thread])
+			{
+				threadUsed[mPasses[i].Thread] = true;
+				stats.ThreadsUsed++;
+			}
+		}
+
+		return stats;
+	}
+
+	uint32 GetPassCount()const
+	{
+		return (uint32)mPasses.size();
+	}
+
+	const std::string& GetPassName(uint32 pass)const
+	{
+		return mPasses[pass].Name;
+	}
+
+	// Thread that recorded the pass in the last Execute.
+	uint32 GetPassThread(uint32 pass)const
+	{
+		return mPasses[pass].Thread;
+	}
+
+private:
+	struct Pass
+	{
+		std::string Name;
+		RecordFunc Record;
+		uint32 Thread = 0;
+	};
+
+	Backend& mBackend;
+	JobSystem& mJobs;
+	uint32 mThreadCount = 0;
+	uint32 mFrameResourceCount = 0;
+
+	// Allocator of thread t for frame resource f is at [f*mThreadCount + t].
+	std::vector<CommandAllocator> mAllocators;
+
+	std::vector<Pass> mPasses;
+
+	// One list per pass, kept apart so they can be submitted as an array.
+	std::vector<CommandList> mLists;
+};
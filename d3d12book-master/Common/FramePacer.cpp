@@ -0,0 +1,120 @@
+//***************************************************************************************
+// FramePacer.cpp
+//***************************************************************************************
+
+#include "FramePacer.h"
+#include <cassert>
+#include <chrono>
+
+namespace
+{
+	// While there is idle work, waits wake up this often to look for more.
+	const std::uint32_t IdleWorkPollMs = 1;
+}
+
+FramePacer::FramePacer(FrameFence& fence, uint32 framesInFlight)
+	: mFence(fence)
+{
+	SetFramesInFlight(framesInFlight);
+}
+
+void FramePacer::SetFramesInFlight(uint32 count)
+{
+	assert(count > 0);
+
+	if(!mFrameFences.empty())
+		WaitForIdle();
+
+	mFence.SetWaitSlotCount(count + 1);
+
+	// The last slot so that the first BeginFrame moves to slot 0.
+	mFrameFences.assign(count, 0);
+	mFrameIndex = count - 1;
+}
+
+void FramePacer::SetIdleWork(IdleWork work)
+{
+	mIdleWork = std::move(work);
+}
+
+FramePacer::uint32 FramePacer::BeginFrame()
+{
+	mFrameIndex = (mFrameIndex + 1) % (uint32)mFrameFences.size();
+
+	// Has the GPU finished processing the commands of this slot's last frame?
+	// If not, wait until the GPU has completed commands up to its fence point.
+	WaitForValue(mFrameIndex, mFrameFences[mFrameIndex]);
+
+	return mFrameIndex;
+}
+
+FramePacer::uint64 FramePacer::EndFrame()
+{
+	mFrameFences[mFrameIndex] = mFence.Signal();
+	mStats.FrameCount++;
+
+	return mFrameFences[mFrameIndex];
+}
+
+void FramePacer::WaitForIdle()
+{
+	WaitForValue((uint32)mFrameFences.size(), mFence.Signal());
+}
+
+FramePacer::uint32 FramePacer::GetFramesInFlight()const
+{
+	return (uint32)mFrameFences.size();
+}
+
+FramePacer::uint32 FramePacer::GetFrameIndex()const
+{
+	return mFrameIndex;
+}
+
+FramePacer::uint64 FramePacer::GetCompletedValue()
+{
+	return mFence.GetCompletedValue();
+}
+
+const FramePacer::Stats& FramePacer::GetStats()const
+{
+	return mStats;
+}
+
+void FramePacer::ResetStats()
+{
+	mStats = Stats();
+}
+
+void FramePacer::WaitForValue(uint32 slot, uint64 value)
+{
+	if(mFence.GetCompletedValue() >= value)
+		return;
+
+	using Clock = std::chrono::steady_clock;
+	using Milliseconds = std::chrono::duration<double, std::milli>;
+
+	Clock::time_point start = Clock::now();
+	double blockedMs = 0.0;
+
+	while(mFence.GetCompletedValue() < value)
+	{
+		if(mIdleWork && mIdleWork())
+		{
+			mStats.IdleWorkCount++;
+			continue;
+		}
+
+		// Nothing to do.  Block, but wake now and then if work may turn up.
+		Clock::time_point blockStart = Clock::now();
+		mFence.Wait(slot, value, mIdleWork ? IdleWorkPollMs : FrameFence::InfiniteWait);
+		blockedMs += Milliseconds(Clock::now() - blockStart).count();
+	}
+
+	double waitMs = Milliseconds(Clock::now() - start).count();
+	mStats.WaitCount++;
+	mStats.WaitMs += waitMs;
+	mStats.BlockedMs += blockedMs;
+	if(waitMs > mStats.MaxWaitMs)
+		mStats.MaxWaitMs = waitMs;
+}
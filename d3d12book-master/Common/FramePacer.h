@@ -0,0 +1,90 @@
+//***************************************************************************************
+// FramePacer.h
+//
+// Keeps the CPU at most a set number of frames ahead of the GPU.  Each frame in flight
+// has a slot, which is the index of the app's frame resource: BeginFrame moves to the
+// next slot and waits until the GPU has finished the frame that last used it, and
+// EndFrame signals the fence for the frame just submitted.  WaitForIdle waits for
+// everything submitted, for resizing and shutting down.
+//
+// Instead of blocking outright, a wait runs the app's idle work, such as queued asset
+// streaming jobs, until the GPU catches up or there is none left.  The time spent
+// waiting, and how much of it the CPU was idle, is kept in the stats.
+//***************************************************************************************
+
+#pragma once
+
+#include "FrameFence.h"
+#include <functional>
+#include <vector>
+
+class FramePacer
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	///<summary>
+	/// Runs one piece of work, returning false if there was none.
+	///</summary>
+	using IdleWork = std::function<bool()>;
+
+	struct Stats
+	{
+		uint64 FrameCount = 0;
+
+		// Waits that found the GPU behind, their total and longest times, and the part
+		// of the total spent blocked rather than running idle work.
+		uint64 WaitCount = 0;
+		double WaitMs = 0.0;
+		double MaxWaitMs = 0.0;
+		double BlockedMs = 0.0;
+
+		uint64 IdleWorkCount = 0;
+	};
+
+	FramePacer(FrameFence& fence, uint32 framesInFlight);
+	FramePacer(const FramePacer& rhs) = delete;
+	FramePacer& operator=(const FramePacer& rhs) = delete;
+
+	///<summary>
+	/// Waits for the GPU to go idle and starts over with count frames in flight.
+	///</summary>
+	void SetFramesInFlight(uint32 count);
+
+	void SetIdleWork(IdleWork work);
+
+	///<summary>
+	/// Moves to the next frame slot and returns it, once the GPU is done with the
+	/// frame that used it last.
+	///</summary>
+	uint32 BeginFrame();
+
+	///<summary>
+	/// Signals the fence after the current frame's work.  Returns the fence value.
+	///</summary>
+	uint64 EndFrame();
+
+	void WaitForIdle();
+
+	uint32 GetFramesInFlight()const;
+	uint32 GetFrameIndex()const;
+	uint64 GetCompletedValue();
+
+	const Stats& GetStats()const;
+	void ResetStats();
+
+private:
+	void WaitForValue(uint32 slot, uint64 value);
+
+private:
+	FrameFence& mFence;
+	IdleWork mIdleWork;
+
+	// Fence value of the last frame in each slot.  Waits outside frames use the
+	// fence's wait slot after the frame slots.
+	std::vector<uint64> mFrameFences;
+	uint32 mFrameIndex = 0;
+
+	Stats mStats;
+};
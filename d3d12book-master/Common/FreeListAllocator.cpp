@@ -0,0 +1,115 @@
+//***************************************************************************************
+// FreeListAllocator.cpp
+//***************************************************************************************
+
+#include "FreeListAllocator.h"
+#include <cassert>
+#include <iterator>
+
+const FreeListAllocator::uint32 FreeListAllocator::InvalidOffset;
+
+FreeListAllocator::FreeListAllocator(uint32 capacity)
+{
+	mCapacity = capacity;
+	Reset(0);
+}
+
+FreeListAllocator::uint32 FreeListAllocator::Allocate(uint32 count)
+{
+	if(count == 0 || count > mFreeCount)
+		return InvalidOffset;
+
+	// Best fit.
+	auto best = mFreeRanges.end();
+	for(auto it = mFreeRanges.begin(); it != mFreeRanges.end(); ++it)
+	{
+		if(it->second >= count && (best == mFreeRanges.end() || it->second < best->second))
+		{
+			best = it;
+			if(it->second == count)
+				break;
+		}
+	}
+
+	if(best == mFreeRanges.end())
+		return InvalidOffset;
+
+	uint32 offset = best->first;
+	uint32 remaining = best->second - count;
+	mFreeRanges.erase(best);
+	if(remaining > 0)
+		mFreeRanges[offset + count] = remaining;
+
+	mFreeCount -= count;
+	return offset;
+}
+
+void FreeListAllocator::Free(uint32 offset, uint32 count)
+{
+	if(count == 0)
+		return;
+
+	assert(offset + count <= mCapacity);
+	mFreeCount += count;
+
+	auto next = mFreeRanges.lower_bound(offset);
+	assert(next == mFreeRanges.end() || offset + count <= next->first);
+
+	// Merge with the free range that ends where this one starts...
+	if(next != mFreeRanges.begin())
+	{
+		auto prev = std::prev(next);
+		assert(prev->first + prev->second <= offset);
+
+		if(prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			count += prev->second;
+			mFreeRanges.erase(prev);
+		}
+	}
+
+	// ...and the one that starts where it ends.
+	if(next != mFreeRanges.end() && next->first == offset + count)
+	{
+		count += next->second;
+		mFreeRanges.erase(next);
+	}
+
+	mFreeRanges[offset] = count;
+}
+
+void FreeListAllocator::Reset(uint32 usedCount)
+{
+	assert(usedCount <= mCapacity);
+
+	mFreeRanges.clear();
+	if(usedCount < mCapacity)
+		mFreeRanges[usedCount] = mCapacity - usedCount;
+
+	mFreeCount = mCapacity - usedCount;
+}
+
+FreeListAllocator::uint32 FreeListAllocator::GetCapacity()const
+{
+	return mCapacity;
+}
+
+FreeListAllocator::uint32 FreeListAllocator::GetFreeCount()const
+{
+	return mFreeCount;
+}
+
+FreeListAllocator::uint32 FreeListAllocator::GetLargestFreeRange()const
+{
+	uint32 largest = 0;
+	for(auto& range : mFreeRanges)
+		largest = range.second > largest ? range.second : largest;
+
+	return largest;
+}
+
+FreeListAllocator::uint32 FreeListAllocator::GetFreeRangeCount()const
+{
+	return (uint32)mFreeRanges.size();
+}
@@ -0,0 +1,52 @@
+//***************************************************************************************
+// FreeListAllocator.h
+//
+// Hands out ranges of [0, capacity) elements from a free list.  Allocation takes the
+// smallest free range that fits, to keep large ranges whole, and freed ranges are
+// merged with their free neighbours.  It only does the bookkeeping: the caller owns
+// the memory the offsets refer to.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+class FreeListAllocator
+{
+public:
+	using uint32 = std::uint32_t;
+
+	static const uint32 InvalidOffset = UINT32_MAX;
+
+	explicit FreeListAllocator(uint32 capacity = 0);
+
+	///<summary>
+	/// Returns the offset of count free elements, or InvalidOffset if no free range is
+	/// large enough.
+	///</summary>
+	uint32 Allocate(uint32 count);
+
+	///<summary>
+	/// Returns a range from Allocate to the free list.
+	///</summary>
+	void Free(uint32 offset, uint32 count);
+
+	///<summary>
+	/// Marks [0, usedCount) allocated and everything after it free, for callers that
+	/// have compacted their allocations to the front.
+	///</summary>
+	void Reset(uint32 usedCount);
+
+	uint32 GetCapacity()const;
+	uint32 GetFreeCount()const;
+	uint32 GetLargestFreeRange()const;
+	uint32 GetFreeRangeCount()const;
+
+private:
+	uint32 mCapacity = 0;
+	uint32 mFreeCount = 0;
+
+	// Offset -> count of each free range.
+	std::map<uint32, uint32> mFreeRanges;
+};
@@ -3,13 +3,217 @@
 //***************************************************************************************
 
 #include "GeometryGenerator.h"
+#include "IndexConversion.h"
 #include <algorithm>
+#include <stdexcept>
 
 using namespace DirectX;
 
+namespace
+{
+	const std::uint64_t EmptyEdgeKey = ~0ull;
+
+	// Open addressing hash table from an undirected edge (a pair of vertex indices) to
+	// the index of the vertex at its midpoint.
+	class EdgeMidpointTable
+	{
+	public:
+		using uint32 = GeometryGenerator::uint32;
+		using uint64 = std::uint64_t;
+
+		explicit EdgeMidpointTable(uint32 maxEdges)
+		{
+			// Keep the load factor at or below 1/2.
+			uint32 capacity = 16;
+			while(capacity < 2*maxEdges)
+				capacity *= 2;
+
+			mKeys.assign(capacity, EmptyEdgeKey);
+			mMidpoints.resize(capacity);
+			mMask = capacity - 1;
+		}
+
+		// Returns the midpoint of edge (a, b).  An edge seen for the first time is given
+		// the vertex index nextVertex, which is then incremented.
+		uint32 FindOrAdd(uint32 a, uint32 b, uint32& nextVertex)
+		{
+			uint64 key = a < b ? ((uint64)a << 32) | b : ((uint64)b << 32) | a;
+
+			uint32 slot = (uint32)((key*0x9E3779B97F4A7C15ull) >> 32) & mMask;
+			while(mKeys[slot] != key)
+			{
+				if(mKeys[slot] == EmptyEdgeKey)
+				{
+					mKeys[slot] = key;
+					mMidpoints[slot] = nextVertex++;
+					break;
+				}
+
+				slot = (slot + 1) & mMask;
+			}
+
+			return mMidpoints[slot];
+		}
+
+		uint32 Capacity()const { return mMask + 1; }
+
+		bool GetEntry(uint32 slot, uint32& a, uint32& b, uint32& midpoint)const
+		{
+			if(mKeys[slot] == EmptyEdgeKey)
+				return false;
+
+			a = (uint32)(mKeys[slot] >> 32);
+			b = (uint32)mKeys[slot];
+			midpoint = mMidpoints[slot];
+			return true;
+		}
+
+	private:
+		std::vector<uint64> mKeys;
+		std::vector<uint32> mMidpoints;
+		uint32 mMask = 0;
+	};
+
+	// Layout used by the MeshData overloads: stores the full vertex unchanged.
+	struct FullVertexLayout
+	{
+		using Vertex = GeometryGenerator::Vertex;
+
+		static void Encode(const GeometryGenerator::Vertex& in, Vertex& out)
+		{
+			out = in;
+		}
+	};
+
+	const GeometryGenerator::uint32 MaxBoxSubdivisions = 6;
+
+	// Subdivide welds the midpoints, so level n has 10*4^n + 2 vertices: 40962 at
+	// level 6 (still fits 16-bit indices) and 655362 at level 8.
+	const GeometryGenerator::uint32 MaxGeosphereSubdivisions = 8;
+}
+
+std::vector<GeometryGenerator::uint16>& GeometryGenerator::MeshData::GetIndices16()
+{
+	if(mIndices16Generation != Indices32.Generation() || mIndices16.size() != Indices32.size())
+	{
+		mIndices16.resize(Indices32.size());
+		mFitsIndices16 = IndexConversion::Narrow(Indices32.data(), Indices32.size(), mIndices16.data());
+		mIndices16Generation = Indices32.Generation();
+	}
+
+	// A wider index would silently wrap around to the wrong vertex.
+	if(!mFitsIndices16)
+		throw std::out_of_range("MeshData::GetIndices16: an index does not fit in 16 bits; use GetNarrowestIndices");
+
+	return mIndices16;
+}
+
+bool GeometryGenerator::MeshData::FitsIndices16()
+{
+	if(mIndices16Generation != Indices32.Generation())
+	{
+		// Only the range check; the copy is made when GetIndices16 is called.
+		mIndices16.clear();
+		mFitsIndices16 = IndexConversion::FitsIn16(Indices32.data(), Indices32.size());
+		mIndices16Generation = Indices32.Generation();
+	}
+
+	return mFitsIndices16;
+}
+
+const void* GeometryGenerator::MeshData::GetNarrowestIndices(uint32& indexSize)
+{
+	if(FitsIndices16())
+	{
+		indexSize = sizeof(uint16);
+		return GetIndices16().data();
+	}
+
+	indexSize = sizeof(uint32);
+	return Indices32.data();
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GetBoxSize(uint32 numSubdivisions)
+{
+	// Each face is a quad of 2 triangles; welded subdivision turns it into a
+	// (2^n+1)x(2^n+1) vertex grid.
+	numSubdivisions = std::min(numSubdivisions, MaxBoxSubdivisions);
+	uint32 side = (1u << numSubdivisions) + 1;
+
+	MeshSize size;
+	size.VertexCount = 6*side*side;
+	size.IndexCount = 6*2*3*(1u << (2*numSubdivisions));
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GetSphereSize(uint32 sliceCount, uint32 stackCount)
+{
+	// Two poles plus stackCount-1 rings of sliceCount+1 vertices; one triangle per
+	// slice in the two pole stacks and two in every other stack.
+	MeshSize size;
+	size.VertexCount = 2 + (stackCount - 1)*(sliceCount + 1);
+	size.IndexCount = 6*sliceCount + 6*sliceCount*(stackCount - 2);
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GetGeosphereSize(uint32 numSubdivisions)
+{
+	numSubdivisions = std::min(numSubdivisions, MaxGeosphereSubdivisions);
+	uint32 pow4 = 1u << (2*numSubdivisions);
+
+	MeshSize size;
+	size.VertexCount = 10*pow4 + 2;
+	size.IndexCount = 60*pow4;
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GetCylinderSize(uint32 sliceCount, uint32 stackCount)
+{
+	// stackCount+1 rings of sliceCount+1 vertices, plus a ring and a center vertex
+	// for each cap.
+	MeshSize size;
+	size.VertexCount = (stackCount + 1)*(sliceCount + 1) + 2*(sliceCount + 2);
+	size.IndexCount = 6*sliceCount*stackCount + 2*3*sliceCount;
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GetGridSize(uint32 m, uint32 n)
+{
+	MeshSize size;
+	size.VertexCount = m*n;
+	size.IndexCount = 6*(m - 1)*(n - 1);
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GetQuadSize()
+{
+	MeshSize size;
+	size.VertexCount = 4;
+	size.IndexCount = 6;
+	return size;
+}
+
+GeometryGenerator::MeshData GeometryGenerator::AllocateMeshData(const MeshSize& size)
+{
+	MeshData meshData;
+	meshData.Vertices.resize(size.VertexCount);
+	meshData.Indices32.resize(size.IndexCount);
+	return meshData;
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
 {
-    MeshData meshData;
+    MeshData meshData = AllocateMeshData(GetBoxSize(numSubdivisions));
+
+    LayoutVertexSink<FullVertexLayout> vertices(meshData.Vertices.data());
+    GenerateBox(width, height, depth, numSubdivisions, vertices, IndexSink(meshData.Indices32.MutableData()));
+
+    return meshData;
+}
+
+void GeometryGenerator::GenerateBox(float width, float height, float depth, uint32 numSubdivisions,
+                                    VertexSink& vertices, IndexSink indices)
+{
 
     //
 	// Create the vertices.
@@ -57,8 +261,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 	v[22] = Vertex(+w2, +h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f);
 	v[23] = Vertex(+w2, -h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
 
-	meshData.Vertices.assign(&v[0], &v[24]);
- 
+
 	//
 	// Create the indices.
 	//
@@ -89,20 +292,51 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 	i[30] = 20; i[31] = 21; i[32] = 22;
 	i[33] = 20; i[34] = 22; i[35] = 23;
 
-	meshData.Indices32.assign(&i[0], &i[36]);
-
     // Put a cap on the number of subdivisions.
-    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+    numSubdivisions = std::min(numSubdivisions, MaxBoxSubdivisions);
+
+    if(numSubdivisions == 0)
+    {
+        for(uint32 k = 0; k < 24; ++k)
+            vertices.Write(k, v[k]);
+
+        for(uint32 k = 0; k < 36; ++k)
+            indices.Write(k, i[k]);
+
+        return;
+    }
+
+    // Subdivide works on a whole mesh, so the subdivided box is built in a scratch
+    // mesh and then written out.
+    MeshData meshData;
+    meshData.Vertices.assign(&v[0], &v[24]);
+    meshData.Indices32.assign(&i[0], &i[36]);
 
-    for(uint32 i = 0; i < numSubdivisions; ++i)
+    for(uint32 k = 0; k < numSubdivisions; ++k)
         Subdivide(meshData);
 
-    return meshData;
+    for(uint32 k = 0; k < (uint32)meshData.Vertices.size(); ++k)
+        vertices.Write(k, meshData.Vertices[k]);
+
+    for(uint32 k = 0; k < (uint32)meshData.Indices32.size(); ++k)
+        indices.Write(k, meshData.Indices32[k]);
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
 {
-    MeshData meshData;
+    MeshData meshData = AllocateMeshData(GetSphereSize(sliceCount, stackCount));
+
+    LayoutVertexSink<FullVertexLayout> vertices(meshData.Vertices.data());
+    GenerateSphere(radius, sliceCount, stackCount, vertices, IndexSink(meshData.Indices32.MutableData()));
+
+    return meshData;
+}
+
+void GeometryGenerator::GenerateSphere(float radius, uint32 sliceCount, uint32 stackCount,
+                                       VertexSink& vertices, IndexSink indices)
+{
+    uint32 vertexCount = 0;
+    uint32 indexCount = 0;
 
 	//
 	// Compute the vertices stating at the top pole and moving down the stacks.
@@ -114,7 +348,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 	Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
-	meshData.Vertices.push_back( topVertex );
+	vertices.Write(vertexCount++, topVertex);
 
 	float phiStep   = XM_PI/stackCount;
 	float thetaStep = 2.0f*XM_PI/sliceCount;
@@ -150,11 +384,11 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 			v.TexC.x = theta / XM_2PI;
 			v.TexC.y = phi / XM_PI;
 
-			meshData.Vertices.push_back( v );
+			vertices.Write(vertexCount++, v);
 		}
 	}
 
-	meshData.Vertices.push_back( bottomVertex );
+	vertices.Write(vertexCount++, bottomVertex);
 
 	//
 	// Compute indices for top stack.  The top stack was written first to the vertex buffer
@@ -163,9 +397,9 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 
     for(uint32 i = 1; i <= sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(0);
-		meshData.Indices32.push_back(i+1);
-		meshData.Indices32.push_back(i);
+		indices.Write(indexCount++, 0);
+		indices.Write(indexCount++, i+1);
+		indices.Write(indexCount++, i);
 	}
 	
 	//
@@ -180,13 +414,13 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	{
 		for(uint32 j = 0; j < sliceCount; ++j)
 		{
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
+			indices.Write(indexCount++, baseIndex + i*ringVertexCount + j);
+			indices.Write(indexCount++, baseIndex + i*ringVertexCount + j+1);
+			indices.Write(indexCount++, baseIndex + (i+1)*ringVertexCount + j);
 
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j+1);
+			indices.Write(indexCount++, baseIndex + (i+1)*ringVertexCount + j);
+			indices.Write(indexCount++, baseIndex + i*ringVertexCount + j+1);
+			indices.Write(indexCount++, baseIndex + (i+1)*ringVertexCount + j+1);
 		}
 	}
 
@@ -196,30 +430,21 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	//
 
 	// South pole vertex was added last.
-	uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
+	uint32 southPoleIndex = vertexCount-1;
 
 	// Offset the indices to the index of the first vertex in the last ring.
 	baseIndex = southPoleIndex - ringVertexCount;
 	
 	for(uint32 i = 0; i < sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(southPoleIndex);
-		meshData.Indices32.push_back(baseIndex+i);
-		meshData.Indices32.push_back(baseIndex+i+1);
+		indices.Write(indexCount++, southPoleIndex);
+		indices.Write(indexCount++, baseIndex+i);
+		indices.Write(indexCount++, baseIndex+i+1);
 	}
-
-    return meshData;
 }
  
 void GeometryGenerator::Subdivide(MeshData& meshData)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
-
-
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
-
 	//       v1
 	//       *
 	//      / \
@@ -229,49 +454,48 @@ void GeometryGenerator::Subdivide(MeshData& meshData)
 	//  /   \ /   \
 	// *-----*-----*
 	// v0    m2     v2
+	//
+	// The corners keep their vertex index and each edge gets one midpoint vertex that
+	// is shared by the triangles on both sides of it, so the output is welded wherever
+	// the input is.  The new vertices are appended to the existing ones.
+
+	uint32 numTris = (uint32)meshData.Indices32.size()/3;
+	uint32 numVertices = (uint32)meshData.Vertices.size();
 
-	uint32 numTris = (uint32)inputCopy.Indices32.size()/3;
+	std::vector<uint32> indices(numTris*12);
+	EdgeMidpointTable edgeMidpoints(3*numTris);
+
+	uint32 nextVertex = numVertices;
 	for(uint32 i = 0; i < numTris; ++i)
 	{
-		Vertex v0 = inputCopy.Vertices[ inputCopy.Indices32[i*3+0] ];
-		Vertex v1 = inputCopy.Vertices[ inputCopy.Indices32[i*3+1] ];
-		Vertex v2 = inputCopy.Vertices[ inputCopy.Indices32[i*3+2] ];
-
-		//
-		// Generate the midpoints.
-		//
-
-        Vertex m0 = MidPoint(v0, v1);
-        Vertex m1 = MidPoint(v1, v2);
-        Vertex m2 = MidPoint(v0, v2);
-
-		//
-		// Add new geometry.
-		//
-
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
- 
-		meshData.Indices32.push_back(i*6+0);
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+5);
-
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+5);
+		uint32 v0 = meshData.Indices32[i*3+0];
+		uint32 v1 = meshData.Indices32[i*3+1];
+		uint32 v2 = meshData.Indices32[i*3+2];
+
+		uint32 m0 = edgeMidpoints.FindOrAdd(v0, v1, nextVertex);
+		uint32 m1 = edgeMidpoints.FindOrAdd(v1, v2, nextVertex);
+		uint32 m2 = edgeMidpoints.FindOrAdd(v0, v2, nextVertex);
+
+		uint32* tri = &indices[i*12];
+		tri[0] = v0; tri[1]  = m0; tri[2]  = m2;
+		tri[3] = m0; tri[4]  = m1; tri[5]  = m2;
+		tri[6] = m2; tri[7]  = m1; tri[8]  = v2;
+		tri[9] = m0; tri[10] = v1; tri[11] = m1;
+	}
 
-		meshData.Indices32.push_back(i*6+5);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+2);
+	//
+	// Generate the midpoints.
+	//
 
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+1);
-		meshData.Indices32.push_back(i*6+4);
+	meshData.Vertices.resize(nextVertex);
+	for(uint32 slot = 0; slot < edgeMidpoints.Capacity(); ++slot)
+	{
+		uint32 a, b, m;
+		if(edgeMidpoints.GetEntry(slot, a, b, m))
+			meshData.Vertices[m] = MidPoint(meshData.Vertices[a], meshData.Vertices[b]);
 	}
+
+	meshData.Indices32.swap(indices);
 }
 
 GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Vertex& v1)
@@ -306,10 +530,23 @@ GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Ve
 
 GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
 {
-    MeshData meshData;
+    MeshData meshData = AllocateMeshData(GetGeosphereSize(numSubdivisions));
+
+    LayoutVertexSink<FullVertexLayout> vertices(meshData.Vertices.data());
+    GenerateGeosphere(radius, numSubdivisions, vertices, IndexSink(meshData.Indices32.MutableData()));
+
+    return meshData;
+}
 
+void GeometryGenerator::GenerateGeosphere(float radius, uint32 numSubdivisions,
+                                          VertexSink& vertices, IndexSink indices)
+{
 	// Put a cap on the number of subdivisions.
-    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+    numSubdivisions = std::min(numSubdivisions, MaxGeosphereSubdivisions);
+
+	// The icosahedron is subdivided in a scratch mesh in which only the positions are
+	// set; the other attributes are derived from the projected position below.
+    MeshData meshData;
 
 	// Approximate a sphere by tessellating an icosahedron.
 
@@ -346,42 +583,59 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 	// Project vertices onto sphere and scale.
 	for(uint32 i = 0; i < meshData.Vertices.size(); ++i)
 	{
+		Vertex v;
+
 		// Project onto unit sphere.
 		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&meshData.Vertices[i].Position));
 
 		// Project onto sphere.
 		XMVECTOR p = radius*n;
 
-		XMStoreFloat3(&meshData.Vertices[i].Position, p);
-		XMStoreFloat3(&meshData.Vertices[i].Normal, n);
+		XMStoreFloat3(&v.Position, p);
+		XMStoreFloat3(&v.Normal, n);
 
 		// Derive texture coordinates from spherical coordinates.
-        float theta = atan2f(meshData.Vertices[i].Position.z, meshData.Vertices[i].Position.x);
+        float theta = atan2f(v.Position.z, v.Position.x);
 
         // Put in [0, 2pi].
         if(theta < 0.0f)
             theta += XM_2PI;
 
-		float phi = acosf(meshData.Vertices[i].Position.y / radius);
+		float phi = acosf(v.Position.y / radius);
 
-		meshData.Vertices[i].TexC.x = theta/XM_2PI;
-		meshData.Vertices[i].TexC.y = phi/XM_PI;
+		v.TexC.x = theta/XM_2PI;
+		v.TexC.y = phi/XM_PI;
 
 		// Partial derivative of P with respect to theta
-		meshData.Vertices[i].TangentU.x = -radius*sinf(phi)*sinf(theta);
-		meshData.Vertices[i].TangentU.y = 0.0f;
-		meshData.Vertices[i].TangentU.z = +radius*sinf(phi)*cosf(theta);
+		v.TangentU.x = -radius*sinf(phi)*sinf(theta);
+		v.TangentU.y = 0.0f;
+		v.TangentU.z = +radius*sinf(phi)*cosf(theta);
+
+		XMVECTOR T = XMLoadFloat3(&v.TangentU);
+		XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
 
-		XMVECTOR T = XMLoadFloat3(&meshData.Vertices[i].TangentU);
-		XMStoreFloat3(&meshData.Vertices[i].TangentU, XMVector3Normalize(T));
+		vertices.Write(i, v);
 	}
 
-    return meshData;
+	for(uint32 i = 0; i < meshData.Indices32.size(); ++i)
+		indices.Write(i, meshData.Indices32[i]);
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
 {
-    MeshData meshData;
+    MeshData meshData = AllocateMeshData(GetCylinderSize(sliceCount, stackCount));
+
+    LayoutVertexSink<FullVertexLayout> vertices(meshData.Vertices.data());
+    GenerateCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, vertices, IndexSink(meshData.Indices32.MutableData()));
+
+    return meshData;
+}
+
+void GeometryGenerator::GenerateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount,
+                                         VertexSink& vertices, IndexSink indices)
+{
+    uint32 vertexCount = 0;
+    uint32 indexCount = 0;
 
 	//
 	// Build Stacks.
@@ -444,7 +698,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
 			XMStoreFloat3(&vertex.Normal, N);
 
-			meshData.Vertices.push_back(vertex);
+			vertices.Write(vertexCount++, vertex);
 		}
 	}
 
@@ -457,26 +711,25 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 	{
 		for(uint32 j = 0; j < sliceCount; ++j)
 		{
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
+			indices.Write(indexCount++, i*ringVertexCount + j);
+			indices.Write(indexCount++, (i+1)*ringVertexCount + j);
+			indices.Write(indexCount++, (i+1)*ringVertexCount + j+1);
 
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
-			meshData.Indices32.push_back(i*ringVertexCount + j+1);
+			indices.Write(indexCount++, i*ringVertexCount + j);
+			indices.Write(indexCount++, (i+1)*ringVertexCount + j+1);
+			indices.Write(indexCount++, i*ringVertexCount + j+1);
 		}
 	}
 
-	BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
-	BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
-
-    return meshData;
+	BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, vertices, indices, vertexCount, indexCount);
+	BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, vertices, indices, vertexCount, indexCount);
 }
 
 void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius, float height,
-											uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+											uint32 sliceCount, uint32 stackCount, VertexSink& vertices, IndexSink indices,
+											uint32& vertexCount, uint32& indexCount)
 {
-	uint32 baseIndex = (uint32)meshData.Vertices.size();
+	uint32 baseIndex = vertexCount;
 
 	float y = 0.5f*height;
 	float dTheta = 2.0f*XM_PI/sliceCount;
@@ -492,31 +745,32 @@ void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius,
 		float u = x/height + 0.5f;
 		float v = z/height + 0.5f;
 
-		meshData.Vertices.push_back( Vertex(x, y, z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v) );
+		vertices.Write(vertexCount++, Vertex(x, y, z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
 	}
 
 	// Cap center vertex.
-	meshData.Vertices.push_back( Vertex(0.0f, y, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f) );
+	vertices.Write(vertexCount++, Vertex(0.0f, y, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
 
 	// Index of center vertex.
-	uint32 centerIndex = (uint32)meshData.Vertices.size()-1;
+	uint32 centerIndex = vertexCount-1;
 
 	for(uint32 i = 0; i < sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(centerIndex);
-		meshData.Indices32.push_back(baseIndex + i+1);
-		meshData.Indices32.push_back(baseIndex + i);
+		indices.Write(indexCount++, centerIndex);
+		indices.Write(indexCount++, baseIndex + i+1);
+		indices.Write(indexCount++, baseIndex + i);
 	}
 }
 
 void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadius, float height,
-											   uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+											   uint32 sliceCount, uint32 stackCount, VertexSink& vertices, IndexSink indices,
+											   uint32& vertexCount, uint32& indexCount)
 {
 	// 
 	// Build bottom cap.
 	//
 
-	uint32 baseIndex = (uint32)meshData.Vertices.size();
+	uint32 baseIndex = vertexCount;
 	float y = -0.5f*height;
 
 	// vertices of ring
@@ -531,29 +785,36 @@ void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadi
 		float u = x/height + 0.5f;
 		float v = z/height + 0.5f;
 
-		meshData.Vertices.push_back( Vertex(x, y, z, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v) );
+		vertices.Write(vertexCount++, Vertex(x, y, z, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
 	}
 
 	// Cap center vertex.
-	meshData.Vertices.push_back( Vertex(0.0f, y, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f) );
+	vertices.Write(vertexCount++, Vertex(0.0f, y, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
 
 	// Cache the index of center vertex.
-	uint32 centerIndex = (uint32)meshData.Vertices.size()-1;
+	uint32 centerIndex = vertexCount-1;
 
 	for(uint32 i = 0; i < sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(centerIndex);
-		meshData.Indices32.push_back(baseIndex + i);
-		meshData.Indices32.push_back(baseIndex + i+1);
+		indices.Write(indexCount++, centerIndex);
+		indices.Write(indexCount++, baseIndex + i);
+		indices.Write(indexCount++, baseIndex + i+1);
 	}
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
 {
-    MeshData meshData;
+    MeshData meshData = AllocateMeshData(GetGridSize(m, n));
 
-	uint32 vertexCount = m*n;
-	uint32 faceCount   = (m-1)*(n-1)*2;
+    LayoutVertexSink<FullVertexLayout> vertices(meshData.Vertices.data());
+    GenerateGrid(width, depth, m, n, vertices, IndexSink(meshData.Indices32.MutableData()));
+
+    return meshData;
+}
+
+void GeometryGenerator::GenerateGrid(float width, float depth, uint32 m, uint32 n,
+                                     VertexSink& vertices, IndexSink indices)
+{
 
 	//
 	// Create the vertices.
@@ -568,7 +829,6 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	float du = 1.0f / (n-1);
 	float dv = 1.0f / (m-1);
 
-	meshData.Vertices.resize(vertexCount);
 	for(uint32 i = 0; i < m; ++i)
 	{
 		float z = halfDepth - i*dz;
@@ -576,13 +836,16 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 		{
 			float x = -halfWidth + j*dx;
 
-			meshData.Vertices[i*n+j].Position = XMFLOAT3(x, 0.0f, z);
-			meshData.Vertices[i*n+j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.Vertices[i*n+j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+			Vertex v;
+			v.Position = XMFLOAT3(x, 0.0f, z);
+			v.Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			v.TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
 
 			// Stretch texture over grid.
-			meshData.Vertices[i*n+j].TexC.x = j*du;
-			meshData.Vertices[i*n+j].TexC.y = i*dv;
+			v.TexC.x = j*du;
+			v.TexC.y = i*dv;
+
+			vertices.Write(i*n+j, v);
 		}
 	}
  
@@ -590,68 +853,69 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	// Create the indices.
 	//
 
-	meshData.Indices32.resize(faceCount*3); // 3 indices per face
-
 	// Iterate over each quad and compute indices.
 	uint32 k = 0;
 	for(uint32 i = 0; i < m-1; ++i)
 	{
 		for(uint32 j = 0; j < n-1; ++j)
 		{
-			meshData.Indices32[k]   = i*n+j;
-			meshData.Indices32[k+1] = i*n+j+1;
-			meshData.Indices32[k+2] = (i+1)*n+j;
+			indices.Write(k,   i*n+j);
+			indices.Write(k+1, i*n+j+1);
+			indices.Write(k+2, (i+1)*n+j);
 
-			meshData.Indices32[k+3] = (i+1)*n+j;
-			meshData.Indices32[k+4] = i*n+j+1;
-			meshData.Indices32[k+5] = (i+1)*n+j+1;
+			indices.Write(k+3, (i+1)*n+j);
+			indices.Write(k+4, i*n+j+1);
+			indices.Write(k+5, (i+1)*n+j+1);
 
 			k += 6; // next quad
 		}
 	}
-
-    return meshData;
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth)
 {
-    MeshData meshData;
+    MeshData meshData = AllocateMeshData(GetQuadSize());
+
+    LayoutVertexSink<FullVertexLayout> vertices(meshData.Vertices.data());
+    GenerateQuad(x, y, w, h, depth, vertices, IndexSink(meshData.Indices32.MutableData()));
 
-	meshData.Vertices.resize(4);
-	meshData.Indices32.resize(6);
+    return meshData;
+}
+
+void GeometryGenerator::GenerateQuad(float x, float y, float w, float h, float depth,
+                                     VertexSink& vertices, IndexSink indices)
+{
 
 	// Position coordinates specified in NDC space.
-	meshData.Vertices[0] = Vertex(
+	vertices.Write(0, Vertex(
         x, y - h, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
-		0.0f, 1.0f);
+		0.0f, 1.0f));
 
-	meshData.Vertices[1] = Vertex(
+	vertices.Write(1, Vertex(
 		x, y, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f);
+		0.0f, 0.0f));
 
-	meshData.Vertices[2] = Vertex(
+	vertices.Write(2, Vertex(
 		x+w, y, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
-		1.0f, 0.0f);
+		1.0f, 0.0f));
 
-	meshData.Vertices[3] = Vertex(
+	vertices.Write(3, Vertex(
 		x+w, y-h, depth,
 		0.0f, 0.0f, -1.0f,
 		1.0f, 0.0f, 0.0f,
-		1.0f, 1.0f);
+		1.0f, 1.0f));
 
-	meshData.Indices32[0] = 0;
-	meshData.Indices32[1] = 1;
-	meshData.Indices32[2] = 2;
+	indices.Write(0, 0);
+	indices.Write(1, 1);
+	indices.Write(2, 2);
 
-	meshData.Indices32[3] = 0;
-	meshData.Indices32[4] = 2;
-	meshData.Indices32[5] = 3;
-
-    return meshData;
+	indices.Write(3, 0);
+	indices.Write(4, 2);
+	indices.Write(5, 3);
 }
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <cassert>
 #include <cstdint>
 #include <DirectXMath.h>
 #include <vector>
@@ -53,25 +54,123 @@ public:
         DirectX::XMFLOAT2 TexC;
 	};
 
+	// A std::vector<uint32> that only gives read access directly.  Every change goes
+	// through a member that bumps Generation(), so MeshData knows when its 16-bit copy
+	// is stale.  It converts to const std::vector<uint32>& for code that wants a copy.
+	class IndexList
+	{
+	public:
+		size_t size()const { return mIndices.size(); }
+		bool empty()const { return mIndices.empty(); }
+		const uint32* data()const { return mIndices.data(); }
+		const uint32& operator[](size_t i)const { return mIndices[i]; }
+		std::vector<uint32>::const_iterator begin()const { return mIndices.begin(); }
+		std::vector<uint32>::const_iterator end()const { return mIndices.end(); }
+		operator const std::vector<uint32>&()const { return mIndices; }
+
+		void assign(const uint32* first, const uint32* last) { mIndices.assign(first, last); ++mGeneration; }
+		void resize(size_t count) { mIndices.resize(count); ++mGeneration; }
+		void clear() { mIndices.clear(); ++mGeneration; }
+		void push_back(uint32 index) { mIndices.push_back(index); ++mGeneration; }
+		void swap(std::vector<uint32>& indices) { mIndices.swap(indices); ++mGeneration; }
+		void Set(size_t i, uint32 index) { mIndices[i] = index; ++mGeneration; }
+
+		// Write access for filling the indices in place.  The generation is bumped when
+		// the pointer is taken, so finish writing before reading the 16-bit copy.
+		uint32* MutableData() { ++mGeneration; return mIndices.data(); }
+
+		uint32 Generation()const { return mGeneration; }
+
+	private:
+		std::vector<uint32> mIndices;
+		uint32 mGeneration = 0;
+	};
+
 	struct MeshData
 	{
 		std::vector<Vertex> Vertices;
-        std::vector<uint32> Indices32;
+		IndexList Indices32;
 
-        std::vector<uint16>& GetIndices16()
-        {
-			if(mIndices16.empty())
-			{
-				mIndices16.resize(Indices32.size());
-				for(size_t i = 0; i < Indices32.size(); ++i)
-					mIndices16[i] = static_cast<uint16>(Indices32[i]);
-			}
+		// 16-bit copy of Indices32, built on first use and rebuilt after Indices32
+		// changes.  Throws std::out_of_range if an index does not fit in 16 bits; use
+		// GetNarrowestIndices for meshes that may be larger.
+        std::vector<uint16>& GetIndices16();
+
+		// True if every index fits in 16 bits.
+		bool FitsIndices16();
 
-			return mIndices16;
-        }
+		// Indices in the narrowest format that holds them: returns GetIndices16().data()
+		// and sets indexSize to 2 (DXGI_FORMAT_R16_UINT) when every index fits, otherwise
+		// Indices32.data() and 4 (DXGI_FORMAT_R32_UINT).
+		const void* GetNarrowestIndices(uint32& indexSize);
 
 	private:
 		std::vector<uint16> mIndices16;
+
+		// Generation of Indices32 that mIndices16 and mFitsIndices16 were made from.
+		// mIndices16 is left empty when only the range was checked.
+		uint32 mIndices16Generation = ~0u;
+		bool mFitsIndices16 = false;
+	};
+
+	// Exact number of vertices and indices a Create* call produces.
+	struct MeshSize
+	{
+		uint32 VertexCount = 0;
+		uint32 IndexCount = 0;
+	};
+
+	// Receives the generated vertices one at a time, in any order.
+	class VertexSink
+	{
+	public:
+		virtual void Write(uint32 index, const Vertex& v) = 0;
+
+	protected:
+		~VertexSink() = default;
+	};
+
+	// Encodes each vertex with Layout straight into a caller buffer.  A layout is a
+	// struct with a nested Vertex type and a static Encode(const GeometryGenerator::Vertex&,
+	// Vertex&); see VertexLayouts.h for the packed ones.
+	template<typename Layout>
+	class LayoutVertexSink : public VertexSink
+	{
+	public:
+		explicit LayoutVertexSink(typename Layout::Vertex* vertices) : mVertices(vertices) {}
+
+		void Write(uint32 index, const Vertex& v) override
+		{
+			Layout::Encode(v, mVertices[index]);
+		}
+
+	private:
+		typename Layout::Vertex* mVertices;
+	};
+
+	// Writes indices to a 16- or 32-bit caller buffer.
+	class IndexSink
+	{
+	public:
+		explicit IndexSink(uint32* indices) : mIndices32(indices) {}
+		explicit IndexSink(uint16* indices) : mIndices16(indices) {}
+
+		void Write(uint32 i, uint32 index)
+		{
+			if(mIndices32 != nullptr)
+			{
+				mIndices32[i] = index;
+			}
+			else
+			{
+				assert(index <= 0xffff && "mesh has too many vertices for 16-bit indices");
+				mIndices16[i] = static_cast<uint16>(index);
+			}
+		}
+
+	private:
+		uint32* mIndices32 = nullptr;
+		uint16* mIndices16 = nullptr;
 	};
 
 	///<summary>
@@ -110,10 +209,87 @@ public:
 	///</summary>
     MeshData CreateQuad(float x, float y, float w, float h, float depth);
 
+	///<summary>
+	/// Exact vertex and index counts of the matching Create* call, so callers can
+	/// allocate their buffers before generating into them.
+	///</summary>
+    static MeshSize GetBoxSize(uint32 numSubdivisions);
+    static MeshSize GetSphereSize(uint32 sliceCount, uint32 stackCount);
+    static MeshSize GetGeosphereSize(uint32 numSubdivisions);
+    static MeshSize GetCylinderSize(uint32 sliceCount, uint32 stackCount);
+    static MeshSize GetGridSize(uint32 m, uint32 n);
+    static MeshSize GetQuadSize();
+
+	///<summary>
+	/// Same shapes as above, but each vertex is encoded with Layout and written straight
+	/// into the caller's buffers, which must hold at least the counts returned by the
+	/// matching Get*Size.  Index is uint16 or uint32; indices start at 0 for each shape.
+	///
+	/// Example: geoGen.CreateSphere<VertexLayouts::PositionOctNormalTex>(0.5f, 20, 20, v, i);
+	///</summary>
+    template<typename Layout, typename Index>
+    void CreateBox(float width, float height, float depth, uint32 numSubdivisions,
+        typename Layout::Vertex* vertices, Index* indices)
+    {
+        LayoutVertexSink<Layout> sink(vertices);
+        GenerateBox(width, height, depth, numSubdivisions, sink, IndexSink(indices));
+    }
+
+    template<typename Layout, typename Index>
+    void CreateSphere(float radius, uint32 sliceCount, uint32 stackCount,
+        typename Layout::Vertex* vertices, Index* indices)
+    {
+        LayoutVertexSink<Layout> sink(vertices);
+        GenerateSphere(radius, sliceCount, stackCount, sink, IndexSink(indices));
+    }
+
+    template<typename Layout, typename Index>
+    void CreateGeosphere(float radius, uint32 numSubdivisions,
+        typename Layout::Vertex* vertices, Index* indices)
+    {
+        LayoutVertexSink<Layout> sink(vertices);
+        GenerateGeosphere(radius, numSubdivisions, sink, IndexSink(indices));
+    }
+
+    template<typename Layout, typename Index>
+    void CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount,
+        typename Layout::Vertex* vertices, Index* indices)
+    {
+        LayoutVertexSink<Layout> sink(vertices);
+        GenerateCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, sink, IndexSink(indices));
+    }
+
+    template<typename Layout, typename Index>
+    void CreateGrid(float width, float depth, uint32 m, uint32 n,
+        typename Layout::Vertex* vertices, Index* indices)
+    {
+        LayoutVertexSink<Layout> sink(vertices);
+        GenerateGrid(width, depth, m, n, sink, IndexSink(indices));
+    }
+
+    template<typename Layout, typename Index>
+    void CreateQuad(float x, float y, float w, float h, float depth,
+        typename Layout::Vertex* vertices, Index* indices)
+    {
+        LayoutVertexSink<Layout> sink(vertices);
+        GenerateQuad(x, y, w, h, depth, sink, IndexSink(indices));
+    }
+
 private:
+    static MeshData AllocateMeshData(const MeshSize& size);
+
+    void GenerateBox(float width, float height, float depth, uint32 numSubdivisions, VertexSink& vertices, IndexSink indices);
+    void GenerateSphere(float radius, uint32 sliceCount, uint32 stackCount, VertexSink& vertices, IndexSink indices);
+    void GenerateGeosphere(float radius, uint32 numSubdivisions, VertexSink& vertices, IndexSink indices);
+    void GenerateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, VertexSink& vertices, IndexSink indices);
+    void GenerateGrid(float width, float depth, uint32 m, uint32 n, VertexSink& vertices, IndexSink indices);
+    void GenerateQuad(float x, float y, float w, float h, float depth, VertexSink& vertices, IndexSink indices);
+
 	void Subdivide(MeshData& meshData);
     Vertex MidPoint(const Vertex& v0, const Vertex& v1);
-    void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
-    void BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
+    void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount,
+        VertexSink& vertices, IndexSink indices, uint32& vertexCount, uint32& indexCount);
+    void BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount,
+        VertexSink& vertices, IndexSink indices, uint32& vertexCount, uint32& indexCount);
 };
 
@@ -0,0 +1,313 @@
+//***************************************************************************************
+// GeometryRegistry.cpp
+//***************************************************************************************
+
+#include "GeometryRegistry.h"
+
+using Microsoft::WRL::ComPtr;
+using namespace DirectX;
+
+GeometryRegistry::GeometryRegistry(ID3D12Device* device, UINT vertexByteStride, UINT vertexCapacity,
+	UINT indexCapacity, DXGI_FORMAT indexFormat)
+	: mVertexAllocator(vertexCapacity), mIndexAllocator(indexCapacity)
+{
+	assert(indexFormat == DXGI_FORMAT_R16_UINT || indexFormat == DXGI_FORMAT_R32_UINT);
+
+	md3dDevice = device;
+	mVertexByteStride = vertexByteStride;
+	mIndexFormat = indexFormat;
+	mIndexByteSize = indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+
+	mVertexData.resize((size_t)vertexCapacity*vertexByteStride);
+	mIndexData.resize((size_t)indexCapacity*mIndexByteSize);
+
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(mVertexData.size()),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(mVertexBufferGPU.GetAddressOf())));
+
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(mIndexData.size()),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(mIndexBufferGPU.GetAddressOf())));
+}
+
+GeometryHandle GeometryRegistry::Add(const std::string& name, const void* vertices, UINT vertexCount,
+	const void* indices, UINT indexCount)
+{
+	assert(name.empty() || mNames.find(name) == mNames.end());
+
+	GeometryHandle handle;
+	if(vertexCount == 0 || indexCount == 0 ||
+		vertexCount > mVertexAllocator.GetFreeCount() || indexCount > mIndexAllocator.GetFreeCount())
+	{
+		return handle;
+	}
+
+	if(vertexCount > mVertexAllocator.GetLargestFreeRange() || indexCount > mIndexAllocator.GetLargestFreeRange())
+		Defragment();
+
+	UINT vertexOffset = mVertexAllocator.Allocate(vertexCount);
+	UINT indexOffset = mIndexAllocator.Allocate(indexCount);
+	assert(vertexOffset != FreeListAllocator::InvalidOffset && indexOffset != FreeListAllocator::InvalidOffset);
+
+	UINT64 vertexBytes = (UINT64)vertexCount*mVertexByteStride;
+	UINT64 indexBytes = (UINT64)indexCount*mIndexByteSize;
+	std::memcpy(&mVertexData[(size_t)vertexOffset*mVertexByteStride], vertices, (size_t)vertexBytes);
+	std::memcpy(&mIndexData[(size_t)indexOffset*mIndexByteSize], indices, (size_t)indexBytes);
+	AddDirtyRange(mDirtyVertices, (UINT64)vertexOffset*mVertexByteStride, vertexBytes);
+	AddDirtyRange(mDirtyIndices, (UINT64)indexOffset*mIndexByteSize, indexBytes);
+
+	if(mFreeEntries.empty())
+	{
+		mFreeEntries.push_back((UINT)mEntries.size());
+		mEntries.emplace_back();
+	}
+
+	handle.Index = mFreeEntries.back();
+	mFreeEntries.pop_back();
+
+	Entry& entry = mEntries[handle.Index];
+	entry.Name = name;
+	entry.VertexCount = vertexCount;
+	entry.Live = true;
+	entry.Submesh.IndexCount = indexCount;
+	entry.Submesh.StartIndexLocation = indexOffset;
+	entry.Submesh.BaseVertexLocation = (INT)vertexOffset;
+	BoundingBox::CreateFromPoints(entry.Submesh.Bounds, vertexCount,
+		reinterpret_cast<const XMFLOAT3*>(vertices), mVertexByteStride);
+	handle.Generation = entry.Generation;
+
+	if(!name.empty())
+		mNames[name] = handle.Index;
+
+	return handle;
+}
+
+void GeometryRegistry::Remove(GeometryHandle handle)
+{
+	if(!IsValid(handle))
+		return;
+
+	Entry& entry = mEntries[handle.Index];
+	mVertexAllocator.Free((UINT)entry.Submesh.BaseVertexLocation, entry.VertexCount);
+	mIndexAllocator.Free(entry.Submesh.StartIndexLocation, entry.Submesh.IndexCount);
+
+	if(!entry.Name.empty())
+		mNames.erase(entry.Name);
+
+	entry.Name.clear();
+	entry.Live = false;
+	++entry.Generation;
+	mFreeEntries.push_back(handle.Index);
+}
+
+bool GeometryRegistry::IsValid(GeometryHandle handle)const
+{
+	return handle.Index < mEntries.size() &&
+		mEntries[handle.Index].Live &&
+		mEntries[handle.Index].Generation == handle.Generation;
+}
+
+GeometryHandle GeometryRegistry::Find(const std::string& name)const
+{
+	GeometryHandle handle;
+
+	auto it = mNames.find(name);
+	if(it != mNames.end())
+	{
+		handle.Index = it->second;
+		handle.Generation = mEntries[it->second].Generation;
+	}
+
+	return handle;
+}
+
+const SubmeshGeometry& GeometryRegistry::Get(GeometryHandle handle)const
+{
+	assert(IsValid(handle));
+	return mEntries[handle.Index].Submesh;
+}
+
+void GeometryRegistry::Defragment()
+{
+	// Live entries in buffer order, so each mesh moves towards the front over space that
+	// is free or already moved.
+	std::vector<Entry*> byVertex;
+	for(auto& entry : mEntries)
+	{
+		if(entry.Live)
+			byVertex.push_back(&entry);
+	}
+	std::vector<Entry*> byIndex = byVertex;
+
+	std::sort(byVertex.begin(), byVertex.end(), [](const Entry* a, const Entry* b)
+	{
+		return a->Submesh.BaseVertexLocation < b->Submesh.BaseVertexLocation;
+	});
+	std::sort(byIndex.begin(), byIndex.end(), [](const Entry* a, const Entry* b)
+	{
+		return a->Submesh.StartIndexLocation < b->Submesh.StartIndexLocation;
+	});
+
+	UINT vertexEnd = 0;
+	for(Entry* entry : byVertex)
+	{
+		std::memmove(&mVertexData[(size_t)vertexEnd*mVertexByteStride],
+			&mVertexData[(size_t)entry->Submesh.BaseVertexLocation*mVertexByteStride],
+			(size_t)entry->VertexCount*mVertexByteStride);
+		entry->Submesh.BaseVertexLocation = (INT)vertexEnd;
+		vertexEnd += entry->VertexCount;
+	}
+
+	UINT indexEnd = 0;
+	for(Entry* entry : byIndex)
+	{
+		std::memmove(&mIndexData[(size_t)indexEnd*mIndexByteSize],
+			&mIndexData[(size_t)entry->Submesh.StartIndexLocation*mIndexByteSize],
+			(size_t)entry->Submesh.IndexCount*mIndexByteSize);
+		entry->Submesh.StartIndexLocation = indexEnd;
+		indexEnd += entry->Submesh.IndexCount;
+	}
+
+	mVertexAllocator.Reset(vertexEnd);
+	mIndexAllocator.Reset(indexEnd);
+
+	mDirtyVertices.clear();
+	mDirtyIndices.clear();
+	AddDirtyRange(mDirtyVertices, 0, (UINT64)vertexEnd*mVertexByteStride);
+	AddDirtyRange(mDirtyIndices, 0, (UINT64)indexEnd*mIndexByteSize);
+
+	++mLayoutVersion;
+}
+
+UINT GeometryRegistry::GetLayoutVersion()const
+{
+	return mLayoutVersion;
+}
+
+void GeometryRegistry::Flush(ID3D12GraphicsCommandList* cmdList, UINT64 fenceValue)
+{
+	if(mDirtyVertices.empty() && mDirtyIndices.empty())
+		return;
+
+	UINT64 uploadSize = 0;
+	for(auto& range : mDirtyVertices)
+		uploadSize += range.Size;
+	for(auto& range : mDirtyIndices)
+		uploadSize += range.Size;
+
+	PendingUpload upload;
+	upload.FenceValue = fenceValue;
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(uploadSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(upload.Buffer.GetAddressOf())));
+
+	BYTE* mapped = nullptr;
+	ThrowIfFailed(upload.Buffer->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
+
+	D3D12_RESOURCE_BARRIER toCopyDest[2] =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(mVertexBufferGPU.Get(), mBufferState, D3D12_RESOURCE_STATE_COPY_DEST),
+		CD3DX12_RESOURCE_BARRIER::Transition(mIndexBufferGPU.Get(), mBufferState, D3D12_RESOURCE_STATE_COPY_DEST)
+	};
+	cmdList->ResourceBarrier(2, toCopyDest);
+
+	UINT64 uploadOffset = 0;
+	for(auto& range : mDirtyVertices)
+	{
+		std::memcpy(mapped + uploadOffset, &mVertexData[(size_t)range.Offset], (size_t)range.Size);
+		cmdList->CopyBufferRegion(mVertexBufferGPU.Get(), range.Offset, upload.Buffer.Get(), uploadOffset, range.Size);
+		uploadOffset += range.Size;
+	}
+
+	for(auto& range : mDirtyIndices)
+	{
+		std::memcpy(mapped + uploadOffset, &mIndexData[(size_t)range.Offset], (size_t)range.Size);
+		cmdList->CopyBufferRegion(mIndexBufferGPU.Get(), range.Offset, upload.Buffer.Get(), uploadOffset, range.Size);
+		uploadOffset += range.Size;
+	}
+
+	upload.Buffer->Unmap(0, nullptr);
+
+	mBufferState = D3D12_RESOURCE_STATE_GENERIC_READ;
+	D3D12_RESOURCE_BARRIER toRead[2] =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(mVertexBufferGPU.Get(), D3D12_RESOURCE_STATE_COPY_DEST, mBufferState),
+		CD3DX12_RESOURCE_BARRIER::Transition(mIndexBufferGPU.Get(), D3D12_RESOURCE_STATE_COPY_DEST, mBufferState)
+	};
+	cmdList->ResourceBarrier(2, toRead);
+
+	mPendingUploads.push_back(std::move(upload));
+	mDirtyVertices.clear();
+	mDirtyIndices.clear();
+}
+
+void GeometryRegistry::ReleaseUploads(UINT64 completedFenceValue)
+{
+	mPendingUploads.erase(std::remove_if(mPendingUploads.begin(), mPendingUploads.end(),
+		[completedFenceValue](const PendingUpload& upload)
+	{
+		return upload.FenceValue <= completedFenceValue;
+	}), mPendingUploads.end());
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryRegistry::VertexBufferView()const
+{
+	D3D12_VERTEX_BUFFER_VIEW vbv;
+	vbv.BufferLocation = mVertexBufferGPU->GetGPUVirtualAddress();
+	vbv.StrideInBytes = mVertexByteStride;
+	vbv.SizeInBytes = (UINT)mVertexData.size();
+
+	return vbv;
+}
+
+D3D12_INDEX_BUFFER_VIEW GeometryRegistry::IndexBufferView()const
+{
+	D3D12_INDEX_BUFFER_VIEW ibv;
+	ibv.BufferLocation = mIndexBufferGPU->GetGPUVirtualAddress();
+	ibv.Format = mIndexFormat;
+	ibv.SizeInBytes = (UINT)mIndexData.size();
+
+	return ibv;
+}
+
+UINT GeometryRegistry::GetMeshCount()const
+{
+	return (UINT)(mEntries.size() - mFreeEntries.size());
+}
+
+UINT GeometryRegistry::GetFreeVertexCount()const
+{
+	return mVertexAllocator.GetFreeCount();
+}
+
+UINT GeometryRegistry::GetFreeIndexCount()const
+{
+	return mIndexAllocator.GetFreeCount();
+}
+
+void GeometryRegistry::AddDirtyRange(std::vector<ByteRange>& ranges, UINT64 offset, UINT64 size)
+{
+	if(size == 0)
+		return;
+
+	// Meshes added one after another usually land back to back; copy them as one range.
+	if(!ranges.empty() && ranges.back().Offset + ranges.back().Size == offset)
+	{
+		ranges.back().Size += size;
+		return;
+	}
+
+	ranges.push_back({ offset, size });
+}
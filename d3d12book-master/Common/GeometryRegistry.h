@@ -0,0 +1,137 @@
+//***************************************************************************************
+// GeometryRegistry.h
+//
+// Sub-allocates static meshes of one vertex format from a shared vertex buffer and a
+// shared index buffer, so they all draw with the same IASetVertexBuffers and
+// IASetIndexBuffer and adding a mesh costs a free list allocation instead of two
+// committed resources.  This does by registration what BuildShapeGeometry does by hand
+// when it concatenates the shapes into one MeshGeometry.
+//
+// Each mesh keeps its own indices, placed with BaseVertexLocation, so 16-bit indices
+// work as long as each mesh has fewer than 65536 vertices.
+//
+// The registry keeps a system memory copy of both buffers.  Add and Defragment write
+// it, and Flush copies the changed ranges to the GPU buffers.  Record Flush on the same
+// queue as the draws: the copies then wait for earlier draws that read the old data,
+// so ranges freed by Remove can be reused at once.
+//
+// Defragment packs the meshes to the front of the buffers, merging the free space left
+// by Remove.  Handles stay valid, but their SubmeshGeometry changes, so read it with
+// Get at draw time or re-read it when GetLayoutVersion changes.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "FreeListAllocator.h"
+
+struct GeometryHandle
+{
+	UINT Index = UINT_MAX;
+	UINT Generation = 0;
+};
+
+class GeometryRegistry
+{
+public:
+	GeometryRegistry(ID3D12Device* device, UINT vertexByteStride, UINT vertexCapacity,
+		UINT indexCapacity, DXGI_FORMAT indexFormat = DXGI_FORMAT_R16_UINT);
+	GeometryRegistry(const GeometryRegistry& rhs) = delete;
+	GeometryRegistry& operator=(const GeometryRegistry& rhs) = delete;
+
+	///<summary>
+	/// Copies a mesh into the registry.  Vertices are vertexByteStride bytes each and
+	/// start with their position as an XMFLOAT3, which gives the bounds; indices are in
+	/// the registry's index format.  If the free space is enough but fragmented, the
+	/// registry defragments.  Returns an invalid handle if the mesh does not fit.
+	///</summary>
+	GeometryHandle Add(const std::string& name, const void* vertices, UINT vertexCount,
+		const void* indices, UINT indexCount);
+
+	template<typename V, typename I>
+	GeometryHandle Add(const std::string& name, const std::vector<V>& vertices, const std::vector<I>& indices)
+	{
+		assert(sizeof(V) == mVertexByteStride && sizeof(I) == mIndexByteSize);
+		return Add(name, vertices.data(), (UINT)vertices.size(), indices.data(), (UINT)indices.size());
+	}
+
+	///<summary>
+	/// Frees the mesh's ranges.  The handle and its name become invalid.
+	///</summary>
+	void Remove(GeometryHandle handle);
+
+	bool IsValid(GeometryHandle handle)const;
+	GeometryHandle Find(const std::string& name)const;
+	const SubmeshGeometry& Get(GeometryHandle handle)const;
+
+	///<summary>
+	/// Moves every mesh to the front of the buffers.
+	///</summary>
+	void Defragment();
+	UINT GetLayoutVersion()const;
+
+	///<summary>
+	/// Records the copies of everything changed since the last Flush.  The upload
+	/// buffer is kept until ReleaseUploads sees fenceValue completed.
+	///</summary>
+	void Flush(ID3D12GraphicsCommandList* cmdList, UINT64 fenceValue);
+	void ReleaseUploads(UINT64 completedFenceValue);
+
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView()const;
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView()const;
+
+	UINT GetMeshCount()const;
+	UINT GetFreeVertexCount()const;
+	UINT GetFreeIndexCount()const;
+
+private:
+	struct Entry
+	{
+		std::string Name;
+		SubmeshGeometry Submesh;
+		UINT VertexCount = 0;
+		UINT Generation = 0;
+		bool Live = false;
+	};
+
+	struct ByteRange
+	{
+		UINT64 Offset = 0;
+		UINT64 Size = 0;
+	};
+
+	struct PendingUpload
+	{
+		UINT64 FenceValue = 0;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Buffer;
+	};
+
+	static void AddDirtyRange(std::vector<ByteRange>& ranges, UINT64 offset, UINT64 size);
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+
+	UINT mVertexByteStride = 0;
+	UINT mIndexByteSize = 0;
+	DXGI_FORMAT mIndexFormat = DXGI_FORMAT_R16_UINT;
+
+	FreeListAllocator mVertexAllocator;
+	FreeListAllocator mIndexAllocator;
+
+	std::vector<std::uint8_t> mVertexData;
+	std::vector<std::uint8_t> mIndexData;
+
+	std::vector<Entry> mEntries;
+	std::vector<UINT> mFreeEntries;
+	std::unordered_map<std::string, UINT> mNames;
+	UINT mLayoutVersion = 0;
+
+	std::vector<ByteRange> mDirtyVertices;
+	std::vector<ByteRange> mDirtyIndices;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> mVertexBufferGPU;
+	Microsoft::WRL::ComPtr<ID3D12Resource> mIndexBufferGPU;
+	D3D12_RESOURCE_STATES mBufferState = D3D12_RESOURCE_STATE_COMMON;
+
+	std::vector<PendingUpload> mPendingUploads;
+};
@@ -0,0 +1,95 @@
+//***************************************************************************************
+// IndexConversion.h
+//
+// SSE2 conversion between 16- and 32-bit index lists.  Narrowing packs eight indices
+// per iteration and checks the range at the same time, so choosing 16-bit indices costs
+// one pass over the data.
+//
+// A 16-bit index of 0xffff is a valid vertex in a triangle list; only strip topologies
+// with primitive restart reserve it.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <emmintrin.h>
+
+namespace IndexConversion
+{
+	///<summary>
+	/// True if every index is at most 0xffff.
+	///</summary>
+	inline bool FitsIn16(const std::uint32_t* src, std::size_t count)
+	{
+		// OR all the indices together; any high bit set means a wide index.
+		__m128i bits = _mm_setzero_si128();
+		std::size_t i = 0;
+		for(; i + 8 <= count; i += 8)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4));
+			bits = _mm_or_si128(bits, _mm_or_si128(a, b));
+		}
+
+		std::uint32_t tail = 0;
+		for(; i < count; ++i)
+			tail |= src[i];
+
+		__m128i high = _mm_srli_epi32(bits, 16);
+		return _mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) == 0xffff && tail <= 0xffff;
+	}
+
+	///<summary>
+	/// Converts count indices to 16 bits.  Returns false if an index does not fit, in
+	/// which case the contents of dst are unspecified.
+	///</summary>
+	inline bool Narrow(const std::uint32_t* src, std::size_t count, std::uint16_t* dst)
+	{
+		// _mm_packs_epi32 saturates as signed, so move [0, 0xffff] to [-0x8000, 0x7fff]
+		// before packing and flip the top bit back after.
+		const __m128i bias32 = _mm_set1_epi32(0x8000);
+		const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+
+		__m128i bits = _mm_setzero_si128();
+		std::size_t i = 0;
+		for(; i + 8 <= count; i += 8)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4));
+			bits = _mm_or_si128(bits, _mm_or_si128(a, b));
+
+			__m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, bias32), _mm_sub_epi32(b, bias32));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(packed, bias16));
+		}
+
+		std::uint32_t tail = 0;
+		for(; i < count; ++i)
+		{
+			tail |= src[i];
+			dst[i] = static_cast<std::uint16_t>(src[i]);
+		}
+
+		__m128i high = _mm_srli_epi32(bits, 16);
+		return _mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) == 0xffff && tail <= 0xffff;
+	}
+
+	///<summary>
+	/// Converts count 16-bit indices to 32 bits.
+	///</summary>
+	inline void Widen(const std::uint16_t* src, std::size_t count, std::uint32_t* dst)
+	{
+		const __m128i zero = _mm_setzero_si128();
+
+		std::size_t i = 0;
+		for(; i + 8 <= count; i += 8)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(v, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(v, zero));
+		}
+
+		for(; i < count; ++i)
+			dst[i] = src[i];
+	}
+}
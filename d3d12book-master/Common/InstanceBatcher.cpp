@@ -0,0 +1,105 @@
+//***************************************************************************************
+// InstanceBatcher.cpp
+//***************************************************************************************
+
+#include "InstanceBatcher.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	const std::uint64_t InvalidKey = UINT64_MAX;
+}
+
+void InstanceBatcher::Add(uint32 item, uint64 key)
+{
+	assert(key != InvalidKey && !Contains(item));
+
+	if(item >= mKeys.size())
+		mKeys.resize((size_t)item + 1, InvalidKey);
+
+	mKeys[item] = key;
+	mItemCount++;
+	mChanged = true;
+}
+
+void InstanceBatcher::Remove(uint32 item)
+{
+	assert(Contains(item));
+
+	mKeys[item] = InvalidKey;
+	mItemCount--;
+	mChanged = true;
+}
+
+void InstanceBatcher::SetKey(uint32 item, uint64 key)
+{
+	assert(key != InvalidKey && Contains(item));
+
+	if(mKeys[item] != key)
+	{
+		mKeys[item] = key;
+		mChanged = true;
+	}
+}
+
+bool InstanceBatcher::Contains(uint32 item)const
+{
+	return item < mKeys.size() && mKeys[item] != InvalidKey;
+}
+
+bool InstanceBatcher::Rebatch()
+{
+	if(!mChanged)
+		return false;
+
+	mChanged = false;
+
+	mInstanceItems.clear();
+	for(uint32 item = 0; item < (uint32)mKeys.size(); ++item)
+	{
+		if(mKeys[item] != InvalidKey)
+			mInstanceItems.push_back(item);
+	}
+
+	// Items stay in index order within a batch.
+	std::stable_sort(mInstanceItems.begin(), mInstanceItems.end(),
+		[this](uint32 a, uint32 b) { return mKeys[a] < mKeys[b]; });
+
+	mBatches.clear();
+	for(uint32 i = 0; i < (uint32)mInstanceItems.size(); ++i)
+	{
+		uint64 key = mKeys[mInstanceItems[i]];
+		if(mBatches.empty() || mBatches.back().Key != key)
+		{
+			Batch batch;
+			batch.Key = key;
+			batch.FirstInstance = i;
+			mBatches.push_back(batch);
+		}
+
+		mBatches.back().InstanceCount++;
+	}
+
+	return true;
+}
+
+const std::vector<InstanceBatcher::Batch>& InstanceBatcher::GetBatches()const
+{
+	return mBatches;
+}
+
+const std::vector<InstanceBatcher::uint32>& InstanceBatcher::GetInstanceItems()const
+{
+	return mInstanceItems;
+}
+
+InstanceBatcher::uint32 InstanceBatcher::GetItemCount()const
+{
+	return mItemCount;
+}
+
+InstanceBatcher::uint32 InstanceBatcher::GetBatchCount()const
+{
+	return (uint32)mBatches.size();
+}
@@ -0,0 +1,67 @@
+//***************************************************************************************
+// InstanceBatcher.h
+//
+// Groups render items that draw the same thing into instanced draws.  Each item is
+// added with a batch key, which the app makes from what the draw shares: the geometry,
+// the submesh and the material.  Rebatch sorts the items by key and cuts them into
+// batches of consecutive instances, so that a batch is one DrawIndexedInstanced over
+// InstanceCount instances starting at FirstInstance of the frame's instance buffer.
+//
+// Grouping only depends on which items there are and their keys, so Rebatch does the
+// work only after Add, Remove or SetKey.  Moving items only changes the instance data,
+// which the app writes every frame in GetInstanceItems order.
+//
+// LitColumns is the only demo drawn through it so far.  ShapesApp, the crates and the
+// tree billboards still draw one item at a time from per-object constant buffers;
+// batching them needs their shaders to read world matrices from an instance buffer
+// indexed by SV_InstanceID, as LitColumns' Default.hlsl does, and ShapesApp's culling
+// to produce instance lists per batch each frame.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class InstanceBatcher
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	struct Batch
+	{
+		uint64 Key = 0;
+		uint32 FirstInstance = 0;
+		uint32 InstanceCount = 0;
+	};
+
+	///<summary>
+	/// Adds item, an index of the app's choosing, to the batch with the given key.
+	///</summary>
+	void Add(uint32 item, uint64 key);
+	void Remove(uint32 item);
+	void SetKey(uint32 item, uint64 key);
+	bool Contains(uint32 item)const;
+
+	///<summary>
+	/// Regroups the items if they changed since the last call.  Returns true if it did.
+	///</summary>
+	bool Rebatch();
+
+	// Batches in key order, and the item of each instance, batch after batch.
+	const std::vector<Batch>& GetBatches()const;
+	const std::vector<uint32>& GetInstanceItems()const;
+
+	uint32 GetItemCount()const;
+	uint32 GetBatchCount()const;
+
+private:
+	// Batch key of each item, or UINT64_MAX for items not added.
+	std::vector<uint64> mKeys;
+	uint32 mItemCount = 0;
+	bool mChanged = false;
+
+	std::vector<Batch> mBatches;
+	std::vector<uint32> mInstanceItems;
+};
@@ -0,0 +1,124 @@
+//***************************************************************************************
+// JobSystem.cpp
+//***************************************************************************************
+
+#include "JobSystem.h"
+
+JobSystem::uint32 JobSystem::DefaultWorkerCount()
+{
+	uint32 hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+JobSystem::JobSystem(uint32 workerCount)
+{
+	for(uint32 i = 0; i < workerCount; ++i)
+		mWorkers.push_back(std::thread(&JobSystem::WorkerMain, this, i + 1));
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mJobAvailable.notify_all();
+
+	for(size_t i = 0; i < mWorkers.size(); ++i)
+		mWorkers[i].join();
+}
+
+void JobSystem::Submit(Group& group, Job job)
+{
+	group.mPending++;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		QueuedJob queued;
+		queued.Run = std::move(job);
+		queued.Owner = &group;
+		mQueue.push_back(std::move(queued));
+	}
+	mJobAvailable.notify_one();
+}
+
+void JobSystem::Wait(Group& group)
+{
+	while(!group.IsDone())
+	{
+		if(RunOne())
+			continue;
+
+		// Everything left of the group is running on the workers.
+		std::unique_lock<std::mutex> lock(mMutex);
+		mJobFinished.wait(lock, [&]() { return group.IsDone() || !mQueue.empty(); });
+	}
+
+	if(group.mException)
+	{
+		std::exception_ptr e = group.mException;
+		group.mException = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+bool JobSystem::RunOne()
+{
+	QueuedJob job;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(mQueue.empty())
+			return false;
+
+		job = std::move(mQueue.front());
+		mQueue.pop_front();
+	}
+
+	Run(job, 0);
+	return true;
+}
+
+JobSystem::uint32 JobSystem::GetThreadCount()const
+{
+	return (uint32)mWorkers.size() + 1;
+}
+
+void JobSystem::Run(QueuedJob& job, uint32 threadIndex)
+{
+	try
+	{
+		job.Run(threadIndex);
+	}
+	catch(...)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(!job.Owner->mException)
+			job.Owner->mException = std::current_exception();
+	}
+
+	// Notify under the lock, so a thread between checking the group and waiting
+	// cannot miss it.
+	std::lock_guard<std::mutex> lock(mMutex);
+	if(--job.Owner->mPending == 0)
+		mJobFinished.notify_all();
+}
+
+void JobSystem::WorkerMain(uint32 threadIndex)
+{
+	for(;;)
+	{
+		QueuedJob job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mJobAvailable.wait(lock, [this]() { return mStopping || !mQueue.empty(); });
+			if(mQueue.empty())
+				return;
+
+			job = std::move(mQueue.front());
+			mQueue.pop_front();
+		}
+
+		Run(job, threadIndex);
+	}
+}
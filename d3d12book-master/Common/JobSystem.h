@@ -0,0 +1,94 @@
+//***************************************************************************************
+// JobSystem.h
+//
+// A pool of worker threads running jobs from one queue.  Jobs are submitted to a group
+// and Wait returns when all the jobs of the group have run; the waiting thread runs
+// queued jobs itself meanwhile, so with no workers every job runs inside Wait, in
+// submission order.
+//
+// A job is told the index of the thread running it: 0 for the thread that calls Wait
+// and RunOne, which must always be the same one, and 1 to GetThreadCount()-1 for the
+// workers.  So per-thread resources, such as command allocators, can be indexed by it
+// without locking.
+//
+// An exception thrown by a job is rethrown from Wait on its group.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem
+{
+public:
+	using uint32 = std::uint32_t;
+	using Job = std::function<void(uint32 threadIndex)>;
+
+	class Group
+	{
+	public:
+		Group() = default;
+		Group(const Group& rhs) = delete;
+		Group& operator=(const Group& rhs) = delete;
+
+		bool IsDone()const { return mPending == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<uint32> mPending{ 0 };
+		std::exception_ptr mException;
+	};
+
+	///<summary>
+	/// One worker per hardware thread, less one for the thread that waits.
+	///</summary>
+	static uint32 DefaultWorkerCount();
+
+	explicit JobSystem(uint32 workerCount = DefaultWorkerCount());
+	JobSystem(const JobSystem& rhs) = delete;
+	JobSystem& operator=(const JobSystem& rhs) = delete;
+	~JobSystem();
+
+	void Submit(Group& group, Job job);
+
+	///<summary>
+	/// Runs queued jobs on this thread until every job of group has finished.
+	///</summary>
+	void Wait(Group& group);
+
+	///<summary>
+	/// Runs one queued job on this thread, if there is one.  Lets a thread that has to
+	/// wait for something else help with the jobs meanwhile.
+	///</summary>
+	bool RunOne();
+
+	uint32 GetThreadCount()const;
+
+private:
+	struct QueuedJob
+	{
+		Job Run;
+		Group* Owner = nullptr;
+	};
+
+	void Run(QueuedJob& job, uint32 threadIndex);
+	void WorkerMain(uint32 threadIndex);
+
+private:
+	std::mutex mMutex;
+	std::condition_variable mJobAvailable;
+	std::condition_variable mJobFinished;
+	std::deque<QueuedJob> mQueue;
+	bool mStopping = false;
+
+	std::vector<std::thread> mWorkers;
+};
@@ -0,0 +1,146 @@
+//***************************************************************************************
+// MappedSpan.h
+//
+// Writes into mapped upload memory.  Upload heaps are write-combined: stores are
+// gathered into whole lines and sent on without going through the cache, so they are
+// fast when written once, front to back, and slow when read or written piecemeal.
+//
+// MappedSpan<T> is a view of count elements, elementByteSize bytes apart, for building
+// data in place, plus per-element and bulk copies.  Bulk copies of large ranges use
+// non-temporal (streaming) stores, which write whole lines without first reading them.
+// Nothing here touches the device, so a span over ordinary memory stands in for an
+// upload buffer when measuring.
+//***************************************************************************************
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace MappedMemory
+{
+	// Below this many bytes a plain memcpy is as fast as streaming.
+	const std::size_t StreamingCopyMinSize = 4096;
+
+	///<summary>
+	/// Copies with streaming stores, without the closing fence.  Call Fence before the
+	/// GPU can see the data, e.g. once after a batch of copies.
+	///</summary>
+	inline void StreamRange(void* dst, const void* src, std::size_t byteSize)
+	{
+		auto* d = static_cast<std::uint8_t*>(dst);
+		auto* s = static_cast<const std::uint8_t*>(src);
+
+		// Up to the first 16 byte aligned destination address.
+		std::size_t head = (16 - ((std::uintptr_t)d & 15)) & 15;
+		head = head < byteSize ? head : byteSize;
+		std::memcpy(d, s, head);
+		d += head;
+		s += head;
+		byteSize -= head;
+
+		for(; byteSize >= 64; d += 64, s += 64, byteSize -= 64)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+			__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+		}
+
+		for(; byteSize >= 16; d += 16, s += 16, byteSize -= 16)
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+
+		std::memcpy(d, s, byteSize);
+	}
+
+	///<summary>
+	/// Orders the streaming stores before everything after it.
+	///</summary>
+	inline void Fence()
+	{
+		_mm_sfence();
+	}
+
+	///<summary>
+	/// memcpy for mapped memory: streams large copies, fence included.
+	///</summary>
+	inline void StreamingCopy(void* dst, const void* src, std::size_t byteSize)
+	{
+		if(byteSize < StreamingCopyMinSize)
+		{
+			std::memcpy(dst, src, byteSize);
+			return;
+		}
+
+		StreamRange(dst, src, byteSize);
+		Fence();
+	}
+}
+
+template<typename T>
+class MappedSpan
+{
+public:
+	MappedSpan(void* data, std::size_t count, std::size_t elementByteSize = sizeof(T)) :
+		mData(static_cast<std::uint8_t*>(data)), mCount(count), mElementByteSize(elementByteSize)
+	{
+		assert(elementByteSize >= sizeof(T));
+	}
+
+	std::size_t size()const
+	{
+		return mCount;
+	}
+
+	// Element i, for writing only: reads from write-combined memory are uncached.
+	T& operator[](std::size_t i)const
+	{
+		assert(i < mCount);
+		return *reinterpret_cast<T*>(mData + i*mElementByteSize);
+	}
+
+	void CopyData(std::size_t index, const T& data)const
+	{
+		assert(index < mCount);
+		std::memcpy(mData + index*mElementByteSize, &data, sizeof(T));
+	}
+
+	///<summary>
+	/// Copies count elements to elements [firstIndex, firstIndex + count).
+	///</summary>
+	void CopyData(std::size_t firstIndex, const T* data, std::size_t count)const
+	{
+		assert(firstIndex + count <= mCount);
+
+		std::uint8_t* dst = mData + firstIndex*mElementByteSize;
+		if(mElementByteSize == sizeof(T))
+		{
+			MappedMemory::StreamingCopy(dst, data, count*sizeof(T));
+		}
+		else if(count*sizeof(T) < MappedMemory::StreamingCopyMinSize)
+		{
+			for(std::size_t i = 0; i < count; ++i)
+				std::memcpy(dst + i*mElementByteSize, &data[i], sizeof(T));
+		}
+		else
+		{
+			// Padded elements, such as constant buffers: stream each one, fence once.
+			for(std::size_t i = 0; i < count; ++i)
+				MappedMemory::StreamRange(dst + i*mElementByteSize, &data[i], sizeof(T));
+
+			MappedMemory::Fence();
+		}
+	}
+
+private:
+	std::uint8_t* mData = nullptr;
+	std::size_t mCount = 0;
+	std::size_t mElementByteSize = 0;
+};
@@ -0,0 +1,508 @@
+//***************************************************************************************
+// MeshBvh.cpp
+//***************************************************************************************
+
+#include "MeshBvh.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+const MeshBvh::uint32 MeshBvh::PacketSize;
+
+namespace
+{
+	// Leaves are never split below this many triangles, and never left above
+	// MaxLeafTriangles unless all centroids coincide.
+	const std::uint32_t MinLeafTriangles = 2;
+	const std::uint32_t MaxLeafTriangles = 8;
+
+	const std::uint32_t SahBinCount = 12;
+
+	// Cost of visiting an interior node relative to one ray/triangle test.
+	const float TraversalCost = 1.0f;
+
+	// Traversal stack size.  Build() stops splitting before the tree gets this deep.
+	const int MaxStackDepth = 64;
+
+	struct Bin
+	{
+		XMFLOAT3 BoxMin = XMFLOAT3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+		XMFLOAT3 BoxMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		std::uint32_t Count = 0;
+	};
+
+	float Component(const XMFLOAT3& v, int axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+
+	void Grow(XMFLOAT3& boxMin, XMFLOAT3& boxMax, const XMFLOAT3& pMin, const XMFLOAT3& pMax)
+	{
+		boxMin.x = std::min(boxMin.x, pMin.x); boxMax.x = std::max(boxMax.x, pMax.x);
+		boxMin.y = std::min(boxMin.y, pMin.y); boxMax.y = std::max(boxMax.y, pMax.y);
+		boxMin.z = std::min(boxMin.z, pMin.z); boxMax.z = std::max(boxMax.z, pMax.z);
+	}
+
+	float HalfArea(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+	{
+		float ex = boxMax.x - boxMin.x;
+		float ey = boxMax.y - boxMin.y;
+		float ez = boxMax.z - boxMin.z;
+		return ex*ey + ey*ez + ez*ex;
+	}
+}
+
+void MeshBvh::Build(const XMFLOAT3* positions, uint32 positionStride,
+	const uint32* indices, uint32 indexCount, int baseVertex)
+{
+	mNodes.clear();
+	mBlocks.clear();
+	mBlockTriangles.clear();
+
+	uint32 triCount = indexCount / 3;
+	mTriangleCount = triCount;
+	if(triCount == 0)
+		return;
+
+	auto position = [&](uint32 index) -> const XMFLOAT3&
+	{
+		auto bytes = reinterpret_cast<const char*>(positions);
+		return *reinterpret_cast<const XMFLOAT3*>(bytes + (size_t)(index + baseVertex)*positionStride);
+	};
+
+	// Per-triangle bounds and centroids are only needed while building.
+	std::vector<BuildTriangle> buildTris(triCount);
+	std::vector<uint32> order(triCount);
+	for(uint32 i = 0; i < triCount; ++i)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&position(indices[i*3+0]));
+		XMVECTOR v1 = XMLoadFloat3(&position(indices[i*3+1]));
+		XMVECTOR v2 = XMLoadFloat3(&position(indices[i*3+2]));
+
+		XMVECTOR vMin = XMVectorMin(XMVectorMin(v0, v1), v2);
+		XMVECTOR vMax = XMVectorMax(XMVectorMax(v0, v1), v2);
+
+		XMStoreFloat3(&buildTris[i].BoxMin, vMin);
+		XMStoreFloat3(&buildTris[i].BoxMax, vMax);
+		XMStoreFloat3(&buildTris[i].Centroid, 0.5f*(vMin + vMax));
+
+		order[i] = i;
+	}
+
+	// A binary tree with n leaves of at least one triangle has at most 2n-1 nodes.
+	mNodes.reserve(2*triCount - 1);
+	mNodes.emplace_back();
+	mNodes[0].LeftOrFirst = 0;
+	mNodes[0].Count = triCount;
+	UpdateNodeBounds(mNodes[0], buildTris, order);
+
+	Subdivide(0, 0, buildTris, order);
+
+	// Pack each leaf's triangles into its own run of SoA blocks, and point the leaf
+	// at its first block instead of its first triangle.
+	for(Node& node : mNodes)
+	{
+		if(node.Count == 0)
+			continue;
+
+		uint32 first = node.LeftOrFirst;
+		uint32 blockStart = (uint32)mBlocks.size();
+		uint32 blockCount = (node.Count + 3) / 4;
+
+		mBlocks.resize(blockStart + blockCount);
+		mBlockTriangles.resize((blockStart + blockCount)*4, UINT32_MAX);
+
+		for(uint32 b = 0; b < blockCount; ++b)
+			RayTriangleSimd::ClearBlock(mBlocks[blockStart + b]);
+
+		for(uint32 i = 0; i < node.Count; ++i)
+		{
+			uint32 tri = order[first + i];
+
+			const XMFLOAT3& v0 = position(indices[tri*3+0]);
+			const XMFLOAT3& v1 = position(indices[tri*3+1]);
+			const XMFLOAT3& v2 = position(indices[tri*3+2]);
+
+			RayTriangleSimd::SetTriangle(mBlocks[blockStart + i/4], i%4, &v0.x, &v1.x, &v2.x);
+			mBlockTriangles[blockStart*4 + i] = tri;
+		}
+
+		node.LeftOrFirst = blockStart;
+	}
+
+	mNodes.shrink_to_fit();
+}
+
+void MeshBvh::UpdateNodeBounds(Node& node, const std::vector<BuildTriangle>& buildTris, const std::vector<uint32>& order)
+{
+	node.BoxMin = XMFLOAT3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+	node.BoxMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for(uint32 i = 0; i < node.Count; ++i)
+	{
+		const BuildTriangle& t = buildTris[order[node.LeftOrFirst + i]];
+		Grow(node.BoxMin, node.BoxMax, t.BoxMin, t.BoxMax);
+	}
+}
+
+void MeshBvh::Subdivide(uint32 nodeIndex, uint32 depth, std::vector<BuildTriangle>& buildTris, std::vector<uint32>& order)
+{
+	uint32 first = mNodes[nodeIndex].LeftOrFirst;
+	uint32 count = mNodes[nodeIndex].Count;
+
+	if(count <= MinLeafTriangles || depth + 2 >= (uint32)MaxStackDepth)
+		return;
+
+	// Bin along the axis with the largest centroid extent.
+	XMFLOAT3 cMin(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+	XMFLOAT3 cMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for(uint32 i = 0; i < count; ++i)
+	{
+		const XMFLOAT3& c = buildTris[order[first + i]].Centroid;
+		Grow(cMin, cMax, c, c);
+	}
+
+	int axis = 0;
+	float extent = cMax.x - cMin.x;
+	if(cMax.y - cMin.y > extent) { axis = 1; extent = cMax.y - cMin.y; }
+	if(cMax.z - cMin.z > extent) { axis = 2; extent = cMax.z - cMin.z; }
+
+	// All centroids coincide; no split can separate them.
+	if(extent <= 0.0f)
+		return;
+
+	float axisMin = Component(cMin, axis);
+	float binScale = SahBinCount / extent;
+
+	auto binOf = [&](const BuildTriangle& t)
+	{
+		uint32 b = (uint32)((Component(t.Centroid, axis) - axisMin)*binScale);
+		return std::min(b, SahBinCount - 1);
+	};
+
+	Bin bins[SahBinCount];
+	for(uint32 i = 0; i < count; ++i)
+	{
+		const BuildTriangle& t = buildTris[order[first + i]];
+		Bin& b = bins[binOf(t)];
+		Grow(b.BoxMin, b.BoxMax, t.BoxMin, t.BoxMax);
+		b.Count++;
+	}
+
+	// Sweep from both sides to get the area/count of every candidate split plane.
+	float leftArea[SahBinCount - 1], rightArea[SahBinCount - 1];
+	uint32 leftCount[SahBinCount - 1], rightCount[SahBinCount - 1];
+
+	Bin left, right;
+	for(uint32 i = 0; i < SahBinCount - 1; ++i)
+	{
+		Grow(left.BoxMin, left.BoxMax, bins[i].BoxMin, bins[i].BoxMax);
+		left.Count += bins[i].Count;
+		leftCount[i] = left.Count;
+		leftArea[i] = left.Count > 0 ? HalfArea(left.BoxMin, left.BoxMax) : 0.0f;
+
+		const Bin& rb = bins[SahBinCount - 1 - i];
+		Grow(right.BoxMin, right.BoxMax, rb.BoxMin, rb.BoxMax);
+		right.Count += rb.Count;
+		rightCount[SahBinCount - 2 - i] = right.Count;
+		rightArea[SahBinCount - 2 - i] = right.Count > 0 ? HalfArea(right.BoxMin, right.BoxMax) : 0.0f;
+	}
+
+	const Node& node = mNodes[nodeIndex];
+	float parentArea = HalfArea(node.BoxMin, node.BoxMax);
+
+	uint32 bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for(uint32 i = 0; i < SahBinCount - 1; ++i)
+	{
+		if(leftCount[i] == 0 || rightCount[i] == 0)
+			continue;
+
+		float cost = leftArea[i]*leftCount[i] + rightArea[i]*rightCount[i];
+		if(cost < bestCost)
+		{
+			bestCost = cost;
+			bestSplit = i;
+		}
+	}
+
+	// Compare against keeping this node as a leaf (cost = count triangle tests).
+	float splitCost = parentArea > 0.0f ? TraversalCost + bestCost/parentArea : FLT_MAX;
+	if(bestCost == FLT_MAX || (splitCost >= (float)count && count <= MaxLeafTriangles))
+		return;
+
+	auto mid = std::partition(order.begin() + first, order.begin() + first + count,
+		[&](uint32 tri) { return binOf(buildTris[tri]) <= bestSplit; });
+
+	uint32 leftTris = (uint32)(mid - (order.begin() + first));
+	if(leftTris == 0 || leftTris == count)
+		return;
+
+	uint32 leftIndex = (uint32)mNodes.size();
+	mNodes.emplace_back();
+	mNodes.emplace_back();
+
+	Node& leftNode = mNodes[leftIndex];
+	leftNode.LeftOrFirst = first;
+	leftNode.Count = leftTris;
+	UpdateNodeBounds(leftNode, buildTris, order);
+
+	Node& rightNode = mNodes[leftIndex + 1];
+	rightNode.LeftOrFirst = first + leftTris;
+	rightNode.Count = count - leftTris;
+	UpdateNodeBounds(rightNode, buildTris, order);
+
+	mNodes[nodeIndex].LeftOrFirst = leftIndex;
+	mNodes[nodeIndex].Count = 0;
+
+	Subdivide(leftIndex, depth + 1, buildTris, order);
+	Subdivide(leftIndex + 1, depth + 1, buildTris, order);
+}
+
+bool MeshBvh::IntersectBox(const Node& node, FXMVECTOR rayOrigin, FXMVECTOR invDir,
+	float maxDistance, float& tEntry)
+{
+	// Slab test.
+	XMVECTOR t0 = (XMLoadFloat3(&node.BoxMin) - rayOrigin)*invDir;
+	XMVECTOR t1 = (XMLoadFloat3(&node.BoxMax) - rayOrigin)*invDir;
+
+	XMFLOAT3 tNear, tFar;
+	XMStoreFloat3(&tNear, XMVectorMin(t0, t1));
+	XMStoreFloat3(&tFar, XMVectorMax(t0, t1));
+
+	float tMin = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+	float tMax = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+
+	tEntry = tMin;
+	return tMin <= tMax;
+}
+
+bool MeshBvh::IntersectClosest(FXMVECTOR rayOrigin, FXMVECTOR rayDir, Hit& hit, float maxDistance)const
+{
+	if(mNodes.empty())
+		return false;
+
+	XMVECTOR invDir = XMVectorReciprocal(rayDir);
+
+	XMFLOAT3 o, d;
+	XMStoreFloat3(&o, rayOrigin);
+	XMStoreFloat3(&d, rayDir);
+	RayTriangleSimd::Ray4 ray = RayTriangleSimd::BroadcastRay(&o.x, &d.x);
+
+	float closest = maxDistance;
+	bool found = false;
+
+	float tEntry;
+	if(!IntersectBox(mNodes[0], rayOrigin, invDir, closest, tEntry))
+		return false;
+
+	uint32 stack[MaxStackDepth];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while(stackSize > 0)
+	{
+		const Node& node = mNodes[stack[--stackSize]];
+
+		if(node.Count > 0)
+		{
+			uint32 blockCount = (node.Count + 3) / 4;
+			for(uint32 b = node.LeftOrFirst; b < node.LeftOrFirst + blockCount; ++b)
+			{
+				float t, u, v;
+				int lane = RayTriangleSimd::IntersectRayClosest4(ray, mBlocks[b], closest, t, u, v);
+				if(lane >= 0)
+				{
+					closest = t;
+					found = true;
+
+					hit.TriangleIndex = mBlockTriangles[b*4 + lane];
+					hit.Distance = t;
+					hit.U = u;
+					hit.V = v;
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so closest shrinks early and prunes the other.
+		uint32 nearChild = node.LeftOrFirst;
+		uint32 farChild = node.LeftOrFirst + 1;
+
+		float tNear, tFar;
+		bool hitNear = IntersectBox(mNodes[nearChild], rayOrigin, invDir, closest, tNear);
+		bool hitFar = IntersectBox(mNodes[farChild], rayOrigin, invDir, closest, tFar);
+
+		if(hitNear && hitFar && tFar < tNear)
+		{
+			std::swap(nearChild, farChild);
+		}
+		else if(!hitNear)
+		{
+			nearChild = farChild;
+			hitNear = hitFar;
+			hitFar = false;
+		}
+
+		// Push far first so near is popped next.
+		if(hitFar)
+			stack[stackSize++] = farChild;
+		if(hitNear)
+			stack[stackSize++] = nearChild;
+	}
+
+	return found;
+}
+
+bool MeshBvh::IntersectAny(FXMVECTOR rayOrigin, FXMVECTOR rayDir, float maxDistance)const
+{
+	if(mNodes.empty())
+		return false;
+
+	XMVECTOR invDir = XMVectorReciprocal(rayDir);
+
+	XMFLOAT3 o, d;
+	XMStoreFloat3(&o, rayOrigin);
+	XMStoreFloat3(&d, rayDir);
+	RayTriangleSimd::Ray4 ray = RayTriangleSimd::BroadcastRay(&o.x, &d.x);
+
+	uint32 stack[MaxStackDepth];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while(stackSize > 0)
+	{
+		const Node& node = mNodes[stack[--stackSize]];
+
+		float tEntry;
+		if(!IntersectBox(node, rayOrigin, invDir, maxDistance, tEntry))
+			continue;
+
+		if(node.Count > 0)
+		{
+			uint32 blockCount = (node.Count + 3) / 4;
+			for(uint32 b = node.LeftOrFirst; b < node.LeftOrFirst + blockCount; ++b)
+			{
+				if(RayTriangleSimd::IntersectRayAny4(ray, mBlocks[b], maxDistance))
+					return true;
+			}
+			continue;
+		}
+
+		stack[stackSize++] = node.LeftOrFirst + 1;
+		stack[stackSize++] = node.LeftOrFirst;
+	}
+
+	return false;
+}
+
+void MeshBvh::IntersectClosestPacket(const XMFLOAT3* rayOrigins, const XMFLOAT3* rayDirs,
+	uint32 rayCount, Hit* hits, float maxDistance)const
+{
+	for(uint32 i = 0; i < rayCount; ++i)
+		hits[i] = Hit();
+
+	if(mNodes.empty())
+		return;
+
+	for(uint32 base = 0; base < rayCount; base += PacketSize)
+	{
+		uint32 packetCount = std::min(PacketSize, rayCount - base);
+
+		XMVECTOR origin[PacketSize];
+		XMVECTOR dir[PacketSize];
+		XMVECTOR invDir[PacketSize];
+		RayTriangleSimd::Ray4 ray[PacketSize];
+		float closest[PacketSize];
+		for(uint32 r = 0; r < packetCount; ++r)
+		{
+			origin[r] = XMLoadFloat3(&rayOrigins[base + r]);
+			dir[r] = XMLoadFloat3(&rayDirs[base + r]);
+			invDir[r] = XMVectorReciprocal(dir[r]);
+			ray[r] = RayTriangleSimd::BroadcastRay(&rayOrigins[base + r].x, &rayDirs[base + r].x);
+			closest[r] = maxDistance;
+		}
+
+		// Each stack entry carries the mask of rays that reached it, so a subtree is
+		// only tested against the rays that hit its parent.
+		struct Entry { uint32 NodeIndex; uint32 RayMask; };
+		Entry stack[MaxStackDepth];
+		int stackSize = 0;
+		stack[stackSize++] = { 0, (1u << packetCount) - 1 };
+
+		while(stackSize > 0)
+		{
+			Entry entry = stack[--stackSize];
+			const Node& node = mNodes[entry.NodeIndex];
+
+			uint32 activeMask = 0;
+			for(uint32 r = 0; r < packetCount; ++r)
+			{
+				float tEntry;
+				if((entry.RayMask & (1u << r)) && IntersectBox(node, origin[r], invDir[r], closest[r], tEntry))
+					activeMask |= 1u << r;
+			}
+
+			if(activeMask == 0)
+				continue;
+
+			if(node.Count > 0)
+			{
+				uint32 blockCount = (node.Count + 3) / 4;
+				for(uint32 b = node.LeftOrFirst; b < node.LeftOrFirst + blockCount; ++b)
+				{
+					for(uint32 r = 0; r < packetCount; ++r)
+					{
+						if((activeMask & (1u << r)) == 0)
+							continue;
+
+						float t, u, v;
+						int lane = RayTriangleSimd::IntersectRayClosest4(ray[r], mBlocks[b], closest[r], t, u, v);
+						if(lane >= 0)
+						{
+							closest[r] = t;
+
+							Hit& hit = hits[base + r];
+							hit.TriangleIndex = mBlockTriangles[b*4 + lane];
+							hit.Distance = t;
+							hit.U = u;
+							hit.V = v;
+						}
+					}
+				}
+				continue;
+			}
+
+			// Order children by the direction of the first active ray; packets are
+			// expected to be coherent, so this is near-first for most of them.
+			uint32 first = 0;
+			while((activeMask & (1u << first)) == 0)
+				++first;
+
+			uint32 nearChild = node.LeftOrFirst;
+			const Node& leftNode = mNodes[node.LeftOrFirst];
+			const Node& rightNode = mNodes[node.LeftOrFirst + 1];
+			XMFLOAT3 d;
+			XMStoreFloat3(&d, dir[first]);
+			float leftCenter  = (leftNode.BoxMin.x + leftNode.BoxMax.x)*d.x + (leftNode.BoxMin.y + leftNode.BoxMax.y)*d.y + (leftNode.BoxMin.z + leftNode.BoxMax.z)*d.z;
+			float rightCenter = (rightNode.BoxMin.x + rightNode.BoxMax.x)*d.x + (rightNode.BoxMin.y + rightNode.BoxMax.y)*d.y + (rightNode.BoxMin.z + rightNode.BoxMax.z)*d.z;
+			if(rightCenter < leftCenter)
+				nearChild = node.LeftOrFirst + 1;
+
+			uint32 farChild = nearChild == node.LeftOrFirst ? node.LeftOrFirst + 1 : node.LeftOrFirst;
+			stack[stackSize++] = { farChild, activeMask };
+			stack[stackSize++] = { nearChild, activeMask };
+		}
+	}
+}
+
+XMFLOAT3 MeshBvh::BoundsMin()const
+{
+	return mNodes.empty() ? XMFLOAT3(0.0f, 0.0f, 0.0f) : mNodes[0].BoxMin;
+}
+
+XMFLOAT3 MeshBvh::BoundsMax()const
+{
+	return mNodes.empty() ? XMFLOAT3(0.0f, 0.0f, 0.0f) : mNodes[0].BoxMax;
+}
@@ -0,0 +1,123 @@
+//***************************************************************************************
+// MeshBvh.h
+//
+// Bounding volume hierarchy over the triangles of one mesh, used for ray queries such
+// as picking.  The tree is built once when the geometry is loaded (binned SAH split),
+// stored as a flat node array, and the triangles are kept in leaf order in a
+// precomputed Moller-Trumbore layout (v0, e1 = v1-v0, e2 = v2-v0), packed in SoA
+// blocks of 4 so each leaf is tested with the SSE kernel from RayTriangleSimd.h and
+// does not have to touch the vertex/index buffers again.
+//
+// All queries work in the local space of the mesh.  The ray direction does not need
+// to be normalized; the returned distance is in units of the direction length.
+//***************************************************************************************
+
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <DirectXMath.h>
+#include <vector>
+#include "RayTriangleSimd.h"
+
+class MeshBvh
+{
+public:
+
+	using uint32 = std::uint32_t;
+
+	// Maximum number of rays traced together by IntersectClosestPacket.
+	static const uint32 PacketSize = 8;
+
+	struct Hit
+	{
+		// Index of the triangle within the index range the tree was built from.
+		uint32 TriangleIndex = UINT32_MAX;
+
+		// Ray parameter of the hit point: P = origin + Distance*dir.
+		float Distance = FLT_MAX;
+
+		// Barycentric coordinates of the hit point relative to v1 and v2:
+		// P = (1-U-V)*v0 + U*v1 + V*v2.
+		float U = 0.0f;
+		float V = 0.0f;
+	};
+
+	struct Node
+	{
+		DirectX::XMFLOAT3 BoxMin;
+
+		// Leaf: index of the first triangle block.  Interior: index of the left child;
+		// the right child is always stored right after it.
+		uint32 LeftOrFirst = 0;
+
+		DirectX::XMFLOAT3 BoxMax;
+
+		// Number of triangles for a leaf, 0 for an interior node.
+		uint32 Count = 0;
+	};
+
+	///<summary>
+	/// Builds the tree over indexCount/3 triangles.  positions points at the position
+	/// of the first vertex and positionStride is the byte distance between vertices, so
+	/// an interleaved vertex buffer can be passed directly.  baseVertex is added to
+	/// every index, like the BaseVertexLocation of a draw call.
+	///</summary>
+	void Build(const DirectX::XMFLOAT3* positions, uint32 positionStride,
+		const uint32* indices, uint32 indexCount, int baseVertex = 0);
+
+	///<summary>
+	/// Finds the nearest triangle hit by the ray with 0 < t < maxDistance.
+	///</summary>
+	bool IntersectClosest(DirectX::FXMVECTOR rayOrigin, DirectX::FXMVECTOR rayDir,
+		Hit& hit, float maxDistance = FLT_MAX)const;
+
+	///<summary>
+	/// Returns true as soon as any triangle is hit with 0 < t < maxDistance.  Cheaper
+	/// than IntersectClosest; use it for occlusion/visibility rays.
+	///</summary>
+	bool IntersectAny(DirectX::FXMVECTOR rayOrigin, DirectX::FXMVECTOR rayDir,
+		float maxDistance = FLT_MAX)const;
+
+	///<summary>
+	/// Closest-hit query for rayCount rays.  Rays are traced in packets of PacketSize
+	/// that share one traversal stack, so coherent rays (e.g. a block of screen pixels)
+	/// visit each node once per packet instead of once per ray.  hits[i] keeps
+	/// TriangleIndex == UINT32_MAX when ray i misses.
+	///</summary>
+	void IntersectClosestPacket(const DirectX::XMFLOAT3* rayOrigins, const DirectX::XMFLOAT3* rayDirs,
+		uint32 rayCount, Hit* hits, float maxDistance = FLT_MAX)const;
+
+	bool Empty()const { return mNodes.empty(); }
+	uint32 TriangleCount()const { return mTriangleCount; }
+	uint32 NodeCount()const { return (uint32)mNodes.size(); }
+
+	// Bounds of the whole mesh (the root box).
+	DirectX::XMFLOAT3 BoundsMin()const;
+	DirectX::XMFLOAT3 BoundsMax()const;
+
+private:
+	struct BuildTriangle
+	{
+		DirectX::XMFLOAT3 BoxMin;
+		DirectX::XMFLOAT3 BoxMax;
+		DirectX::XMFLOAT3 Centroid;
+	};
+
+	void Subdivide(uint32 nodeIndex, uint32 depth, std::vector<BuildTriangle>& buildTris, std::vector<uint32>& order);
+	void UpdateNodeBounds(Node& node, const std::vector<BuildTriangle>& buildTris, const std::vector<uint32>& order);
+
+	static bool IntersectBox(const Node& node, DirectX::FXMVECTOR rayOrigin, DirectX::FXMVECTOR invDir,
+		float maxDistance, float& tEntry);
+
+private:
+	std::vector<Node> mNodes;
+
+	// Leaf triangles, 4 per block.  Unused lanes of a leaf's last block are zeroed.
+	std::vector<RayTriangleSimd::TriangleBlock4> mBlocks;
+
+	// Original triangle index of every block lane, reported back in Hit::TriangleIndex.
+	std::vector<uint32> mBlockTriangles;
+
+	uint32 mTriangleCount = 0;
+};
@@ -0,0 +1,412 @@
+//***************************************************************************************
+// MeshOptimizer.cpp
+//***************************************************************************************
+
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = MeshOptimizer::uint32;
+
+	// Forsyth's "Linear-Speed Vertex Cache Optimisation" scoring.  The LRU cache
+	// modelled here is larger than the FIFO used for analysis on purpose: the score only
+	// needs to prefer recently used vertices, not predict the hardware exactly.
+	const uint32 ScoringCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	float VertexScore(int cachePosition, uint32 remainingValence)
+	{
+		// No triangles left to draw with this vertex.
+		if(remainingValence == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if(cachePosition >= 0)
+		{
+			// The three vertices of the last triangle get a fixed score so the next pick
+			// does not favour one edge of it over another.
+			if(cachePosition < 3)
+				score = LastTriScore;
+			else
+			{
+				float scaler = 1.0f / (ScoringCacheSize - 3);
+				score = powf(1.0f - (cachePosition - 3)*scaler, CacheDecayPower);
+			}
+		}
+
+		// Boost vertices with few triangles left so they get finished off and leave the
+		// cache for good.
+		score += ValenceBoostScale * powf((float)remainingValence, -ValenceBoostPower);
+		return score;
+	}
+
+	// FIFO cache simulation with timestamps: a vertex is in the cache when fewer than
+	// cacheSize misses happened since it was loaded.
+	class FifoCache
+	{
+	public:
+		FifoCache(uint32 vertexCount, uint32 cacheSize)
+			: mTimestamps(vertexCount, 0), mCacheSize(cacheSize), mTime(cacheSize + 1)
+		{
+		}
+
+		// Returns true on a miss.
+		bool Access(uint32 v)
+		{
+			if(mTime - mTimestamps[v] > mCacheSize)
+			{
+				mTimestamps[v] = mTime++;
+				return true;
+			}
+			return false;
+		}
+
+		void Clear()
+		{
+			mTime += mCacheSize + 1;
+		}
+
+	private:
+		std::vector<uint32> mTimestamps;
+		uint32 mCacheSize;
+		uint32 mTime;
+	};
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const uint32* indices, uint32 indexCount,
+	uint32 vertexCount, uint32 cacheSize)
+{
+	CacheStats stats;
+
+	uint32 triangleCount = indexCount / 3;
+	if(triangleCount == 0)
+		return stats;
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<bool> referenced(vertexCount, false);
+
+	uint32 misses = 0;
+	uint32 uniqueVertices = 0;
+	for(uint32 i = 0; i < triangleCount*3; ++i)
+	{
+		uint32 v = indices[i];
+		if(cache.Access(v))
+			misses++;
+
+		if(!referenced[v])
+		{
+			referenced[v] = true;
+			uniqueVertices++;
+		}
+	}
+
+	stats.Acmr = (float)misses / triangleCount;
+	stats.Atvr = (float)misses / uniqueVertices;
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32* indices, uint32 indexCount, uint32 vertexCount)
+{
+	uint32 triangleCount = indexCount / 3;
+	if(triangleCount == 0)
+		return;
+
+	// Triangles adjacent to each vertex, packed by vertex.  The first valence[v] entries
+	// of a vertex's range are the triangles not drawn yet.
+	std::vector<uint32> valence(vertexCount, 0);
+	for(uint32 i = 0; i < triangleCount*3; ++i)
+		valence[indices[i]]++;
+
+	std::vector<uint32> adjacencyOffset(vertexCount + 1, 0);
+	for(uint32 v = 0; v < vertexCount; ++v)
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+
+	std::vector<uint32> adjacency(triangleCount*3);
+	std::vector<uint32> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for(uint32 i = 0; i < triangleCount*3; ++i)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for(uint32 v = 0; v < vertexCount; ++v)
+		vertexScore[v] = VertexScore(-1, valence[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+
+	int bestTriangle = -1;
+	float bestScore = -1.0f;
+	for(uint32 t = 0; t < triangleCount; ++t)
+	{
+		triangleScore[t] = vertexScore[indices[t*3+0]] + vertexScore[indices[t*3+1]] + vertexScore[indices[t*3+2]];
+		if(triangleScore[t] > bestScore)
+		{
+			bestScore = triangleScore[t];
+			bestTriangle = (int)t;
+		}
+	}
+
+	std::vector<uint32> output(triangleCount*3);
+	std::vector<uint32> cache;
+	std::vector<uint32> newCache;
+	cache.reserve(ScoringCacheSize + 3);
+	newCache.reserve(ScoringCacheSize + 3);
+
+	uint32 cursor = 0;
+	for(uint32 outTriangle = 0; outTriangle < triangleCount; ++outTriangle)
+	{
+		// Nothing in the cache has triangles left: take the next one in input order.
+		if(bestTriangle < 0)
+		{
+			while(emitted[cursor])
+				cursor++;
+			bestTriangle = (int)cursor;
+		}
+
+		uint32 t = (uint32)bestTriangle;
+		const uint32* tri = &indices[t*3];
+		output[outTriangle*3+0] = tri[0];
+		output[outTriangle*3+1] = tri[1];
+		output[outTriangle*3+2] = tri[2];
+		emitted[t] = true;
+
+		// Take the triangle out of the live adjacency of its vertices.
+		for(uint32 k = 0; k < 3; ++k)
+		{
+			uint32 v = tri[k];
+			uint32* live = &adjacency[adjacencyOffset[v]];
+			for(uint32 j = 0; j < valence[v]; ++j)
+			{
+				if(live[j] == t)
+				{
+					std::swap(live[j], live[valence[v] - 1]);
+					break;
+				}
+			}
+			valence[v]--;
+		}
+
+		// Move the triangle's vertices to the front of the LRU cache.
+		newCache.assign(tri, tri + 3);
+		for(uint32 v : cache)
+		{
+			if(v != tri[0] && v != tri[1] && v != tri[2])
+				newCache.push_back(v);
+		}
+
+		for(uint32 i = 0; i < newCache.size(); ++i)
+		{
+			uint32 v = newCache[i];
+			cachePosition[v] = i < ScoringCacheSize ? (int)i : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], valence[v]);
+		}
+
+		// Only triangles touching a vertex whose score changed need rescoring, and the
+		// next triangle is picked among them.
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for(uint32 v : newCache)
+		{
+			const uint32* live = &adjacency[adjacencyOffset[v]];
+			for(uint32 j = 0; j < valence[v]; ++j)
+			{
+				uint32 u = live[j];
+				float score = vertexScore[indices[u*3+0]] + vertexScore[indices[u*3+1]] + vertexScore[indices[u*3+2]];
+				triangleScore[u] = score;
+				if(score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = (int)u;
+				}
+			}
+		}
+
+		if(newCache.size() > ScoringCacheSize)
+			newCache.resize(ScoringCacheSize);
+		cache.swap(newCache);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32* indices, uint32 indexCount,
+	const XMFLOAT3* positions, uint32 vertexCount, float threshold)
+{
+	uint32 triangleCount = indexCount / 3;
+	if(triangleCount == 0)
+		return;
+
+	// Hard boundaries: a triangle whose three vertices all miss starts a new strip in
+	// the cache-optimized order, so cutting there costs nothing.
+	std::vector<uint32> hardClusters;
+	{
+		FifoCache cache(vertexCount, DefaultCacheSize);
+		for(uint32 t = 0; t < triangleCount; ++t)
+		{
+			uint32 misses = 0;
+			for(uint32 k = 0; k < 3; ++k)
+				misses += cache.Access(indices[t*3+k]) ? 1 : 0;
+
+			if(t == 0 || misses == 3)
+				hardClusters.push_back(t);
+		}
+		hardClusters.push_back(triangleCount);
+	}
+
+	// Soft boundaries: split a hard cluster further once the part since the last cut
+	// already has an ACMR within threshold of the whole cluster's.
+	std::vector<uint32> clusters;
+	FifoCache cache(vertexCount, DefaultCacheSize);
+	for(size_t c = 0; c + 1 < hardClusters.size(); ++c)
+	{
+		uint32 start = hardClusters[c];
+		uint32 end = hardClusters[c + 1];
+
+		cache.Clear();
+		uint32 clusterMisses = 0;
+		for(uint32 i = start*3; i < end*3; ++i)
+			clusterMisses += cache.Access(indices[i]) ? 1 : 0;
+		float clusterAcmr = (float)clusterMisses / (end - start);
+
+		cache.Clear();
+		clusters.push_back(start);
+		uint32 cutStart = start;
+		uint32 misses = 0;
+		for(uint32 t = start; t < end; ++t)
+		{
+			for(uint32 k = 0; k < 3; ++k)
+				misses += cache.Access(indices[t*3+k]) ? 1 : 0;
+
+			if(t + 1 < end && (float)misses / (t + 1 - cutStart) <= clusterAcmr*threshold)
+			{
+				clusters.push_back(t + 1);
+				cutStart = t + 1;
+				misses = 0;
+				cache.Clear();
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	uint32 clusterCount = (uint32)clusters.size() - 1;
+
+	// Area weighted centroid and normal of each cluster and of the whole mesh.
+	std::vector<XMFLOAT3> clusterCentroid(clusterCount);
+	std::vector<XMFLOAT3> clusterNormal(clusterCount);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+
+	for(uint32 c = 0; c < clusterCount; ++c)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for(uint32 t = clusters[c]; t < clusters[c + 1]; ++t)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&positions[indices[t*3+0]]);
+			XMVECTOR p1 = XMLoadFloat3(&positions[indices[t*3+1]]);
+			XMVECTOR p2 = XMLoadFloat3(&positions[indices[t*3+2]]);
+
+			XMVECTOR cross = XMVector3Cross(p1 - p0, p2 - p0);
+			float triArea = 0.5f*XMVectorGetX(XMVector3Length(cross));
+
+			centroid += (triArea/3.0f)*(p0 + p1 + p2);
+			normal += cross;
+			area += triArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+
+		XMStoreFloat3(&clusterCentroid[c], area > 0.0f ? centroid/area : XMVectorZero());
+		XMStoreFloat3(&clusterNormal[c], XMVector3Normalize(normal));
+	}
+
+	if(meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// Clusters that face away from the centre are on the outside of the mesh and are
+	// likely to cover the rest, so they go first.
+	std::vector<float> sortKey(clusterCount);
+	for(uint32 c = 0; c < clusterCount; ++c)
+	{
+		XMVECTOR offset = XMLoadFloat3(&clusterCentroid[c]) - meshCentroid;
+		float key = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormal[c])));
+		sortKey[c] = key == key ? key : 0.0f; // Degenerate clusters have a NaN normal.
+	}
+
+	std::vector<uint32> order(clusterCount);
+	for(uint32 c = 0; c < clusterCount; ++c)
+		order[c] = c;
+
+	std::stable_sort(order.begin(), order.end(),
+		[&](uint32 a, uint32 b) { return sortKey[a] > sortKey[b]; });
+
+	std::vector<uint32> output;
+	output.reserve(triangleCount*3);
+	for(uint32 c : order)
+		output.insert(output.end(), indices + clusters[c]*3, indices + clusters[c + 1]*3);
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(uint32* indices, uint32 indexCount, uint32 vertexCount,
+	std::vector<uint32>& remap)
+{
+	const uint32 Unused = ~0u;
+	remap.assign(vertexCount, Unused);
+
+	uint32 next = 0;
+	for(uint32 i = 0; i < indexCount; ++i)
+	{
+		uint32& r = remap[indices[i]];
+		if(r == Unused)
+			r = next++;
+		indices[i] = r;
+	}
+
+	for(uint32 v = 0; v < vertexCount; ++v)
+	{
+		if(remap[v] == Unused)
+			remap[v] = next++;
+	}
+}
+
+MeshOptimizer::Report MeshOptimizer::Optimize(GeometryGenerator::MeshData& mesh)
+{
+	Report report = OptimizeSubmesh(mesh.Vertices.data(), 0, (uint32)mesh.Vertices.size(),
+		mesh.Indices32.MutableData(), (uint32)mesh.Indices32.size(), &GeometryGenerator::Vertex::Position);
+
+	return report;
+}
+
+MeshOptimizer::Report MeshOptimizer::Optimize(std::vector<uint32>& indices,
+	const std::vector<XMFLOAT3>& positions, std::vector<uint32>& remap)
+{
+	uint32 indexCount = (uint32)indices.size();
+	uint32 vertexCount = (uint32)positions.size();
+
+	Report report;
+	report.Before = AnalyzeVertexCache(indices.data(), indexCount, vertexCount);
+
+	// Some exporters already write a cache-friendly order that the greedy pass does not
+	// beat (skull.txt is one), so keep whichever is better.
+	std::vector<uint32> reordered(indices);
+	OptimizeVertexCache(reordered.data(), indexCount, vertexCount);
+	if(AnalyzeVertexCache(reordered.data(), indexCount, vertexCount).Acmr < report.Before.Acmr)
+		indices.swap(reordered);
+
+	OptimizeOverdraw(indices.data(), indexCount, positions.data(), vertexCount);
+	OptimizeVertexFetch(indices.data(), indexCount, vertexCount, remap);
+
+	report.After = AnalyzeVertexCache(indices.data(), indexCount, vertexCount);
+	return report;
+}
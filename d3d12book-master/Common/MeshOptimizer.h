@@ -0,0 +1,122 @@
+//***************************************************************************************
+// MeshOptimizer.h
+//
+// Reorders the triangles and vertices of an indexed triangle list for the GPU:
+//
+//   1. Vertex cache: Forsyth's linear-speed greedy ordering, so triangles that share
+//      vertices are drawn close together and the post-transform cache hits more.
+//   2. Overdraw: the cache-friendly order is cut into clusters where restarting costs
+//      little, and the clusters are sorted so the ones facing outward (which tend to
+//      occlude the rest of the mesh) are drawn first.
+//   3. Vertex fetch: vertices are renumbered in the order the index buffer first
+//      uses them, so vertex fetches walk memory forward.
+//
+// Only the order changes; the set of triangles and their winding stay the same.  The
+// functions work on plain arrays so they can run at load time or in an offline tool.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <DirectXMath.h>
+#include <vector>
+#include "GeometryGenerator.h"
+
+class MeshOptimizer
+{
+public:
+
+	using uint16 = std::uint16_t;
+	using uint32 = std::uint32_t;
+
+	// Size of the FIFO post-transform cache simulated by AnalyzeVertexCache.
+	static const uint32 DefaultCacheSize = 16;
+
+	struct CacheStats
+	{
+		// Average cache miss ratio: transformed vertices per triangle (0.5 is ideal
+		// for a large regular grid, 3 is the worst case).
+		float Acmr = 0.0f;
+
+		// Average transform to vertex ratio: transformed vertices per referenced
+		// vertex (1 is ideal).
+		float Atvr = 0.0f;
+	};
+
+	struct Report
+	{
+		CacheStats Before;
+		CacheStats After;
+	};
+
+	///<summary>
+	/// Simulates a FIFO post-transform cache of cacheSize entries over the index list.
+	///</summary>
+	static CacheStats AnalyzeVertexCache(const uint32* indices, uint32 indexCount, uint32 vertexCount,
+		uint32 cacheSize = DefaultCacheSize);
+
+	///<summary>
+	/// Reorders the triangles in place for the post-transform vertex cache.
+	///</summary>
+	static void OptimizeVertexCache(uint32* indices, uint32 indexCount, uint32 vertexCount);
+
+	///<summary>
+	/// Reorders the clusters of an index list already optimized with OptimizeVertexCache.
+	/// threshold is how much ACMR a cluster cut may cost (1.05 = 5%).
+	///</summary>
+	static void OptimizeOverdraw(uint32* indices, uint32 indexCount,
+		const DirectX::XMFLOAT3* positions, uint32 vertexCount, float threshold = 1.05f);
+
+	///<summary>
+	/// Renumbers the vertices in first-use order and rewrites the indices.  remap[old]
+	/// receives the new index of each vertex; unused vertices keep their relative order
+	/// at the end.  Apply it to the vertex array with RemapVertices.
+	///</summary>
+	static void OptimizeVertexFetch(uint32* indices, uint32 indexCount, uint32 vertexCount,
+		std::vector<uint32>& remap);
+
+	template<typename T>
+	static void RemapVertices(T* vertices, uint32 vertexCount, const std::vector<uint32>& remap)
+	{
+		std::vector<T> copy(vertices, vertices + vertexCount);
+		for(uint32 i = 0; i < vertexCount; ++i)
+			vertices[remap[i]] = copy[i];
+	}
+
+	///<summary>
+	/// Runs all three passes on one draw range: indexCount indices that reference the
+	/// vertices [vertexStart, vertexStart+vertexCount).  Vertices outside the range are
+	/// not touched, so this can be called per M3D subset.  position names the position
+	/// member of the vertex, e.g. &M3DLoader::SkinnedVertex::Pos.
+	///</summary>
+	template<typename Vertex, typename Index>
+	static Report OptimizeSubmesh(Vertex* vertices, uint32 vertexStart, uint32 vertexCount,
+		Index* indices, uint32 indexCount, DirectX::XMFLOAT3 Vertex::* position)
+	{
+		std::vector<uint32> localIndices(indexCount);
+		for(uint32 i = 0; i < indexCount; ++i)
+			localIndices[i] = static_cast<uint32>(indices[i]) - vertexStart;
+
+		std::vector<DirectX::XMFLOAT3> positions(vertexCount);
+		for(uint32 i = 0; i < vertexCount; ++i)
+			positions[i] = vertices[vertexStart + i].*position;
+
+		std::vector<uint32> remap;
+		Report report = Optimize(localIndices, positions, remap);
+
+		for(uint32 i = 0; i < indexCount; ++i)
+			indices[i] = static_cast<Index>(localIndices[i] + vertexStart);
+
+		RemapVertices(vertices + vertexStart, vertexCount, remap);
+		return report;
+	}
+
+	///<summary>
+	/// Optimizes a whole generated mesh.
+	///</summary>
+	static Report Optimize(GeometryGenerator::MeshData& mesh);
+
+private:
+	static Report Optimize(std::vector<uint32>& indices, const std::vector<DirectX::XMFLOAT3>& positions,
+		std::vector<uint32>& remap);
+};
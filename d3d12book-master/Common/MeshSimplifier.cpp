@@ -0,0 +1,635 @@
+//***************************************************************************************
+// MeshSimplifier.cpp
+//***************************************************************************************
+
+#include "MeshSimplifier.h"
+#include "Camera.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = MeshSimplifier::uint32;
+	using uint64 = std::uint64_t;
+
+	// Weight of the planes that hold open borders in place, relative to face planes.
+	const double BorderWeight = 10.0;
+
+	// Symmetric 4x4 error quadric of a set of planes: Q(p) = p^T A p + 2 b.p + c.
+	struct Quadric
+	{
+		double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+		double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+		double C = 0.0;
+
+		void AddPlane(double nx, double ny, double nz, double d, double weight)
+		{
+			A00 += weight*nx*nx; A01 += weight*nx*ny; A02 += weight*nx*nz;
+			A11 += weight*ny*ny; A12 += weight*ny*nz; A22 += weight*nz*nz;
+			B0 += weight*nx*d; B1 += weight*ny*d; B2 += weight*nz*d;
+			C += weight*d*d;
+		}
+
+		void Add(const Quadric& q)
+		{
+			A00 += q.A00; A01 += q.A01; A02 += q.A02;
+			A11 += q.A11; A12 += q.A12; A22 += q.A22;
+			B0 += q.B0; B1 += q.B1; B2 += q.B2;
+			C += q.C;
+		}
+
+		double Evaluate(const XMFLOAT3& p)const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double e = A00*x*x + A11*y*y + A22*z*z + 2.0*(A01*x*y + A02*x*z + A12*y*z)
+				+ 2.0*(B0*x + B1*y + B2*z) + C;
+			return e > 0.0 ? e : 0.0;
+		}
+	};
+
+	struct SimplifyVertex
+	{
+		XMFLOAT3 Pos;
+		XMFLOAT3 Normal;
+		XMFLOAT2 TexC;
+		std::uint8_t Bones[4];
+		float Weights[4];
+	};
+
+	struct Collapse
+	{
+		float Cost;
+		float Error;
+		uint32 From;
+		uint32 To;
+	};
+
+	uint64 EdgeKey(uint32 a, uint32 b)
+	{
+		return a < b ? ((uint64)a << 32) | b : ((uint64)b << 32) | a;
+	}
+
+	float DistanceSq(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&a) - XMLoadFloat3(&b)));
+	}
+
+	// Squared difference of two sets of bone influences, compared per bone.
+	float SkinDistanceSq(const SimplifyVertex& a, const SimplifyVertex& b)
+	{
+		float d = 0.0f;
+		for(int i = 0; i < 4; ++i)
+		{
+			// Count each bone once even if a vertex lists it twice.
+			bool seen = false;
+			for(int j = 0; j < i; ++j)
+				seen = seen || a.Bones[j] == a.Bones[i];
+			if(seen)
+				continue;
+
+			float wa = 0.0f, wb = 0.0f;
+			for(int j = 0; j < 4; ++j)
+			{
+				if(a.Bones[j] == a.Bones[i]) wa += a.Weights[j];
+				if(b.Bones[j] == a.Bones[i]) wb += b.Weights[j];
+			}
+			d += (wa - wb)*(wa - wb);
+		}
+
+		for(int i = 0; i < 4; ++i)
+		{
+			// Bones only b is bound to.
+			bool inA = false, seen = false;
+			for(int j = 0; j < 4; ++j)
+				inA = inA || a.Bones[j] == b.Bones[i];
+			for(int j = 0; j < i; ++j)
+				seen = seen || b.Bones[j] == b.Bones[i];
+			if(inA || seen)
+				continue;
+
+			float wb = 0.0f;
+			for(int j = 0; j < 4; ++j)
+			{
+				if(b.Bones[j] == b.Bones[i]) wb += b.Weights[j];
+			}
+			d += wb*wb;
+		}
+
+		return d;
+	}
+
+	// Mesh state while collapsing edges.  All positions are scaled to unit size.
+	class EdgeCollapser
+	{
+	public:
+		EdgeCollapser(std::vector<SimplifyVertex>& vertices, const std::vector<uint32>& indices,
+			const MeshSimplifier::Settings& settings, bool hasNormals, bool hasTexC, bool hasSkin)
+			: mVertices(vertices), mTriangles(indices), mSettings(settings),
+			  mHasNormals(hasNormals), mHasTexC(hasTexC), mHasSkin(hasSkin)
+		{
+			uint32 vertexCount = (uint32)mVertices.size();
+			mQuadrics.resize(vertexCount);
+			mArea.assign(vertexCount, 0.0f);
+			mLocked.assign(vertexCount, false);
+
+			LockSeams();
+			BuildQuadrics();
+		}
+
+		const std::vector<uint32>& Triangles()const { return mTriangles; }
+		float MaxError()const { return mMaxError; }
+
+		// Collapses a set of independent edges, cheapest first, until the mesh has
+		// targetTriangles triangles.  Returns false if no edge could be collapsed.
+		bool Pass(uint32 targetTriangles)
+		{
+			uint32 vertexCount = (uint32)mVertices.size();
+			uint32 triangleCount = (uint32)mTriangles.size() / 3;
+
+			BuildAdjacency();
+
+			std::vector<Collapse> candidates;
+			std::vector<uint32> neighbours;
+			for(uint32 u = 0; u < vertexCount; ++u)
+			{
+				if(mLocked[u] || mAdjacencyOffset[u] == mAdjacencyOffset[u + 1])
+					continue;
+
+				Neighbours(u, neighbours);
+
+				Collapse best = { MathHelper::Infinity, 0.0f, u, u };
+				for(uint32 v : neighbours)
+				{
+					// Border vertices may only slide along the border.
+					if(mBorder[u] && EdgeCount(u, v) != 1)
+						continue;
+
+					if(!LinkConditionHolds(u, v, neighbours) || FlipsTriangle(u, v))
+						continue;
+
+					Collapse c = Evaluate(u, v);
+					if(c.Cost < best.Cost)
+						best = c;
+				}
+
+				if(best.To != u)
+					candidates.push_back(best);
+			}
+
+			if(candidates.empty())
+				return false;
+
+			std::sort(candidates.begin(), candidates.end(),
+				[](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+			// Only the cheaper half is eligible, so a pass does not spend collapses on
+			// expensive edges while cheaper ones wait for their neighbourhood to clear.
+			float costLimit = candidates[candidates.size() / 2].Cost;
+
+			std::vector<bool> dirty(vertexCount, false);
+			uint32 collapsed = 0;
+			for(const Collapse& c : candidates)
+			{
+				if(triangleCount <= targetTriangles || c.Cost > costLimit)
+					break;
+
+				if(dirty[c.From] || dirty[c.To])
+					continue;
+
+				// Both one-rings change, so nothing in them may collapse again this pass.
+				MarkRing(c.From, dirty);
+				MarkRing(c.To, dirty);
+
+				for(uint32 k = mAdjacencyOffset[c.From]; k < mAdjacencyOffset[c.From + 1]; ++k)
+				{
+					uint32* tri = &mTriangles[mAdjacency[k]*3];
+					bool degenerate = tri[0] == c.To || tri[1] == c.To || tri[2] == c.To;
+					for(uint32 j = 0; j < 3; ++j)
+					{
+						if(tri[j] == c.From)
+							tri[j] = c.To;
+					}
+					if(degenerate)
+						triangleCount--;
+				}
+
+				mQuadrics[c.To].Add(mQuadrics[c.From]);
+				mArea[c.To] += mArea[c.From];
+				mMaxError = MathHelper::Max(mMaxError, c.Error);
+				collapsed++;
+			}
+
+			// Drop the triangles that collapsed to an edge.
+			uint32 out = 0;
+			for(uint32 t = 0; t < (uint32)mTriangles.size() / 3; ++t)
+			{
+				uint32 a = mTriangles[t*3+0], b = mTriangles[t*3+1], c = mTriangles[t*3+2];
+				if(a == b || b == c || a == c)
+					continue;
+
+				mTriangles[out++] = a;
+				mTriangles[out++] = b;
+				mTriangles[out++] = c;
+			}
+			mTriangles.resize(out);
+
+			return collapsed > 0;
+		}
+
+	private:
+		// Vertices that share a position with another vertex sit on an attribute seam;
+		// moving one side would open a crack.
+		void LockSeams()
+		{
+			uint32 vertexCount = (uint32)mVertices.size();
+			std::vector<uint32> order(vertexCount);
+			for(uint32 i = 0; i < vertexCount; ++i)
+				order[i] = i;
+
+			auto less = [&](uint32 a, uint32 b)
+			{
+				const XMFLOAT3& p = mVertices[a].Pos;
+				const XMFLOAT3& q = mVertices[b].Pos;
+				if(p.x != q.x) return p.x < q.x;
+				if(p.y != q.y) return p.y < q.y;
+				return p.z < q.z;
+			};
+			std::sort(order.begin(), order.end(), less);
+
+			for(uint32 i = 1; i < vertexCount; ++i)
+			{
+				if(!less(order[i - 1], order[i]))
+				{
+					mLocked[order[i - 1]] = true;
+					mLocked[order[i]] = true;
+				}
+			}
+		}
+
+		void BuildQuadrics()
+		{
+			std::vector<uint64> edges;
+			CollectEdges(edges);
+
+			for(uint32 t = 0; t < (uint32)mTriangles.size() / 3; ++t)
+			{
+				const uint32* tri = &mTriangles[t*3];
+				XMVECTOR p0 = XMLoadFloat3(&mVertices[tri[0]].Pos);
+				XMVECTOR p1 = XMLoadFloat3(&mVertices[tri[1]].Pos);
+				XMVECTOR p2 = XMLoadFloat3(&mVertices[tri[2]].Pos);
+
+				XMVECTOR cross = XMVector3Cross(p1 - p0, p2 - p0);
+				float length = XMVectorGetX(XMVector3Length(cross));
+				if(length <= 0.0f)
+					continue;
+
+				XMFLOAT3 n;
+				XMStoreFloat3(&n, cross / length);
+				float d = -XMVectorGetX(XMVector3Dot(cross / length, p0));
+				float area = 0.5f*length;
+
+				for(uint32 k = 0; k < 3; ++k)
+				{
+					mQuadrics[tri[k]].AddPlane(n.x, n.y, n.z, d, area);
+					mArea[tri[k]] += area / 3.0f;
+				}
+
+				// A plane through each border edge, perpendicular to the face, keeps the
+				// border from pulling in.
+				for(uint32 k = 0; k < 3; ++k)
+				{
+					uint32 a = tri[k];
+					uint32 b = tri[(k + 1) % 3];
+					auto range = std::equal_range(edges.begin(), edges.end(), EdgeKey(a, b));
+					if(range.second - range.first != 1)
+						continue;
+
+					XMVECTOR pa = XMLoadFloat3(&mVertices[a].Pos);
+					XMVECTOR edge = XMLoadFloat3(&mVertices[b].Pos) - pa;
+					XMVECTOR bn = XMVector3Normalize(XMVector3Cross(edge, cross));
+
+					XMFLOAT3 bnf;
+					XMStoreFloat3(&bnf, bn);
+					double bd = -XMVectorGetX(XMVector3Dot(bn, pa));
+					double weight = BorderWeight*XMVectorGetX(XMVector3LengthSq(edge));
+
+					mQuadrics[a].AddPlane(bnf.x, bnf.y, bnf.z, bd, weight);
+					mQuadrics[b].AddPlane(bnf.x, bnf.y, bnf.z, bd, weight);
+				}
+			}
+		}
+
+		void CollectEdges(std::vector<uint64>& edges)const
+		{
+			edges.resize(mTriangles.size());
+			for(uint32 t = 0; t < (uint32)mTriangles.size() / 3; ++t)
+			{
+				for(uint32 k = 0; k < 3; ++k)
+					edges[t*3+k] = EdgeKey(mTriangles[t*3+k], mTriangles[t*3+(k + 1) % 3]);
+			}
+			std::sort(edges.begin(), edges.end());
+		}
+
+		void BuildAdjacency()
+		{
+			uint32 vertexCount = (uint32)mVertices.size();
+			uint32 triangleCount = (uint32)mTriangles.size() / 3;
+
+			mAdjacencyOffset.assign(vertexCount + 1, 0);
+			for(uint32 index : mTriangles)
+				mAdjacencyOffset[index + 1]++;
+			for(uint32 v = 0; v < vertexCount; ++v)
+				mAdjacencyOffset[v + 1] += mAdjacencyOffset[v];
+
+			mAdjacency.resize(mTriangles.size());
+			std::vector<uint32> fill(mAdjacencyOffset.begin(), mAdjacencyOffset.end() - 1);
+			for(uint32 t = 0; t < triangleCount; ++t)
+			{
+				for(uint32 k = 0; k < 3; ++k)
+					mAdjacency[fill[mTriangles[t*3+k]]++] = t;
+			}
+
+			CollectEdges(mEdges);
+
+			mBorder.assign(vertexCount, false);
+			for(size_t i = 0; i < mEdges.size(); )
+			{
+				size_t j = i + 1;
+				while(j < mEdges.size() && mEdges[j] == mEdges[i])
+					++j;
+
+				if(j - i == 1)
+				{
+					mBorder[(uint32)(mEdges[i] >> 32)] = true;
+					mBorder[(uint32)(mEdges[i] & 0xffffffff)] = true;
+				}
+				i = j;
+			}
+		}
+
+		uint32 EdgeCount(uint32 a, uint32 b)const
+		{
+			auto range = std::equal_range(mEdges.begin(), mEdges.end(), EdgeKey(a, b));
+			return (uint32)(range.second - range.first);
+		}
+
+		void Neighbours(uint32 u, std::vector<uint32>& neighbours)const
+		{
+			neighbours.clear();
+			for(uint32 k = mAdjacencyOffset[u]; k < mAdjacencyOffset[u + 1]; ++k)
+			{
+				const uint32* tri = &mTriangles[mAdjacency[k]*3];
+				for(uint32 j = 0; j < 3; ++j)
+				{
+					if(tri[j] != u && std::find(neighbours.begin(), neighbours.end(), tri[j]) == neighbours.end())
+						neighbours.push_back(tri[j]);
+				}
+			}
+		}
+
+		// The collapse keeps the surface a manifold only if u and v have no common
+		// neighbours other than the vertices opposite their shared edge.
+		bool LinkConditionHolds(uint32 u, uint32 v, const std::vector<uint32>& neighboursOfU)const
+		{
+			uint32 shared = 0;
+			for(uint32 k = mAdjacencyOffset[u]; k < mAdjacencyOffset[u + 1]; ++k)
+			{
+				const uint32* tri = &mTriangles[mAdjacency[k]*3];
+				if(tri[0] == v || tri[1] == v || tri[2] == v)
+					shared++;
+			}
+
+			uint32 common = 0;
+			for(uint32 k = mAdjacencyOffset[v]; k < mAdjacencyOffset[v + 1]; ++k)
+			{
+				const uint32* tri = &mTriangles[mAdjacency[k]*3];
+				for(uint32 j = 0; j < 3; ++j)
+				{
+					uint32 w = tri[j];
+					if(w == u || w == v)
+						continue;
+
+					// A common neighbour shows up once per triangle of v that holds it,
+					// so count each one at its first triangle only.
+					bool first = true;
+					for(uint32 m = mAdjacencyOffset[v]; m < k && first; ++m)
+					{
+						const uint32* prev = &mTriangles[mAdjacency[m]*3];
+						first = prev[0] != w && prev[1] != w && prev[2] != w;
+					}
+
+					if(first && std::find(neighboursOfU.begin(), neighboursOfU.end(), w) != neighboursOfU.end())
+						common++;
+				}
+			}
+
+			return common == shared;
+		}
+
+		// True if moving u onto v turns one of u's remaining triangles over.
+		bool FlipsTriangle(uint32 u, uint32 v)const
+		{
+			XMVECTOR pv = XMLoadFloat3(&mVertices[v].Pos);
+			for(uint32 k = mAdjacencyOffset[u]; k < mAdjacencyOffset[u + 1]; ++k)
+			{
+				const uint32* tri = &mTriangles[mAdjacency[k]*3];
+				if(tri[0] == v || tri[1] == v || tri[2] == v)
+					continue;
+
+				XMVECTOR p[3];
+				XMVECTOR q[3];
+				for(uint32 j = 0; j < 3; ++j)
+				{
+					p[j] = XMLoadFloat3(&mVertices[tri[j]].Pos);
+					q[j] = tri[j] == u ? pv : p[j];
+				}
+
+				XMVECTOR before = XMVector3Cross(p[1] - p[0], p[2] - p[0]);
+				XMVECTOR after = XMVector3Cross(q[1] - q[0], q[2] - q[0]);
+
+				float dot = XMVectorGetX(XMVector3Dot(before, after));
+				float scale = XMVectorGetX(XMVector3Length(before))*XMVectorGetX(XMVector3Length(after));
+				if(dot <= 1e-3f*scale || scale <= 0.0f)
+					return true;
+			}
+			return false;
+		}
+
+		void MarkRing(uint32 u, std::vector<bool>& dirty)const
+		{
+			dirty[u] = true;
+			for(uint32 k = mAdjacencyOffset[u]; k < mAdjacencyOffset[u + 1]; ++k)
+			{
+				const uint32* tri = &mTriangles[mAdjacency[k]*3];
+				dirty[tri[0]] = dirty[tri[1]] = dirty[tri[2]] = true;
+			}
+		}
+
+		Collapse Evaluate(uint32 u, uint32 v)const
+		{
+			const SimplifyVertex& a = mVertices[u];
+			const SimplifyVertex& b = mVertices[v];
+
+			Quadric q = mQuadrics[u];
+			q.Add(mQuadrics[v]);
+			float distance = (float)q.Evaluate(b.Pos);
+
+			// The attributes of u are replaced by those of v over u's share of the area.
+			float attribute = 0.0f;
+			if(mHasNormals)
+				attribute += mSettings.NormalWeight*DistanceSq(a.Normal, b.Normal);
+			if(mHasTexC)
+			{
+				float du = a.TexC.x - b.TexC.x;
+				float dv = a.TexC.y - b.TexC.y;
+				attribute += mSettings.TexCWeight*(du*du + dv*dv);
+			}
+			if(mHasSkin)
+				attribute += mSettings.SkinWeight*SkinDistanceSq(a, b);
+
+			// The reported error is geometric only (an area weighted RMS distance), so
+			// it can be compared with a size on screen.
+			Collapse c;
+			c.Cost = distance + attribute*mArea[u];
+			c.Error = sqrtf(distance / MathHelper::Max(mArea[u] + mArea[v], 1e-12f));
+			c.From = u;
+			c.To = v;
+			return c;
+		}
+
+		std::vector<SimplifyVertex>& mVertices;
+		std::vector<uint32> mTriangles;
+		const MeshSimplifier::Settings& mSettings;
+		bool mHasNormals;
+		bool mHasTexC;
+		bool mHasSkin;
+
+		std::vector<Quadric> mQuadrics;
+		std::vector<float> mArea;
+		std::vector<bool> mLocked;
+		float mMaxError = 0.0f;
+
+		// Rebuilt at the start of every pass.
+		std::vector<uint32> mAdjacencyOffset;
+		std::vector<uint32> mAdjacency;
+		std::vector<uint64> mEdges;
+		std::vector<bool> mBorder;
+	};
+}
+
+void MeshSimplifier::Simplify(const std::uint8_t* vertices, uint32 vertexCount, const VertexFormat& format,
+	const std::vector<uint32>& indices, const Settings& settings,
+	std::vector<std::vector<uint32>>& levels, std::vector<float>& errors)
+{
+	levels.assign(1, indices);
+	errors.assign(1, 0.0f);
+
+	uint32 triangleCount = (uint32)indices.size() / 3;
+	if(vertexCount == 0 || triangleCount == 0)
+		return;
+
+	bool hasNormals = format.NormalOffset >= 0;
+	bool hasTexC = format.TexCOffset >= 0;
+	bool hasSkin = format.BoneWeightsOffset >= 0 && format.BoneIndicesOffset >= 0;
+
+	XMVECTOR vMin = XMVectorReplicate(+MathHelper::Infinity);
+	XMVECTOR vMax = XMVectorReplicate(-MathHelper::Infinity);
+
+	std::vector<SimplifyVertex> simplifyVertices(vertexCount);
+	for(uint32 i = 0; i < vertexCount; ++i)
+	{
+		const std::uint8_t* src = vertices + i*format.Stride;
+		SimplifyVertex& v = simplifyVertices[i];
+		memset(&v, 0, sizeof(v));
+
+		memcpy(&v.Pos, src + format.PositionOffset, sizeof(XMFLOAT3));
+		if(hasNormals)
+			memcpy(&v.Normal, src + format.NormalOffset, sizeof(XMFLOAT3));
+		if(hasTexC)
+			memcpy(&v.TexC, src + format.TexCOffset, sizeof(XMFLOAT2));
+		if(hasSkin)
+		{
+			memcpy(v.Weights, src + format.BoneWeightsOffset, 3*sizeof(float));
+			v.Weights[3] = 1.0f - v.Weights[0] - v.Weights[1] - v.Weights[2];
+			memcpy(v.Bones, src + format.BoneIndicesOffset, 4);
+		}
+
+		XMVECTOR p = XMLoadFloat3(&v.Pos);
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+
+	// Scale to unit size so the attribute weights mean the same for every mesh.
+	XMFLOAT3 extent;
+	XMStoreFloat3(&extent, vMax - vMin);
+	float scale = MathHelper::Max(extent.x, MathHelper::Max(extent.y, extent.z));
+	if(scale <= 0.0f)
+		scale = 1.0f;
+
+	for(auto& v : simplifyVertices)
+		XMStoreFloat3(&v.Pos, (XMLoadFloat3(&v.Pos) - vMin) / scale);
+
+	std::vector<uint32> triangles(indices.begin(), indices.begin() + triangleCount*3);
+	EdgeCollapser collapser(simplifyVertices, triangles, settings, hasNormals, hasTexC, hasSkin);
+
+	while(levels.size() < settings.MaxLodCount)
+	{
+		uint32 previous = (uint32)levels.back().size() / 3;
+		uint32 target = (uint32)(previous*settings.LodRatio);
+		if(target < settings.MinTriangleCount)
+			break;
+
+		bool stalled = false;
+		while(collapser.Triangles().size() / 3 > target)
+		{
+			if(!collapser.Pass(target))
+			{
+				stalled = true;
+				break;
+			}
+		}
+
+		// Not worth another level if the mesh barely got smaller.
+		std::vector<uint32> level = collapser.Triangles();
+		if(level.size() / 3 > previous - previous / 8)
+			break;
+
+		MeshOptimizer::OptimizeVertexCache(level.data(), (uint32)level.size(), vertexCount);
+		levels.push_back(level);
+		errors.push_back(collapser.MaxError()*scale);
+
+		if(stalled)
+			break;
+	}
+}
+
+float MeshSimplifier::ProjectedSize(const Camera& camera, FXMVECTOR centerW, float radiusW)
+{
+	float depth = XMVectorGetX(XMVector3Dot(centerW - camera.GetPosition(), camera.GetLook()));
+	if(depth <= radiusW)
+		return MathHelper::Infinity;
+
+	// The projection maps a view space height of depth/cotHalfFovY to the full viewport
+	// height of 2 NDC units, so the diameter covers this fraction of it.
+	float cotHalfFovY = 1.0f / tanf(0.5f*camera.GetFovY());
+	return radiusW*cotHalfFovY / depth;
+}
+
+MeshSimplifier::uint32 MeshSimplifier::SelectLod(const Lod* lods, uint32 lodCount, float projectedSize,
+	float radius, float viewportHeight, float maxPixelError)
+{
+	if(lodCount == 0 || radius <= 0.0f)
+		return 0;
+
+	float pixelsPerUnit = projectedSize*viewportHeight / (2.0f*radius);
+	for(uint32 i = lodCount - 1; i > 0; --i)
+	{
+		if(lods[i].Error*pixelsPerUnit <= maxPixelError)
+			return i;
+	}
+	return 0;
+}
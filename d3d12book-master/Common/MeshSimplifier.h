@@ -0,0 +1,126 @@
+//***************************************************************************************
+// MeshSimplifier.h
+//
+// Builds a chain of levels of detail for an indexed triangle list by quadric error
+// edge collapse (Garland & Heckbert 1997).
+//
+// Collapses are half-edge collapses: a vertex is merged into one of its neighbours,
+// so every level reuses the vertex buffer of the full-detail mesh and only needs its
+// own index range.  The cost of a collapse is the quadric (plane distance) error plus
+// the difference of the normals, texture coordinates and skinning weights of the two
+// vertices, weighted by Settings.  Open borders may only slide along themselves and
+// vertices that share their position with another vertex (texture or normal seams)
+// never move, so the levels stay watertight wherever the input was.
+//
+// Each draw range (e.g. each M3D subset) is simplified on its own, so subsets keep
+// their vertex ranges and materials at every level.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <DirectXMath.h>
+#include <vector>
+
+class Camera;
+
+class MeshSimplifier
+{
+public:
+
+	using uint32 = std::uint32_t;
+
+	// Byte offsets of the attributes inside a vertex (use offsetof), -1 if absent.
+	struct VertexFormat
+	{
+		uint32 Stride = 0;
+		int PositionOffset = 0;     // XMFLOAT3
+		int NormalOffset = -1;      // XMFLOAT3
+		int TexCOffset = -1;        // XMFLOAT2
+		int BoneWeightsOffset = -1; // XMFLOAT3, the fourth weight is 1 - x - y - z as in M3D
+		int BoneIndicesOffset = -1; // BYTE[4]
+	};
+
+	struct Settings
+	{
+		// Attribute error weights relative to the geometric error of a mesh scaled
+		// to unit size.
+		float NormalWeight = 0.5f;
+		float TexCWeight = 1.0f;
+		float SkinWeight = 1.0f;
+
+		// Triangle count of each level relative to the previous one.
+		float LodRatio = 0.5f;
+
+		// Number of levels including the full-detail one.
+		uint32 MaxLodCount = 6;
+
+		// Stop once a level would have fewer triangles than this.
+		uint32 MinTriangleCount = 64;
+	};
+
+	struct Lod
+	{
+		// Range in the lodIndices array returned by BuildLodChain.
+		uint32 StartIndex = 0;
+		uint32 IndexCount = 0;
+
+		// Largest collapse error of this level, in the units of the vertex positions.
+		float Error = 0.0f;
+	};
+
+	///<summary>
+	/// Simplifies the indexCount indices, which reference the vertices
+	/// [vertexStart, vertexStart+vertexCount) of vertices.  lodIndices receives the
+	/// index ranges of all levels one after the other, starting with a copy of the input
+	/// as level 0; the indices keep the input numbering.  lods receives one entry per
+	/// level, finest first.
+	///</summary>
+	template<typename Index>
+	static void BuildLodChain(const void* vertices, uint32 vertexStart, uint32 vertexCount,
+		const VertexFormat& format, const Index* indices, uint32 indexCount, const Settings& settings,
+		std::vector<Index>& lodIndices, std::vector<Lod>& lods)
+	{
+		std::vector<uint32> localIndices(indexCount);
+		for(uint32 i = 0; i < indexCount; ++i)
+			localIndices[i] = static_cast<uint32>(indices[i]) - vertexStart;
+
+		const std::uint8_t* first = static_cast<const std::uint8_t*>(vertices) + vertexStart*format.Stride;
+
+		std::vector<std::vector<uint32>> levels;
+		std::vector<float> errors;
+		Simplify(first, vertexCount, format, localIndices, settings, levels, errors);
+
+		lodIndices.clear();
+		lods.clear();
+		for(size_t i = 0; i < levels.size(); ++i)
+		{
+			Lod lod;
+			lod.StartIndex = (uint32)lodIndices.size();
+			lod.IndexCount = (uint32)levels[i].size();
+			lod.Error = errors[i];
+			lods.push_back(lod);
+
+			for(uint32 index : levels[i])
+				lodIndices.push_back(static_cast<Index>(index + vertexStart));
+		}
+	}
+
+	///<summary>
+	/// Fraction of the viewport height covered by a bounding sphere seen through the
+	/// camera.  Returns a large value when the camera is inside the sphere.
+	///</summary>
+	static float ProjectedSize(const Camera& camera, DirectX::FXMVECTOR centerW, float radiusW);
+
+	///<summary>
+	/// Picks the coarsest level whose error covers at most maxPixelError pixels.
+	/// radius is the bounding sphere radius in the same (object) units as Lod::Error.
+	///</summary>
+	static uint32 SelectLod(const Lod* lods, uint32 lodCount, float projectedSize, float radius,
+		float viewportHeight, float maxPixelError = 1.0f);
+
+private:
+	static void Simplify(const std::uint8_t* vertices, uint32 vertexCount, const VertexFormat& format,
+		const std::vector<uint32>& indices, const Settings& settings,
+		std::vector<std::vector<uint32>>& levels, std::vector<float>& errors);
+};
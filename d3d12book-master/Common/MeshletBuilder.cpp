@@ -0,0 +1,253 @@
+//***************************************************************************************
+// MeshletBuilder.cpp
+//***************************************************************************************
+
+#include "MeshletBuilder.h"
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint8 = MeshletBuilder::uint8;
+	using uint32 = MeshletBuilder::uint32;
+
+	const uint8 NotInMeshlet = 0xff;
+
+	// Normal cones whose normals are spread wider than this (cos of the angle to the
+	// axis) are not worth testing.
+	const float MinConeDot = 0.1f;
+
+	const XMFLOAT3& Position(const XMFLOAT3* positions, uint32 stride, uint32 v)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8*>(positions) + v*stride);
+	}
+
+	void ComputeBounds(const XMFLOAT3* positions, uint32 stride, const std::vector<XMFLOAT3>& normals,
+		const MeshletBuilder::MeshletData& data, MeshletBuilder::Meshlet& meshlet)
+	{
+		std::vector<XMFLOAT3> points(meshlet.VertexCount);
+		for(uint32 i = 0; i < meshlet.VertexCount; ++i)
+			points[i] = Position(positions, stride, data.Vertices[meshlet.VertexOffset + i]);
+
+		BoundingSphere::CreateFromPoints(meshlet.Bounds, meshlet.VertexCount, points.data(), sizeof(XMFLOAT3));
+
+		XMVECTOR axis = XMVectorZero();
+		for(uint32 t = 0; t < meshlet.TriangleCount; ++t)
+			axis += XMLoadFloat3(&normals[meshlet.TriangleOffset + t]);
+
+		meshlet.ConeCutoff = 1.0f;
+		if(XMVectorGetX(XMVector3LengthSq(axis)) <= 1e-12f)
+			return;
+
+		axis = XMVector3Normalize(axis);
+		XMStoreFloat3(&meshlet.ConeAxis, axis);
+
+		float minDot = 1.0f;
+		for(uint32 t = 0; t < meshlet.TriangleCount; ++t)
+		{
+			const XMFLOAT3& n = normals[meshlet.TriangleOffset + t];
+
+			// Degenerate triangles cannot be seen from either side.
+			if(n.x == 0.0f && n.y == 0.0f && n.z == 0.0f)
+				continue;
+
+			float d = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&n), axis));
+			minDot = d < minDot ? d : minDot;
+		}
+
+		if(minDot > MinConeDot)
+			meshlet.ConeCutoff = sqrtf(1.0f - minDot*minDot);
+	}
+}
+
+void MeshletBuilder::Build(const XMFLOAT3* positions, uint32 positionStride, uint32 vertexCount,
+	const std::vector<uint32>& indices, MeshletData& meshlets, std::vector<uint32>& clusterIndices)
+{
+	meshlets.Meshlets.clear();
+	meshlets.Vertices.clear();
+	meshlets.Triangles.clear();
+	clusterIndices.clear();
+
+	uint32 triangleCount = (uint32)indices.size() / 3;
+	if(triangleCount == 0)
+		return;
+
+	// Unit face normals, zero for degenerate triangles.
+	std::vector<XMFLOAT3> faceNormals(triangleCount);
+	std::vector<XMFLOAT3> faceCentroids(triangleCount);
+	for(uint32 t = 0; t < triangleCount; ++t)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&Position(positions, positionStride, indices[t*3+0]));
+		XMVECTOR p1 = XMLoadFloat3(&Position(positions, positionStride, indices[t*3+1]));
+		XMVECTOR p2 = XMLoadFloat3(&Position(positions, positionStride, indices[t*3+2]));
+
+		XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+		float length = XMVectorGetX(XMVector3Length(n));
+		XMStoreFloat3(&faceNormals[t], length > 0.0f ? n / length : XMVectorZero());
+		XMStoreFloat3(&faceCentroids[t], (p0 + p1 + p2) / 3.0f);
+	}
+
+	// Triangles around each vertex.
+	std::vector<uint32> adjacencyOffset(vertexCount + 1, 0);
+	for(uint32 i = 0; i < triangleCount*3; ++i)
+		adjacencyOffset[indices[i] + 1]++;
+	for(uint32 v = 0; v < vertexCount; ++v)
+		adjacencyOffset[v + 1] += adjacencyOffset[v];
+
+	std::vector<uint32> adjacency(triangleCount*3);
+	std::vector<uint32> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for(uint32 i = 0; i < triangleCount*3; ++i)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	std::vector<bool> used(triangleCount, false);
+	std::vector<uint8> localIndex(vertexCount, NotInMeshlet);
+
+	// Face normals in meshlet order, for the cones.
+	std::vector<XMFLOAT3> meshletNormals;
+	meshletNormals.reserve(triangleCount);
+	clusterIndices.reserve(triangleCount*3);
+
+	uint32 cursor = 0;
+	uint32 seed = triangleCount;
+	uint32 emitted = 0;
+	while(emitted < triangleCount)
+	{
+		// Continue next to the previous meshlet if it left a neighbour unused, so the
+		// remaining triangles do not break up into small islands.
+		if(seed == triangleCount)
+		{
+			while(used[cursor])
+				cursor++;
+			seed = cursor;
+		}
+
+		Meshlet meshlet;
+		meshlet.VertexOffset = (uint32)meshlets.Vertices.size();
+		meshlet.TriangleOffset = (uint32)meshletNormals.size();
+
+		XMVECTOR normalSum = XMVectorZero();
+		XMVECTOR centroidSum = XMVectorZero();
+		uint32 next = seed;
+
+		for(;;)
+		{
+			const uint32* tri = &indices[next*3];
+			for(uint32 k = 0; k < 3; ++k)
+			{
+				uint32 v = tri[k];
+				if(localIndex[v] == NotInMeshlet)
+				{
+					localIndex[v] = (uint8)meshlet.VertexCount++;
+					meshlets.Vertices.push_back(v);
+				}
+
+				meshlets.Triangles.push_back(localIndex[v]);
+				clusterIndices.push_back(v);
+			}
+
+			used[next] = true;
+			emitted++;
+			meshlet.TriangleCount++;
+			meshletNormals.push_back(faceNormals[next]);
+			normalSum += XMLoadFloat3(&faceNormals[next]);
+			centroidSum += XMLoadFloat3(&faceCentroids[next]);
+
+			if(meshlet.TriangleCount == MaxTriangles)
+				break;
+
+			// Best unused triangle touching the meshlet: fewest new vertices first, then
+			// the one that keeps the meshlet round and flat.
+			XMVECTOR averageNormal = XMVector3Normalize(normalSum);
+			XMVECTOR centroid = centroidSum / (float)meshlet.TriangleCount;
+			uint32 bestNewVertices = 4;
+			float bestScore = FLT_MAX;
+			uint32 best = triangleCount;
+
+			for(uint32 i = meshlet.VertexOffset; i < (uint32)meshlets.Vertices.size(); ++i)
+			{
+				uint32 v = meshlets.Vertices[i];
+				for(uint32 a = adjacencyOffset[v]; a < adjacencyOffset[v + 1]; ++a)
+				{
+					uint32 t = adjacency[a];
+					if(used[t])
+						continue;
+
+					uint32 newVertices = 0;
+					for(uint32 k = 0; k < 3; ++k)
+						newVertices += localIndex[indices[t*3+k]] == NotInMeshlet ? 1 : 0;
+
+					if(meshlet.VertexCount + newVertices > MaxVertices || newVertices > bestNewVertices)
+						continue;
+
+					float distanceSq = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&faceCentroids[t]) - centroid));
+					float d = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&faceNormals[t]), averageNormal));
+					float score = distanceSq*(1.0f + 16.0f*(1.0f - d));
+					if(newVertices < bestNewVertices || score < bestScore)
+					{
+						bestNewVertices = newVertices;
+						bestScore = score;
+						best = t;
+					}
+				}
+			}
+
+			if(best == triangleCount)
+				break;
+
+			next = best;
+		}
+
+		seed = triangleCount;
+		for(uint32 i = meshlet.VertexOffset; i < (uint32)meshlets.Vertices.size(); ++i)
+		{
+			uint32 v = meshlets.Vertices[i];
+			localIndex[v] = NotInMeshlet;
+
+			for(uint32 a = adjacencyOffset[v]; a < adjacencyOffset[v + 1] && seed == triangleCount; ++a)
+			{
+				if(!used[adjacency[a]])
+					seed = adjacency[a];
+			}
+		}
+
+		ComputeBounds(positions, positionStride, meshletNormals, meshlets, meshlet);
+		meshlets.Meshlets.push_back(meshlet);
+	}
+}
+
+MeshletBuilder::uint32 MeshletBuilder::Cull(const MeshletData& meshlets, const BoundingFrustum& frustumL,
+	FXMVECTOR eyeL, std::vector<IndexRange>& ranges)
+{
+	ranges.clear();
+
+	uint32 visibleTriangles = 0;
+	for(const Meshlet& m : meshlets.Meshlets)
+	{
+		if(frustumL.Contains(m.Bounds) == DirectX::DISJOINT)
+			continue;
+
+		XMVECTOR toCenter = XMLoadFloat3(&m.Bounds.Center) - eyeL;
+		float along = XMVectorGetX(XMVector3Dot(toCenter, XMLoadFloat3(&m.ConeAxis)));
+		float distance = XMVectorGetX(XMVector3Length(toCenter));
+		if(along >= m.ConeCutoff*distance + m.Bounds.Radius)
+			continue;
+
+		uint32 start = m.TriangleOffset*3;
+		uint32 count = m.TriangleCount*3;
+		if(!ranges.empty() && ranges.back().StartIndex + ranges.back().IndexCount == start)
+			ranges.back().IndexCount += count;
+		else
+		{
+			IndexRange range;
+			range.StartIndex = start;
+			range.IndexCount = count;
+			ranges.push_back(range);
+		}
+
+		visibleTriangles += m.TriangleCount;
+	}
+
+	return visibleTriangles;
+}
@@ -0,0 +1,106 @@
+//***************************************************************************************
+// MeshletBuilder.h
+//
+// Splits an indexed triangle list into meshlets of at most 64 vertices and 124
+// triangles, each with a bounding sphere and a normal cone, and culls them on the CPU.
+//
+// The builder grows each meshlet greedily from a seed triangle, always adding the
+// connected triangle that brings in the fewest new vertices and, among those, the one
+// whose normal is closest to the meshlet's average.  That keeps meshlets compact and
+// their normal cones narrow.
+//
+// Besides the usual meshlet data (a vertex list and three local 8-bit indices per
+// triangle, as a mesh shader would read them), Build returns the index list reordered
+// so that every meshlet's triangles are contiguous.  Cull then turns the meshlets that
+// survive frustum and backface cone tests into a few index ranges of that list, which
+// can be drawn with ordinary DrawIndexedInstanced calls.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+
+class MeshletBuilder
+{
+public:
+
+	using uint8 = std::uint8_t;
+	using uint32 = std::uint32_t;
+
+	static const uint32 MaxVertices = 64;
+	static const uint32 MaxTriangles = 124;
+
+	struct Meshlet
+	{
+		// Range in MeshletData::Vertices.
+		uint32 VertexOffset = 0;
+		uint32 VertexCount = 0;
+
+		// Range in triangles: MeshletData::Triangles holds 3 entries per triangle, as
+		// does the reordered index list, so the index range is 3x this one.
+		uint32 TriangleOffset = 0;
+		uint32 TriangleCount = 0;
+
+		DirectX::BoundingSphere Bounds;
+
+		// All triangles face away from the viewer when the direction from the eye to
+		// the sphere centre is within the cone around ConeAxis given by ConeCutoff (the
+		// sine of the spread of the normals).  ConeCutoff is 1 if the normals spread too
+		// far for the test to ever succeed.
+		DirectX::XMFLOAT3 ConeAxis = { 0.0f, 0.0f, 0.0f };
+		float ConeCutoff = 1.0f;
+	};
+
+	struct MeshletData
+	{
+		std::vector<Meshlet> Meshlets;
+
+		// Mesh vertex index of every meshlet vertex.
+		std::vector<uint32> Vertices;
+
+		// Three meshlet-local vertex numbers per triangle.
+		std::vector<uint8> Triangles;
+	};
+
+	struct IndexRange
+	{
+		uint32 StartIndex = 0;
+		uint32 IndexCount = 0;
+	};
+
+	///<summary>
+	/// Builds the meshlets of indexCount indices and writes the indices reordered by
+	/// meshlet to clusterIndices.  Triangle i of the reordered list is triangle i of
+	/// the meshlets, so per-triangle data (e.g. a BVH for picking) should be built from
+	/// clusterIndices.  To keep an M3D subset in place, pass the subset's index range
+	/// and copy clusterIndices back over it.
+	///</summary>
+	template<typename Index>
+	static void Build(const DirectX::XMFLOAT3* positions, uint32 positionStride, uint32 vertexCount,
+		const Index* indices, uint32 indexCount, MeshletData& meshlets, std::vector<Index>& clusterIndices)
+	{
+		std::vector<uint32> indices32(indices, indices + indexCount);
+		std::vector<uint32> reordered;
+		Build(positions, positionStride, vertexCount, indices32, meshlets, reordered);
+
+		clusterIndices.resize(reordered.size());
+		for(size_t i = 0; i < reordered.size(); ++i)
+			clusterIndices[i] = static_cast<Index>(reordered[i]);
+	}
+
+	///<summary>
+	/// Replaces ranges with the index ranges (relative to the start of clusterIndices)
+	/// of the meshlets that may be visible.  Neighbouring visible meshlets share a range.
+	/// frustumL and eyeL are in the mesh's local space, which must not be scaled
+	/// non-uniformly for the cone test to hold.  Returns the visible triangle count.
+	///</summary>
+	static uint32 Cull(const MeshletData& meshlets, const DirectX::BoundingFrustum& frustumL,
+		DirectX::FXMVECTOR eyeL, std::vector<IndexRange>& ranges);
+
+private:
+	static void Build(const DirectX::XMFLOAT3* positions, uint32 positionStride, uint32 vertexCount,
+		const std::vector<uint32>& indices, MeshletData& meshlets, std::vector<uint32>& clusterIndices);
+};
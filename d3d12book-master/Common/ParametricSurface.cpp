@@ -0,0 +1,183 @@
+//***************************************************************************************
+// ParametricSurface.cpp
+//***************************************************************************************
+
+#include "ParametricSurface.h"
+#include "MathHelper.h"
+#include <atomic>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = ParametricSurface::uint32;
+
+	// Rows handed to a worker at a time.  Central differences evaluate one extra row on
+	// either side of each band, so this keeps their overhead small.
+	const uint32 RowsPerTask = 64;
+
+	class MeshDataVertexSink : public GeometryGenerator::VertexSink
+	{
+	public:
+		explicit MeshDataVertexSink(GeometryGenerator::Vertex* vertices) : mVertices(vertices) {}
+
+		void Write(uint32 index, const GeometryGenerator::Vertex& v) override
+		{
+			mVertices[index] = v;
+		}
+
+	private:
+		GeometryGenerator::Vertex* mVertices;
+	};
+
+	// Normalizes three SoA vectors; zero vectors stay zero.
+	void Normalize3(XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+	{
+		XMVECTOR lengthSq = XMVectorMultiplyAdd(x, x, XMVectorMultiplyAdd(y, y, XMVectorMultiply(z, z)));
+		XMVECTOR invLength = XMVectorReciprocal(XMVectorSqrt(XMVectorMax(lengthSq, XMVectorReplicate(1e-30f))));
+		x = XMVectorMultiply(x, invLength);
+		y = XMVectorMultiply(y, invLength);
+		z = XMVectorMultiply(z, invLength);
+	}
+}
+
+void ParametricSurface::RowSamples::Resize(uint32 n)
+{
+	// n + 2 samples, rounded up to whole batches of 4.
+	uint32 size = (n + 2 + 3) & ~3u;
+	X.resize(size);
+	Y.resize(size);
+	Z.resize(size);
+}
+
+ParametricSurface::Domain ParametricSurface::HeightFieldDomain(float width, float depth, uint32 m, uint32 n)
+{
+	Domain domain;
+	domain.U0 = -0.5f*width;
+	domain.U1 = +0.5f*width;
+	domain.V0 = +0.5f*depth;
+	domain.V1 = -0.5f*depth;
+	domain.M = m;
+	domain.N = n;
+
+	return domain;
+}
+
+GeometryGenerator::MeshSize ParametricSurface::GetSize(const Domain& domain)
+{
+	GeometryGenerator::MeshSize size;
+	size.VertexCount = domain.M*domain.N;
+	size.IndexCount = (domain.M - 1)*(domain.N - 1)*6;
+
+	return size;
+}
+
+GeometryGenerator::MeshData ParametricSurface::CreateMeshData(const Domain& domain, const SinkRowBand& band)
+{
+	GeometryGenerator::MeshSize size = GetSize(domain);
+
+	GeometryGenerator::MeshData meshData;
+	meshData.Vertices.resize(size.VertexCount);
+	meshData.Indices32.resize(size.IndexCount);
+
+	MeshDataVertexSink sink(meshData.Vertices.data());
+	Generate(domain, [&](uint32 first, uint32 last)
+	{
+		band(first, last, sink);
+	}, GeometryGenerator::IndexSink(meshData.Indices32.MutableData()));
+
+	return meshData;
+}
+
+void ParametricSurface::Generate(const Domain& domain, const RowBand& band, GeometryGenerator::IndexSink indices)
+{
+	assert(domain.M >= 2 && domain.N >= 2);
+
+	uint32 m = domain.M;
+	uint32 n = domain.N;
+
+	std::atomic<uint32> nextTask(0);
+	uint32 taskCount = (m + RowsPerTask - 1) / RowsPerTask;
+
+	// Each task writes the vertices of its rows and the quads below them, so the
+	// workers never touch the same entries.
+	auto worker = [&]()
+	{
+		for(uint32 task = nextTask++; task < taskCount; task = nextTask++)
+		{
+			uint32 first = task*RowsPerTask;
+			uint32 last = MathHelper::Min(m, first + RowsPerTask);
+
+			band(first, last);
+
+			uint32 k = first*(n - 1)*6;
+			for(uint32 i = first; i < MathHelper::Min(last, m - 1); ++i)
+			{
+				for(uint32 j = 0; j < n - 1; ++j)
+				{
+					indices.Write(k++, i*n + j);
+					indices.Write(k++, i*n + j + 1);
+					indices.Write(k++, (i + 1)*n + j);
+
+					indices.Write(k++, (i + 1)*n + j);
+					indices.Write(k++, i*n + j + 1);
+					indices.Write(k++, (i + 1)*n + j + 1);
+				}
+			}
+		}
+	};
+
+	uint32 threadCount = domain.ThreadCount;
+	if(threadCount == 0)
+		threadCount = MathHelper::Max(1u, std::thread::hardware_concurrency());
+	threadCount = MathHelper::Min(threadCount, taskCount);
+
+	std::vector<std::thread> threads;
+	for(uint32 i = 1; i < threadCount; ++i)
+		threads.push_back(std::thread(worker));
+	worker();
+	for(size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+}
+
+void ParametricSurface::WriteVertices(const Domain& domain, uint32 i, uint32 j,
+	const XMVECTOR p[3], const XMVECTOR dPdj[3], const XMVECTOR dPdi[3],
+	GeometryGenerator::VertexSink& vertices)
+{
+	// n = dP/dj x dP/di
+	XMVECTOR nx = XMVectorSubtract(XMVectorMultiply(dPdj[1], dPdi[2]), XMVectorMultiply(dPdj[2], dPdi[1]));
+	XMVECTOR ny = XMVectorSubtract(XMVectorMultiply(dPdj[2], dPdi[0]), XMVectorMultiply(dPdj[0], dPdi[2]));
+	XMVECTOR nz = XMVectorSubtract(XMVectorMultiply(dPdj[0], dPdi[1]), XMVectorMultiply(dPdj[1], dPdi[0]));
+	Normalize3(nx, ny, nz);
+
+	XMVECTOR tx = dPdj[0];
+	XMVECTOR ty = dPdj[1];
+	XMVECTOR tz = dPdj[2];
+	Normalize3(tx, ty, tz);
+
+	XMFLOAT4 px, py, pz, nxs, nys, nzs, txs, tys, tzs;
+	XMStoreFloat4(&px, p[0]);
+	XMStoreFloat4(&py, p[1]);
+	XMStoreFloat4(&pz, p[2]);
+	XMStoreFloat4(&nxs, nx);
+	XMStoreFloat4(&nys, ny);
+	XMStoreFloat4(&nzs, nz);
+	XMStoreFloat4(&txs, tx);
+	XMStoreFloat4(&tys, ty);
+	XMStoreFloat4(&tzs, tz);
+
+	float du = 1.0f / (domain.N - 1);
+	float dv = 1.0f / (domain.M - 1);
+	uint32 count = MathHelper::Min(4u, domain.N - j);
+	for(uint32 k = 0; k < count; ++k)
+	{
+		GeometryGenerator::Vertex v;
+		v.Position = XMFLOAT3((&px.x)[k], (&py.x)[k], (&pz.x)[k]);
+		v.Normal = XMFLOAT3((&nxs.x)[k], (&nys.x)[k], (&nzs.x)[k]);
+		v.TangentU = XMFLOAT3((&txs.x)[k], (&tys.x)[k], (&tzs.x)[k]);
+		v.TexC = XMFLOAT2((j + k)*du, i*dv);
+
+		vertices.Write(i*domain.N + j + k, v);
+	}
+}
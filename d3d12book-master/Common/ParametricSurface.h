@@ -0,0 +1,291 @@
+//***************************************************************************************
+// ParametricSurface.h
+//
+// Tessellates a parametric surface P(u,v), or a height field y = h(x,z), into a grid
+// mesh laid out like GeometryGenerator::CreateGrid.
+//
+// The surface is evaluated four samples at a time: functors receive u and v as
+// XMVECTORs and return x, y and z the same way, so they can use XMVectorSin/XMVectorCos
+// and friends instead of scalar sinf/cosf.  Normals and tangents are computed in the
+// same pass, either from analytic partial derivatives supplied by the caller or from
+// central differences of the neighbouring samples.  Bands of rows are built on worker
+// threads.
+//
+// Central differences also sample one step beyond each edge of the domain, so the
+// functor must be defined there.  In return the edge normals are as accurate as the
+// inner ones and match those of an adjacent patch of the same surface.
+//
+// Functor signatures (all lanes are independent samples):
+//
+//   Surface:  void operator()(FXMVECTOR u, FXMVECTOR v, XMVECTOR& x, XMVECTOR& y, XMVECTOR& z) const;
+//   Partials: void operator()(FXMVECTOR u, FXMVECTOR v, XMVECTOR dPdu[3], XMVECTOR dPdv[3]) const;
+//   Height:   XMVECTOR operator()(FXMVECTOR x, FXMVECTOR z) const;
+//   Gradient: void operator()(FXMVECTOR x, FXMVECTOR z, XMVECTOR& dhdx, XMVECTOR& dhdz) const;
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <functional>
+
+class ParametricSurface
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+
+	// Vertex (i, j) sits at u = U0 + j*(U1-U0)/(N-1), v = V0 + i*(V1-V0)/(M-1) and gets
+	// the texture coordinates (j/(N-1), i/(M-1)).  Triangles are wound so that the front
+	// face points along dP/dj x dP/di, i.e. up for CreateGrid's layout.
+	struct Domain
+	{
+		float U0 = 0.0f;
+		float U1 = 1.0f;
+		float V0 = 0.0f;
+		float V1 = 1.0f;
+
+		uint32 M = 2; // rows, along v
+		uint32 N = 2; // columns, along u
+
+		// 0 uses one thread per hardware thread.
+		uint32 ThreadCount = 0;
+	};
+
+	///<summary>
+	/// Domain of a height field over the xz-plane with the same vertices as
+	/// CreateGrid(width, depth, m, n): u is x and v is z.
+	///</summary>
+	static Domain HeightFieldDomain(float width, float depth, uint32 m, uint32 n);
+
+	static GeometryGenerator::MeshSize GetSize(const Domain& domain);
+
+	///<summary>
+	/// Builds the surface with normals and tangents from central differences.
+	///</summary>
+	template<typename Surface>
+	static GeometryGenerator::MeshData Create(const Domain& domain, const Surface& surface)
+	{
+		return CreateMeshData(domain, [&](uint32 first, uint32 last, GeometryGenerator::VertexSink& vertices)
+		{
+			EvaluateRows(domain, surface, static_cast<const NoPartials*>(nullptr), first, last, vertices);
+		});
+	}
+
+	///<summary>
+	/// Builds the surface with normals and tangents from the analytic partials.
+	///</summary>
+	template<typename Surface, typename Partials>
+	static GeometryGenerator::MeshData Create(const Domain& domain, const Surface& surface, const Partials& partials)
+	{
+		return CreateMeshData(domain, [&](uint32 first, uint32 last, GeometryGenerator::VertexSink& vertices)
+		{
+			EvaluateRows(domain, surface, &partials, first, last, vertices);
+		});
+	}
+
+	///<summary>
+	/// Same as above, but each vertex is encoded with Layout and written straight into
+	/// the caller's buffers (see GeometryGenerator's Layout overloads), which must hold
+	/// GetSize(domain) vertices and indices.
+	///</summary>
+	template<typename Layout, typename Index, typename Surface>
+	static void Create(const Domain& domain, const Surface& surface,
+		typename Layout::Vertex* vertices, Index* indices)
+	{
+		GeometryGenerator::LayoutVertexSink<Layout> sink(vertices);
+		Generate(domain, [&](uint32 first, uint32 last)
+		{
+			EvaluateRows(domain, surface, static_cast<const NoPartials*>(nullptr), first, last, sink);
+		}, GeometryGenerator::IndexSink(indices));
+	}
+
+	template<typename Layout, typename Index, typename Surface, typename Partials>
+	static void Create(const Domain& domain, const Surface& surface, const Partials& partials,
+		typename Layout::Vertex* vertices, Index* indices)
+	{
+		GeometryGenerator::LayoutVertexSink<Layout> sink(vertices);
+		Generate(domain, [&](uint32 first, uint32 last)
+		{
+			EvaluateRows(domain, surface, &partials, first, last, sink);
+		}, GeometryGenerator::IndexSink(indices));
+	}
+
+	///<summary>
+	/// Writes only the vertices (central difference normals), on the calling thread.
+	/// For callers that share one index buffer between many patches, such as terrain
+	/// chunks built on their own worker threads.
+	///</summary>
+	template<typename Surface>
+	static void CreateVertices(const Domain& domain, const Surface& surface, GeometryGenerator::VertexSink& vertices)
+	{
+		EvaluateRows(domain, surface, static_cast<const NoPartials*>(nullptr), 0, domain.M, vertices);
+	}
+
+	// Adapts a Height functor to a Surface: P = (x, h(x,z), z).
+	template<typename Height>
+	struct HeightFieldSurface
+	{
+		explicit HeightFieldSurface(const Height& height) : H(height) {}
+
+		void operator()(DirectX::FXMVECTOR u, DirectX::FXMVECTOR v,
+			DirectX::XMVECTOR& x, DirectX::XMVECTOR& y, DirectX::XMVECTOR& z)const
+		{
+			x = u;
+			y = H(u, v);
+			z = v;
+		}
+
+		const Height& H;
+	};
+
+	// Adapts a Gradient functor to Partials: dP/dx = (1, dh/dx, 0), dP/dz = (0, dh/dz, 1).
+	template<typename Gradient>
+	struct HeightFieldPartials
+	{
+		explicit HeightFieldPartials(const Gradient& gradient) : G(gradient) {}
+
+		void operator()(DirectX::FXMVECTOR u, DirectX::FXMVECTOR v,
+			DirectX::XMVECTOR dPdu[3], DirectX::XMVECTOR dPdv[3])const
+		{
+			G(u, v, dPdu[1], dPdv[1]);
+			dPdu[0] = DirectX::XMVectorSplatOne();
+			dPdu[2] = DirectX::XMVectorZero();
+			dPdv[0] = DirectX::XMVectorZero();
+			dPdv[2] = DirectX::XMVectorSplatOne();
+		}
+
+		const Gradient& G;
+	};
+
+private:
+	// Selects the central difference overload of EvaluateRows.
+	struct NoPartials {};
+
+	// Positions of one row in SoA form, from one sample before the row to one after it:
+	// sample j is stored at j+1.
+	struct RowSamples
+	{
+		std::vector<float> X, Y, Z;
+
+		void Resize(uint32 n);
+	};
+
+	using RowBand = std::function<void(uint32 firstRow, uint32 lastRow)>;
+	using SinkRowBand = std::function<void(uint32 firstRow, uint32 lastRow, GeometryGenerator::VertexSink& vertices)>;
+
+	static GeometryGenerator::MeshData CreateMeshData(const Domain& domain, const SinkRowBand& band);
+	static void Generate(const Domain& domain, const RowBand& band, GeometryGenerator::IndexSink indices);
+
+	// Writes the vertices of samples [j, j+4) of row i, clipped to the row length.
+	static void WriteVertices(const Domain& domain, uint32 i, uint32 j,
+		const DirectX::XMVECTOR p[3], const DirectX::XMVECTOR dPdj[3], const DirectX::XMVECTOR dPdi[3],
+		GeometryGenerator::VertexSink& vertices);
+
+	// Evaluates row i (which may be -1 or M) including the samples at j = -1 and j = N.
+	template<typename Surface>
+	static void EvaluateRow(const Domain& domain, const Surface& surface, int i, RowSamples& row)
+	{
+		using namespace DirectX;
+
+		float du = (domain.U1 - domain.U0) / (domain.N - 1);
+		XMVECTOR v = XMVectorReplicate(domain.V0 + i*(domain.V1 - domain.V0) / (domain.M - 1));
+		XMVECTOR lane = XMVectorSet(-1.0f, 0.0f, 1.0f, 2.0f);
+
+		for(uint32 k = 0; k < domain.N + 2; k += 4)
+		{
+			XMVECTOR u = XMVectorMultiplyAdd(XMVectorAdd(XMVectorReplicate((float)k), lane),
+				XMVectorReplicate(du), XMVectorReplicate(domain.U0));
+
+			XMVECTOR x, y, z;
+			surface(u, v, x, y, z);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&row.X[k]), x);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&row.Y[k]), y);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&row.Z[k]), z);
+		}
+	}
+
+	// Central differences: dP/dj from the samples on either side in the row, dP/di
+	// from the rows above and below.
+	template<typename Surface>
+	static void EvaluateRows(const Domain& domain, const Surface& surface, const NoPartials*,
+		uint32 firstRow, uint32 lastRow, GeometryGenerator::VertexSink& vertices)
+	{
+		using namespace DirectX;
+
+		RowSamples rows[3];
+		for(RowSamples& row : rows)
+			row.Resize(domain.N);
+
+		RowSamples* prev = &rows[0];
+		RowSamples* curr = &rows[1];
+		RowSamples* next = &rows[2];
+
+		EvaluateRow(domain, surface, (int)firstRow - 1, *prev);
+		EvaluateRow(domain, surface, (int)firstRow, *curr);
+
+		for(uint32 i = firstRow; i < lastRow; ++i)
+		{
+			EvaluateRow(domain, surface, (int)i + 1, *next);
+
+			for(uint32 j = 0; j < domain.N; j += 4)
+			{
+				const float* c[3] = { &curr->X[j + 1], &curr->Y[j + 1], &curr->Z[j + 1] };
+				const float* a[3] = { &prev->X[j + 1], &prev->Y[j + 1], &prev->Z[j + 1] };
+				const float* b[3] = { &next->X[j + 1], &next->Y[j + 1], &next->Z[j + 1] };
+
+				XMVECTOR p[3], dPdj[3], dPdi[3];
+				for(int k = 0; k < 3; ++k)
+				{
+					p[k] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(c[k]));
+					dPdj[k] = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(c[k] + 1)),
+						XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(c[k] - 1)));
+					dPdi[k] = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(b[k])),
+						XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(a[k])));
+				}
+
+				WriteVertices(domain, i, j, p, dPdj, dPdi, vertices);
+			}
+
+			RowSamples* recycled = prev;
+			prev = curr;
+			curr = next;
+			next = recycled;
+		}
+	}
+
+	template<typename Surface, typename Partials>
+	static void EvaluateRows(const Domain& domain, const Surface& surface, const Partials* partials,
+		uint32 firstRow, uint32 lastRow, GeometryGenerator::VertexSink& vertices)
+	{
+		using namespace DirectX;
+
+		// Scale the partials by the sample spacing so they point along +j and +i even
+		// when the domain runs backwards (as z does in a height field).
+		float du = (domain.U1 - domain.U0) / (domain.N - 1);
+		float dv = (domain.V1 - domain.V0) / (domain.M - 1);
+		XMVECTOR lane = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+
+		for(uint32 i = firstRow; i < lastRow; ++i)
+		{
+			XMVECTOR v = XMVectorReplicate(domain.V0 + i*dv);
+
+			for(uint32 j = 0; j < domain.N; j += 4)
+			{
+				XMVECTOR u = XMVectorMultiplyAdd(XMVectorAdd(XMVectorReplicate((float)j), lane),
+					XMVectorReplicate(du), XMVectorReplicate(domain.U0));
+
+				XMVECTOR p[3], dPdu[3], dPdv[3];
+				surface(u, v, p[0], p[1], p[2]);
+				(*partials)(u, v, dPdu, dPdv);
+
+				for(int k = 0; k < 3; ++k)
+				{
+					dPdu[k] = XMVectorScale(dPdu[k], du);
+					dPdv[k] = XMVectorScale(dPdv[k], dv);
+				}
+
+				WriteVertices(domain, i, j, p, dPdu, dPdv, vertices);
+			}
+		}
+	}
+};
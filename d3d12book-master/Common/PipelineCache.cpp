@@ -0,0 +1,272 @@
+//***************************************************************************************
+// PipelineCache.cpp
+//***************************************************************************************
+
+#include "PipelineCache.h"
+#include "ContentHash.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	void HashShader(ContentHash& hash, const D3D12_SHADER_BYTECODE& shader)
+	{
+		hash.AddArray(shader.pShaderBytecode, shader.BytecodeLength);
+	}
+
+	void HashString(ContentHash& hash, const char* s)
+	{
+		hash.AddString(s != nullptr ? s : "");
+	}
+
+	void HashStreamOutput(ContentHash& hash, const D3D12_STREAM_OUTPUT_DESC& so)
+	{
+		hash.AddValue(so.NumEntries);
+		for(UINT i = 0; i < so.NumEntries; ++i)
+		{
+			const D3D12_SO_DECLARATION_ENTRY& entry = so.pSODeclaration[i];
+			hash.AddValue(entry.Stream);
+			HashString(hash, entry.SemanticName);
+			hash.AddValue(entry.SemanticIndex);
+			hash.AddValue(entry.StartComponent);
+			hash.AddValue(entry.ComponentCount);
+			hash.AddValue(entry.OutputSlot);
+		}
+
+		hash.AddArray(so.pBufferStrides, so.NumStrides*sizeof(UINT));
+		hash.AddValue(so.RasterizedStream);
+	}
+
+	void HashBlend(ContentHash& hash, const D3D12_BLEND_DESC& blend)
+	{
+		hash.AddValue(blend.AlphaToCoverageEnable);
+		hash.AddValue(blend.IndependentBlendEnable);
+		for(UINT i = 0; i < 8; ++i)
+		{
+			const D3D12_RENDER_TARGET_BLEND_DESC& rt = blend.RenderTarget[i];
+			hash.AddValue(rt.BlendEnable);
+			hash.AddValue(rt.LogicOpEnable);
+			hash.AddValue(rt.SrcBlend);
+			hash.AddValue(rt.DestBlend);
+			hash.AddValue(rt.BlendOp);
+			hash.AddValue(rt.SrcBlendAlpha);
+			hash.AddValue(rt.DestBlendAlpha);
+			hash.AddValue(rt.BlendOpAlpha);
+			hash.AddValue(rt.LogicOp);
+			hash.AddValue(rt.RenderTargetWriteMask);
+		}
+	}
+
+	void HashDepthStencil(ContentHash& hash, const D3D12_DEPTH_STENCIL_DESC& ds)
+	{
+		hash.AddValue(ds.DepthEnable);
+		hash.AddValue(ds.DepthWriteMask);
+		hash.AddValue(ds.DepthFunc);
+		hash.AddValue(ds.StencilEnable);
+		hash.AddValue(ds.StencilReadMask);
+		hash.AddValue(ds.StencilWriteMask);
+
+		// D3D12_DEPTH_STENCILOP_DESC is four enums, without padding.
+		hash.AddValue(ds.FrontFace);
+		hash.AddValue(ds.BackFace);
+	}
+
+	void HashInputLayout(ContentHash& hash, const D3D12_INPUT_LAYOUT_DESC& layout)
+	{
+		hash.AddValue(layout.NumElements);
+		for(UINT i = 0; i < layout.NumElements; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = layout.pInputElementDescs[i];
+			HashString(hash, element.SemanticName);
+			hash.AddValue(element.SemanticIndex);
+			hash.AddValue(element.Format);
+			hash.AddValue(element.InputSlot);
+			hash.AddValue(element.AlignedByteOffset);
+			hash.AddValue(element.InputSlotClass);
+			hash.AddValue(element.InstanceDataStepRate);
+		}
+	}
+}
+
+PipelineCache::PipelineCache(ID3D12Device* device, BlobCache* diskCache)
+	: md3dDevice(device), mDiskCache(diskCache)
+{
+}
+
+void PipelineCache::AddRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serialized)
+{
+	mRootSignatureKeys[rootSignature] = ContentHash::Of(serialized->GetBufferPointer(), serialized->GetBufferSize());
+}
+
+void PipelineCache::Add(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	Pipeline& pipeline = mPipelines[name];
+	pipeline.Desc = desc;
+	pipeline.Key = 0;
+	pipeline.State = nullptr;
+
+	mPending.push_back(name);
+}
+
+PipelineCache::Stats PipelineCache::Build(JobSystem& jobs)
+{
+	Stats stats;
+	stats.PipelineCount = (UINT)mPending.size();
+
+	// Hashing is cheap next to creating a PSO, so key them on this thread.
+	std::vector<UINT64> keys(mPending.size());
+	std::vector<Creation> creations;
+	std::unordered_map<UINT64, size_t> keysSeen;
+	for(size_t i = 0; i < mPending.size(); ++i)
+	{
+		const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc = mPipelines.at(mPending[i]).Desc;
+		keys[i] = MakeKey(desc);
+
+		if(keysSeen.count(keys[i]) != 0)
+			continue;
+
+		keysSeen[keys[i]] = i;
+		stats.UniqueCount++;
+
+		if(mStates.count(keys[i]) != 0)
+		{
+			stats.MemoryHitCount++;
+			continue;
+		}
+
+		Creation creation;
+		creation.Key = keys[i];
+		creation.Desc = desc;
+		creations.push_back(creation);
+	}
+
+	JobSystem::Group group;
+	for(size_t i = 0; i < creations.size(); ++i)
+	{
+		jobs.Submit(group, [this, &creations, i](std::uint32_t)
+		{
+			Create(creations[i]);
+		});
+	}
+	jobs.Wait(group);
+
+	for(auto& creation : creations)
+	{
+		mStates[creation.Key] = creation.State;
+
+		if(creation.FromDisk)
+			stats.DiskHitCount++;
+		else
+			stats.CreateCount++;
+
+		if(creation.DiskRejected)
+			stats.DiskRejectCount++;
+	}
+
+	for(size_t i = 0; i < mPending.size(); ++i)
+	{
+		Pipeline& pipeline = mPipelines.at(mPending[i]);
+		pipeline.Key = keys[i];
+		pipeline.State = mStates.at(keys[i]);
+	}
+
+	mPending.clear();
+
+	mStats = stats;
+	return stats;
+}
+
+bool PipelineCache::Contains(const std::string& name)const
+{
+	auto it = mPipelines.find(name);
+	return it != mPipelines.end() && it->second.State != nullptr;
+}
+
+ID3D12PipelineState* PipelineCache::Get(const std::string& name)const
+{
+	assert(Contains(name));
+	return mPipelines.at(name).State.Get();
+}
+
+UINT64 PipelineCache::GetKey(const std::string& name)const
+{
+	assert(Contains(name));
+	return mPipelines.at(name).Key;
+}
+
+const PipelineCache::Stats& PipelineCache::GetStats()const
+{
+	return mStats;
+}
+
+UINT64 PipelineCache::MakeKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)const
+{
+	UINT64 rootSignatureKey = 0;
+	if(desc.pRootSignature != nullptr)
+	{
+		assert(mRootSignatureKeys.count(desc.pRootSignature) != 0);
+		rootSignatureKey = mRootSignatureKeys.at(desc.pRootSignature);
+	}
+
+	// CachedPSO is left out: it is how the PSO gets made, not what it is.
+	ContentHash hash;
+	hash.AddValue(rootSignatureKey);
+	HashShader(hash, desc.VS);
+	HashShader(hash, desc.PS);
+	HashShader(hash, desc.DS);
+	HashShader(hash, desc.HS);
+	HashShader(hash, desc.GS);
+	HashStreamOutput(hash, desc.StreamOutput);
+	HashBlend(hash, desc.BlendState);
+	hash.AddValue(desc.SampleMask);
+
+	// D3D12_RASTERIZER_DESC is all 4 byte members, without padding.
+	hash.AddValue(desc.RasterizerState);
+
+	HashDepthStencil(hash, desc.DepthStencilState);
+	HashInputLayout(hash, desc.InputLayout);
+	hash.AddValue(desc.IBStripCutValue);
+	hash.AddValue(desc.PrimitiveTopologyType);
+	hash.AddValue(desc.NumRenderTargets);
+	for(UINT i = 0; i < 8; ++i)
+		hash.AddValue(desc.RTVFormats[i]);
+	hash.AddValue(desc.DSVFormat);
+	hash.AddValue(desc.SampleDesc.Count);
+	hash.AddValue(desc.SampleDesc.Quality);
+	hash.AddValue(desc.NodeMask);
+	hash.AddValue(desc.Flags);
+	return hash.Get();
+}
+
+void PipelineCache::Create(Creation& creation)
+{
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = creation.Desc;
+
+	BlobCache::Blob cachedBlob;
+	if(mDiskCache != nullptr && mDiskCache->Load(creation.Key, cachedBlob))
+	{
+		desc.CachedPSO.pCachedBlob = cachedBlob.data();
+		desc.CachedPSO.CachedBlobSizeInBytes = cachedBlob.size();
+
+		// Fails with D3D12_ERROR_DRIVER_VERSION_MISMATCH or D3D12_ERROR_ADAPTER_NOT_FOUND
+		// when the blob was made by another driver or adapter.
+		if(SUCCEEDED(md3dDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&creation.State))))
+		{
+			creation.FromDisk = true;
+			return;
+		}
+
+		creation.DiskRejected = true;
+	}
+
+	desc.CachedPSO.pCachedBlob = nullptr;
+	desc.CachedPSO.CachedBlobSizeInBytes = 0;
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&creation.State)));
+
+	ComPtr<ID3DBlob> blob;
+	if(mDiskCache != nullptr && SUCCEEDED(creation.State->GetCachedBlob(&blob)))
+	{
+		const std::uint8_t* data = (const std::uint8_t*)blob->GetBufferPointer();
+		mDiskCache->Store(creation.Key, BlobCache::Blob(data, data + blob->GetBufferSize()));
+	}
+}
@@ -0,0 +1,110 @@
+//***************************************************************************************
+// PipelineCache.h
+//
+// Creates an app's graphics pipeline states on the JobSystem and keeps them by name.
+// PSO descriptions are added where BuildPSOs used to call CreateGraphicsPipelineState,
+// then Build creates them all in parallel.
+//
+// Each PSO is keyed by a canonical hash of its description: every member is hashed by
+// value, following the pointers to the shader bytecode, the input layout and the stream
+// output declaration, so the key does not depend on where any of it lives or on the
+// padding between members.  The root signature is hashed by its serialized blob, given
+// to AddRootSignature, so keys are the same from run to run.
+//
+//  - Descriptions with the same key share one PSO, within a Build and across Builds.
+//  - With a BlobCache, the driver's cached blob (GetCachedBlob) of each PSO is stored
+//    under its key, and a later run creates the PSO from it, skipping the driver's
+//    compile.  A blob the driver rejects, after a driver update or on another adapter,
+//    is replaced by a fresh one.
+//
+// The pointers in an added description must stay valid until Build returns.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "BlobCache.h"
+#include "JobSystem.h"
+
+class PipelineCache
+{
+public:
+	struct Stats
+	{
+		// PSOs created by the last Build, and how many different keys they had.
+		UINT PipelineCount = 0;
+		UINT UniqueCount = 0;
+
+		// Where the unique ones came from.
+		UINT MemoryHitCount = 0;
+		UINT DiskHitCount = 0;
+		UINT CreateCount = 0;
+
+		// Cached blobs the driver would not take.
+		UINT DiskRejectCount = 0;
+	};
+
+	///<summary>
+	/// diskCache may be null, to keep the PSOs in memory only.
+	///</summary>
+	PipelineCache(ID3D12Device* device, BlobCache* diskCache);
+	PipelineCache(const PipelineCache& rhs) = delete;
+	PipelineCache& operator=(const PipelineCache& rhs) = delete;
+
+	///<summary>
+	/// Tells the cache the serialized form of a root signature the descriptions use.
+	///</summary>
+	void AddRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serialized);
+
+	///<summary>
+	/// Adds a PSO to create on the next Build.  Adding a name again replaces it.
+	///</summary>
+	void Add(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+	///<summary>
+	/// Creates the PSOs added since the last Build.  Rethrows the first error, after
+	/// every job has finished.
+	///</summary>
+	Stats Build(JobSystem& jobs);
+
+	bool Contains(const std::string& name)const;
+	ID3D12PipelineState* Get(const std::string& name)const;
+	UINT64 GetKey(const std::string& name)const;
+
+	const Stats& GetStats()const;
+
+private:
+	struct Pipeline
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+		UINT64 Key = 0;
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> State;
+	};
+
+	// A key created by the current Build.
+	struct Creation
+	{
+		UINT64 Key = 0;
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> State;
+		bool FromDisk = false;
+		bool DiskRejected = false;
+	};
+
+	UINT64 MakeKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)const;
+	void Create(Creation& creation);
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+	BlobCache* mDiskCache = nullptr;
+
+	std::unordered_map<ID3D12RootSignature*, UINT64> mRootSignatureKeys;
+
+	std::unordered_map<std::string, Pipeline> mPipelines;
+	std::vector<std::string> mPending;
+
+	// PSO of every key created so far.
+	std::unordered_map<UINT64, Microsoft::WRL::ComPtr<ID3D12PipelineState>> mStates;
+
+	Stats mStats;
+};
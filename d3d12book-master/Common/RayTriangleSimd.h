@@ -0,0 +1,277 @@
+//***************************************************************************************
+// RayTriangleSimd.h
+//
+// SIMD Moller-Trumbore ray/triangle kernels.  Triangles are stored in SoA blocks as
+// (v0, e1 = v1-v0, e2 = v2-v0) so one ray can be tested against 4 triangles with SSE
+// (or 8 with AVX when the project is compiled with /arch:AVX), and a packet of 4 rays
+// can be tested against one triangle.
+//
+// The test is two sided and accepts hits with 0 < t < tMax and u, v, u+v in [0, 1],
+// the same rule as the scalar test it replaces.  Unused lanes of a block should be
+// left zeroed: a degenerate triangle never reports a hit.
+//
+// Only plain float arrays are used, so the header can be shared by code built on
+// DirectXMath as well as the older XNA math library.  The blocks are loaded with
+// unaligned loads: they are kept in std::vector, which does not honour their alignas
+// before C++17.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstring>
+#include <emmintrin.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace RayTriangleSimd
+{
+	// Determinants with a smaller magnitude are treated as parallel to the triangle.
+	const float DetEpsilon = 1.0e-8f;
+
+	struct alignas(16) TriangleBlock4
+	{
+		float V0x[4], V0y[4], V0z[4];
+		float E1x[4], E1y[4], E1z[4];
+		float E2x[4], E2y[4], E2z[4];
+	};
+
+	// One ray broadcast to every lane.
+	struct Ray4
+	{
+		__m128 Ox, Oy, Oz;
+		__m128 Dx, Dy, Dz;
+	};
+
+	// Four rays in SoA form, one per lane.
+	struct alignas(16) RayPacket4
+	{
+		float Ox[4], Oy[4], Oz[4];
+		float Dx[4], Dy[4], Dz[4];
+	};
+
+	inline void ClearBlock(TriangleBlock4& block)
+	{
+		std::memset(&block, 0, sizeof(block));
+	}
+
+	inline void SetTriangle(TriangleBlock4& block, int lane, const float v0[3], const float v1[3], const float v2[3])
+	{
+		block.V0x[lane] = v0[0];         block.V0y[lane] = v0[1];         block.V0z[lane] = v0[2];
+		block.E1x[lane] = v1[0] - v0[0]; block.E1y[lane] = v1[1] - v0[1]; block.E1z[lane] = v1[2] - v0[2];
+		block.E2x[lane] = v2[0] - v0[0]; block.E2y[lane] = v2[1] - v0[1]; block.E2z[lane] = v2[2] - v0[2];
+	}
+
+	inline Ray4 BroadcastRay(const float origin[3], const float dir[3])
+	{
+		Ray4 ray;
+		ray.Ox = _mm_set1_ps(origin[0]);
+		ray.Oy = _mm_set1_ps(origin[1]);
+		ray.Oz = _mm_set1_ps(origin[2]);
+		ray.Dx = _mm_set1_ps(dir[0]);
+		ray.Dy = _mm_set1_ps(dir[1]);
+		ray.Dz = _mm_set1_ps(dir[2]);
+		return ray;
+	}
+
+	// Shared lane math, one lane per ray/triangle pair.  Arguments are taken by reference
+	// because 32-bit MSVC cannot pass more than three __m128 by value.
+	inline __m128 IntersectLanes4(
+		const __m128& ox, const __m128& oy, const __m128& oz,
+		const __m128& dx, const __m128& dy, const __m128& dz,
+		const __m128& v0x, const __m128& v0y, const __m128& v0z,
+		const __m128& e1x, const __m128& e1y, const __m128& e1z,
+		const __m128& e2x, const __m128& e2y, const __m128& e2z,
+		const __m128& tMax, __m128& t, __m128& u, __m128& v)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+		// p = d x e2
+		__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+		__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+		__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+		// det = e1 . p
+		__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+		__m128 mask = _mm_cmpge_ps(_mm_and_ps(det, absMask), _mm_set1_ps(DetEpsilon));
+
+		__m128 invDet = _mm_div_ps(one, det);
+
+		// s = o - v0
+		__m128 sx = _mm_sub_ps(ox, v0x);
+		__m128 sy = _mm_sub_ps(oy, v0y);
+		__m128 sz = _mm_sub_ps(oz, v0z);
+
+		u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+		mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+
+		// q = s x e1
+		__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+		__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+		__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+		v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+		mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+
+		t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+		mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, tMax)));
+
+		return mask;
+	}
+
+	///<summary>
+	/// Tests one ray against the 4 triangles of a block.  Returns the bit mask of the
+	/// lanes that were hit; t, u and v receive the per-lane results (only meaningful
+	/// for lanes in the mask).
+	///</summary>
+	inline int IntersectRay4(const Ray4& ray, const TriangleBlock4& block, float tMax,
+		float t[4], float u[4], float v[4])
+	{
+		__m128 tt, uu, vv;
+		__m128 mask = IntersectLanes4(
+			ray.Ox, ray.Oy, ray.Oz, ray.Dx, ray.Dy, ray.Dz,
+			_mm_loadu_ps(block.V0x), _mm_loadu_ps(block.V0y), _mm_loadu_ps(block.V0z),
+			_mm_loadu_ps(block.E1x), _mm_loadu_ps(block.E1y), _mm_loadu_ps(block.E1z),
+			_mm_loadu_ps(block.E2x), _mm_loadu_ps(block.E2y), _mm_loadu_ps(block.E2z),
+			_mm_set1_ps(tMax), tt, uu, vv);
+
+		_mm_storeu_ps(t, tt);
+		_mm_storeu_ps(u, uu);
+		_mm_storeu_ps(v, vv);
+		return _mm_movemask_ps(mask);
+	}
+
+	///<summary>
+	/// Returns true if the ray hits any of the 4 triangles with 0 < t < tMax.
+	///</summary>
+	inline bool IntersectRayAny4(const Ray4& ray, const TriangleBlock4& block, float tMax)
+	{
+		__m128 tt, uu, vv;
+		__m128 mask = IntersectLanes4(
+			ray.Ox, ray.Oy, ray.Oz, ray.Dx, ray.Dy, ray.Dz,
+			_mm_loadu_ps(block.V0x), _mm_loadu_ps(block.V0y), _mm_loadu_ps(block.V0z),
+			_mm_loadu_ps(block.E1x), _mm_loadu_ps(block.E1y), _mm_loadu_ps(block.E1z),
+			_mm_loadu_ps(block.E2x), _mm_loadu_ps(block.E2y), _mm_loadu_ps(block.E2z),
+			_mm_set1_ps(tMax), tt, uu, vv);
+
+		return _mm_movemask_ps(mask) != 0;
+	}
+
+	///<summary>
+	/// Returns the lane of the nearest triangle hit with 0 < t < tMax, or -1.
+	///</summary>
+	inline int IntersectRayClosest4(const Ray4& ray, const TriangleBlock4& block, float tMax,
+		float& t, float& u, float& v)
+	{
+		float tt[4], uu[4], vv[4];
+		int mask = IntersectRay4(ray, block, tMax, tt, uu, vv);
+
+		int lane = -1;
+		for(int i = 0; i < 4; ++i)
+		{
+			if((mask & (1 << i)) && (lane < 0 || tt[i] < tt[lane]))
+				lane = i;
+		}
+
+		if(lane >= 0)
+		{
+			t = tt[lane];
+			u = uu[lane];
+			v = vv[lane];
+		}
+		return lane;
+	}
+
+	///<summary>
+	/// Tests 4 rays against one triangle given as (v0, e1, e2).  tMax holds the
+	/// per-ray limit.  Returns the bit mask of the rays that hit.
+	///</summary>
+	inline int IntersectPacket4(const RayPacket4& rays, const float v0[3], const float e1[3], const float e2[3],
+		const float tMax[4], float t[4], float u[4], float v[4])
+	{
+		__m128 tt, uu, vv;
+		__m128 mask = IntersectLanes4(
+			_mm_loadu_ps(rays.Ox), _mm_loadu_ps(rays.Oy), _mm_loadu_ps(rays.Oz),
+			_mm_loadu_ps(rays.Dx), _mm_loadu_ps(rays.Dy), _mm_loadu_ps(rays.Dz),
+			_mm_set1_ps(v0[0]), _mm_set1_ps(v0[1]), _mm_set1_ps(v0[2]),
+			_mm_set1_ps(e1[0]), _mm_set1_ps(e1[1]), _mm_set1_ps(e1[2]),
+			_mm_set1_ps(e2[0]), _mm_set1_ps(e2[1]), _mm_set1_ps(e2[2]),
+			_mm_loadu_ps(tMax), tt, uu, vv);
+
+		_mm_storeu_ps(t, tt);
+		_mm_storeu_ps(u, uu);
+		_mm_storeu_ps(v, vv);
+		return _mm_movemask_ps(mask);
+	}
+
+#if defined(__AVX__)
+	struct alignas(32) TriangleBlock8
+	{
+		float V0x[8], V0y[8], V0z[8];
+		float E1x[8], E1y[8], E1z[8];
+		float E2x[8], E2y[8], E2z[8];
+	};
+
+	inline void ClearBlock(TriangleBlock8& block)
+	{
+		std::memset(&block, 0, sizeof(block));
+	}
+
+	inline void SetTriangle(TriangleBlock8& block, int lane, const float v0[3], const float v1[3], const float v2[3])
+	{
+		block.V0x[lane] = v0[0];         block.V0y[lane] = v0[1];         block.V0z[lane] = v0[2];
+		block.E1x[lane] = v1[0] - v0[0]; block.E1y[lane] = v1[1] - v0[1]; block.E1z[lane] = v1[2] - v0[2];
+		block.E2x[lane] = v2[0] - v0[0]; block.E2y[lane] = v2[1] - v0[1]; block.E2z[lane] = v2[2] - v0[2];
+	}
+
+	///<summary>
+	/// AVX version of IntersectRay4 for 8 triangles.
+	///</summary>
+	inline int IntersectRay8(const float origin[3], const float dir[3], const TriangleBlock8& block, float tMax,
+		float t[8], float u[8], float v[8])
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+		__m256 ox = _mm256_set1_ps(origin[0]), oy = _mm256_set1_ps(origin[1]), oz = _mm256_set1_ps(origin[2]);
+		__m256 dx = _mm256_set1_ps(dir[0]), dy = _mm256_set1_ps(dir[1]), dz = _mm256_set1_ps(dir[2]);
+
+		__m256 e1x = _mm256_loadu_ps(block.E1x), e1y = _mm256_loadu_ps(block.E1y), e1z = _mm256_loadu_ps(block.E1z);
+		__m256 e2x = _mm256_loadu_ps(block.E2x), e2y = _mm256_loadu_ps(block.E2y), e2z = _mm256_loadu_ps(block.E2z);
+
+		__m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+		__m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+		__m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+
+		__m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+		__m256 mask = _mm256_cmp_ps(_mm256_and_ps(det, absMask), _mm256_set1_ps(DetEpsilon), _CMP_GE_OQ);
+
+		__m256 invDet = _mm256_div_ps(one, det);
+
+		__m256 sx = _mm256_sub_ps(ox, _mm256_loadu_ps(block.V0x));
+		__m256 sy = _mm256_sub_ps(oy, _mm256_loadu_ps(block.V0y));
+		__m256 sz = _mm256_sub_ps(oz, _mm256_loadu_ps(block.V0z));
+
+		__m256 uu = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)), invDet);
+		mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(uu, zero, _CMP_GE_OQ), _mm256_cmp_ps(uu, one, _CMP_LE_OQ)));
+
+		__m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+		__m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+		__m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+
+		__m256 vv = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), invDet);
+		mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(vv, zero, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(uu, vv), one, _CMP_LE_OQ)));
+
+		__m256 tt = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), invDet);
+		mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(tt, zero, _CMP_GT_OQ), _mm256_cmp_ps(tt, _mm256_set1_ps(tMax), _CMP_LT_OQ)));
+
+		_mm256_storeu_ps(t, tt);
+		_mm256_storeu_ps(u, uu);
+		_mm256_storeu_ps(v, vv);
+		return _mm256_movemask_ps(mask);
+	}
+#endif
+}
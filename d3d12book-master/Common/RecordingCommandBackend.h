@@ -0,0 +1,232 @@
+//***************************************************************************************
+// RecordingCommandBackend.h
+//
+// FrameGraph backend without a device.  Command lists and allocators are ids, a pass
+// records commands as strings with Record, and ExecuteCommandLists appends the commands
+// of the submitted lists to a log, so tests can check what the GPU would have run and
+// in which order.
+//
+// The backend checks the calls against the D3D12 rules and keeps the violations:
+//   - an allocator records one list at a time;
+//   - an allocator is not reset while a list records from it, nor before the GPU has
+//     finished the lists submitted from it (see Signal and Complete);
+//   - a list is reset only when closed, and only open lists are recorded into or closed;
+//   - open lists are not executed.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class RecordingCommandBackend
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+	using CommandList = uint32;
+	using CommandAllocator = uint32;
+
+	CommandAllocator CreateCommandAllocator()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		mAllocators.push_back(AllocatorState());
+		return (CommandAllocator)mAllocators.size() - 1;
+	}
+
+	CommandList CreateCommandList(CommandAllocator& /*allocator*/)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		mLists.push_back(ListState());
+		return (CommandList)mLists.size() - 1;
+	}
+
+	void ResetCommandAllocator(CommandAllocator& allocator)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		AllocatorState& state = mAllocators[allocator];
+		if(state.OpenList != NoList)
+			Violation("allocator " + std::to_string(allocator) + " reset while list " +
+				std::to_string(state.OpenList) + " is recording");
+		if(state.LastFence > mCompletedFence)
+			Violation("allocator " + std::to_string(allocator) + " reset before the GPU finished with it");
+
+		state.ResetCount++;
+	}
+
+	void ResetCommandList(CommandList& list, CommandAllocator& allocator)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		ListState& listState = mLists[list];
+		AllocatorState& allocatorState = mAllocators[allocator];
+		if(listState.Open)
+			Violation("list " + std::to_string(list) + " reset while open");
+		if(allocatorState.OpenList != NoList)
+			Violation("allocator " + std::to_string(allocator) + " used by list " + std::to_string(list) +
+				" while list " + std::to_string(allocatorState.OpenList) + " is recording");
+
+		listState.Open = true;
+		listState.Allocator = allocator;
+		listState.Commands.clear();
+		allocatorState.OpenList = list;
+		allocatorState.UseCount++;
+	}
+
+	void CloseCommandList(CommandList& list)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		ListState& state = mLists[list];
+		if(!state.Open)
+		{
+			Violation("list " + std::to_string(list) + " closed while not open");
+			return;
+		}
+
+		state.Open = false;
+		mAllocators[state.Allocator].OpenList = NoList;
+	}
+
+	void ExecuteCommandLists(CommandList* lists, uint32 count)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		mExecuteCount++;
+		for(uint32 i = 0; i < count; ++i)
+		{
+			ListState& state = mLists[lists[i]];
+			if(state.Open)
+				Violation("list " + std::to_string(lists[i]) + " executed while open");
+
+			// The allocator holds the commands until the GPU passes the next fence.
+			mAllocators[state.Allocator].LastFence = mFence + 1;
+
+			mExecuted.insert(mExecuted.end(), state.Commands.begin(), state.Commands.end());
+		}
+	}
+
+	///<summary>
+	/// Adds a command to an open list.  Called by the passes.
+	///</summary>
+	void Record(CommandList list, const std::string& command)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		ListState& state = mLists[list];
+		if(!state.Open)
+			Violation("list " + std::to_string(list) + " recorded into while closed");
+
+		state.Commands.push_back(command);
+	}
+
+	///<summary>
+	/// Fence value that the work executed so far completes.  Like ID3D12CommandQueue::Signal.
+	///</summary>
+	uint64 Signal()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return ++mFence;
+	}
+
+	///<summary>
+	/// Simulates the GPU finishing the work up to fence.
+	///</summary>
+	void Complete(uint64 fence)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(fence > mCompletedFence)
+			mCompletedFence = fence;
+	}
+
+	uint64 GetCompletedFence()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mCompletedFence;
+	}
+
+	// Commands of all the executed lists, in execution order.
+	std::vector<std::string> GetExecutedCommands()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mExecuted;
+	}
+
+	void ClearExecutedCommands()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mExecuted.clear();
+	}
+
+	uint32 GetExecuteCount()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mExecuteCount;
+	}
+
+	uint32 GetAllocatorCount()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return (uint32)mAllocators.size();
+	}
+
+	// Number of times the allocator was reset, and lists were reset onto it.
+	uint32 GetAllocatorResetCount(CommandAllocator allocator)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mAllocators[allocator].ResetCount;
+	}
+
+	uint32 GetAllocatorUseCount(CommandAllocator allocator)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mAllocators[allocator].UseCount;
+	}
+
+	std::vector<std::string> GetViolations()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mViolations;
+	}
+
+private:
+	static const uint32 NoList = UINT32_MAX;
+
+	struct AllocatorState
+	{
+		uint32 OpenList = NoList;
+		uint64 LastFence = 0;
+		uint32 ResetCount = 0;
+		uint32 UseCount = 0;
+	};
+
+	struct ListState
+	{
+		bool Open = false;
+		uint32 Allocator = 0;
+		std::vector<std::string> Commands;
+	};
+
+	void Violation(const std::string& text)
+	{
+		mViolations.push_back(text);
+	}
+
+private:
+	std::mutex mMutex;
+
+	std::vector<AllocatorState> mAllocators;
+	std::vector<ListState> mLists;
+
+	uint64 mFence = 0;
+	uint64 mCompletedFence = 0;
+	uint32 mExecuteCount = 0;
+
+	std::vector<std::string> mExecuted;
+	std::vector<std::string> mViolations;
+};
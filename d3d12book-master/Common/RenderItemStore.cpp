@@ -0,0 +1,177 @@
+//***************************************************************************************
+// RenderItemStore.cpp
+//***************************************************************************************
+
+#include "RenderItemStore.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace DirectX;
+
+const RenderItemStore::uint32 RenderItemStore::InvalidSlot;
+
+RenderItemStore::RenderItemStore(uint32 capacity, uint32 frameResourceCount)
+{
+	Reset(capacity, frameResourceCount);
+}
+
+void RenderItemStore::Reset(uint32 capacity, uint32 frameResourceCount)
+{
+	mCount = 0;
+
+	mWorlds.resize(capacity);
+	mLocalBounds.resize(capacity);
+	mWorldBounds.resize(capacity);
+	mDrawKeys.resize(capacity);
+	mHandleIndices.resize(capacity);
+
+	// There are never more live items than slots, so one handle entry per slot.
+	// Generations carry on from before so that old handles stay invalid.
+	mSlots.assign(capacity, InvalidSlot);
+	mGenerations.resize(capacity, 0);
+	for(auto& generation : mGenerations)
+		++generation;
+
+	// Hand out the entries in ascending order.
+	mFreeHandles.resize(capacity);
+	for(uint32 i = 0; i < capacity; ++i)
+		mFreeHandles[i] = capacity - 1 - i;
+
+	mDirty.Resize(frameResourceCount, capacity);
+}
+
+RenderItemHandle RenderItemStore::Create(const XMFLOAT4X4& world, const BoundingBox& localBounds, uint64 drawKey)
+{
+	RenderItemHandle handle;
+	if(mFreeHandles.empty())
+		return handle;
+
+	handle.Index = mFreeHandles.back();
+	handle.Generation = mGenerations[handle.Index];
+	mFreeHandles.pop_back();
+
+	uint32 slot = mCount++;
+	mSlots[handle.Index] = slot;
+	mHandleIndices[slot] = handle.Index;
+
+	mWorlds[slot] = world;
+	mLocalBounds[slot] = localBounds;
+	mDrawKeys[slot] = drawKey;
+	UpdateWorldBounds(slot);
+
+	mDirty.MarkDirty(slot);
+	return handle;
+}
+
+void RenderItemStore::Destroy(RenderItemHandle handle)
+{
+	assert(IsValid(handle));
+
+	uint32 slot = mSlots[handle.Index];
+	uint32 last = --mCount;
+	if(slot != last)
+	{
+		mWorlds[slot] = mWorlds[last];
+		mLocalBounds[slot] = mLocalBounds[last];
+		mWorldBounds[slot] = mWorldBounds[last];
+		mDrawKeys[slot] = mDrawKeys[last];
+		mHandleIndices[slot] = mHandleIndices[last];
+		mSlots[mHandleIndices[slot]] = slot;
+
+		// The moved item's constants are still at its old slot.
+		mDirty.MarkDirty(slot);
+	}
+
+	mSlots[handle.Index] = InvalidSlot;
+	++mGenerations[handle.Index];
+	mFreeHandles.push_back(handle.Index);
+}
+
+bool RenderItemStore::IsValid(RenderItemHandle handle)const
+{
+	return handle.Index < mSlots.size() && mSlots[handle.Index] != InvalidSlot &&
+		mGenerations[handle.Index] == handle.Generation;
+}
+
+RenderItemStore::uint32 RenderItemStore::GetSlot(RenderItemHandle handle)const
+{
+	assert(IsValid(handle));
+	return mSlots[handle.Index];
+}
+
+RenderItemHandle RenderItemStore::GetHandle(uint32 slot)const
+{
+	assert(slot < mCount);
+
+	RenderItemHandle handle;
+	handle.Index = mHandleIndices[slot];
+	handle.Generation = mGenerations[handle.Index];
+	return handle;
+}
+
+void RenderItemStore::SetWorld(RenderItemHandle handle, const XMFLOAT4X4& world)
+{
+	uint32 slot = GetSlot(handle);
+	mWorlds[slot] = world;
+	UpdateWorldBounds(slot);
+	mDirty.MarkDirty(slot);
+}
+
+void RenderItemStore::SetLocalBounds(RenderItemHandle handle, const BoundingBox& localBounds)
+{
+	uint32 slot = GetSlot(handle);
+	mLocalBounds[slot] = localBounds;
+	UpdateWorldBounds(slot);
+}
+
+void RenderItemStore::SetDrawKey(RenderItemHandle handle, uint64 drawKey)
+{
+	mDrawKeys[GetSlot(handle)] = drawKey;
+}
+
+void RenderItemStore::TakeDirty(uint32 frameResource, std::vector<uint32>& slots)
+{
+	mDirty.Take(frameResource, slots);
+
+	// Slots past the end were marked by items destroyed since.
+	slots.erase(std::lower_bound(slots.begin(), slots.end(), mCount), slots.end());
+}
+
+void RenderItemStore::Cull(const BoundingFrustum& frustum, std::vector<uint32>& visibleSlots)const
+{
+	for(uint32 slot = 0; slot < mCount; ++slot)
+	{
+		if(frustum.Intersects(mWorldBounds[slot]))
+			visibleSlots.push_back(slot);
+	}
+}
+
+RenderItemStore::uint32 RenderItemStore::GetCount()const
+{
+	return mCount;
+}
+
+RenderItemStore::uint32 RenderItemStore::GetCapacity()const
+{
+	return (uint32)mWorlds.size();
+}
+
+const XMFLOAT4X4* RenderItemStore::GetWorlds()const
+{
+	return mWorlds.data();
+}
+
+const BoundingBox* RenderItemStore::GetWorldBounds()const
+{
+	return mWorldBounds.data();
+}
+
+const RenderItemStore::uint64* RenderItemStore::GetDrawKeys()const
+{
+	return mDrawKeys.data();
+}
+
+void RenderItemStore::UpdateWorldBounds(uint32 slot)
+{
+	mLocalBounds[slot].Transform(mWorldBounds[slot], XMLoadFloat4x4(&mWorlds[slot]));
+}
@@ -0,0 +1,113 @@
+//***************************************************************************************
+// RenderItemStore.h
+//
+// Render items kept as parallel arrays instead of one struct per item: world matrices,
+// bounds and draw keys each in their own contiguous array, indexed by slot.  Updating
+// the constants touches only the matrices, culling only the bounds, and sorting or
+// drawing only the keys, so each pass streams through exactly the data it needs.
+//
+// The live items always fill slots [0, GetCount()).  Destroy moves the last item into
+// the freed slot, so the arrays never have holes and the slot of an item can change.
+// Items are therefore named by handles, which map to slots through a table with a free
+// list; a handle's generation tells a destroyed item from a newer one in the same entry.
+//
+// The slot doubles as the index of the item's object constants.  Creating, moving and
+// changing an item marks its slot dirty for every frame resource (see DirtyList), so a
+// moved item's constants are rewritten at its new slot.
+//
+// The draw key is the app's: whatever identifies what to draw and with which state,
+// e.g. a geometry handle and a material index packed into 64 bits.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <vector>
+#include "DirtyList.h"
+
+struct RenderItemHandle
+{
+	std::uint32_t Index = UINT32_MAX;
+	std::uint32_t Generation = 0;
+};
+
+class RenderItemStore
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	static const uint32 InvalidSlot = UINT32_MAX;
+
+	RenderItemStore(uint32 capacity = 0, uint32 frameResourceCount = 0);
+	RenderItemStore(const RenderItemStore& rhs) = delete;
+	RenderItemStore& operator=(const RenderItemStore& rhs) = delete;
+
+	///<summary>
+	/// Destroys every item and sets the number of slots (the size of the object constant
+	/// buffers) and of frame resources.
+	///</summary>
+	void Reset(uint32 capacity, uint32 frameResourceCount);
+
+	///<summary>
+	/// Adds an item in the next slot.  localBounds are the mesh's bounds in its local
+	/// space.  Returns an invalid handle if every slot is in use.
+	///</summary>
+	RenderItemHandle Create(const DirectX::XMFLOAT4X4& world, const DirectX::BoundingBox& localBounds, uint64 drawKey);
+
+	///<summary>
+	/// Removes the item.  The last item moves into its slot.
+	///</summary>
+	void Destroy(RenderItemHandle handle);
+
+	bool IsValid(RenderItemHandle handle)const;
+	uint32 GetSlot(RenderItemHandle handle)const;
+	RenderItemHandle GetHandle(uint32 slot)const;
+
+	void SetWorld(RenderItemHandle handle, const DirectX::XMFLOAT4X4& world);
+	void SetLocalBounds(RenderItemHandle handle, const DirectX::BoundingBox& localBounds);
+	void SetDrawKey(RenderItemHandle handle, uint64 drawKey);
+
+	///<summary>
+	/// Moves the slots changed since the last call for frameResource to slots, in
+	/// ascending order.
+	///</summary>
+	void TakeDirty(uint32 frameResource, std::vector<uint32>& slots);
+
+	///<summary>
+	/// Appends, in ascending order, the slots whose world space bounds intersect
+	/// frustum, which is in world space too.
+	///</summary>
+	void Cull(const DirectX::BoundingFrustum& frustum, std::vector<uint32>& visibleSlots)const;
+
+	uint32 GetCount()const;
+	uint32 GetCapacity()const;
+
+	// Arrays of GetCount() elements, indexed by slot.  Valid until the next Create or
+	// Destroy.
+	const DirectX::XMFLOAT4X4* GetWorlds()const;
+	const DirectX::BoundingBox* GetWorldBounds()const;
+	const uint64* GetDrawKeys()const;
+
+private:
+	void UpdateWorldBounds(uint32 slot);
+
+private:
+	uint32 mCount = 0;
+
+	// Indexed by slot.
+	std::vector<DirectX::XMFLOAT4X4> mWorlds;
+	std::vector<DirectX::BoundingBox> mLocalBounds;
+	std::vector<DirectX::BoundingBox> mWorldBounds;
+	std::vector<uint64> mDrawKeys;
+	std::vector<uint32> mHandleIndices;
+
+	// Indexed by handle.
+	std::vector<uint32> mSlots;
+	std::vector<uint32> mGenerations;
+	std::vector<uint32> mFreeHandles;
+
+	DirtyList mDirty;
+};
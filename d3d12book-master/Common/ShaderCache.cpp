@@ -0,0 +1,160 @@
+//***************************************************************************************
+// ShaderCache.cpp
+//***************************************************************************************
+
+#include "ShaderCache.h"
+#include "ContentHash.h"
+#include <cassert>
+
+ShaderCache::ShaderCache(ShaderCompiler& compiler, BlobCache* diskCache)
+	: mCompiler(compiler), mDiskCache(diskCache)
+{
+	mCompilerVersion = mCompiler.GetVersion();
+}
+
+void ShaderCache::Add(const std::string& name, const ShaderRequest& request)
+{
+	Shader& shader = mShaders[name];
+	shader.Request = request;
+	shader.Key = 0;
+	shader.Bytecode = nullptr;
+
+	mPending.push_back(name);
+}
+
+ShaderCache::Stats ShaderCache::Build(JobSystem& jobs)
+{
+	//
+	// Preprocess and key every shader added since the last Build.
+	//
+
+	std::vector<uint64> keys(mPending.size());
+
+	JobSystem::Group keyGroup;
+	for(size_t i = 0; i < mPending.size(); ++i)
+	{
+		jobs.Submit(keyGroup, [this, &keys, i](uint32)
+		{
+			const ShaderRequest& request = mShaders.at(mPending[i]).Request;
+			keys[i] = MakeKey(request, mCompiler.Preprocess(request));
+		});
+	}
+	jobs.Wait(keyGroup);
+
+	//
+	// Build each key once, unless an earlier Build did.
+	//
+
+	Stats stats;
+	stats.ShaderCount = (uint32)mPending.size();
+
+	std::vector<Compilation> compilations;
+	std::unordered_map<uint64, size_t> keysSeen;
+	for(size_t i = 0; i < mPending.size(); ++i)
+	{
+		if(keysSeen.count(keys[i]) != 0)
+			continue;
+
+		keysSeen[keys[i]] = i;
+		stats.UniqueCount++;
+
+		if(mBytecode.count(keys[i]) != 0)
+		{
+			stats.MemoryHitCount++;
+			continue;
+		}
+
+		Compilation compilation;
+		compilation.Key = keys[i];
+		compilation.Request = mShaders.at(mPending[i]).Request;
+		compilations.push_back(std::move(compilation));
+	}
+
+	JobSystem::Group compileGroup;
+	for(size_t i = 0; i < compilations.size(); ++i)
+	{
+		jobs.Submit(compileGroup, [this, &compilations, i](uint32)
+		{
+			Compilation& compilation = compilations[i];
+
+			Blob bytecode;
+			if(mDiskCache != nullptr && mDiskCache->Load(compilation.Key, bytecode))
+			{
+				compilation.FromDisk = true;
+			}
+			else
+			{
+				bytecode = mCompiler.Compile(compilation.Request);
+				if(mDiskCache != nullptr)
+					mDiskCache->Store(compilation.Key, bytecode);
+			}
+
+			compilation.Bytecode = std::make_shared<const Blob>(std::move(bytecode));
+		});
+	}
+	jobs.Wait(compileGroup);
+
+	for(auto& compilation : compilations)
+	{
+		mBytecode[compilation.Key] = compilation.Bytecode;
+
+		if(compilation.FromDisk)
+			stats.DiskHitCount++;
+		else
+			stats.CompileCount++;
+	}
+
+	for(size_t i = 0; i < mPending.size(); ++i)
+	{
+		Shader& shader = mShaders.at(mPending[i]);
+		shader.Key = keys[i];
+		shader.Bytecode = mBytecode.at(keys[i]);
+	}
+
+	mPending.clear();
+
+	mStats = stats;
+	return stats;
+}
+
+bool ShaderCache::Contains(const std::string& name)const
+{
+	auto it = mShaders.find(name);
+	return it != mShaders.end() && it->second.Bytecode != nullptr;
+}
+
+const ShaderCache::Blob& ShaderCache::Get(const std::string& name)const
+{
+	assert(Contains(name));
+	return *mShaders.at(name).Bytecode;
+}
+
+ShaderCache::uint64 ShaderCache::GetKey(const std::string& name)const
+{
+	assert(Contains(name));
+	return mShaders.at(name).Key;
+}
+
+const ShaderCache::Stats& ShaderCache::GetStats()const
+{
+	return mStats;
+}
+
+ShaderCache::uint64 ShaderCache::MakeKey(const ShaderRequest& request, const std::string& preprocessed)const
+{
+	// The file name is left out: the preprocessed source covers what the file holds.
+	ContentHash hash;
+	hash.AddString(mCompilerVersion);
+	hash.AddString(preprocessed);
+
+	hash.AddValue((uint64)request.Defines.size());
+	for(auto& define : request.Defines)
+	{
+		hash.AddString(define.first);
+		hash.AddString(define.second);
+	}
+
+	hash.AddString(request.EntryPoint);
+	hash.AddString(request.Target);
+	return hash.Get();
+}
@@ -0,0 +1,110 @@
+//***************************************************************************************
+// ShaderCache.h
+//
+// Builds an app's shaders on the JobSystem and keeps them by name.  Shaders are added
+// with the file, defines, entry point and target they were given to
+// d3dUtil::CompileShader, then Build compiles them all in parallel.
+//
+// Each shader is keyed by a hash of the compiler version, its preprocessed source,
+// defines, entry point and target:
+//
+//  - Shaders with the same key are compiled once and share their bytecode, within a
+//    Build and across Builds.
+//  - With a BlobCache, compiled bytecode is stored under its key, and a later run finds
+//    it there instead of compiling.  Editing a shader or anything it includes changes
+//    the preprocessed source, so only the shaders affected compile again.
+//
+// Preprocessing still runs for every shader on every Build, to compute the keys; it is
+// a small part of the cost of compiling.
+//***************************************************************************************
+
+#pragma once
+
+#include "BlobCache.h"
+#include "JobSystem.h"
+#include "ShaderCompiler.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ShaderCache
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+	using Blob = ShaderCompiler::Blob;
+
+	struct Stats
+	{
+		// Shaders built by the last Build, and how many different keys they had.
+		uint32 ShaderCount = 0;
+		uint32 UniqueCount = 0;
+
+		// Where the unique ones came from.
+		uint32 MemoryHitCount = 0;
+		uint32 DiskHitCount = 0;
+		uint32 CompileCount = 0;
+	};
+
+	///<summary>
+	/// diskCache may be null, to keep the bytecode in memory only.
+	///</summary>
+	ShaderCache(ShaderCompiler& compiler, BlobCache* diskCache);
+	ShaderCache(const ShaderCache& rhs) = delete;
+	ShaderCache& operator=(const ShaderCache& rhs) = delete;
+
+	///<summary>
+	/// Adds a shader to build on the next Build.  Adding a name again replaces it.
+	///</summary>
+	void Add(const std::string& name, const ShaderRequest& request);
+
+	///<summary>
+	/// Builds the shaders added since the last Build.  Rethrows the first error of the
+	/// compiler, after every job has finished.
+	///</summary>
+	Stats Build(JobSystem& jobs);
+
+	bool Contains(const std::string& name)const;
+
+	///<summary>
+	/// Bytecode of a built shader.  Stays valid for the life of the cache.
+	///</summary>
+	const Blob& Get(const std::string& name)const;
+	uint64 GetKey(const std::string& name)const;
+
+	const Stats& GetStats()const;
+
+private:
+	struct Shader
+	{
+		ShaderRequest Request;
+		uint64 Key = 0;
+		std::shared_ptr<const Blob> Bytecode;
+	};
+
+	// A key built by the current Build.
+	struct Compilation
+	{
+		uint64 Key = 0;
+		ShaderRequest Request;
+		std::shared_ptr<const Blob> Bytecode;
+		bool FromDisk = false;
+	};
+
+	uint64 MakeKey(const ShaderRequest& request, const std::string& preprocessed)const;
+
+private:
+	ShaderCompiler& mCompiler;
+	BlobCache* mDiskCache = nullptr;
+	std::string mCompilerVersion;
+
+	std::unordered_map<std::string, Shader> mShaders;
+	std::vector<std::string> mPending;
+
+	// Bytecode of every key built so far.
+	std::unordered_map<uint64, std::shared_ptr<const Blob>> mBytecode;
+
+	Stats mStats;
+};
@@ -0,0 +1,50 @@
+//***************************************************************************************
+// ShaderCompiler.h
+//
+// What ShaderCache needs of a shader compiler: the source a shader compiles from, with
+// its includes and defines applied, and the compiled bytecode.  D3D12ShaderCompiler
+// uses the D3D compiler; a stand-in that fakes the bytecode exercises the cache without
+// one.
+//
+// The cache calls both from its job threads, for different shaders at the same time.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ShaderRequest
+{
+	std::string Filename;
+	std::vector<std::pair<std::string, std::string>> Defines;
+	std::string EntryPoint;
+	std::string Target;
+};
+
+class ShaderCompiler
+{
+public:
+	using Blob = std::vector<std::uint8_t>;
+
+	virtual ~ShaderCompiler() = default;
+
+	///<summary>
+	/// Names the compiler and the flags it compiles with.  It is part of every cache
+	/// key, so blobs from another compiler or other flags are not reused.
+	///</summary>
+	virtual std::string GetVersion() = 0;
+
+	///<summary>
+	/// Returns the source as the compiler sees it, with the included files and the
+	/// defines applied, so editing any of them changes the key.  Throws on errors.
+	///</summary>
+	virtual std::string Preprocess(const ShaderRequest& request) = 0;
+
+	///<summary>
+	/// Returns the bytecode.  Throws on errors.
+	///</summary>
+	virtual Blob Compile(const ShaderRequest& request) = 0;
+};
@@ -0,0 +1,116 @@
+//***************************************************************************************
+// SimulatedFrameFence.cpp
+//***************************************************************************************
+
+#include "SimulatedFrameFence.h"
+#include <chrono>
+
+SimulatedFrameFence::SimulatedFrameFence()
+{
+	mGpuThread = std::thread(&SimulatedFrameFence::GpuMain, this);
+}
+
+SimulatedFrameFence::~SimulatedFrameFence()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mCommandAvailable.notify_all();
+
+	mGpuThread.join();
+}
+
+void SimulatedFrameFence::Submit(double gpuMilliseconds)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		Command work;
+		work.Milliseconds = gpuMilliseconds;
+		mCommands.push_back(work);
+	}
+	mCommandAvailable.notify_one();
+}
+
+SimulatedFrameFence::uint64 SimulatedFrameFence::Signal()
+{
+	uint64 value = 0;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		Command signal;
+		signal.SignalValue = value = ++mLastSignaled;
+		mCommands.push_back(signal);
+	}
+	mCommandAvailable.notify_one();
+
+	return value;
+}
+
+SimulatedFrameFence::uint64 SimulatedFrameFence::GetCompletedValue()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mCompleted;
+}
+
+void SimulatedFrameFence::SetWaitSlotCount(uint32 count)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	while(mSlots.size() < count)
+		mSlots.push_back(std::make_unique<std::condition_variable>());
+}
+
+bool SimulatedFrameFence::Wait(uint32 slot, uint64 value, uint32 timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if(mCompleted >= value)
+		return true;
+
+	mBlockingWaitCount++;
+
+	auto completed = [&]() { return mCompleted >= value; };
+	if(timeoutMs == InfiniteWait)
+	{
+		mSlots[slot]->wait(lock, completed);
+		return true;
+	}
+
+	return mSlots[slot]->wait_for(lock, std::chrono::milliseconds(timeoutMs), completed);
+}
+
+SimulatedFrameFence::uint64 SimulatedFrameFence::GetBlockingWaitCount()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mBlockingWaitCount;
+}
+
+void SimulatedFrameFence::GpuMain()
+{
+	for(;;)
+	{
+		Command command;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCommandAvailable.wait(lock, [this]() { return mStopping || !mCommands.empty(); });
+			if(mStopping)
+				return;
+
+			command = mCommands.front();
+			mCommands.pop_front();
+		}
+
+		if(command.SignalValue == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(command.Milliseconds));
+			continue;
+		}
+
+		// Wake every slot; each waiter checks its own value.
+		std::lock_guard<std::mutex> lock(mMutex);
+		mCompleted = command.SignalValue;
+		for(size_t i = 0; i < mSlots.size(); ++i)
+			mSlots[i]->notify_all();
+	}
+}
@@ -0,0 +1,66 @@
+//***************************************************************************************
+// SimulatedFrameFence.h
+//
+// FrameFence with a thread standing in for the GPU.  Submit queues GPU work that takes
+// a given time; the thread works through the queue in order and completes each Signal
+// once the work before it is done.  Each wait slot is a condition variable.
+//
+// With no work submitted, signals complete straight away, which makes for
+// deterministic tests; with timed work, the CPU really waits, which is what the pacing
+// metrics measure.
+//***************************************************************************************
+
+#pragma once
+
+#include "FrameFence.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class SimulatedFrameFence : public FrameFence
+{
+public:
+	SimulatedFrameFence();
+	SimulatedFrameFence(const SimulatedFrameFence& rhs) = delete;
+	SimulatedFrameFence& operator=(const SimulatedFrameFence& rhs) = delete;
+	~SimulatedFrameFence();
+
+	///<summary>
+	/// Queues GPU work taking gpuMilliseconds, like ExecuteCommandLists.
+	///</summary>
+	void Submit(double gpuMilliseconds);
+
+	virtual uint64 Signal()override;
+	virtual uint64 GetCompletedValue()override;
+	virtual void SetWaitSlotCount(uint32 count)override;
+	virtual bool Wait(uint32 slot, uint64 value, uint32 timeoutMs)override;
+
+	// Number of Wait calls that had to block.
+	uint64 GetBlockingWaitCount();
+
+private:
+	struct Command
+	{
+		double Milliseconds = 0.0;
+		uint64 SignalValue = 0; // 0 for work
+	};
+
+	void GpuMain();
+
+private:
+	std::mutex mMutex;
+	std::condition_variable mCommandAvailable;
+	std::deque<Command> mCommands;
+	bool mStopping = false;
+
+	uint64 mLastSignaled = 0;
+	uint64 mCompleted = 0;
+	uint64 mBlockingWaitCount = 0;
+
+	std::vector<std::unique_ptr<std::condition_variable>> mSlots;
+
+	std::thread mGpuThread;
+};
@@ -1,13 +1,15 @@
 #pragma once
 
 #include "d3dUtil.h"
+#include "MappedSpan.h"
+#include "UploadRing.h"
 
 template<typename T>
 class UploadBuffer
 {
 public:
     UploadBuffer(ID3D12Device* device, UINT elementCount, bool isConstantBuffer) : 
-        mIsConstantBuffer(isConstantBuffer)
+        mElementCount(elementCount), mIsConstantBuffer(isConstantBuffer)
     {
         mElementByteSize = sizeof(T);
 
@@ -55,10 +57,69 @@ public:
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Copies count elements starting at firstIndex in one go, with streaming stores when
+    // the range is large.  Prefer this to a CopyData per element.
+    void CopyData(int firstIndex, const T* data, UINT count)
+    {
+        Map().CopyData(firstIndex, data, count);
+    }
+
+    // Write-only view of the elements, for building them in place front to back
+    // instead of in a temporary that is then copied.
+    MappedSpan<T> Map()
+    {
+        return MappedSpan<T>(mMappedData, mElementCount, mElementByteSize);
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
 
+    UINT mElementCount = 0;
     UINT mElementByteSize = 0;
     bool mIsConstantBuffer = false;
-};
\ No newline at end of file
+};
+
+// One persistently mapped upload heap buffer handed out frame by frame through an
+// UploadRing, for constants, dynamic vertices and instance data alike.
+class UploadRingBuffer
+{
+public:
+    UploadRingBuffer(ID3D12Device* device, UINT64 byteSize)
+    {
+        ThrowIfFailed(device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&mUploadBuffer)));
+
+        void* mappedData = nullptr;
+        ThrowIfFailed(mUploadBuffer->Map(0, nullptr, &mappedData));
+
+        mRing = std::make_unique<UploadRing>(mappedData, mUploadBuffer->GetGPUVirtualAddress(), byteSize);
+    }
+
+    UploadRingBuffer(const UploadRingBuffer& rhs) = delete;
+    UploadRingBuffer& operator=(const UploadRingBuffer& rhs) = delete;
+    ~UploadRingBuffer()
+    {
+        if(mUploadBuffer != nullptr)
+            mUploadBuffer->Unmap(0, nullptr);
+    }
+
+    ID3D12Resource* Resource()const
+    {
+        return mUploadBuffer.Get();
+    }
+
+    UploadRing& Ring()
+    {
+        return *mRing;
+    }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
+    std::unique_ptr<UploadRing> mRing;
+};
@@ -0,0 +1,124 @@
+//***************************************************************************************
+// UploadRing.cpp
+//***************************************************************************************
+
+#include "UploadRing.h"
+#include <cassert>
+
+UploadRing::UploadRing(uint64 capacity)
+	: mOwnedMemory((size_t)capacity)
+{
+	mCpuBase = mOwnedMemory.data();
+	mGpuBase = 0;
+	mCapacity = capacity;
+}
+
+UploadRing::UploadRing(void* cpuBase, uint64 gpuBase, uint64 capacity)
+{
+	mCpuBase = static_cast<std::uint8_t*>(cpuBase);
+	mGpuBase = gpuBase;
+	mCapacity = capacity;
+}
+
+UploadRing::Allocation UploadRing::Allocate(uint64 size, uint64 alignment)
+{
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+	Allocation allocation;
+	if(size == 0 || size > mCapacity)
+		return allocation;
+
+	uint64 used = mAllocated - mReleased;
+	if(used == 0)
+	{
+		// Nothing in flight, so start over at the front and keep the ring from wrapping
+		// needlessly.  Unreclaimed frames here are empty and end where the ring starts.
+		mHead = mTail = 0;
+		for(auto& frame : mFrames)
+			frame.End = 0;
+	}
+
+	uint64 offset = (mTail + alignment - 1) & ~(alignment - 1);
+	uint64 padding = offset - mTail;
+
+	if(used > 0 && mTail == mHead)
+	{
+		return allocation;
+	}
+	else if(mTail >= mHead)
+	{
+		// Free space is [mTail, mCapacity) and [0, mHead).
+		if(offset + size > mCapacity)
+		{
+			if(size > mHead)
+				return allocation;
+
+			offset = 0;
+			padding = mCapacity - mTail;
+		}
+	}
+	else if(offset + size > mHead)
+	{
+		// Free space is [mTail, mHead).
+		return allocation;
+	}
+
+	mTail = offset + size;
+	mAllocated += padding + size;
+
+	allocation.CpuAddress = mCpuBase + offset;
+	allocation.GpuAddress = mGpuBase + offset;
+	allocation.Offset = offset;
+	allocation.Size = size;
+	return allocation;
+}
+
+void UploadRing::FinishFrame(uint64 fenceValue)
+{
+	assert(mFrames.empty() || mFrames.back().FenceValue <= fenceValue);
+
+	Frame frame;
+	frame.FenceValue = fenceValue;
+	frame.End = mTail;
+	frame.Allocated = mAllocated;
+	mFrames.push_back(frame);
+
+	uint64 frameBytes = mAllocated - mFrameStart;
+	mPeakFrameBytes = frameBytes > mPeakFrameBytes ? frameBytes : mPeakFrameBytes;
+	mFrameStart = mAllocated;
+}
+
+void UploadRing::Reclaim(uint64 completedFenceValue)
+{
+	while(!mFrames.empty() && mFrames.front().FenceValue <= completedFenceValue)
+	{
+		mHead = mFrames.front().End;
+		mReleased = mFrames.front().Allocated;
+		mFrames.pop_front();
+	}
+}
+
+UploadRing::uint64 UploadRing::GetCapacity()const
+{
+	return mCapacity;
+}
+
+UploadRing::uint64 UploadRing::GetUsedBytes()const
+{
+	return mAllocated - mReleased;
+}
+
+UploadRing::uint64 UploadRing::GetFrameBytes()const
+{
+	return mAllocated - mFrameStart;
+}
+
+UploadRing::uint64 UploadRing::GetPeakFrameBytes()const
+{
+	return mPeakFrameBytes;
+}
+
+UploadRing::uint64 UploadRing::GetFramesInFlight()const
+{
+	return (uint64)mFrames.size();
+}
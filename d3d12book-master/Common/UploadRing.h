@@ -0,0 +1,128 @@
+//***************************************************************************************
+// UploadRing.h
+//
+// Bump allocator over a ring of persistently mapped memory for data that lives for one
+// frame: constants, dynamic vertices, instance data.  Each frame allocates after the
+// previous one; FinishFrame tags everything allocated since the last call with the
+// frame's fence value, and Reclaim frees it once the GPU has passed that fence.  So the
+// memory in use follows what the frames in flight actually write, instead of every
+// frame resource holding a worst-case buffer per data type.
+//
+// The ring does not touch the device.  It hands out ranges of memory the caller keeps
+// mapped (UploadRingBuffer in UploadBuffer.h wraps an upload heap buffer), or of its own
+// system memory, where GPU addresses are plain offsets, for exercising the allocator
+// and the fence recycling without a GPU.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+class UploadRing
+{
+public:
+	using uint64 = std::uint64_t;
+
+	// Constant buffer views need 256 byte aligned offsets and sizes.
+	static const uint64 ConstantBufferAlignment = 256;
+
+	struct Allocation
+	{
+		std::uint8_t* CpuAddress = nullptr;
+		uint64 GpuAddress = 0;
+		uint64 Offset = 0;
+		uint64 Size = 0;
+
+		bool IsValid()const { return CpuAddress != nullptr; }
+
+		template<typename T>
+		T* Data()const { return reinterpret_cast<T*>(CpuAddress); }
+	};
+
+	///<summary>
+	/// Ring over capacity bytes of its own system memory.
+	///</summary>
+	explicit UploadRing(uint64 capacity);
+
+	///<summary>
+	/// Ring over memory the caller owns and keeps mapped at cpuBase, seen by the GPU at
+	/// gpuBase.
+	///</summary>
+	UploadRing(void* cpuBase, uint64 gpuBase, uint64 capacity);
+
+	UploadRing(const UploadRing& rhs) = delete;
+	UploadRing& operator=(const UploadRing& rhs) = delete;
+
+	///<summary>
+	/// Returns size bytes at a multiple of alignment (a power of two), or an invalid
+	/// allocation if the frames in flight leave no room.  A range that would run past the
+	/// end of the ring starts over at the front instead.
+	///</summary>
+	Allocation Allocate(uint64 size, uint64 alignment = ConstantBufferAlignment);
+
+	///<summary>
+	/// Allocates and fills one constant buffer.
+	///</summary>
+	template<typename T>
+	Allocation AllocateConstants(const T& data)
+	{
+		Allocation a = Allocate((sizeof(T) + ConstantBufferAlignment - 1) & ~(ConstantBufferAlignment - 1));
+		if(a.IsValid())
+			std::memcpy(a.CpuAddress, &data, sizeof(T));
+
+		return a;
+	}
+
+	///<summary>
+	/// Allocates count tightly packed elements, for vertex and structured buffers.
+	///</summary>
+	template<typename T>
+	Allocation AllocateArray(uint64 count, uint64 alignment = alignof(T) < 16 ? 16 : alignof(T))
+	{
+		return Allocate(count*sizeof(T), alignment);
+	}
+
+	///<summary>
+	/// Everything allocated since the last call is in use until fenceValue completes.
+	///</summary>
+	void FinishFrame(uint64 fenceValue);
+
+	///<summary>
+	/// Frees the frames whose fence values are at most completedFenceValue.
+	///</summary>
+	void Reclaim(uint64 completedFenceValue);
+
+	uint64 GetCapacity()const;
+	uint64 GetUsedBytes()const;
+	uint64 GetFrameBytes()const;
+	uint64 GetPeakFrameBytes()const;
+	uint64 GetFramesInFlight()const;
+
+private:
+	struct Frame
+	{
+		uint64 FenceValue = 0;
+		uint64 End = 0;       // mTail when the frame finished
+		uint64 Allocated = 0; // mAllocated when the frame finished
+	};
+
+	std::vector<std::uint8_t> mOwnedMemory;
+	std::uint8_t* mCpuBase = nullptr;
+	uint64 mGpuBase = 0;
+	uint64 mCapacity = 0;
+
+	// In use is [mHead, mTail), wrapping around the end.  The counters of bytes
+	// allocated and released, padding included, tell a full ring from an empty one.
+	uint64 mHead = 0;
+	uint64 mTail = 0;
+	uint64 mAllocated = 0;
+	uint64 mReleased = 0;
+
+	uint64 mFrameStart = 0;
+	uint64 mPeakFrameBytes = 0;
+
+	std::deque<Frame> mFrames;
+};
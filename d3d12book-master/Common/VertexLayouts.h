@@ -0,0 +1,136 @@
+//***************************************************************************************
+// VertexLayouts.h
+//
+// Vertex layouts for the GeometryGenerator::Create* overloads that write into caller
+// buffers.  Each layout has a nested Vertex type and a static Encode that converts the
+// generator's full 44-byte vertex into it.  Apps can define their own layout the same
+// way, e.g. to fill the Vertex struct declared in their FrameResource.h.
+//
+// The DXGI format to use for each member in the input layout is noted next to it.
+//***************************************************************************************
+
+#pragma once
+
+#include <cmath>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include "GeometryGenerator.h"
+
+namespace VertexLayouts
+{
+	///<summary>
+	/// Octahedral encoding of a unit vector into [-1,1]^2: project onto the octahedron
+	/// |x|+|y|+|z| = 1 and fold the lower half over the upper one.
+	///</summary>
+	inline DirectX::XMFLOAT2 OctEncode(const DirectX::XMFLOAT3& n)
+	{
+		float invL1 = 1.0f / (fabsf(n.x) + fabsf(n.y) + fabsf(n.z));
+		float x = n.x*invL1;
+		float y = n.y*invL1;
+
+		if(n.z < 0.0f)
+		{
+			float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = fx;
+			y = fy;
+		}
+
+		return DirectX::XMFLOAT2(x, y);
+	}
+
+	///<summary>
+	/// Inverse of OctEncode.  The shader version is the same few lines of HLSL.
+	///</summary>
+	inline DirectX::XMFLOAT3 OctDecode(const DirectX::XMFLOAT2& e)
+	{
+		DirectX::XMFLOAT3 n(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+		if(n.z < 0.0f)
+		{
+			float fx = (1.0f - fabsf(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f);
+			float fy = (1.0f - fabsf(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+			n.x = fx;
+			n.y = fy;
+		}
+
+		DirectX::XMStoreFloat3(&n, DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&n)));
+		return n;
+	}
+
+	// 12 bytes.  Depth-only and shadow passes.
+	struct Position
+	{
+		struct Vertex
+		{
+			DirectX::XMFLOAT3 Position;  // DXGI_FORMAT_R32G32B32_FLOAT
+		};
+
+		static void Encode(const GeometryGenerator::Vertex& in, Vertex& out)
+		{
+			out.Position = in.Position;
+		}
+	};
+
+	// 28 bytes.  The w component of the normal is 0.
+	struct PositionHalfNormalTex
+	{
+		struct Vertex
+		{
+			DirectX::XMFLOAT3 Position;              // DXGI_FORMAT_R32G32B32_FLOAT
+			DirectX::PackedVector::XMHALF4 Normal;   // DXGI_FORMAT_R16G16B16A16_FLOAT
+			DirectX::XMFLOAT2 TexC;                  // DXGI_FORMAT_R32G32_FLOAT
+		};
+
+		static void Encode(const GeometryGenerator::Vertex& in, Vertex& out)
+		{
+			out.Position = in.Position;
+			DirectX::PackedVector::XMStoreHalf4(&out.Normal,
+				DirectX::XMVectorSetW(DirectX::XMLoadFloat3(&in.Normal), 0.0f));
+			out.TexC = in.TexC;
+		}
+	};
+
+	// 24 bytes.  Decode the normal with OctDecode in the vertex shader.
+	struct PositionOctNormalTex
+	{
+		struct Vertex
+		{
+			DirectX::XMFLOAT3 Position;               // DXGI_FORMAT_R32G32B32_FLOAT
+			DirectX::PackedVector::XMSHORTN2 Normal;  // DXGI_FORMAT_R16G16_SNORM
+			DirectX::XMFLOAT2 TexC;                   // DXGI_FORMAT_R32G32_FLOAT
+		};
+
+		static void Encode(const GeometryGenerator::Vertex& in, Vertex& out)
+		{
+			DirectX::XMFLOAT2 oct = OctEncode(in.Normal);
+
+			out.Position = in.Position;
+			DirectX::PackedVector::XMStoreShortN2(&out.Normal, DirectX::XMLoadFloat2(&oct));
+			out.TexC = in.TexC;
+		}
+	};
+
+	// 28 bytes instead of 44 for normal mapping.  The tangent w holds the bitangent
+	// sign, which is always +1 for the generated shapes.
+	struct PositionOctNormalTangentTex
+	{
+		struct Vertex
+		{
+			DirectX::XMFLOAT3 Position;               // DXGI_FORMAT_R32G32B32_FLOAT
+			DirectX::PackedVector::XMSHORTN2 Normal;  // DXGI_FORMAT_R16G16_SNORM
+			DirectX::PackedVector::XMBYTEN4 TangentU; // DXGI_FORMAT_R8G8B8A8_SNORM
+			DirectX::XMFLOAT2 TexC;                   // DXGI_FORMAT_R32G32_FLOAT
+		};
+
+		static void Encode(const GeometryGenerator::Vertex& in, Vertex& out)
+		{
+			DirectX::XMFLOAT2 oct = OctEncode(in.Normal);
+
+			out.Position = in.Position;
+			DirectX::PackedVector::XMStoreShortN2(&out.Normal, DirectX::XMLoadFloat2(&oct));
+			DirectX::PackedVector::XMStoreByteN4(&out.TangentU,
+				DirectX::XMVectorSetW(DirectX::XMLoadFloat3(&in.TangentU), 1.0f));
+			out.TexC = in.TexC;
+		}
+	};
+}
@@ -473,6 +473,9 @@ bool D3DApp::InitDirect3D()
 
 	CreateCommandObjects();
     CreateSwapChain();
+
+	mFrameFence = std::make_unique<D3D12FrameFence>(mCommandQueue.Get(), mFence.Get(), mCurrentFence);
+	mFramePacer = std::make_unique<FramePacer>(*mFrameFence, mFramesInFlight);
     CreateRtvAndDsvDescriptorHeaps();
 
 	return true;
@@ -533,26 +536,9 @@ void D3DApp::CreateSwapChain()
 
 void D3DApp::FlushCommandQueue()
 {
-	// Advance the fence value to mark commands up to this fence point.
-    mCurrentFence++;
-
-    // Add an instruction to the command queue to set a new fence point.  Because we 
-	// are on the GPU timeline, the new fence point won't be set until the GPU finishes
-	// processing all the commands prior to this Signal().
-    ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
-
-	// Wait until the GPU has completed commands up to this fence point.
-    if(mFence->GetCompletedValue() < mCurrentFence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-
-        // Fire event when GPU hits current fence.  
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFence, eventHandle));
-
-        // Wait until the GPU hits current fence event is fired.
-		WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-	}
+	// Signal a new fence point and wait until the GPU has completed commands up to it,
+	// running the app's idle work meanwhile.
+	mFramePacer->WaitForIdle();
 }
 
 ID3D12Resource* D3DApp::CurrentBackBuffer()const
@@ -581,6 +567,7 @@ void D3DApp::CalculateFrameStats()
     
 	static int frameCnt = 0;
 	static float timeElapsed = 0.0f;
+	static double waitMsElapsed = 0.0;
 
 	frameCnt++;
 
@@ -590,12 +577,19 @@ void D3DApp::CalculateFrameStats()
 		float fps = (float)frameCnt; // fps = frameCnt / 1
 		float mspf = 1000.0f / fps;
 
+		// Time the CPU spent waiting for the GPU, per frame.
+		double waitMs = mFramePacer->GetStats().WaitMs;
+		float waitpf = (float)(waitMs - waitMsElapsed) / fps;
+		waitMsElapsed = waitMs;
+
         wstring fpsStr = to_wstring(fps);
         wstring mspfStr = to_wstring(mspf);
+        wstring waitpfStr = to_wstring(waitpf);
 
         wstring windowText = mMainWndCaption +
             L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+            L"   mspf: " + mspfStr +
+            L"   wait: " + waitpfStr;
 
         SetWindowText(mhMainWnd, windowText.c_str());
 		
@@ -11,6 +11,8 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "D3D12FrameFence.h"
+#include "FramePacer.h"
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
@@ -97,6 +99,11 @@ protected:
 
     Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
     UINT64 mCurrentFence = 0;
+
+    // Waits for the GPU, between frames and in FlushCommandQueue.  The frame fence
+    // signals mFence with values from mCurrentFence.
+    std::unique_ptr<D3D12FrameFence> mFrameFence;
+    std::unique_ptr<FramePacer> mFramePacer;
 	
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> mCommandQueue;
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mDirectCmdListAlloc;
@@ -124,5 +131,6 @@ protected:
     DXGI_FORMAT mDepthStencilFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 	int mClientWidth = 800;
 	int mClientHeight = 600;
+	UINT mFramesInFlight = 3;
 };
 
@@ -0,0 +1,44 @@
+//***************************************************************************************
+// BenchMain.cpp
+//
+// Runs every registered benchmark, or only those whose name contains one of the
+// command line arguments, and prints their results to stdout.  Exits with 1 if a
+// benchmark's own checks failed.  Build it optimized (CMAKE_BUILD_TYPE=Release).
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include <cstring>
+
+static bool IsSelected(const char* name, int argc, char* argv[])
+{
+	if(argc < 2)
+		return true;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strstr(name, argv[i]) != nullptr)
+			return true;
+	}
+	return false;
+}
+
+int main(int argc, char* argv[])
+{
+	int failed = 0;
+	for(const TestFramework::Benchmark& benchmark : TestFramework::Benchmarks())
+	{
+		if(!IsSelected(benchmark.Name, argc, argv))
+			continue;
+
+		std::printf("== %s\n", benchmark.Name);
+		std::fflush(stdout);
+		if(!benchmark.Run())
+		{
+			failed++;
+			std::printf("FAILED  %s\n", benchmark.Name);
+		}
+		std::printf("\n");
+	}
+
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+//***************************************************************************************
+// BezierPatchEvaluatorBench.cpp
+//
+// Tessellates a field of 10,000 patches on the CPU, at a fixed level and at levels
+// picked per patch, and checks a sample of the vertices against a scalar evaluation
+// of the patch.  Needs DirectXMath.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/BezierPatchEvaluator.h"
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+	// Largest distance between every 97th vertex and the patch at its (u, v).
+	float SampledPositionError(const std::vector<BezierPatchEvaluator::Patch>& patches,
+		const std::vector<std::uint32_t>& levels, const GeometryGenerator::MeshData& mesh)
+	{
+		float maxError = 0.0f;
+		size_t start = 0;
+		for(size_t p = 0; p < patches.size(); ++p)
+		{
+			size_t count = (size_t)(levels[p] + 1)*(levels[p] + 1);
+			for(size_t k = (97 - start % 97) % 97; k < count; k += 97)
+			{
+				const GeometryGenerator::Vertex& vertex = mesh.Vertices[start + k];
+				float u = vertex.TexC.x;
+				float v = vertex.TexC.y;
+				float bu[4] = { (1-u)*(1-u)*(1-u), 3*u*(1-u)*(1-u), 3*u*u*(1-u), u*u*u };
+				float bv[4] = { (1-v)*(1-v)*(1-v), 3*v*(1-v)*(1-v), 3*v*v*(1-v), v*v*v };
+
+				float expected[3] = { 0.0f, 0.0f, 0.0f };
+				for(int r = 0; r < 4; ++r)
+				{
+					for(int c = 0; c < 4; ++c)
+					{
+						const XMFLOAT3& cp = patches[p].ControlPoints[r*4 + c];
+						expected[0] += bv[r]*bu[c]*cp.x;
+						expected[1] += bv[r]*bu[c]*cp.y;
+						expected[2] += bv[r]*bu[c]*cp.z;
+					}
+				}
+
+				float dx = vertex.Position.x - expected[0];
+				float dy = vertex.Position.y - expected[1];
+				float dz = vertex.Position.z - expected[2];
+				maxError = std::fmax(maxError, std::sqrt(dx*dx + dy*dy + dz*dz));
+			}
+			start += count;
+		}
+		return maxError;
+	}
+}
+
+BENCHMARK(BezierPatchEvaluator)
+{
+	const int patchesPerSide = 100;
+	const float tolerance = 0.05f;
+	const std::uint32_t uniformLevel = 16;
+
+	// A field of patches with the demo patch's layout, each with a different bulge.
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> height(0.0f, 20.0f);
+	std::vector<BezierPatchEvaluator::Patch> patches(patchesPerSide*patchesPerSide);
+	for(int i = 0; i < patchesPerSide; ++i)
+	{
+		for(int j = 0; j < patchesPerSide; ++j)
+		{
+			BezierPatchEvaluator::Patch& patch = patches[i*patchesPerSide + j];
+			for(int r = 0; r < 4; ++r)
+			{
+				for(int c = 0; c < 4; ++c)
+				{
+					bool inner = (r == 1 || r == 2) && (c == 1 || c == 2);
+					float y = inner ? height(random) : 0.0f;
+					patch.ControlPoints[r*4 + c] = XMFLOAT3(j*30.0f + c*10.0f, y, i*30.0f - r*10.0f);
+				}
+			}
+		}
+	}
+
+	BezierPatchEvaluator evaluator;
+	GeometryGenerator::MeshData mesh;
+
+	auto start = std::chrono::steady_clock::now();
+	evaluator.Tessellate(patches.data(), (std::uint32_t)patches.size(), uniformLevel, mesh);
+	Milliseconds uniformTime = std::chrono::steady_clock::now() - start;
+
+	std::vector<std::uint32_t> uniformLevels(patches.size(), uniformLevel);
+	float uniformError = SampledPositionError(patches, uniformLevels, mesh);
+	size_t uniformVertices = mesh.Vertices.size();
+
+	start = std::chrono::steady_clock::now();
+	std::vector<std::uint32_t> levels(patches.size());
+	for(size_t i = 0; i < patches.size(); ++i)
+		levels[i] = BezierPatchEvaluator::SegmentsForTolerance(patches[i], tolerance);
+	evaluator.Tessellate(patches.data(), (std::uint32_t)patches.size(), levels.data(), mesh);
+	Milliseconds adaptiveTime = std::chrono::steady_clock::now() - start;
+
+	float adaptiveError = SampledPositionError(patches, levels, mesh);
+
+	std::printf("%zu patches\n", patches.size());
+	std::printf("    %u segments:  %8.2f ms, %zu vertices, max sampled error %g\n",
+		uniformLevel, uniformTime.count(), uniformVertices, uniformError);
+	std::printf("    adaptive:     %8.2f ms, %zu vertices, max sampled error %g\n",
+		adaptiveTime.count(), mesh.Vertices.size(), adaptiveError);
+
+	// The field spans 3000 units, where a float step is about 2.4e-4.
+	const float maxError = 1.0e-2f;
+	return uniformError < maxError && adaptiveError < maxError;
+}
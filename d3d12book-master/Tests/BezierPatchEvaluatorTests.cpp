@@ -0,0 +1,160 @@
+//***************************************************************************************
+// BezierPatchEvaluatorTests.cpp
+//
+// Checks BezierPatchEvaluator's tessellation against a scalar evaluation of the patch
+// at each vertex's (u, v).  Needs DirectXMath.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/BezierPatchEvaluator.h"
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	// The patch at (u, v), summing the Bernstein weights directly.
+	XMFLOAT3 ReferencePoint(const BezierPatchEvaluator::Patch& patch, float u, float v)
+	{
+		auto basis = [](float t, float b[4])
+		{
+			float s = 1.0f - t;
+			b[0] = s*s*s;
+			b[1] = 3.0f*t*s*s;
+			b[2] = 3.0f*t*t*s;
+			b[3] = t*t*t;
+		};
+
+		float bu[4], bv[4];
+		basis(u, bu);
+		basis(v, bv);
+
+		XMFLOAT3 p(0.0f, 0.0f, 0.0f);
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+			{
+				const XMFLOAT3& cp = patch.ControlPoints[r*4 + c];
+				float w = bv[r]*bu[c];
+				p.x += w*cp.x;
+				p.y += w*cp.y;
+				p.z += w*cp.z;
+			}
+		}
+		return p;
+	}
+
+	BezierPatchEvaluator::Patch RandomPatch(std::mt19937& random, float x0, float z0)
+	{
+		std::uniform_real_distribution<float> height(0.0f, 20.0f);
+
+		BezierPatchEvaluator::Patch patch;
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+				patch.ControlPoints[r*4 + c] = XMFLOAT3(x0 + c*10.0f, height(random), z0 - r*10.0f);
+		}
+		return patch;
+	}
+
+	// Largest distance between a tessellated vertex and the patch at its (u, v).
+	float MaxPositionError(const std::vector<BezierPatchEvaluator::Patch>& patches, const std::vector<std::uint32_t>& levels,
+		const GeometryGenerator::MeshData& mesh)
+	{
+		float maxError = 0.0f;
+		size_t vertex = 0;
+		for(size_t p = 0; p < patches.size(); ++p)
+		{
+			std::uint32_t n = levels[p] + 1;
+			for(std::uint32_t k = 0; k < n*n; ++k, ++vertex)
+			{
+				const GeometryGenerator::Vertex& v = mesh.Vertices[vertex];
+				XMFLOAT3 expected = ReferencePoint(patches[p], v.TexC.x, v.TexC.y);
+				float dx = v.Position.x - expected.x;
+				float dy = v.Position.y - expected.y;
+				float dz = v.Position.z - expected.z;
+				maxError = std::fmax(maxError, std::sqrt(dx*dx + dy*dy + dz*dz));
+			}
+		}
+		return maxError;
+	}
+}
+
+TEST(BezierPatchEvaluator_VerticesLieOnThePatch)
+{
+	// Five patches, so one group of four lanes and one partly filled group.
+	std::mt19937 random(7);
+	std::vector<BezierPatchEvaluator::Patch> patches;
+	for(int i = 0; i < 5; ++i)
+		patches.push_back(RandomPatch(random, i*30.0f, 0.0f));
+
+	std::vector<std::uint32_t> levels = { 1, 3, 3, 8, 3 };
+
+	BezierPatchEvaluator evaluator;
+	GeometryGenerator::MeshData mesh;
+	evaluator.Tessellate(patches.data(), (std::uint32_t)patches.size(), levels.data(), mesh);
+
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for(std::uint32_t level : levels)
+	{
+		vertexCount += (level + 1)*(level + 1);
+		indexCount += level*level*6;
+	}
+	REQUIRE(mesh.Vertices.size() == vertexCount);
+	CHECK_EQUAL(indexCount, mesh.Indices32.size());
+	CHECK(MaxPositionError(patches, levels, mesh) < 1.0e-3f);
+
+	// The corners of each grid are the corner control points.
+	const GeometryGenerator::Vertex& first = mesh.Vertices[0];
+	CHECK(first.TexC.x == 0.0f && first.TexC.y == 0.0f);
+	CHECK(std::fabs(first.Position.y - patches[0].ControlPoints[0].y) < 1.0e-4f);
+
+	// Every index stays inside its own patch's vertex range.
+	std::uint32_t badIndices = 0;
+	for(std::uint32_t index : mesh.Indices32)
+	{
+		if(index >= vertexCount)
+			badIndices++;
+	}
+	CHECK_EQUAL(0u, badIndices);
+}
+
+TEST(BezierPatchEvaluator_NormalsAreUnitLength)
+{
+	std::mt19937 random(11);
+	std::vector<BezierPatchEvaluator::Patch> patches = { RandomPatch(random, 0.0f, 0.0f) };
+
+	BezierPatchEvaluator evaluator;
+	GeometryGenerator::MeshData mesh;
+	evaluator.Tessellate(patches.data(), 1, 16, mesh);
+
+	std::uint32_t badNormals = 0;
+	for(const GeometryGenerator::Vertex& v : mesh.Vertices)
+	{
+		float length = std::sqrt(v.Normal.x*v.Normal.x + v.Normal.y*v.Normal.y + v.Normal.z*v.Normal.z);
+		if(std::fabs(length - 1.0f) > 1.0e-3f)
+			badNormals++;
+	}
+	CHECK_EQUAL(0u, badNormals);
+}
+
+TEST(BezierPatchEvaluator_SegmentsForToleranceFollowsCurvature)
+{
+	BezierPatchEvaluator::Patch flat;
+	for(int r = 0; r < 4; ++r)
+	{
+		for(int c = 0; c < 4; ++c)
+			flat.ControlPoints[r*4 + c] = XMFLOAT3(c*10.0f, 0.0f, -r*10.0f);
+	}
+	CHECK_EQUAL(1u, BezierPatchEvaluator::SegmentsForTolerance(flat, 0.05f));
+
+	BezierPatchEvaluator::Patch bulge = flat;
+	bulge.ControlPoints[5].y = 20.0f;
+	std::uint32_t coarse = BezierPatchEvaluator::SegmentsForTolerance(bulge, 1.0f);
+	std::uint32_t fine = BezierPatchEvaluator::SegmentsForTolerance(bulge, 0.01f);
+	CHECK(coarse > 1);
+	CHECK(fine > coarse);
+	CHECK(fine <= BezierPatchEvaluator::MaxSegments);
+}
@@ -0,0 +1,157 @@
+//***************************************************************************************
+// BlobCacheTests.cpp
+//
+// Stores and loads blobs in a folder of the build folder, and damages the files to
+// check that a truncated, corrupt or misplaced file is a miss rather than a bad blob.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/BlobCache.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace
+{
+	BlobCache::Blob MakeBlob(std::size_t size, std::uint8_t seed)
+	{
+		BlobCache::Blob blob(size);
+		for(std::size_t i = 0; i < size; ++i)
+			blob[i] = (std::uint8_t)(seed + i*7);
+		return blob;
+	}
+
+	// The file BlobCache keeps key in: its name is the key in hex.
+	std::string FilePath(const BlobCache& cache, BlobCache::uint64 key)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+		return cache.GetDirectory() + name;
+	}
+
+	std::string ReadFile(const std::string& path)
+	{
+		std::ifstream fin(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	}
+
+	bool WriteFile(const std::string& path, const std::string& contents)
+	{
+		std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+		fout.write(contents.data(), (std::streamsize)contents.size());
+		return (bool)fout;
+	}
+}
+
+TEST(BlobCache_StoresAndLoads)
+{
+	BlobCache cache(TestFramework::ScratchPath("BlobCacheStore"));
+	cache.Remove(1);
+	cache.Remove(2);
+	cache.Remove(3);
+
+	BlobCache::Blob blob;
+	CHECK(!cache.Load(1, blob));
+
+	CHECK(cache.Store(1, MakeBlob(1000, 1)));
+	CHECK(cache.Store(2, BlobCache::Blob()));
+	CHECK(cache.Load(1, blob));
+	CHECK(blob == MakeBlob(1000, 1));
+
+	// Empty blobs are stored too.
+	blob = MakeBlob(10, 0);
+	CHECK(cache.Load(2, blob));
+	CHECK(blob.empty());
+
+	// Storing again replaces the blob.
+	CHECK(cache.Store(1, MakeBlob(37, 5)));
+	CHECK(cache.Load(1, blob));
+	CHECK(blob == MakeBlob(37, 5));
+
+	// A second cache over the same folder sees the same blobs.
+	BlobCache reopened(cache.GetDirectory());
+	CHECK(reopened.Load(1, blob));
+	CHECK(blob == MakeBlob(37, 5));
+
+	cache.Remove(1);
+	CHECK(!cache.Load(1, blob));
+	CHECK(!cache.Load(3, blob));
+
+	cache.Remove(2);
+}
+
+TEST(BlobCache_TruncatedFileIsAMiss)
+{
+	BlobCache cache(TestFramework::ScratchPath("BlobCacheTruncated"));
+	REQUIRE(cache.Store(1, MakeBlob(500, 3)));
+
+	std::string contents = ReadFile(FilePath(cache, 1));
+	REQUIRE(contents.size() > 500);
+
+	// Cut into the blob, then into the header, then to nothing.
+	const std::size_t lengths[] = { contents.size() - 1, contents.size() - 500, 10, 0 };
+	for(std::size_t length : lengths)
+	{
+		REQUIRE(WriteFile(FilePath(cache, 1), contents.substr(0, length)));
+
+		BlobCache::Blob blob;
+		CHECK(!cache.Load(1, blob));
+		CHECK(blob.empty());
+	}
+
+	// Extra bytes after the blob are a miss too.
+	REQUIRE(WriteFile(FilePath(cache, 1), contents + "x"));
+	BlobCache::Blob blob;
+	CHECK(!cache.Load(1, blob));
+
+	cache.Remove(1);
+}
+
+TEST(BlobCache_CorruptFileIsAMiss)
+{
+	BlobCache cache(TestFramework::ScratchPath("BlobCacheCorrupt"));
+	REQUIRE(cache.Store(1, MakeBlob(500, 3)));
+
+	std::string contents = ReadFile(FilePath(cache, 1));
+	REQUIRE(contents.size() > 500);
+
+	// Flip a byte of the blob, the last byte, and a byte of the header.
+	const std::size_t positions[] = { contents.size() - 250, contents.size() - 1, 0, 20 };
+	for(std::size_t position : positions)
+	{
+		std::string damaged = contents;
+		damaged[position] ^= 0x40;
+		REQUIRE(WriteFile(FilePath(cache, 1), damaged));
+
+		BlobCache::Blob blob;
+		CHECK(!cache.Load(1, blob));
+		CHECK(blob.empty());
+	}
+
+	// The undamaged file still loads, so the misses were the damage.
+	REQUIRE(WriteFile(FilePath(cache, 1), contents));
+	BlobCache::Blob blob;
+	CHECK(cache.Load(1, blob));
+	CHECK(blob == MakeBlob(500, 3));
+
+	cache.Remove(1);
+}
+
+TEST(BlobCache_FileOfAnotherKeyIsAMiss)
+{
+	BlobCache cache(TestFramework::ScratchPath("BlobCacheWrongKey"));
+	cache.Remove(2);
+	REQUIRE(cache.Store(1, MakeBlob(100, 9)));
+
+	// A file copied or renamed to another key's name holds the wrong key.
+	REQUIRE(WriteFile(FilePath(cache, 2), ReadFile(FilePath(cache, 1))));
+
+	BlobCache::Blob blob;
+	CHECK(!cache.Load(2, blob));
+	CHECK(cache.Load(1, blob));
+
+	cache.Remove(1);
+	cache.Remove(2);
+}
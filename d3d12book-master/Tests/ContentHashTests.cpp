@@ -0,0 +1,57 @@
+//***************************************************************************************
+// ContentHashTests.cpp
+//
+// Checks ContentHash against the published FNV-1a test values, and that strings and
+// arrays are hashed with their lengths so differently split values differ.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/ContentHash.h"
+#include <cstdint>
+#include <string>
+
+TEST(ContentHash_MatchesFnv1a)
+{
+	CHECK_EQUAL(0xcbf29ce484222325ull, ContentHash().Get());
+	CHECK_EQUAL(0xaf63dc4c8601ec8cull, ContentHash::Of("a", 1));
+	CHECK_EQUAL(0x85944171f73967e8ull, ContentHash::Of("foobar", 6));
+
+	// AddBytes continues the stream, so bytes may be added in any pieces.
+	CHECK_EQUAL(ContentHash::Of("foobar", 6), ContentHash().AddBytes("foo", 3).AddBytes("bar", 3).Get());
+}
+
+TEST(ContentHash_StringsAreLengthPrefixed)
+{
+	ContentHash::uint64 ab_c = ContentHash().AddString("ab").AddString("c").Get();
+	ContentHash::uint64 a_bc = ContentHash().AddString("a").AddString("bc").Get();
+	ContentHash::uint64 abc = ContentHash().AddString("abc").Get();
+	CHECK(ab_c != a_bc);
+	CHECK(ab_c != abc);
+	CHECK(a_bc != abc);
+
+	// An empty string still adds its length.
+	CHECK(ContentHash().AddString("").Get() != ContentHash().Get());
+	CHECK(ContentHash().AddString("").AddString("a").Get() != ContentHash().AddString("a").AddString("").Get());
+
+	// The same values hash the same.
+	CHECK_EQUAL(ab_c, ContentHash().AddString("ab").AddString("c").Get());
+}
+
+TEST(ContentHash_ArraysAreLengthPrefixed)
+{
+	const std::uint8_t bytes[] = { 1, 2, 3 };
+	ContentHash::uint64 a12_3 = ContentHash().AddArray(bytes, 2).AddArray(bytes + 2, 1).Get();
+	ContentHash::uint64 a1_23 = ContentHash().AddArray(bytes, 1).AddArray(bytes + 1, 2).Get();
+	CHECK(a12_3 != a1_23);
+
+	// A string and an array of the same bytes hash the same: both are the length,
+	// then the bytes.
+	CHECK_EQUAL(ContentHash().AddString("foo").Get(), ContentHash().AddArray("foo", 3).Get());
+}
+
+TEST(ContentHash_ValuesHashTheirBytes)
+{
+	std::uint32_t value = 0x01020304;
+	CHECK_EQUAL(ContentHash::Of(&value, sizeof(value)), ContentHash().AddValue(value).Get());
+	CHECK(ContentHash().AddValue(value).Get() != ContentHash().AddValue((std::uint64_t)value).Get());
+}
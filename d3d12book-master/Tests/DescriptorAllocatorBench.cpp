@@ -0,0 +1,146 @@
+//***************************************************************************************
+// DescriptorAllocatorBench.cpp
+//
+// Times DescriptorAllocator over 10,000 frames with three in flight.  Each frame takes
+// a CBV per visible object from the transient ring, as ShapesApp does, and replaces a
+// few persistent texture ranges, freeing the old ones with the frame's fence.  The run
+// keeps its own map of the heap and fails if a descriptor is handed out while a live
+// range or an unfinished frame still holds it.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/DescriptorAllocator.h"
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+	struct Held
+	{
+		std::uint64_t FenceValue;
+		std::uint32_t Offset;
+		std::uint32_t Count;
+	};
+}
+
+BENCHMARK(DescriptorAllocator)
+{
+	const int frameCount = 10000;
+	const std::uint64_t framesInFlight = 3;
+	const std::uint32_t persistentCount = 4096;
+	const std::uint32_t maxVisible = 500;
+	const std::uint32_t transientCount = (std::uint32_t)(framesInFlight + 1)*(maxVisible + 1);
+	const int rangesReplacedPerFrame = 4;
+
+	DescriptorAllocator allocator(persistentCount, transientCount);
+	std::mt19937 random(1);
+	std::uniform_int_distribution<std::uint32_t> visible(1, maxVisible);
+	std::uniform_int_distribution<std::uint32_t> rangeSize(1, 8);
+
+	// Which frame or range holds each descriptor, as far as the run knows.
+	std::vector<std::uint8_t> inUse(persistentCount + transientCount, 0);
+	std::deque<Held> held;
+	int doubleAllocations = 0;
+	int failures = 0;
+
+	auto take = [&](std::uint32_t offset, std::uint32_t count)
+	{
+		for(std::uint32_t i = offset; i < offset + count; ++i)
+		{
+			doubleAllocations += inUse[i];
+			inUse[i] = 1;
+		}
+	};
+
+	auto release = [&](std::uint64_t completed)
+	{
+		for(size_t i = 0; i < held.size();)
+		{
+			if(held[i].FenceValue <= completed)
+			{
+				for(std::uint32_t k = held[i].Offset; k < held[i].Offset + held[i].Count; ++k)
+					inUse[k] = 0;
+				held[i] = held.back();
+				held.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+	};
+
+	// A scene's worth of textures to start with.
+	std::vector<DescriptorRangeHandle> textures;
+	for(int i = 0; i < 400; ++i)
+	{
+		DescriptorRangeHandle h = allocator.Allocate(rangeSize(random));
+		take(allocator.GetOffset(h), allocator.GetCount(h));
+		textures.push_back(h);
+	}
+
+	std::uint64_t operations = 0;
+	Milliseconds allocatorTime(0.0);
+	for(std::uint64_t fence = 1; fence <= (std::uint64_t)frameCount; ++fence)
+	{
+		std::uint64_t completed = fence > framesInFlight ? fence - framesInFlight : 0;
+
+		auto start = std::chrono::steady_clock::now();
+		allocator.Reclaim(completed);
+		allocatorTime += std::chrono::steady_clock::now() - start;
+		release(completed);
+
+		std::uint32_t cbvCount = visible(random) + 1;
+		start = std::chrono::steady_clock::now();
+		std::uint32_t cbvStart = allocator.AllocateTransient(cbvCount);
+		allocatorTime += std::chrono::steady_clock::now() - start;
+		operations += 2;
+
+		if(cbvStart == DescriptorAllocator::InvalidOffset)
+		{
+			failures++;
+		}
+		else
+		{
+			// A wrap holds the padding at the end of the ring too; the allocator keeps it,
+			// so only the range itself is checked.
+			take(cbvStart, cbvCount);
+			Held h = { fence, cbvStart, cbvCount };
+			held.push_back(h);
+		}
+
+		for(int r = 0; r < rangesReplacedPerFrame; ++r)
+		{
+			DescriptorRangeHandle& texture = textures[random() % textures.size()];
+			Held old = { fence, allocator.GetOffset(texture), allocator.GetCount(texture) };
+
+			start = std::chrono::steady_clock::now();
+			allocator.Free(texture, fence);
+			texture = allocator.Allocate(rangeSize(random));
+			allocatorTime += std::chrono::steady_clock::now() - start;
+			operations += 2;
+
+			held.push_back(old);
+			if(!allocator.IsValid(texture))
+			{
+				std::printf("    no persistent range free at frame %llu\n", (unsigned long long)fence);
+				return false;
+			}
+			take(allocator.GetOffset(texture), allocator.GetCount(texture));
+		}
+
+		allocator.FinishFrame(fence);
+	}
+
+	std::printf("%d frames, %llu allocator calls\n", frameCount, (unsigned long long)operations);
+	std::printf("    %8.2f ms, %.1f ns a call\n", allocatorTime.count(), allocatorTime.count()*1.0e6/operations);
+	std::printf("    peak frame %u of %u transient descriptors, %u persistent free\n",
+		allocator.GetPeakFrameTransientCount(), transientCount, allocator.GetFreePersistentCount());
+	std::printf("    %d failed allocations, %d descriptors handed out twice\n", failures, doubleAllocations);
+
+	return failures == 0 && doubleAllocations == 0;
+}
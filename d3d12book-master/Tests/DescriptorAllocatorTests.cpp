@@ -0,0 +1,153 @@
+//***************************************************************************************
+// DescriptorAllocatorTests.cpp
+//
+// Checks DescriptorAllocator's persistent ranges (handle generations, frees deferred
+// until their fence completes) and its transient ring (wrap padding, running full), and
+// the best-fit free list under them.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/DescriptorAllocator.h"
+
+TEST(DescriptorAllocator_FreeInvalidatesTheHandle)
+{
+	DescriptorAllocator allocator(16, 0);
+	CHECK(!allocator.IsValid(DescriptorRangeHandle()));
+
+	DescriptorRangeHandle a = allocator.Allocate(4);
+	REQUIRE(allocator.IsValid(a));
+	CHECK_EQUAL(0u, allocator.GetOffset(a));
+	CHECK_EQUAL(4u, allocator.GetCount(a));
+	CHECK_EQUAL(12u, allocator.GetFreePersistentCount());
+
+	allocator.Free(a, 0);
+	CHECK(!allocator.IsValid(a));
+	CHECK_EQUAL(16u, allocator.GetFreePersistentCount());
+
+	// The next range reuses the handle's entry with a new generation: the old handle
+	// stays invalid rather than naming the new range.
+	DescriptorRangeHandle b = allocator.Allocate(2);
+	REQUIRE(allocator.IsValid(b));
+	CHECK_EQUAL(a.Index, b.Index);
+	CHECK(a.Generation != b.Generation);
+	CHECK(!allocator.IsValid(a));
+
+	CHECK(!allocator.IsValid(allocator.Allocate(0)));
+	CHECK(!allocator.IsValid(allocator.Allocate(15)));
+}
+
+TEST(DescriptorAllocator_FreedRangesWaitForTheirFence)
+{
+	DescriptorAllocator allocator(8, 0);
+	DescriptorRangeHandle a = allocator.Allocate(8);
+	REQUIRE(allocator.IsValid(a));
+
+	// Frame 5 still reads the range: the handle dies now, the descriptors later.
+	allocator.Free(a, 5);
+	CHECK(!allocator.IsValid(a));
+	CHECK_EQUAL(1u, allocator.GetPendingFreeCount());
+	CHECK_EQUAL(0u, allocator.GetFreePersistentCount());
+	CHECK(!allocator.IsValid(allocator.Allocate(1)));
+
+	allocator.Reclaim(4);
+	CHECK_EQUAL(1u, allocator.GetPendingFreeCount());
+	CHECK(!allocator.IsValid(allocator.Allocate(1)));
+
+	allocator.Reclaim(5);
+	CHECK_EQUAL(0u, allocator.GetPendingFreeCount());
+	CHECK_EQUAL(8u, allocator.GetFreePersistentCount());
+	CHECK(allocator.IsValid(allocator.Allocate(8)));
+}
+
+TEST(DescriptorAllocator_FreesOutOfFenceOrderAreReclaimed)
+{
+	DescriptorAllocator allocator(8, 0);
+	DescriptorRangeHandle a = allocator.Allocate(4);
+	DescriptorRangeHandle b = allocator.Allocate(4);
+	allocator.Free(a, 9);
+	allocator.Free(b, 3);
+
+	allocator.Reclaim(3);
+	CHECK_EQUAL(4u, allocator.GetFreePersistentCount());
+	CHECK_EQUAL(1u, allocator.GetPendingFreeCount());
+
+	allocator.Reclaim(9);
+	CHECK_EQUAL(8u, allocator.GetFreePersistentCount());
+}
+
+TEST(DescriptorAllocator_TransientRingPadsAtTheEnd)
+{
+	// Transient descriptors start after the 4 persistent ones.
+	DescriptorAllocator allocator(4, 10);
+
+	CHECK_EQUAL(4u, allocator.AllocateTransient(6));
+	allocator.FinishFrame(1);
+	CHECK_EQUAL(10u, allocator.AllocateTransient(3));
+	allocator.FinishFrame(2);
+	allocator.Reclaim(1);
+	CHECK_EQUAL(3u, allocator.GetUsedTransientCount());
+
+	// One descriptor is left before the end, so the range wraps to the front and the
+	// skipped one is held by this frame.
+	CHECK_EQUAL(4u, allocator.AllocateTransient(3));
+	CHECK_EQUAL(7u, allocator.GetUsedTransientCount());
+	allocator.FinishFrame(3);
+	CHECK_EQUAL(6u, allocator.GetPeakFrameTransientCount());
+
+	allocator.Reclaim(2);
+	CHECK_EQUAL(4u, allocator.GetUsedTransientCount());
+	allocator.Reclaim(3);
+	CHECK_EQUAL(0u, allocator.GetUsedTransientCount());
+
+	// An empty ring starts over at the front.
+	CHECK_EQUAL(4u, allocator.AllocateTransient(10));
+}
+
+TEST(DescriptorAllocator_TransientRingRunsOut)
+{
+	DescriptorAllocator allocator(0, 8);
+
+	CHECK(allocator.AllocateTransient(0) == DescriptorAllocator::InvalidOffset);
+	CHECK(allocator.AllocateTransient(9) == DescriptorAllocator::InvalidOffset);
+
+	CHECK_EQUAL(0u, allocator.AllocateTransient(5));
+	allocator.FinishFrame(1);
+
+	// Four would wrap, padding three: seven more than the three free.
+	CHECK(allocator.AllocateTransient(4) == DescriptorAllocator::InvalidOffset);
+	CHECK_EQUAL(5u, allocator.AllocateTransient(3));
+	CHECK(allocator.AllocateTransient(1) == DescriptorAllocator::InvalidOffset);
+	CHECK_EQUAL(8u, allocator.GetUsedTransientCount());
+
+	allocator.FinishFrame(2);
+	allocator.Reclaim(1);
+	CHECK_EQUAL(0u, allocator.AllocateTransient(5));
+}
+
+TEST(FreeListAllocator_BestFitAndMerging)
+{
+	FreeListAllocator allocator(16);
+	CHECK_EQUAL(0u, allocator.Allocate(4));
+	CHECK_EQUAL(4u, allocator.Allocate(4));
+	CHECK_EQUAL(8u, allocator.Allocate(2));
+	CHECK_EQUAL(10u, allocator.Allocate(6));
+	CHECK_EQUAL(0u, allocator.GetFreeCount());
+	CHECK(allocator.Allocate(1) == FreeListAllocator::InvalidOffset);
+
+	// Free ranges of 4 at 4 and 6 at 10: three fits best in the 4.
+	allocator.Free(4, 4);
+	allocator.Free(10, 6);
+	CHECK_EQUAL(2u, allocator.GetFreeRangeCount());
+	CHECK_EQUAL(4u, allocator.Allocate(3));
+
+	// Freeing [8, 10) joins [7, 8) and [10, 16).
+	allocator.Free(8, 2);
+	CHECK_EQUAL(1u, allocator.GetFreeRangeCount());
+	CHECK_EQUAL(9u, allocator.GetLargestFreeRange());
+	CHECK_EQUAL(9u, allocator.GetFreeCount());
+
+	allocator.Reset(5);
+	CHECK_EQUAL(11u, allocator.GetFreeCount());
+	CHECK_EQUAL(1u, allocator.GetFreeRangeCount());
+	CHECK_EQUAL(5u, allocator.Allocate(11));
+}
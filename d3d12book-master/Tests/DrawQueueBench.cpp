@@ -0,0 +1,125 @@
+//***************************************************************************************
+// DrawQueueBench.cpp
+//
+// Times filling and sorting 20,000 draws with DrawQueue's radix sort and with std::sort,
+// and counts the state changes submitting them costs unsorted and sorted.  Fails if the
+// radix sort's order differs from std::stable_sort's.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/DrawQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+	// Stands in for the command list: counts the calls DrawQueue::Submit makes.
+	struct CountingRecorder
+	{
+		std::uint32_t StateCalls = 0;
+		std::uint32_t DrawCalls = 0;
+
+		void SetPipelineState(std::uint32_t, std::uint32_t) { StateCalls++; }
+		void SetMaterial(std::uint32_t, std::uint32_t) { StateCalls++; }
+		void SetGeometry(std::uint32_t, std::uint32_t) { StateCalls++; }
+		void Draw(std::uint32_t) { DrawCalls++; }
+	};
+
+	bool PacketLess(const DrawQueue::Packet& a, const DrawQueue::Packet& b)
+	{
+		return a.Key < b.Key;
+	}
+
+	void PrintStats(const char* label, const DrawQueue::Stats& stats)
+	{
+		std::printf("    state changes %s %6u (pipeline %u, material %u, geometry %u)\n",
+			label, stats.StateChanges(), stats.PipelineChanges, stats.MaterialChanges, stats.GeometryChanges);
+	}
+}
+
+BENCHMARK(DrawQueue)
+{
+	const int drawCount = 20000;
+	const int frameCount = 100;
+
+	// A scene of draws in no particular order: 3 layers, 8 pipeline states,
+	// 100 materials and 32 meshes.
+	std::mt19937 random(1);
+	auto uniform = [&](std::uint32_t maxValue)
+	{
+		return std::uniform_int_distribution<std::uint32_t>(0, maxValue)(random);
+	};
+
+	std::vector<std::uint64_t> keys(drawCount);
+	for(int i = 0; i < drawCount; ++i)
+		keys[i] = SortKey::Make(uniform(2), uniform(7), uniform(99), uniform(31), uniform(SortKey::MaxDepth));
+
+	DrawQueue queue;
+	auto fill = [&]()
+	{
+		queue.Clear();
+		for(int i = 0; i < drawCount; ++i)
+			queue.Add(keys[i], i);
+	};
+
+	fill();
+	CountingRecorder unsortedRecorder;
+	DrawQueue::Stats unsorted = queue.Submit(unsortedRecorder);
+
+	auto start = std::chrono::steady_clock::now();
+	for(int frame = 0; frame < frameCount; ++frame)
+	{
+		fill();
+		queue.Sort();
+	}
+	Milliseconds radixTime = std::chrono::steady_clock::now() - start;
+
+	std::vector<DrawQueue::Packet> packets;
+	start = std::chrono::steady_clock::now();
+	for(int frame = 0; frame < frameCount; ++frame)
+	{
+		packets.resize(drawCount);
+		for(int i = 0; i < drawCount; ++i)
+		{
+			packets[i].Key = keys[i];
+			packets[i].Item = i;
+		}
+		std::sort(packets.begin(), packets.end(), PacketLess);
+	}
+	Milliseconds stdSortTime = std::chrono::steady_clock::now() - start;
+
+	CountingRecorder sortedRecorder;
+	start = std::chrono::steady_clock::now();
+	DrawQueue::Stats sorted = queue.Submit(sortedRecorder);
+	Milliseconds submitTime = std::chrono::steady_clock::now() - start;
+
+	// The radix sort is stable, so it must match std::stable_sort item for item.
+	for(int i = 0; i < drawCount; ++i)
+	{
+		packets[i].Key = keys[i];
+		packets[i].Item = i;
+	}
+	std::stable_sort(packets.begin(), packets.end(), PacketLess);
+
+	int misplaced = 0;
+	for(int i = 0; i < drawCount; ++i)
+	{
+		if(queue.GetPackets()[i].Item != packets[i].Item)
+			misplaced++;
+	}
+
+	std::printf("%d draws\n", drawCount);
+	std::printf("    fill + radix sort, ms per frame: %8.3f\n", radixTime.count()/frameCount);
+	std::printf("    fill + std::sort, ms per frame:  %8.3f\n", stdSortTime.count()/frameCount);
+	std::printf("    sorted submit, ms:               %8.3f\n", submitTime.count());
+	PrintStats("unsorted:", unsorted);
+	PrintStats("sorted:  ", sorted);
+	std::printf("    %d draws out of std::stable_sort's order\n", misplaced);
+
+	return misplaced == 0 && sortedRecorder.DrawCalls == (std::uint32_t)drawCount &&
+		sorted.StateChanges() < unsorted.StateChanges();
+}
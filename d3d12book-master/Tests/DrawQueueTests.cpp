@@ -0,0 +1,120 @@
+//***************************************************************************************
+// DrawQueueTests.cpp
+//
+// Checks the sort key layout, DrawQueue's radix sort against std::stable_sort, and that
+// Submit sets only the states that change, for the right items.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/DrawQueue.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Logs the calls Submit makes, one letter and number per call.
+	struct LoggingRecorder
+	{
+		std::vector<std::string> Calls;
+
+		void SetPipelineState(std::uint32_t pipeline, std::uint32_t item) { Log("P", pipeline, item); }
+		void SetMaterial(std::uint32_t material, std::uint32_t item) { Log("M", material, item); }
+		void SetGeometry(std::uint32_t geometry, std::uint32_t item) { Log("G", geometry, item); }
+		void Draw(std::uint32_t item) { Calls.push_back("D@" + std::to_string(item)); }
+
+		void Log(const char* what, std::uint32_t value, std::uint32_t item)
+		{
+			Calls.push_back(what + std::to_string(value) + "@" + std::to_string(item));
+		}
+	};
+}
+
+TEST(DrawQueue_SortKeyFieldsRoundTrip)
+{
+	std::uint64_t key = SortKey::Make(15, 255, 65535, 1234, SortKey::MaxDepth);
+	CHECK_EQUAL(15u, SortKey::Layer(key));
+	CHECK_EQUAL(255u, SortKey::Pipeline(key));
+	CHECK_EQUAL(65535u, SortKey::Material(key));
+	CHECK_EQUAL(1234u, SortKey::Geometry(key));
+	CHECK_EQUAL(SortKey::MaxDepth, SortKey::Depth(key));
+
+	// Layer outranks everything below it.
+	CHECK(SortKey::Make(1, 0, 0, 0, 0) > SortKey::Make(0, 255, 65535, 65535, SortKey::MaxDepth));
+
+	CHECK_EQUAL(0u, SortKey::FrontToBack(0.5f, 1.0f, 100.0f));
+	CHECK_EQUAL(SortKey::MaxDepth, SortKey::FrontToBack(200.0f, 1.0f, 100.0f));
+	CHECK(SortKey::FrontToBack(10.0f, 1.0f, 100.0f) < SortKey::FrontToBack(20.0f, 1.0f, 100.0f));
+	CHECK(SortKey::BackToFront(10.0f, 1.0f, 100.0f) > SortKey::BackToFront(20.0f, 1.0f, 100.0f));
+}
+
+TEST(DrawQueue_SortMatchesStableSort)
+{
+	// Few distinct values per field, so there are many equal keys to keep in order, and
+	// a constant layer byte for the sort to skip.
+	std::mt19937 random(3);
+	std::uniform_int_distribution<std::uint32_t> small(0, 3);
+	std::uniform_int_distribution<std::uint32_t> depth(0, 7);
+
+	const std::uint32_t sizes[] = { 0, 1, 2, 1000 };
+	for(std::uint32_t n : sizes)
+	{
+		DrawQueue queue;
+		std::vector<DrawQueue::Packet> expected;
+		for(std::uint32_t i = 0; i < n; ++i)
+		{
+			std::uint64_t key = SortKey::Make(2, small(random), small(random), small(random), depth(random) << 12);
+			queue.Add(key, i);
+
+			DrawQueue::Packet p;
+			p.Key = key;
+			p.Item = i;
+			expected.push_back(p);
+		}
+
+		queue.Sort();
+		std::stable_sort(expected.begin(), expected.end(),
+			[](const DrawQueue::Packet& a, const DrawQueue::Packet& b) { return a.Key < b.Key; });
+
+		const std::vector<DrawQueue::Packet>& packets = queue.GetPackets();
+		REQUIRE(packets.size() == expected.size());
+
+		int mismatches = 0;
+		for(size_t i = 0; i < packets.size(); ++i)
+		{
+			if(packets[i].Key != expected[i].Key || packets[i].Item != expected[i].Item)
+				mismatches++;
+		}
+		CHECK_EQUAL(0, mismatches);
+	}
+}
+
+TEST(DrawQueue_SubmitSetsOnlyChangedState)
+{
+	DrawQueue queue;
+	queue.Add(SortKey::Make(0, 1, 5, 9, 0), 10);
+	queue.Add(SortKey::Make(0, 1, 5, 9, 4), 11);
+	queue.Add(SortKey::Make(0, 1, 5, 8, 0), 12);
+	queue.Add(SortKey::Make(0, 1, 6, 8, 0), 13);
+	queue.Add(SortKey::Make(0, 2, 6, 8, 0), 14);
+
+	LoggingRecorder recorder;
+	DrawQueue::Stats stats = queue.Submit(recorder);
+
+	const char* expected[] = {
+		"P1@10", "M5@10", "G9@10", "D@10",
+		"D@11",
+		"G8@12", "D@12",
+		"M6@13", "D@13",
+		"P2@14", "D@14" };
+	REQUIRE(recorder.Calls.size() == sizeof(expected)/sizeof(expected[0]));
+	for(size_t i = 0; i < recorder.Calls.size(); ++i)
+		CHECK_EQUAL(std::string(expected[i]), recorder.Calls[i]);
+
+	CHECK_EQUAL(5u, stats.Draws);
+	CHECK_EQUAL(2u, stats.PipelineChanges);
+	CHECK_EQUAL(2u, stats.MaterialChanges);
+	CHECK_EQUAL(2u, stats.GeometryChanges);
+	CHECK_EQUAL(6u, stats.StateChanges());
+}
@@ -0,0 +1,87 @@
+//***************************************************************************************
+// FakeShaderCompiler.h
+//
+// ShaderCompiler stand-in for testing ShaderCache without the D3D compiler.  Shader
+// files are strings set by the test, "#include name" pulls in another one, and the
+// bytecode is the preprocessed source with the entry point and target, so equal
+// bytecode means an equal compilation.  It counts the calls to Compile.
+//
+// SetFile and SetVersion must not be called during a Build.
+//***************************************************************************************
+
+#pragma once
+
+#include "../Common/ShaderCompiler.h"
+#include <atomic>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+class FakeShaderCompiler : public ShaderCompiler
+{
+public:
+	void SetFile(const std::string& filename, const std::string& source)
+	{
+		mFiles[filename] = source;
+	}
+
+	void SetVersion(const std::string& version)
+	{
+		mVersion = version;
+	}
+
+	int GetCompileCount()const
+	{
+		return mCompileCount;
+	}
+
+	virtual std::string GetVersion()override
+	{
+		return mVersion;
+	}
+
+	virtual std::string Preprocess(const ShaderRequest& request)override
+	{
+		std::string source;
+		for(auto& define : request.Defines)
+			source += "#define " + define.first + " " + define.second + "\n";
+
+		return source + Expand(request.Filename, 0);
+	}
+
+	virtual Blob Compile(const ShaderRequest& request)override
+	{
+		mCompileCount++;
+
+		std::string text = request.EntryPoint + " " + request.Target + "\n" + Preprocess(request);
+		return Blob(text.begin(), text.end());
+	}
+
+private:
+	std::string Expand(const std::string& filename, int depth)const
+	{
+		auto it = mFiles.find(filename);
+		if(it == mFiles.end() || depth > 16)
+			throw std::runtime_error("cannot open " + filename);
+
+		std::istringstream lines(it->second);
+		std::string expanded;
+		std::string line;
+		while(std::getline(lines, line))
+		{
+			const std::string include = "#include ";
+			if(line.compare(0, include.size(), include) == 0)
+				expanded += Expand(line.substr(include.size()), depth + 1);
+			else
+				expanded += line + "\n";
+		}
+
+		return expanded;
+	}
+
+private:
+	std::map<std::string, std::string> mFiles;
+	std::string mVersion = "fake 1";
+	std::atomic<int> mCompileCount{ 0 };
+};
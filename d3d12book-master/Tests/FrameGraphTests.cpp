@@ -0,0 +1,159 @@
+//***************************************************************************************
+// FrameGraphTests.cpp
+//
+// Runs FrameGraph on the job threads against RecordingCommandBackend, which logs the
+// executed commands and checks the allocator and list calls against the D3D12 rules.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/FrameGraph.h"
+#include "../Common/RecordingCommandBackend.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+	typedef FrameGraph<RecordingCommandBackend> RecordingFrameGraph;
+
+	void AddPasses(RecordingFrameGraph& frameGraph, RecordingCommandBackend& backend, int passCount)
+	{
+		for(int pass = 0; pass < passCount; ++pass)
+		{
+			std::string name = "pass " + std::to_string(pass);
+			frameGraph.AddPass(name, [&backend, name](RecordingCommandBackend::CommandList& cmdList)
+			{
+				backend.Record(cmdList, name + " begin");
+				backend.Record(cmdList, name + " end");
+			});
+		}
+	}
+
+	// Runs frameCount frames over frameResourceCount frame resources.  If waitForGpu,
+	// each frame resource's previous frame completes before it is reused, as the apps
+	// wait on its fence.
+	void RunFrames(RecordingFrameGraph& frameGraph, RecordingCommandBackend& backend,
+		std::uint32_t frameResourceCount, int frameCount, bool waitForGpu)
+	{
+		std::vector<std::uint64_t> fences(frameResourceCount, 0);
+		for(int frame = 0; frame < frameCount; ++frame)
+		{
+			std::uint32_t frameResource = frame % frameResourceCount;
+			if(waitForGpu)
+				backend.Complete(fences[frameResource]);
+
+			frameGraph.Execute(frameResource);
+			fences[frameResource] = backend.Signal();
+		}
+	}
+}
+
+TEST(FrameGraph_PassesExecuteInTheOrderAdded)
+{
+	JobSystem jobs(3);
+	RecordingCommandBackend backend;
+	RecordingFrameGraph frameGraph(backend, jobs, 3);
+	AddPasses(frameGraph, backend, 6);
+
+	RecordingFrameGraph::Stats stats = frameGraph.Execute(0);
+	CHECK_EQUAL(6u, stats.PassCount);
+	CHECK(stats.ThreadsUsed >= 1 && stats.ThreadsUsed <= jobs.GetThreadCount());
+	CHECK_EQUAL(1u, backend.GetExecuteCount());
+
+	// Whatever thread recorded a pass, its commands run in pass order.
+	std::vector<std::string> executed = backend.GetExecutedCommands();
+	REQUIRE(executed.size() == 12);
+	for(int pass = 0; pass < 6; ++pass)
+	{
+		CHECK_EQUAL("pass " + std::to_string(pass) + " begin", executed[2*pass]);
+		CHECK_EQUAL("pass " + std::to_string(pass) + " end", executed[2*pass + 1]);
+		CHECK(frameGraph.GetPassThread(pass) < jobs.GetThreadCount());
+	}
+	CHECK_EQUAL(std::string("pass 3"), frameGraph.GetPassName(3));
+	CHECK(backend.GetViolations().empty());
+}
+
+TEST(FrameGraph_NoViolationsAcrossFrameResourceWraparound)
+{
+	JobSystem jobs(3);
+	RecordingCommandBackend backend;
+	RecordingFrameGraph frameGraph(backend, jobs, 3);
+	AddPasses(frameGraph, backend, 7);
+
+	RunFrames(frameGraph, backend, 3, 30, true);
+
+	std::vector<std::string> violations = backend.GetViolations();
+	CHECK_EQUAL(0u, violations.size());
+	for(const std::string& v : violations)
+		std::printf("    %s\n", v.c_str());
+
+	CHECK_EQUAL(30u, backend.GetExecuteCount());
+	CHECK_EQUAL(30u*14u, backend.GetExecutedCommands().size());
+
+	// Every allocator of a frame resource is reset once per frame on it.
+	for(std::uint32_t a = 0; a < backend.GetAllocatorCount(); ++a)
+		CHECK_EQUAL(10u, backend.GetAllocatorResetCount(a));
+}
+
+TEST(FrameGraph_ReusingAFrameResourceTooSoonIsAViolation)
+{
+	JobSystem jobs(0);
+	RecordingCommandBackend backend;
+	RecordingFrameGraph frameGraph(backend, jobs, 2);
+	AddPasses(frameGraph, backend, 2);
+
+	// Two frames fill both frame resources; the third reuses the first before the GPU
+	// has finished it.
+	RunFrames(frameGraph, backend, 2, 2, false);
+	CHECK(backend.GetViolations().empty());
+
+	RunFrames(frameGraph, backend, 2, 1, false);
+	std::vector<std::string> violations = backend.GetViolations();
+	REQUIRE(violations.size() == 1);
+	CHECK(violations[0].find("before the GPU finished") != std::string::npos);
+}
+
+TEST(FrameGraph_EachThreadRecordsFromItsOwnAllocator)
+{
+	const std::uint32_t frameResourceCount = 3;
+	JobSystem jobs(3);
+	RecordingCommandBackend backend;
+	RecordingFrameGraph frameGraph(backend, jobs, frameResourceCount);
+	AddPasses(frameGraph, backend, 8);
+
+	// The graph creates its allocators first, thread by thread for each frame resource,
+	// so allocator f*threads + t is thread t's for frame resource f.
+	std::uint32_t threadCount = jobs.GetThreadCount();
+	REQUIRE(backend.GetAllocatorCount() == frameResourceCount*threadCount);
+
+	std::vector<std::uint32_t> expectedUses(frameResourceCount*threadCount, 0);
+	std::vector<std::uint64_t> fences(frameResourceCount, 0);
+	for(int frame = 0; frame < 12; ++frame)
+	{
+		std::uint32_t frameResource = frame % frameResourceCount;
+		backend.Complete(fences[frameResource]);
+		frameGraph.Execute(frameResource);
+		fences[frameResource] = backend.Signal();
+
+		for(std::uint32_t pass = 0; pass < frameGraph.GetPassCount(); ++pass)
+			expectedUses[frameResource*threadCount + frameGraph.GetPassThread(pass)]++;
+	}
+
+	for(std::uint32_t a = 0; a < backend.GetAllocatorCount(); ++a)
+		CHECK_EQUAL(expectedUses[a], backend.GetAllocatorUseCount(a));
+	CHECK(backend.GetViolations().empty());
+}
+
+TEST(FrameGraph_WithoutWorkersEverythingRecordsOnTheCallingThread)
+{
+	JobSystem jobs(0);
+	RecordingCommandBackend backend;
+	RecordingFrameGraph frameGraph(backend, jobs, 2);
+	AddPasses(frameGraph, backend, 5);
+
+	RunFrames(frameGraph, backend, 2, 4, true);
+
+	REQUIRE(backend.GetAllocatorCount() == 2);
+	CHECK_EQUAL(10u, backend.GetAllocatorUseCount(0));
+	CHECK_EQUAL(10u, backend.GetAllocatorUseCount(1));
+	CHECK(backend.GetViolations().empty());
+}
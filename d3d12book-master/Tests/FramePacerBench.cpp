@@ -0,0 +1,102 @@
+//***************************************************************************************
+// FramePacerBench.cpp
+//
+// Paces frames against a simulated GPU taking 8 ms a frame, with the CPU taking 3 ms to
+// record a frame and queueing four 1 ms streaming jobs per frame.  The jobs run either
+// after each frame, or by the pacer while it waits for the GPU.  Fails if a frame
+// starts before the GPU is done with its slot's last frame, or a streaming job is lost.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/FramePacer.h"
+#include "../Common/JobSystem.h"
+#include "../Common/SimulatedFrameFence.h"
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+	// Busy CPU work standing in for recording a frame or streaming an asset.
+	void SpinFor(double milliseconds)
+	{
+		auto start = std::chrono::steady_clock::now();
+		while(Milliseconds(std::chrono::steady_clock::now() - start).count() < milliseconds)
+		{
+		}
+	}
+}
+
+BENCHMARK(FramePacer)
+{
+	const int frameCount = 60;
+	const double gpuFrameMs = 8.0;
+	const double cpuFrameMs = 3.0;
+	const int streamingJobsPerFrame = 4;
+	const double streamingJobMs = 1.0;
+
+	bool passed = true;
+	std::printf("GPU %.0f ms, CPU %.0f ms and %d x %.0f ms of streaming per frame\n",
+		gpuFrameMs, cpuFrameMs, streamingJobsPerFrame, streamingJobMs);
+
+	for(std::uint32_t framesInFlight = 1; framesInFlight <= 4; ++framesInFlight)
+	{
+		for(int idleWork = 0; idleWork < 2; ++idleWork)
+		{
+			SimulatedFrameFence fence;
+			FramePacer pacer(fence, framesInFlight);
+
+			JobSystem streaming(0);
+			JobSystem::Group streamingJobs;
+			if(idleWork)
+				pacer.SetIdleWork([&streaming]() { return streaming.RunOne(); });
+
+			std::atomic<int> jobsRun{ 0 };
+			std::vector<FramePacer::uint64> slotValues(framesInFlight, 0);
+			int tooFarAhead = 0;
+
+			auto start = std::chrono::steady_clock::now();
+			for(int frame = 0; frame < frameCount; ++frame)
+			{
+				std::uint32_t slot = pacer.BeginFrame();
+				if(fence.GetCompletedValue() < slotValues[slot])
+					tooFarAhead++;
+
+				for(int i = 0; i < streamingJobsPerFrame; ++i)
+				{
+					streaming.Submit(streamingJobs, [&jobsRun, streamingJobMs](std::uint32_t)
+					{
+						SpinFor(streamingJobMs);
+						jobsRun++;
+					});
+				}
+
+				SpinFor(cpuFrameMs);
+				fence.Submit(gpuFrameMs);
+				slotValues[slot] = pacer.EndFrame();
+
+				if(!idleWork)
+					streaming.Wait(streamingJobs);
+			}
+			streaming.Wait(streamingJobs);
+			pacer.WaitForIdle();
+			Milliseconds elapsed = std::chrono::steady_clock::now() - start;
+
+			const FramePacer::Stats& stats = pacer.GetStats();
+			std::printf("    %u in flight, streaming %s ms per frame %6.2f, wait %5.2f, blocked %5.2f\n",
+				framesInFlight, idleWork ? "while waiting:" : "after frame:  ",
+				elapsed.count()/frameCount, stats.WaitMs/frameCount, stats.BlockedMs/frameCount);
+
+			if(tooFarAhead != 0 || jobsRun != frameCount*streamingJobsPerFrame)
+			{
+				std::printf("    %d frames started too early, %d of %d streaming jobs ran\n",
+					tooFarAhead, jobsRun.load(), frameCount*streamingJobsPerFrame);
+				passed = false;
+			}
+		}
+	}
+
+	return passed;
+}
@@ -0,0 +1,134 @@
+//***************************************************************************************
+// FramePacerTests.cpp
+//
+// Paces frames against SimulatedFrameFence: slot rotation, waiting for a slot's last
+// frame, WaitForIdle, idle work and the stats.  Times only bound from below, so a slow
+// machine makes the tests slower, not flaky.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/FramePacer.h"
+#include "../Common/SimulatedFrameFence.h"
+#include <vector>
+
+TEST(FramePacer_BeginFrameRotatesThroughTheSlots)
+{
+	SimulatedFrameFence fence;
+	FramePacer pacer(fence, 3);
+	CHECK_EQUAL(3u, pacer.GetFramesInFlight());
+
+	const std::uint32_t expectedSlots[] = { 0, 1, 2, 0, 1, 2, 0 };
+	FramePacer::uint64 lastValue = 0;
+	for(std::uint32_t expected : expectedSlots)
+	{
+		CHECK_EQUAL(expected, pacer.BeginFrame());
+		CHECK_EQUAL(expected, pacer.GetFrameIndex());
+
+		FramePacer::uint64 value = pacer.EndFrame();
+		CHECK(value > lastValue);
+		lastValue = value;
+	}
+	CHECK_EQUAL(7u, pacer.GetStats().FrameCount);
+
+	// Changing the frames in flight starts over at slot 0.
+	pacer.SetFramesInFlight(2);
+	CHECK_EQUAL(2u, pacer.GetFramesInFlight());
+	CHECK_EQUAL(0u, pacer.BeginFrame());
+	pacer.EndFrame();
+	CHECK_EQUAL(1u, pacer.BeginFrame());
+	pacer.EndFrame();
+	CHECK_EQUAL(0u, pacer.BeginFrame());
+	pacer.EndFrame();
+}
+
+TEST(FramePacer_BeginFrameWaitsForTheSlotsLastFrame)
+{
+	const std::uint32_t framesInFlight = 2;
+	SimulatedFrameFence fence;
+	FramePacer pacer(fence, framesInFlight);
+
+	std::vector<FramePacer::uint64> slotValues(framesInFlight, 0);
+	int tooFarAhead = 0;
+	for(int frame = 0; frame < 8; ++frame)
+	{
+		std::uint32_t slot = pacer.BeginFrame();
+		if(fence.GetCompletedValue() < slotValues[slot])
+			tooFarAhead++;
+
+		fence.Submit(5.0);
+		slotValues[slot] = pacer.EndFrame();
+	}
+	CHECK_EQUAL(0, tooFarAhead);
+
+	// The GPU takes 5 ms a frame and the CPU no time, so after the first two frames
+	// every BeginFrame found the GPU behind and waited.
+	const FramePacer::Stats& stats = pacer.GetStats();
+	CHECK(stats.WaitCount >= 6);
+	CHECK(stats.WaitMs >= 20.0);
+	CHECK(stats.MaxWaitMs <= stats.WaitMs);
+	CHECK(stats.BlockedMs <= stats.WaitMs);
+	CHECK_EQUAL(0u, stats.IdleWorkCount);
+	CHECK(fence.GetBlockingWaitCount() >= 6);
+
+	pacer.ResetStats();
+	CHECK_EQUAL(0u, pacer.GetStats().WaitCount);
+	CHECK(pacer.GetStats().WaitMs == 0.0);
+}
+
+TEST(FramePacer_WaitForIdleWaitsForEverythingSubmitted)
+{
+	SimulatedFrameFence fence;
+	FramePacer pacer(fence, 3);
+
+	FramePacer::uint64 last = 0;
+	for(int frame = 0; frame < 3; ++frame)
+	{
+		pacer.BeginFrame();
+		fence.Submit(5.0);
+		last = pacer.EndFrame();
+	}
+	CHECK(fence.GetCompletedValue() < last);
+
+	pacer.WaitForIdle();
+	CHECK(pacer.GetCompletedValue() >= last);
+	CHECK(pacer.GetStats().WaitMs >= 10.0);
+}
+
+TEST(FramePacer_IdleWorkRunsWhileWaiting)
+{
+	SimulatedFrameFence fence;
+	FramePacer pacer(fence, 1);
+
+	int jobsLeft = 5;
+	pacer.SetIdleWork([&jobsLeft]()
+	{
+		if(jobsLeft == 0)
+			return false;
+
+		jobsLeft--;
+		return true;
+	});
+
+	pacer.BeginFrame();
+	fence.Submit(30.0);
+	pacer.EndFrame();
+
+	// The GPU is 30 ms behind: the wait runs all five jobs, then blocks for the rest.
+	pacer.BeginFrame();
+	const FramePacer::Stats& stats = pacer.GetStats();
+	CHECK_EQUAL(0, jobsLeft);
+	CHECK_EQUAL(5u, stats.IdleWorkCount);
+	CHECK_EQUAL(1u, stats.WaitCount);
+	CHECK(stats.WaitMs >= 20.0);
+	CHECK(stats.BlockedMs > 0.0 && stats.BlockedMs <= stats.WaitMs);
+	pacer.EndFrame();
+
+	// No wait, no idle work.
+	pacer.WaitForIdle();
+	FramePacer::uint64 idleWorkBefore = stats.IdleWorkCount;
+	jobsLeft = 5;
+	pacer.BeginFrame();
+	CHECK_EQUAL(idleWorkBefore, stats.IdleWorkCount);
+	CHECK_EQUAL(5, jobsLeft);
+	pacer.EndFrame();
+}
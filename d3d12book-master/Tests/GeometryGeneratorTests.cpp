@@ -0,0 +1,108 @@
+//***************************************************************************************
+// GeometryGeneratorTests.cpp
+//
+// Checks that MeshData's 16-bit index copy follows every change to Indices32 and that
+// indices too wide for 16 bits are refused.  Needs DirectXMath.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/GeometryGenerator.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	bool SameIndices(GeometryGenerator::MeshData& mesh)
+	{
+		std::vector<GeometryGenerator::uint16>& indices16 = mesh.GetIndices16();
+		if(indices16.size() != mesh.Indices32.size())
+			return false;
+
+		for(size_t i = 0; i < indices16.size(); ++i)
+		{
+			if(indices16[i] != mesh.Indices32[i])
+				return false;
+		}
+		return true;
+	}
+}
+
+TEST(GeometryGenerator_Indices16FollowEveryChange)
+{
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData mesh = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0);
+	REQUIRE(!mesh.Indices32.empty());
+	CHECK(SameIndices(mesh));
+
+	// Same size and address as before: only the generation shows the change.
+	mesh.Indices32.Set(0, 7);
+	CHECK(SameIndices(mesh));
+
+	mesh.Indices32.MutableData()[1] = 5;
+	CHECK(SameIndices(mesh));
+
+	std::vector<GeometryGenerator::uint32> reversed(mesh.Indices32.begin(), mesh.Indices32.end());
+	std::reverse(reversed.begin(), reversed.end());
+	mesh.Indices32.assign(reversed.data(), reversed.data() + reversed.size());
+	CHECK(SameIndices(mesh));
+
+	mesh.Indices32.push_back(3);
+	CHECK(SameIndices(mesh));
+
+	std::vector<GeometryGenerator::uint32> other = { 0, 1, 2 };
+	mesh.Indices32.swap(other);
+	CHECK(SameIndices(mesh));
+
+	mesh.Indices32.clear();
+	CHECK(mesh.GetIndices16().empty());
+}
+
+TEST(GeometryGenerator_CopiedMeshKeepsItsOwnIndices16)
+{
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData a = geoGen.CreateGeosphere(1.0f, 1);
+	CHECK(SameIndices(a));
+
+	GeometryGenerator::MeshData b = a;
+	b.Indices32.Set(0, 1);
+	CHECK(SameIndices(a));
+	CHECK(SameIndices(b));
+	CHECK_EQUAL(1u, (GeometryGenerator::uint32)b.GetIndices16()[0]);
+}
+
+TEST(GeometryGenerator_WideIndicesAreRefused)
+{
+	GeometryGenerator geoGen;
+
+	// 10*4^8 + 2 = 655362 vertices.
+	GeometryGenerator::MeshData mesh = geoGen.CreateGeosphere(1.0f, 8);
+	REQUIRE(mesh.Vertices.size() > 0xffff);
+	CHECK(!mesh.FitsIndices16());
+
+	bool threw = false;
+	try
+	{
+		mesh.GetIndices16();
+	}
+	catch(const std::out_of_range&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+
+	GeometryGenerator::uint32 indexSize = 0;
+	const void* indices = mesh.GetNarrowestIndices(indexSize);
+	CHECK_EQUAL(4u, indexSize);
+	CHECK(indices == mesh.Indices32.data());
+
+	// Shrinking the mesh below 2^16 vertices makes it fit again.
+	GeometryGenerator::MeshData small = geoGen.CreateGeosphere(1.0f, 2);
+	CHECK(small.FitsIndices16());
+	small.GetNarrowestIndices(indexSize);
+	CHECK_EQUAL(2u, indexSize);
+
+	small.Indices32.Set(0, 0x10000);
+	CHECK(!small.FitsIndices16());
+	small.GetNarrowestIndices(indexSize);
+	CHECK_EQUAL(4u, indexSize);
+}
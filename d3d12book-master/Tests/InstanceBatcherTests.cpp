@@ -0,0 +1,78 @@
+//***************************************************************************************
+// InstanceBatcherTests.cpp
+//
+// Checks that InstanceBatcher groups items by key into runs of consecutive instances
+// and regroups only after the items or their keys change.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/InstanceBatcher.h"
+
+TEST(InstanceBatcher_GroupsItemsByKey)
+{
+	InstanceBatcher batcher;
+	batcher.Add(0, 20);
+	batcher.Add(1, 10);
+	batcher.Add(2, 20);
+	batcher.Add(5, 10);
+	batcher.Add(3, 30);
+
+	CHECK(batcher.Rebatch());
+	CHECK_EQUAL(5u, batcher.GetItemCount());
+	REQUIRE(batcher.GetBatchCount() == 3);
+
+	// Batches in key order; items in index order within a batch.
+	const std::vector<InstanceBatcher::Batch>& batches = batcher.GetBatches();
+	CHECK_EQUAL(10u, batches[0].Key);
+	CHECK_EQUAL(0u, batches[0].FirstInstance);
+	CHECK_EQUAL(2u, batches[0].InstanceCount);
+	CHECK_EQUAL(20u, batches[1].Key);
+	CHECK_EQUAL(2u, batches[1].FirstInstance);
+	CHECK_EQUAL(2u, batches[1].InstanceCount);
+	CHECK_EQUAL(30u, batches[2].Key);
+	CHECK_EQUAL(4u, batches[2].FirstInstance);
+	CHECK_EQUAL(1u, batches[2].InstanceCount);
+
+	const std::uint32_t expected[] = { 1, 5, 0, 2, 3 };
+	const std::vector<std::uint32_t>& items = batcher.GetInstanceItems();
+	REQUIRE(items.size() == 5);
+	for(size_t i = 0; i < items.size(); ++i)
+		CHECK_EQUAL(expected[i], items[i]);
+
+	CHECK(batcher.Contains(5));
+	CHECK(!batcher.Contains(4));
+}
+
+TEST(InstanceBatcher_RebatchesOnlyAfterChanges)
+{
+	InstanceBatcher batcher;
+	batcher.Add(0, 1);
+	batcher.Add(1, 1);
+	batcher.Add(2, 2);
+	CHECK(batcher.Rebatch());
+	CHECK(!batcher.Rebatch());
+	CHECK_EQUAL(2u, batcher.GetBatchCount());
+
+	// Setting the key an item already has changes nothing.
+	batcher.SetKey(2, 2);
+	CHECK(!batcher.Rebatch());
+
+	// Moving item 2 into the first batch leaves one batch of three.
+	batcher.SetKey(2, 1);
+	CHECK(batcher.Rebatch());
+	REQUIRE(batcher.GetBatchCount() == 1);
+	CHECK_EQUAL(3u, batcher.GetBatches()[0].InstanceCount);
+
+	batcher.Remove(1);
+	CHECK(batcher.Rebatch());
+	CHECK_EQUAL(2u, batcher.GetItemCount());
+	REQUIRE(batcher.GetInstanceItems().size() == 2);
+	CHECK_EQUAL(0u, batcher.GetInstanceItems()[0]);
+	CHECK_EQUAL(2u, batcher.GetInstanceItems()[1]);
+
+	batcher.Remove(0);
+	batcher.Remove(2);
+	CHECK(batcher.Rebatch());
+	CHECK_EQUAL(0u, batcher.GetBatchCount());
+	CHECK(batcher.GetInstanceItems().empty());
+}
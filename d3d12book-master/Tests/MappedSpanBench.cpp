@@ -0,0 +1,122 @@
+//***************************************************************************************
+// MappedSpanBench.cpp
+//
+// Times three ways of writing LitWaves' 512x512 wave vertices, the way UpdateWaves does
+// every frame, and checks that each leaves the same vertices behind.  System memory
+// stands in for the upload buffer; it is cached rather than write-combined, which
+// favours the per-element copies.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/MappedSpan.h"
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+	struct Float3
+	{
+		float x, y, z;
+	};
+
+	// LitWaves' vertex layout.
+	struct Vertex
+	{
+		Float3 Pos;
+		Float3 Normal;
+	};
+
+	template<typename WriteFrame>
+	double MillisecondsPerFrame(int frameCount, WriteFrame writeFrame)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for(int frame = 0; frame < frameCount; ++frame)
+			writeFrame();
+		Milliseconds elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count()/frameCount;
+	}
+}
+
+BENCHMARK(MappedSpan)
+{
+	const int frameCount = 200;
+	const int gridSize = 512;
+	const int vertexCount = gridSize*gridSize;
+
+	// What Waves holds after a step: a position and a normal array.
+	std::vector<Float3> positions(vertexCount);
+	std::vector<Float3> normals(vertexCount);
+	for(int i = 0; i < vertexCount; ++i)
+	{
+		float x = (float)(i % gridSize);
+		float z = (float)(i / gridSize);
+		positions[i] = Float3{ x, 0.2f*std::sin(0.1f*x)*std::cos(0.1f*z), z };
+		normals[i] = Float3{ 0.0f, 1.0f, 0.0f };
+	}
+
+	std::vector<Vertex> memory(vertexCount);
+	MappedSpan<Vertex> upload(memory.data(), memory.size());
+	std::vector<Vertex> staged(vertexCount);
+
+	int mismatches = 0;
+	auto check = [&]()
+	{
+		for(int i = 0; i < vertexCount; ++i)
+		{
+			if(std::memcmp(&memory[i].Pos, &positions[i], sizeof(Float3)) != 0 ||
+				std::memcmp(&memory[i].Normal, &normals[i], sizeof(Float3)) != 0)
+			{
+				mismatches++;
+				break;
+			}
+		}
+		std::memset(memory.data(), 0, memory.size()*sizeof(Vertex));
+	};
+
+	// A temporary vertex per element, copied one at a time.
+	double perElement = MillisecondsPerFrame(frameCount, [&]()
+	{
+		for(int i = 0; i < vertexCount; ++i)
+		{
+			Vertex v;
+			v.Pos = positions[i];
+			v.Normal = normals[i];
+			upload.CopyData(i, v);
+		}
+	});
+	check();
+
+	// Built in place through the view.
+	double inPlace = MillisecondsPerFrame(frameCount, [&]()
+	{
+		for(int i = 0; i < vertexCount; ++i)
+		{
+			upload[i].Pos = positions[i];
+			upload[i].Normal = normals[i];
+		}
+	});
+	check();
+
+	// Built in system memory, then one streaming copy.
+	double bulk = MillisecondsPerFrame(frameCount, [&]()
+	{
+		for(int i = 0; i < vertexCount; ++i)
+		{
+			staged[i].Pos = positions[i];
+			staged[i].Normal = normals[i];
+		}
+		upload.CopyData(0, staged.data(), staged.size());
+	});
+	check();
+
+	std::printf("%d wave vertices, ms per frame\n", vertexCount);
+	std::printf("    CopyData per element: %8.3f\n", perElement);
+	std::printf("    Map in place:         %8.3f\n", inPlace);
+	std::printf("    bulk CopyData:        %8.3f\n", bulk);
+	std::printf("    %d of 3 ways left the wrong vertices\n", mismatches);
+
+	return mismatches == 0;
+}
@@ -0,0 +1,120 @@
+//***************************************************************************************
+// MappedSpanTests.cpp
+//
+// Checks MappedSpan's copies over ordinary memory: every size and alignment the
+// streaming kernel splits into head, body and tail, and padded elements, whose padding
+// must be left alone.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/MappedSpan.h"
+#include <vector>
+
+namespace
+{
+	const std::uint8_t Guard = 0xcd;
+
+	struct Element
+	{
+		float Values[12];
+	};
+
+	Element MakeElement(int i)
+	{
+		Element e;
+		for(int k = 0; k < 12; ++k)
+			e.Values[k] = (float)(i*12 + k);
+		return e;
+	}
+
+	bool SameElement(const void* memory, const Element& expected)
+	{
+		return std::memcmp(memory, &expected, sizeof(Element)) == 0;
+	}
+}
+
+TEST(MappedSpan_StreamingCopyMatchesMemcpy)
+{
+	std::vector<std::uint8_t> source(9000);
+	for(size_t i = 0; i < source.size(); ++i)
+		source[i] = (std::uint8_t)(i*7 + 3);
+
+	// Sizes either side of the streaming threshold and of the 64 and 16 byte steps,
+	// at every destination alignment.
+	const size_t sizes[] = { 0, 1, 15, 16, 17, 63, 64, 65, 100, 4095, 4096, 4097, 4159, 8191 };
+	int mismatches = 0;
+	int overruns = 0;
+	for(size_t size : sizes)
+	{
+		for(size_t misalign = 0; misalign < 16; ++misalign)
+		{
+			// Guard bytes on both sides of the copy.
+			std::vector<std::uint8_t> destination(size + 48, Guard);
+			std::uintptr_t first = ((std::uintptr_t)destination.data() + 16) & ~(std::uintptr_t)15;
+			std::uint8_t* dst = reinterpret_cast<std::uint8_t*>(first) + misalign;
+
+			MappedMemory::StreamingCopy(dst, source.data() + 1, size);
+
+			if(std::memcmp(dst, source.data() + 1, size) != 0)
+				mismatches++;
+			for(std::uint8_t* p = destination.data(); p < dst; ++p)
+				overruns += *p != Guard ? 1 : 0;
+			for(std::uint8_t* p = dst + size; p < destination.data() + destination.size(); ++p)
+				overruns += *p != Guard ? 1 : 0;
+		}
+	}
+	CHECK_EQUAL(0, mismatches);
+	CHECK_EQUAL(0, overruns);
+}
+
+TEST(MappedSpan_PaddedElementsKeepTheirPadding)
+{
+	// Constant buffer layout: 48 byte elements 256 bytes apart.  Two elements stay under
+	// the streaming threshold; forty go through the per-element streaming path.
+	const size_t stride = 256;
+	const size_t counts[] = { 2, 40 };
+	for(size_t count : counts)
+	{
+		std::vector<std::uint8_t> memory((count + 2)*stride, Guard);
+		MappedSpan<Element> span(memory.data(), count + 2, stride);
+		REQUIRE(span.size() == count + 2);
+
+		std::vector<Element> elements;
+		for(size_t i = 0; i < count; ++i)
+			elements.push_back(MakeElement((int)i));
+
+		span.CopyData(1, elements.data(), count);
+
+		int wrongElements = 0;
+		int wrongPadding = 0;
+		for(size_t slot = 0; slot < count + 2; ++slot)
+		{
+			const std::uint8_t* p = memory.data() + slot*stride;
+			bool written = slot >= 1 && slot <= count;
+			if(written && !SameElement(p, elements[slot - 1]))
+				wrongElements++;
+
+			for(size_t b = written ? sizeof(Element) : 0; b < stride; ++b)
+				wrongPadding += p[b] != Guard ? 1 : 0;
+		}
+		CHECK_EQUAL(0, wrongElements);
+		CHECK_EQUAL(0, wrongPadding);
+	}
+}
+
+TEST(MappedSpan_ElementWritesLandAtTheirStride)
+{
+	const size_t stride = 64;
+	std::vector<std::uint8_t> memory(4*stride, Guard);
+	MappedSpan<Element> span(memory.data(), 4, stride);
+
+	span.CopyData(2, MakeElement(2));
+	span[0] = MakeElement(0);
+	span[3].Values[0] = 42.0f;
+
+	CHECK(SameElement(memory.data(), MakeElement(0)));
+	CHECK(SameElement(memory.data() + 2*stride, MakeElement(2)));
+	CHECK(*reinterpret_cast<float*>(memory.data() + 3*stride) == 42.0f);
+	CHECK(memory[stride] == Guard);
+	CHECK(memory[2*stride + sizeof(Element)] == Guard);
+}
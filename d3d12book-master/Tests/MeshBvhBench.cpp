@@ -0,0 +1,97 @@
+//***************************************************************************************
+// MeshBvhBench.cpp
+//
+// Times MeshBvh's build and its single ray and packet closest-hit queries on skull.txt
+// and car.txt, and checks the hits against a brute force loop.  Needs DirectXMath.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "TestGeometry.h"
+#include "../Common/MeshBvh.h"
+#include <chrono>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+	bool BenchModel(const char* fileName)
+	{
+		TestGeometry::Mesh mesh;
+		if(!TestGeometry::LoadModel(TestFramework::ModelPath(fileName), mesh))
+		{
+			std::printf("%s not found\n", fileName);
+			return false;
+		}
+
+		const std::uint32_t buildCount = 10;
+		const std::uint32_t rayCount = 100000;
+		const std::uint32_t checkedRayCount = 256;
+
+		MeshBvh bvh;
+		auto start = std::chrono::steady_clock::now();
+		for(std::uint32_t i = 0; i < buildCount; ++i)
+		{
+			bvh.Build(reinterpret_cast<const XMFLOAT3*>(mesh.Positions.data()), sizeof(XMFLOAT3),
+				mesh.Indices.data(), (std::uint32_t)mesh.Indices.size());
+		}
+		Milliseconds buildTime = std::chrono::steady_clock::now() - start;
+
+		std::vector<float> origins, dirs;
+		TestGeometry::MakeRaysTowardMesh(mesh, rayCount, 1, origins, dirs);
+
+		std::vector<MeshBvh::Hit> hits(rayCount);
+		start = std::chrono::steady_clock::now();
+		for(std::uint32_t r = 0; r < rayCount; ++r)
+		{
+			XMVECTOR o = XMVectorSet(origins[3*r], origins[3*r + 1], origins[3*r + 2], 1.0f);
+			XMVECTOR d = XMVectorSet(dirs[3*r], dirs[3*r + 1], dirs[3*r + 2], 0.0f);
+			bvh.IntersectClosest(o, d, hits[r]);
+		}
+		Milliseconds closestTime = std::chrono::steady_clock::now() - start;
+
+		std::vector<MeshBvh::Hit> packetHits(rayCount);
+		start = std::chrono::steady_clock::now();
+		bvh.IntersectClosestPacket(reinterpret_cast<const XMFLOAT3*>(origins.data()),
+			reinterpret_cast<const XMFLOAT3*>(dirs.data()), rayCount, packetHits.data());
+		Milliseconds packetTime = std::chrono::steady_clock::now() - start;
+
+		std::uint32_t mismatches = 0;
+		for(std::uint32_t r = 0; r < checkedRayCount; ++r)
+		{
+			float nearest = FLT_MAX;
+			for(std::uint32_t i = 0; i < mesh.TriangleCount(); ++i)
+			{
+				float t = 0.0f;
+				if(TestGeometry::ReferenceIntersect(&origins[3*r], &dirs[3*r],
+					mesh.Corner(i, 0), mesh.Corner(i, 1), mesh.Corner(i, 2), t) && t > 0.0f)
+				{
+					nearest = std::fmin(nearest, t);
+				}
+			}
+
+			for(const MeshBvh::Hit* hit : { &hits[r], &packetHits[r] })
+			{
+				bool hitAny = hit->TriangleIndex != UINT32_MAX;
+				if(hitAny != (nearest != FLT_MAX) || (hitAny && !TestGeometry::SameDistance(hit->Distance, nearest)))
+					mismatches++;
+			}
+		}
+
+		std::printf("%s, %u triangles, %u nodes\n", fileName, bvh.TriangleCount(), bvh.NodeCount());
+		std::printf("    build:            %8.2f ms\n", buildTime.count() / buildCount);
+		std::printf("    closest, 1 ray:   %8.3f us per ray\n", closestTime.count()*1000.0 / rayCount);
+		std::printf("    closest, packet:  %8.3f us per ray\n", packetTime.count()*1000.0 / rayCount);
+		std::printf("    brute force check of %u rays: %u mismatches\n", checkedRayCount, mismatches);
+
+		return mismatches == 0;
+	}
+}
+
+BENCHMARK(MeshBvh)
+{
+	bool skullOk = BenchModel("skull.txt");
+	bool carOk = BenchModel("car.txt");
+	return skullOk && carOk;
+}
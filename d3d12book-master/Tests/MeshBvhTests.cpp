@@ -0,0 +1,173 @@
+//***************************************************************************************
+// MeshBvhTests.cpp
+//
+// Checks MeshBvh's queries against a brute force loop over every triangle with the
+// scalar reference.  Needs DirectXMath.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "TestGeometry.h"
+#include "../Common/MeshBvh.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const XMFLOAT3* AsFloat3(const TestGeometry::Mesh& mesh)
+	{
+		return reinterpret_cast<const XMFLOAT3*>(mesh.Positions.data());
+	}
+
+	// Distance of the nearest hit with t > 0, or FLT_MAX.
+	float BruteForceClosest(const TestGeometry::Mesh& mesh, const float origin[3], const float dir[3])
+	{
+		float nearest = FLT_MAX;
+		for(std::uint32_t i = 0; i < mesh.TriangleCount(); ++i)
+		{
+			float t = 0.0f;
+			if(TestGeometry::ReferenceIntersect(origin, dir, mesh.Corner(i, 0), mesh.Corner(i, 1), mesh.Corner(i, 2), t) &&
+				t > 0.0f)
+			{
+				nearest = std::fmin(nearest, t);
+			}
+		}
+		return nearest;
+	}
+
+	void CheckModel(const char* fileName)
+	{
+		TestGeometry::Mesh mesh;
+		REQUIRE(TestGeometry::LoadModel(TestFramework::ModelPath(fileName), mesh));
+
+		MeshBvh bvh;
+		bvh.Build(AsFloat3(mesh), sizeof(XMFLOAT3), mesh.Indices.data(), (std::uint32_t)mesh.Indices.size());
+		CHECK_EQUAL(mesh.TriangleCount(), bvh.TriangleCount());
+
+		const std::uint32_t rayCount = 64;
+		std::vector<float> origins, dirs;
+		TestGeometry::MakeRaysTowardMesh(mesh, rayCount, 2, origins, dirs);
+
+		std::vector<MeshBvh::Hit> packetHits(rayCount);
+		bvh.IntersectClosestPacket(reinterpret_cast<const XMFLOAT3*>(origins.data()),
+			reinterpret_cast<const XMFLOAT3*>(dirs.data()), rayCount, packetHits.data());
+
+		std::uint32_t closestMismatches = 0;
+		std::uint32_t triangleMismatches = 0;
+		std::uint32_t anyMismatches = 0;
+		std::uint32_t packetMismatches = 0;
+		std::uint32_t hitCount = 0;
+		for(std::uint32_t r = 0; r < rayCount; ++r)
+		{
+			const float* origin = &origins[3*r];
+			const float* dir = &dirs[3*r];
+			XMVECTOR o = XMVectorSet(origin[0], origin[1], origin[2], 1.0f);
+			XMVECTOR d = XMVectorSet(dir[0], dir[1], dir[2], 0.0f);
+
+			float nearest = BruteForceClosest(mesh, origin, dir);
+			bool expectHit = nearest != FLT_MAX;
+
+			// The tree may report another triangle at the same distance, so distances are
+			// compared, and the reported triangle must really be hit there.
+			MeshBvh::Hit hit;
+			bool hitAny = bvh.IntersectClosest(o, d, hit);
+			if(hitAny != expectHit || (hitAny && !TestGeometry::SameDistance(hit.Distance, nearest)))
+				closestMismatches++;
+
+			if(hitAny)
+			{
+				hitCount++;
+				float t = 0.0f;
+				std::uint32_t tri = hit.TriangleIndex;
+				if(tri >= mesh.TriangleCount() ||
+					!TestGeometry::ReferenceIntersect(origin, dir, mesh.Corner(tri, 0), mesh.Corner(tri, 1), mesh.Corner(tri, 2), t) ||
+					!TestGeometry::SameDistance(t, hit.Distance))
+				{
+					triangleMismatches++;
+				}
+			}
+
+			if(bvh.IntersectAny(o, d) != expectHit)
+				anyMismatches++;
+			if(expectHit && (bvh.IntersectAny(o, d, 0.99f*nearest) || !bvh.IntersectAny(o, d, 1.01f*nearest)))
+				anyMismatches++;
+
+			bool packetHit = packetHits[r].TriangleIndex != UINT32_MAX;
+			if(packetHit != expectHit || (packetHit && !TestGeometry::SameDistance(packetHits[r].Distance, nearest)))
+				packetMismatches++;
+		}
+
+		CHECK(hitCount > rayCount/2);
+		CHECK_EQUAL(0u, closestMismatches);
+		CHECK_EQUAL(0u, triangleMismatches);
+		CHECK_EQUAL(0u, anyMismatches);
+		CHECK_EQUAL(0u, packetMismatches);
+	}
+}
+
+TEST(MeshBvh_AgreesWithBruteForceOnSkull)
+{
+	CheckModel("skull.txt");
+}
+
+TEST(MeshBvh_AgreesWithBruteForceOnCar)
+{
+	CheckModel("car.txt");
+}
+
+TEST(MeshBvh_ReadsInterleavedVerticesWithBaseVertex)
+{
+	TestGeometry::Mesh mesh;
+	REQUIRE(TestGeometry::LoadModel(TestFramework::ModelPath("car.txt"), mesh));
+
+	// Position + normal vertices behind 5 unused ones, as in a shared vertex buffer.
+	const int baseVertex = 5;
+	const std::uint32_t vertexCount = (std::uint32_t)mesh.Positions.size() / 3;
+	std::vector<float> interleaved(6*(baseVertex + vertexCount), 1.0e6f);
+	for(std::uint32_t i = 0; i < vertexCount; ++i)
+	{
+		for(int k = 0; k < 3; ++k)
+			interleaved[6*(baseVertex + i) + k] = mesh.Positions[3*i + k];
+	}
+
+	MeshBvh plain;
+	plain.Build(AsFloat3(mesh), sizeof(XMFLOAT3), mesh.Indices.data(), (std::uint32_t)mesh.Indices.size());
+
+	MeshBvh shared;
+	shared.Build(reinterpret_cast<const XMFLOAT3*>(interleaved.data()), 6*sizeof(float),
+		mesh.Indices.data(), (std::uint32_t)mesh.Indices.size(), baseVertex);
+
+	XMFLOAT3 plainMin = plain.BoundsMin(), sharedMin = shared.BoundsMin();
+	XMFLOAT3 plainMax = plain.BoundsMax(), sharedMax = shared.BoundsMax();
+	CHECK(plainMin.x == sharedMin.x && plainMin.y == sharedMin.y && plainMin.z == sharedMin.z);
+	CHECK(plainMax.x == sharedMax.x && plainMax.y == sharedMax.y && plainMax.z == sharedMax.z);
+
+	const std::uint32_t rayCount = 32;
+	std::vector<float> origins, dirs;
+	TestGeometry::MakeRaysTowardMesh(mesh, rayCount, 3, origins, dirs);
+
+	std::uint32_t mismatches = 0;
+	for(std::uint32_t r = 0; r < rayCount; ++r)
+	{
+		XMVECTOR o = XMVectorSet(origins[3*r], origins[3*r + 1], origins[3*r + 2], 1.0f);
+		XMVECTOR d = XMVectorSet(dirs[3*r], dirs[3*r + 1], dirs[3*r + 2], 0.0f);
+
+		MeshBvh::Hit a, b;
+		bool hitA = plain.IntersectClosest(o, d, a);
+		bool hitB = shared.IntersectClosest(o, d, b);
+		if(hitA != hitB || (hitA && a.Distance != b.Distance))
+			mismatches++;
+	}
+	CHECK_EQUAL(0u, mismatches);
+}
+
+TEST(MeshBvh_EmptyMeshNeverHits)
+{
+	MeshBvh bvh;
+	CHECK(bvh.Empty());
+
+	MeshBvh::Hit hit;
+	XMVECTOR o = XMVectorSet(0.0f, 0.0f, -5.0f, 1.0f);
+	XMVECTOR d = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+	CHECK(!bvh.IntersectClosest(o, d, hit));
+	CHECK(!bvh.IntersectAny(o, d));
+}
@@ -0,0 +1,182 @@
+//***************************************************************************************
+// RayTriangleSimdBench.cpp
+//
+// Times the RayTriangleSimd kernels against the scalar reference on every triangle of
+// skull.txt and car.txt.  Each kernel fills its own result buffers in a timed pass;
+// the results are compared with the scalar ones afterwards, outside the timing.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "TestGeometry.h"
+#include "../Common/RayTriangleSimd.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace RayTriangleSimd;
+
+namespace
+{
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+	bool BenchModel(const char* fileName)
+	{
+		TestGeometry::Mesh mesh;
+		if(!TestGeometry::LoadModel(TestFramework::ModelPath(fileName), mesh))
+		{
+			std::printf("%s not found\n", fileName);
+			return false;
+		}
+
+		const std::uint32_t rayCount = 128;
+		const std::uint32_t triCount = mesh.TriangleCount();
+		const size_t testCount = (size_t)rayCount*triCount;
+
+		std::vector<float> origins, dirs;
+		TestGeometry::MakeRaysTowardMesh(mesh, rayCount, 1, origins, dirs);
+
+		std::vector<TriangleBlock4> blocks4;
+		TestGeometry::PackTriangles(mesh, 4, blocks4);
+#if defined(__AVX__)
+		std::vector<TriangleBlock8> blocks8;
+		TestGeometry::PackTriangles(mesh, 8, blocks8);
+#endif
+
+		std::vector<std::uint8_t> scalarHits(testCount);
+		std::vector<float> scalarDists(testCount);
+		std::vector<std::uint8_t> simdHits(testCount);
+		std::vector<float> simdDists(testCount);
+
+		auto start = std::chrono::steady_clock::now();
+		for(std::uint32_t r = 0; r < rayCount; ++r)
+		{
+			for(std::uint32_t i = 0; i < triCount; ++i)
+			{
+				float t = 0.0f;
+				size_t k = (size_t)r*triCount + i;
+				scalarHits[k] = TestGeometry::ReferenceIntersect(&origins[3*r], &dirs[3*r],
+					mesh.Corner(i, 0), mesh.Corner(i, 1), mesh.Corner(i, 2), t) && t > 0.0f;
+				scalarDists[k] = t;
+			}
+		}
+		Milliseconds scalarTime = std::chrono::steady_clock::now() - start;
+
+		auto countMismatches = [&]()
+		{
+			std::uint32_t mismatches = 0;
+			for(size_t k = 0; k < testCount; ++k)
+			{
+				if(simdHits[k] != scalarHits[k] ||
+					(simdHits[k] && !TestGeometry::SameDistance(simdDists[k], scalarDists[k])))
+				{
+					mismatches++;
+				}
+			}
+			return mismatches;
+		};
+
+		start = std::chrono::steady_clock::now();
+		for(std::uint32_t r = 0; r < rayCount; ++r)
+		{
+			Ray4 ray = BroadcastRay(&origins[3*r], &dirs[3*r]);
+			for(std::uint32_t b = 0; b < (std::uint32_t)blocks4.size(); ++b)
+			{
+				float t[4], u[4], v[4];
+				int mask = IntersectRay4(ray, blocks4[b], FLT_MAX, t, u, v);
+				for(std::uint32_t lane = 0; lane < 4 && b*4 + lane < triCount; ++lane)
+				{
+					size_t k = (size_t)r*triCount + b*4 + lane;
+					simdHits[k] = (mask >> lane) & 1;
+					simdDists[k] = t[lane];
+				}
+			}
+		}
+		Milliseconds sseTime = std::chrono::steady_clock::now() - start;
+		std::uint32_t sseMismatches = countMismatches();
+
+#if defined(__AVX__)
+		start = std::chrono::steady_clock::now();
+		for(std::uint32_t r = 0; r < rayCount; ++r)
+		{
+			for(std::uint32_t b = 0; b < (std::uint32_t)blocks8.size(); ++b)
+			{
+				float t[8], u[8], v[8];
+				int mask = IntersectRay8(&origins[3*r], &dirs[3*r], blocks8[b], FLT_MAX, t, u, v);
+				for(std::uint32_t lane = 0; lane < 8 && b*8 + lane < triCount; ++lane)
+				{
+					size_t k = (size_t)r*triCount + b*8 + lane;
+					simdHits[k] = (mask >> lane) & 1;
+					simdDists[k] = t[lane];
+				}
+			}
+		}
+		Milliseconds avxTime = std::chrono::steady_clock::now() - start;
+		std::uint32_t avxMismatches = countMismatches();
+#endif
+
+		start = std::chrono::steady_clock::now();
+		for(std::uint32_t r = 0; r < rayCount; r += 4)
+		{
+			RayPacket4 packet;
+			for(std::uint32_t lane = 0; lane < 4; ++lane)
+			{
+				const float* o = &origins[3*(r + lane)];
+				const float* d = &dirs[3*(r + lane)];
+				packet.Ox[lane] = o[0]; packet.Oy[lane] = o[1]; packet.Oz[lane] = o[2];
+				packet.Dx[lane] = d[0]; packet.Dy[lane] = d[1]; packet.Dz[lane] = d[2];
+			}
+
+			const float tMax[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+			for(std::uint32_t i = 0; i < triCount; ++i)
+			{
+				const float* p0 = mesh.Corner(i, 0);
+				const float* p1 = mesh.Corner(i, 1);
+				const float* p2 = mesh.Corner(i, 2);
+				const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+				float t[4], u[4], v[4];
+				int mask = IntersectPacket4(packet, p0, e1, e2, tMax, t, u, v);
+				for(std::uint32_t lane = 0; lane < 4; ++lane)
+				{
+					size_t k = (size_t)(r + lane)*triCount + i;
+					simdHits[k] = (mask >> lane) & 1;
+					simdDists[k] = t[lane];
+				}
+			}
+		}
+		Milliseconds packetTime = std::chrono::steady_clock::now() - start;
+		std::uint32_t packetMismatches = countMismatches();
+
+		// Millions of ray/triangle tests per second.
+		auto rate = [testCount](const Milliseconds& time) { return testCount / (time.count()*1000.0); };
+
+		std::printf("%s, %u triangles, %u rays, %zu tests\n", fileName, triCount, rayCount, testCount);
+		std::printf("    scalar:       %8.1f Mtests/s\n", rate(scalarTime));
+		std::printf("    SSE x4:       %8.1f Mtests/s, %u mismatches\n", rate(sseTime), sseMismatches);
+#if defined(__AVX__)
+		std::printf("    AVX x8:       %8.1f Mtests/s, %u mismatches\n", rate(avxTime), avxMismatches);
+#else
+		std::printf("    AVX x8:       not built (configure with COMMON_ENABLE_AVX=ON)\n");
+#endif
+		std::printf("    packet of 4:  %8.1f Mtests/s, %u mismatches\n", rate(packetTime), packetMismatches);
+
+		bool ok = sseMismatches == 0 && packetMismatches == 0;
+#if defined(__AVX__)
+		ok = ok && avxMismatches == 0;
+#endif
+		return ok;
+	}
+}
+
+BENCHMARK(RayTriangleSimd)
+{
+#if defined(__AVX__)
+	std::printf("kernels: SSE2 and AVX\n");
+#else
+	std::printf("kernels: SSE2 only, the AVX kernel is compiled out\n");
+#endif
+
+	bool skullOk = BenchModel("skull.txt");
+	bool carOk = BenchModel("car.txt");
+	return skullOk && carOk;
+}
@@ -0,0 +1,354 @@
+//***************************************************************************************
+// RayTriangleSimdTests.cpp
+//
+// Checks the RayTriangleSimd kernels on hand made cases and against the scalar
+// reference on every triangle of skull.txt and car.txt.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "TestGeometry.h"
+#include "../Common/RayTriangleSimd.h"
+
+using namespace RayTriangleSimd;
+
+namespace
+{
+	const float TriV0[3] = { 0.0f, 0.0f, 0.0f };
+	const float TriV1[3] = { 1.0f, 0.0f, 0.0f };
+	const float TriV2[3] = { 0.0f, 1.0f, 0.0f };
+
+	// Number of ray/triangle pairs of a model where kernel disagrees with the reference.
+	struct Mismatches
+	{
+		std::uint32_t Ray4 = 0;
+		std::uint32_t Ray8 = 0;
+		std::uint32_t Packet4 = 0;
+		std::uint32_t Any4 = 0;
+		std::uint32_t Closest4 = 0;
+	};
+
+	void CompareWithReference(const TestGeometry::Mesh& mesh, std::uint32_t rayCount, Mismatches& mismatches)
+	{
+		const std::uint32_t triCount = mesh.TriangleCount();
+
+		std::vector<float> origins, dirs;
+		TestGeometry::MakeRaysTowardMesh(mesh, rayCount, 1, origins, dirs);
+
+		std::vector<TriangleBlock4> blocks4;
+		TestGeometry::PackTriangles(mesh, 4, blocks4);
+#if defined(__AVX__)
+		std::vector<TriangleBlock8> blocks8;
+		TestGeometry::PackTriangles(mesh, 8, blocks8);
+#endif
+
+		std::vector<std::uint8_t> refHits(triCount);
+		std::vector<float> refDists(triCount);
+		for(std::uint32_t r = 0; r < rayCount; ++r)
+		{
+			const float* origin = &origins[3*r];
+			const float* dir = &dirs[3*r];
+
+			for(std::uint32_t i = 0; i < triCount; ++i)
+			{
+				float t = 0.0f;
+				refHits[i] = TestGeometry::ReferenceIntersect(origin, dir,
+					mesh.Corner(i, 0), mesh.Corner(i, 1), mesh.Corner(i, 2), t) && t > 0.0f;
+				refDists[i] = t;
+			}
+
+			auto differs = [&](std::uint32_t tri, bool hit, float t)
+			{
+				return hit != (refHits[tri] != 0) || (hit && !TestGeometry::SameDistance(t, refDists[tri]));
+			};
+
+			Ray4 ray = BroadcastRay(origin, dir);
+			for(std::uint32_t b = 0; b < (std::uint32_t)blocks4.size(); ++b)
+			{
+				float t[4], u[4], v[4];
+				int mask = IntersectRay4(ray, blocks4[b], FLT_MAX, t, u, v);
+
+				bool anyRef = false;
+				int closestRef = -1;
+				for(std::uint32_t lane = 0; lane < 4 && b*4 + lane < triCount; ++lane)
+				{
+					std::uint32_t tri = b*4 + lane;
+					if(differs(tri, ((mask >> lane) & 1) != 0, t[lane]))
+						mismatches.Ray4++;
+
+					if(refHits[tri])
+					{
+						anyRef = true;
+						if(closestRef < 0 || refDists[tri] < refDists[b*4 + closestRef])
+							closestRef = (int)lane;
+					}
+				}
+
+				if(IntersectRayAny4(ray, blocks4[b], FLT_MAX) != anyRef)
+					mismatches.Any4++;
+
+				float tc = 0.0f, uc = 0.0f, vc = 0.0f;
+				int closest = IntersectRayClosest4(ray, blocks4[b], FLT_MAX, tc, uc, vc);
+				if((closest < 0) != (closestRef < 0) ||
+					(closest >= 0 && !TestGeometry::SameDistance(tc, refDists[b*4 + closestRef])))
+				{
+					mismatches.Closest4++;
+				}
+			}
+
+#if defined(__AVX__)
+			for(std::uint32_t b = 0; b < (std::uint32_t)blocks8.size(); ++b)
+			{
+				float t[8], u[8], v[8];
+				int mask = IntersectRay8(origin, dir, blocks8[b], FLT_MAX, t, u, v);
+				for(std::uint32_t lane = 0; lane < 8 && b*8 + lane < triCount; ++lane)
+				{
+					if(differs(b*8 + lane, ((mask >> lane) & 1) != 0, t[lane]))
+						mismatches.Ray8++;
+				}
+			}
+#endif
+
+			// The same ray in every lane of a packet must give the scalar result too.
+			RayPacket4 packet;
+			for(int lane = 0; lane < 4; ++lane)
+			{
+				packet.Ox[lane] = origin[0]; packet.Oy[lane] = origin[1]; packet.Oz[lane] = origin[2];
+				packet.Dx[lane] = dir[0];    packet.Dy[lane] = dir[1];    packet.Dz[lane] = dir[2];
+			}
+
+			const float tMax[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+			for(std::uint32_t i = 0; i < triCount; ++i)
+			{
+				const float* p0 = mesh.Corner(i, 0);
+				const float* p1 = mesh.Corner(i, 1);
+				const float* p2 = mesh.Corner(i, 2);
+				const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+				float t[4], u[4], v[4];
+				int mask = IntersectPacket4(packet, p0, e1, e2, tMax, t, u, v);
+				if(mask != 0 && mask != 0xf)
+					mismatches.Packet4++;
+				else if(differs(i, mask != 0, t[0]))
+					mismatches.Packet4++;
+			}
+		}
+	}
+
+	void CheckModel(const char* fileName)
+	{
+		TestGeometry::Mesh mesh;
+		REQUIRE(TestGeometry::LoadModel(TestFramework::ModelPath(fileName), mesh));
+
+		Mismatches mismatches;
+		CompareWithReference(mesh, 32, mismatches);
+
+		CHECK_EQUAL(0u, mismatches.Ray4);
+		CHECK_EQUAL(0u, mismatches.Ray8);
+		CHECK_EQUAL(0u, mismatches.Packet4);
+		CHECK_EQUAL(0u, mismatches.Any4);
+		CHECK_EQUAL(0u, mismatches.Closest4);
+	}
+}
+
+TEST(RayTriangleSimd_HitReportsDistanceAndBarycentrics)
+{
+	TriangleBlock4 block;
+	ClearBlock(block);
+	SetTriangle(block, 2, TriV0, TriV1, TriV2);
+
+	const float origin[3] = { 0.25f, 0.5f, 2.0f };
+	const float dir[3] = { 0.0f, 0.0f, -1.0f };
+
+	float t[4], u[4], v[4];
+	int mask = IntersectRay4(BroadcastRay(origin, dir), block, FLT_MAX, t, u, v);
+
+	// Zeroed lanes are degenerate and never hit.
+	CHECK_EQUAL(1 << 2, mask);
+	CHECK(TestGeometry::SameDistance(t[2], 2.0f));
+	CHECK(TestGeometry::SameDistance(u[2], 0.25f));
+	CHECK(TestGeometry::SameDistance(v[2], 0.5f));
+}
+
+TEST(RayTriangleSimd_TestIsTwoSided)
+{
+	TriangleBlock4 block;
+	ClearBlock(block);
+	SetTriangle(block, 0, TriV0, TriV1, TriV2);
+
+	const float origin[3] = { 0.25f, 0.25f, -1.0f };
+	const float dir[3] = { 0.0f, 0.0f, 1.0f };
+
+	float t[4], u[4], v[4];
+	CHECK_EQUAL(1, IntersectRay4(BroadcastRay(origin, dir), block, FLT_MAX, t, u, v));
+	CHECK(TestGeometry::SameDistance(t[0], 1.0f));
+}
+
+TEST(RayTriangleSimd_RejectsMissesBehindParallelAndBeyondTMax)
+{
+	TriangleBlock4 block;
+	ClearBlock(block);
+	for(int lane = 0; lane < 4; ++lane)
+		SetTriangle(block, lane, TriV0, TriV1, TriV2);
+
+	const float down[3] = { 0.0f, 0.0f, -1.0f };
+	const float sideways[3] = { 1.0f, 0.0f, 0.0f };
+
+	const float outside[3] = { 0.75f, 0.75f, 1.0f };
+	const float below[3] = { 0.25f, 0.25f, -1.0f };
+	const float inPlane[3] = { -1.0f, 0.25f, 0.0f };
+	const float above[3] = { 0.25f, 0.25f, 1.0f };
+
+	float t[4], u[4], v[4];
+	CHECK_EQUAL(0, IntersectRay4(BroadcastRay(outside, down), block, FLT_MAX, t, u, v));
+	CHECK_EQUAL(0, IntersectRay4(BroadcastRay(below, down), block, FLT_MAX, t, u, v));
+	CHECK_EQUAL(0, IntersectRay4(BroadcastRay(inPlane, sideways), block, FLT_MAX, t, u, v));
+	CHECK_EQUAL(0, IntersectRay4(BroadcastRay(above, down), block, 0.5f, t, u, v));
+	CHECK_EQUAL(0xf, IntersectRay4(BroadcastRay(above, down), block, 1.5f, t, u, v));
+	CHECK(!IntersectRayAny4(BroadcastRay(above, down), block, 0.5f));
+}
+
+TEST(RayTriangleSimd_ClosestPicksNearestLane)
+{
+	const float far0[3] = { 0.0f, 0.0f, -3.0f }, far1[3] = { 1.0f, 0.0f, -3.0f }, far2[3] = { 0.0f, 1.0f, -3.0f };
+	const float near0[3] = { 0.0f, 0.0f, -1.0f }, near1[3] = { 1.0f, 0.0f, -1.0f }, near2[3] = { 0.0f, 1.0f, -1.0f };
+
+	TriangleBlock4 block;
+	ClearBlock(block);
+	SetTriangle(block, 0, far0, far1, far2);
+	SetTriangle(block, 3, near0, near1, near2);
+
+	const float origin[3] = { 0.25f, 0.25f, 0.0f };
+	const float dir[3] = { 0.0f, 0.0f, -1.0f };
+
+	float t = 0.0f, u = 0.0f, v = 0.0f;
+	CHECK_EQUAL(3, IntersectRayClosest4(BroadcastRay(origin, dir), block, FLT_MAX, t, u, v));
+	CHECK(TestGeometry::SameDistance(t, 1.0f));
+	CHECK_EQUAL(-1, IntersectRayClosest4(BroadcastRay(origin, dir), block, 0.5f, t, u, v));
+
+	// From below the near triangle is lane 0.
+	const float below[3] = { 0.25f, 0.25f, -4.0f };
+	const float up[3] = { 0.0f, 0.0f, 1.0f };
+	CHECK_EQUAL(0, IntersectRayClosest4(BroadcastRay(below, up), block, FLT_MAX, t, u, v));
+	CHECK(TestGeometry::SameDistance(t, 1.0f));
+}
+
+TEST(RayTriangleSimd_PacketLanesAreIndependent)
+{
+	const float e1[3] = { 1.0f, 0.0f, 0.0f };
+	const float e2[3] = { 0.0f, 1.0f, 0.0f };
+
+	// Lane 0 hits, lane 1 misses sideways, lane 2 hits beyond its own tMax, lane 3 hits.
+	RayPacket4 packet;
+	const float ox[4] = { 0.25f, 2.0f, 0.25f, 0.1f };
+	for(int lane = 0; lane < 4; ++lane)
+	{
+		packet.Ox[lane] = ox[lane]; packet.Oy[lane] = 0.25f; packet.Oz[lane] = 1.0f;
+		packet.Dx[lane] = 0.0f;     packet.Dy[lane] = 0.0f;  packet.Dz[lane] = -1.0f;
+	}
+	const float tMax[4] = { FLT_MAX, FLT_MAX, 0.5f, 2.0f };
+
+	float t[4], u[4], v[4];
+	CHECK_EQUAL(0x9, IntersectPacket4(packet, TriV0, e1, e2, tMax, t, u, v));
+	CHECK(TestGeometry::SameDistance(t[3], 1.0f));
+	CHECK(TestGeometry::SameDistance(u[3], 0.1f));
+}
+
+TEST(RayTriangleSimd_EveryKernelFindsPointsJustInsideTheEdges)
+{
+	// A tilted triangle, and rays along its normal through points on a barycentric grid
+	// that reaches just inside and just outside each edge.
+	const float v0[3] = { 1.0f, 2.0f, 3.0f };
+	const float v1[3] = { 4.0f, 2.5f, 5.0f };
+	const float v2[3] = { 0.5f, 6.0f, 4.0f };
+	const float e1[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+	const float e2[3] = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+
+	float n[3] = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+	float invLength = 1.0f / std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+	for(float& c : n)
+		c *= invLength;
+
+	TriangleBlock4 block4;
+	ClearBlock(block4);
+	SetTriangle(block4, 1, v0, v1, v2);
+#if defined(__AVX__)
+	TriangleBlock8 block8;
+	ClearBlock(block8);
+	SetTriangle(block8, 6, v0, v1, v2);
+#endif
+
+	const float margin = 0.01f;
+	const int steps = 50;
+	std::vector<float> grid = { -margin, margin };
+	for(int k = 1; k < steps; ++k)
+		grid.push_back((float)k / steps);
+	grid.push_back(1.0f - margin);
+	grid.push_back(1.0f + margin);
+
+	std::uint32_t mismatches = 0;
+	std::uint32_t wrongResults = 0;
+	for(float u : grid)
+	{
+		for(float v : grid)
+		{
+			bool inside = u > 0.0f && v > 0.0f && u + v < 1.0f - 0.5f*margin;
+			bool outside = u < 0.0f || v < 0.0f || u + v > 1.0f + 0.5f*margin;
+			if(!inside && !outside)
+				continue;
+
+			float origin[3], dir[3];
+			for(int k = 0; k < 3; ++k)
+			{
+				origin[k] = v0[k] + u*e1[k] + v*e2[k] + 2.0f*n[k];
+				dir[k] = -n[k];
+			}
+
+			float t[8], uu[8], vv[8];
+			int mask = IntersectRay4(BroadcastRay(origin, dir), block4, FLT_MAX, t, uu, vv);
+			if(mask != (inside ? 0x2 : 0))
+				mismatches++;
+			else if(inside && (!TestGeometry::SameDistance(t[1], 2.0f) ||
+				std::fabs(uu[1] - u) > 1.0e-4f || std::fabs(vv[1] - v) > 1.0e-4f))
+				wrongResults++;
+
+#if defined(__AVX__)
+			mask = IntersectRay8(origin, dir, block8, FLT_MAX, t, uu, vv);
+			if(mask != (inside ? 0x40 : 0))
+				mismatches++;
+			else if(inside && !TestGeometry::SameDistance(t[6], 2.0f))
+				wrongResults++;
+#endif
+
+			RayPacket4 packet;
+			for(int lane = 0; lane < 4; ++lane)
+			{
+				packet.Ox[lane] = origin[0]; packet.Oy[lane] = origin[1]; packet.Oz[lane] = origin[2];
+				packet.Dx[lane] = dir[0];    packet.Dy[lane] = dir[1];    packet.Dz[lane] = dir[2];
+			}
+			const float tMax[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+			mask = IntersectPacket4(packet, v0, e1, e2, tMax, t, uu, vv);
+			if(mask != (inside ? 0xf : 0))
+				mismatches++;
+			else if(inside && !TestGeometry::SameDistance(t[0], 2.0f))
+				wrongResults++;
+
+			float tRef = 0.0f;
+			if(TestGeometry::ReferenceIntersect(origin, dir, v0, v1, v2, tRef) != inside)
+				mismatches++;
+		}
+	}
+
+	CHECK_EQUAL(0u, mismatches);
+	CHECK_EQUAL(0u, wrongResults);
+}
+
+TEST(RayTriangleSimd_AgreesWithScalarReferenceOnSkull)
+{
+	CheckModel("skull.txt");
+}
+
+TEST(RayTriangleSimd_AgreesWithScalarReferenceOnCar)
+{
+	CheckModel("car.txt");
+}
@@ -0,0 +1,250 @@
+//***************************************************************************************
+// ShaderCacheTests.cpp
+//
+// Builds shaders with FakeShaderCompiler: equal keys compile once, a second run over
+// the same BlobCache compiles nothing, and editing an include or changing the compiler
+// compiles again only what it affects.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "FakeShaderCompiler.h"
+#include "../Common/ShaderCache.h"
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	ShaderRequest MakeRequest(const std::string& filename, const std::string& entryPoint,
+		const std::string& target)
+	{
+		ShaderRequest request;
+		request.Filename = filename;
+		request.EntryPoint = entryPoint;
+		request.Target = target;
+		return request;
+	}
+
+	void SetFiles(FakeShaderCompiler& compiler)
+	{
+		compiler.SetFile("Common.hlsl", "float4 gColor;");
+		compiler.SetFile("Default.hlsl", "#include Common.hlsl\nfloat4 VS() {}\nfloat4 PS() {}");
+		compiler.SetFile("Shadows.hlsl", "#include Common.hlsl\nfloat4 VS() {}");
+		compiler.SetFile("Sky.hlsl", "float4 VS() {}\nfloat4 PS() {}");
+	}
+
+	// Adds the shaders of a small app.  The alpha tested pixel shader differs from the
+	// opaque one by a define.
+	void AddShaders(ShaderCache& cache)
+	{
+		cache.Add("standardVS", MakeRequest("Default.hlsl", "VS", "vs_5_1"));
+		cache.Add("opaquePS", MakeRequest("Default.hlsl", "PS", "ps_5_1"));
+
+		ShaderRequest alphaTested = MakeRequest("Default.hlsl", "PS", "ps_5_1");
+		alphaTested.Defines.push_back({ "ALPHA_TEST", "1" });
+		cache.Add("alphaTestedPS", alphaTested);
+
+		cache.Add("shadowVS", MakeRequest("Shadows.hlsl", "VS", "vs_5_1"));
+		cache.Add("skyVS", MakeRequest("Sky.hlsl", "VS", "vs_5_1"));
+		cache.Add("skyPS", MakeRequest("Sky.hlsl", "PS", "ps_5_1"));
+	}
+
+	const char* ShaderNames[] = { "standardVS", "opaquePS", "alphaTestedPS", "shadowVS", "skyVS", "skyPS" };
+	const ShaderCache::uint32 ShaderCount = 6;
+
+	// Removes what earlier runs of the tests left in diskCache for the shaders of
+	// AddShaders, so the first Build over it starts cold.
+	void ClearDiskCache(FakeShaderCompiler& compiler, BlobCache& diskCache, JobSystem& jobs)
+	{
+		ShaderCache cache(compiler, nullptr);
+		AddShaders(cache);
+		cache.Build(jobs);
+		for(const char* name : ShaderNames)
+			diskCache.Remove(cache.GetKey(name));
+	}
+}
+
+TEST(ShaderCache_EqualKeysCompileOnce)
+{
+	JobSystem jobs(3);
+	FakeShaderCompiler compiler;
+	SetFiles(compiler);
+
+	// The same shader under two names, and the same source in another file.
+	compiler.SetFile("DefaultCopy.hlsl", "#include Common.hlsl\nfloat4 VS() {}\nfloat4 PS() {}");
+
+	ShaderCache cache(compiler, nullptr);
+	AddShaders(cache);
+	cache.Add("standardVS2", MakeRequest("Default.hlsl", "VS", "vs_5_1"));
+	cache.Add("copyVS", MakeRequest("DefaultCopy.hlsl", "VS", "vs_5_1"));
+
+	ShaderCache::Stats stats = cache.Build(jobs);
+	CHECK_EQUAL(ShaderCount + 2, stats.ShaderCount);
+	CHECK_EQUAL(ShaderCount, stats.UniqueCount);
+	CHECK_EQUAL(ShaderCount, stats.CompileCount);
+	CHECK_EQUAL(0u, stats.MemoryHitCount);
+	CHECK_EQUAL(0u, stats.DiskHitCount);
+	CHECK_EQUAL((int)ShaderCount, compiler.GetCompileCount());
+
+	CHECK_EQUAL(cache.GetKey("standardVS"), cache.GetKey("standardVS2"));
+	CHECK_EQUAL(cache.GetKey("standardVS"), cache.GetKey("copyVS"));
+	CHECK(&cache.Get("standardVS") == &cache.Get("standardVS2"));
+	CHECK(&cache.Get("standardVS") == &cache.Get("copyVS"));
+
+	// A different entry point, target or define is a different key.
+	CHECK(cache.GetKey("standardVS") != cache.GetKey("opaquePS"));
+	CHECK(cache.GetKey("opaquePS") != cache.GetKey("alphaTestedPS"));
+	CHECK(cache.Get("opaquePS") != cache.Get("alphaTestedPS"));
+
+	// A later Build finds them in memory.
+	cache.Add("standardVS3", MakeRequest("Default.hlsl", "VS", "vs_5_1"));
+	cache.Add("skyPS", MakeRequest("Sky.hlsl", "PS", "ps_5_1"));
+	stats = cache.Build(jobs);
+	CHECK_EQUAL(2u, stats.ShaderCount);
+	CHECK_EQUAL(2u, stats.MemoryHitCount);
+	CHECK_EQUAL(0u, stats.CompileCount);
+	CHECK_EQUAL((int)ShaderCount, compiler.GetCompileCount());
+	CHECK(&cache.Get("standardVS3") == &cache.Get("standardVS"));
+}
+
+TEST(ShaderCache_WarmStartCompilesNothing)
+{
+	JobSystem jobs(3);
+	BlobCache diskCache(TestFramework::ScratchPath("ShaderCacheWarmStart"));
+	{
+		FakeShaderCompiler compiler;
+		SetFiles(compiler);
+		ClearDiskCache(compiler, diskCache, jobs);
+	}
+
+	FakeShaderCompiler coldCompiler;
+	SetFiles(coldCompiler);
+	ShaderCache cold(coldCompiler, &diskCache);
+	AddShaders(cold);
+	ShaderCache::Stats stats = cold.Build(jobs);
+	CHECK_EQUAL(ShaderCount, stats.CompileCount);
+	CHECK_EQUAL(0u, stats.DiskHitCount);
+
+	// A new run: a new compiler and cache over the same folder.
+	FakeShaderCompiler warmCompiler;
+	SetFiles(warmCompiler);
+	ShaderCache warm(warmCompiler, &diskCache);
+	AddShaders(warm);
+	stats = warm.Build(jobs);
+	CHECK_EQUAL(ShaderCount, stats.ShaderCount);
+	CHECK_EQUAL(ShaderCount, stats.DiskHitCount);
+	CHECK_EQUAL(0u, stats.CompileCount);
+	CHECK_EQUAL(0, warmCompiler.GetCompileCount());
+
+	for(const char* name : ShaderNames)
+	{
+		CHECK_EQUAL(cold.GetKey(name), warm.GetKey(name));
+		CHECK(cold.Get(name) == warm.Get(name));
+		diskCache.Remove(cold.GetKey(name));
+	}
+}
+
+TEST(ShaderCache_EditingAnIncludeRecompilesItsShaders)
+{
+	JobSystem jobs(3);
+	BlobCache diskCache(TestFramework::ScratchPath("ShaderCacheEdit"));
+	{
+		FakeShaderCompiler compiler;
+		SetFiles(compiler);
+		ClearDiskCache(compiler, diskCache, jobs);
+	}
+
+	FakeShaderCompiler compiler;
+	SetFiles(compiler);
+	{
+		ShaderCache cache(compiler, &diskCache);
+		AddShaders(cache);
+		cache.Build(jobs);
+	}
+
+	// Common.hlsl is included by Default.hlsl and Shadows.hlsl, not by Sky.hlsl.
+	FakeShaderCompiler editedCompiler;
+	SetFiles(editedCompiler);
+	editedCompiler.SetFile("Common.hlsl", "float4 gColor;\nfloat gTime;");
+	ShaderCache edited(editedCompiler, &diskCache);
+	AddShaders(edited);
+	ShaderCache::Stats stats = edited.Build(jobs);
+	CHECK_EQUAL(4u, stats.CompileCount);
+	CHECK_EQUAL(2u, stats.DiskHitCount);
+	CHECK_EQUAL(4, editedCompiler.GetCompileCount());
+
+	// Another compiler version misses everything.
+	FakeShaderCompiler newCompiler;
+	SetFiles(newCompiler);
+	newCompiler.SetVersion("fake 2");
+	ShaderCache rebuilt(newCompiler, &diskCache);
+	AddShaders(rebuilt);
+	stats = rebuilt.Build(jobs);
+	CHECK_EQUAL(ShaderCount, stats.CompileCount);
+	CHECK_EQUAL(0u, stats.DiskHitCount);
+
+	for(const char* name : ShaderNames)
+	{
+		diskCache.Remove(edited.GetKey(name));
+		diskCache.Remove(rebuilt.GetKey(name));
+	}
+}
+
+TEST(ShaderCache_MissingDiskCacheFileCompilesAgain)
+{
+	JobSystem jobs(3);
+	BlobCache diskCache(TestFramework::ScratchPath("ShaderCacheMissing"));
+	{
+		FakeShaderCompiler compiler;
+		SetFiles(compiler);
+		ClearDiskCache(compiler, diskCache, jobs);
+	}
+
+	FakeShaderCompiler compiler;
+	SetFiles(compiler);
+	ShaderCache cold(compiler, &diskCache);
+	AddShaders(cold);
+	cold.Build(jobs);
+
+	// Lose skyPS's file, as BlobCache loses a damaged one (BlobCacheTests checks that
+	// damaged files are misses).
+	BlobCache::Blob blob;
+	REQUIRE(diskCache.Load(cold.GetKey("skyPS"), blob));
+	diskCache.Remove(cold.GetKey("skyPS"));
+
+	FakeShaderCompiler warmCompiler;
+	SetFiles(warmCompiler);
+	ShaderCache warm(warmCompiler, &diskCache);
+	AddShaders(warm);
+	ShaderCache::Stats stats = warm.Build(jobs);
+	CHECK_EQUAL(1u, stats.CompileCount);
+	CHECK_EQUAL(ShaderCount - 1, stats.DiskHitCount);
+	CHECK(warm.Get("skyPS") == blob);
+
+	// The recompiled shader was stored again.
+	CHECK(diskCache.Load(cold.GetKey("skyPS"), blob));
+
+	for(const char* name : ShaderNames)
+		diskCache.Remove(cold.GetKey(name));
+}
+
+TEST(ShaderCache_CompilerErrorsAreRethrown)
+{
+	JobSystem jobs(3);
+	FakeShaderCompiler compiler;
+	SetFiles(compiler);
+
+	ShaderCache cache(compiler, nullptr);
+	AddShaders(cache);
+	cache.Add("missingVS", MakeRequest("Missing.hlsl", "VS", "vs_5_1"));
+
+	bool threw = false;
+	try
+	{
+		cache.Build(jobs);
+	}
+	catch(std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+}
@@ -0,0 +1,120 @@
+//***************************************************************************************
+// TestFramework.h
+//
+// Minimal self-registering test and benchmark harness for the parts of Common that do
+// not need Windows or a device, so they can be built and checked on any platform with
+// the CMakeLists.txt in this folder.
+//
+// TEST(Name) defines a test.  CHECK(expr) and CHECK_EQUAL(expected, actual) record a
+// failure and carry on; REQUIRE(expr) records a failure and leaves the test.
+//
+// BENCHMARK(Name) defines a benchmark.  It prints its results to stdout and returns
+// false if the results it checked along the way were wrong, so the bench exits with an
+// error instead of reporting timings for a broken kernel.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace TestFramework
+{
+	struct TestCase
+	{
+		const char* Name;
+		void (*Run)();
+	};
+
+	struct Benchmark
+	{
+		const char* Name;
+		bool (*Run)();
+	};
+
+	inline std::vector<TestCase>& Tests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	inline std::vector<Benchmark>& Benchmarks()
+	{
+		static std::vector<Benchmark> benchmarks;
+		return benchmarks;
+	}
+
+	// Failed checks of the test that is running.
+	inline int& FailureCount()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	inline void ReportFailure(const char* file, int line, const std::string& message)
+	{
+		std::printf("%s(%d): check failed: %s\n", file, line, message.c_str());
+		FailureCount()++;
+	}
+
+	template<typename T, typename U>
+	std::string DescribeMismatch(const char* expression, const T& expected, const U& actual)
+	{
+		std::ostringstream text;
+		text << expression << " (expected " << expected << ", got " << actual << ")";
+		return text.str();
+	}
+
+	struct TestRegistrar
+	{
+		TestRegistrar(const char* name, void (*run)())
+		{
+			Tests().push_back({ name, run });
+		}
+	};
+
+	struct BenchmarkRegistrar
+	{
+		BenchmarkRegistrar(const char* name, bool (*run)())
+		{
+			Benchmarks().push_back({ name, run });
+		}
+	};
+
+	// Path of a file in the shared model folder (Chapter 17 Picking/Picking/Models).
+	inline std::string ModelPath(const char* fileName)
+	{
+		return std::string(COMMON_TESTS_MODEL_DIR) + "/" + fileName;
+	}
+
+	// Path of a file or folder the tests may write, in the build folder.
+	inline std::string ScratchPath(const char* fileName)
+	{
+		return std::string(COMMON_TESTS_SCRATCH_DIR) + "/" + fileName;
+	}
+}
+
+#define TEST(name) \
+	static void name(); \
+	static TestFramework::TestRegistrar name##Registrar(#name, &name); \
+	static void name()
+
+#define BENCHMARK(name) \
+	static bool name##Benchmark(); \
+	static TestFramework::BenchmarkRegistrar name##BenchmarkRegistrar(#name, &name##Benchmark); \
+	static bool name##Benchmark()
+
+#define CHECK(expr) \
+	do { if(!(expr)) TestFramework::ReportFailure(__FILE__, __LINE__, #expr); } while(false)
+
+#define CHECK_EQUAL(expected, actual) \
+	do { \
+		if(!((expected) == (actual))) \
+			TestFramework::ReportFailure(__FILE__, __LINE__, \
+				TestFramework::DescribeMismatch(#actual " == " #expected, (expected), (actual))); \
+	} while(false)
+
+#define REQUIRE(expr) \
+	do { if(!(expr)) { TestFramework::ReportFailure(__FILE__, __LINE__, #expr); return; } } while(false)
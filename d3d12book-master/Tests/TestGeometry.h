@@ -0,0 +1,217 @@
+//***************************************************************************************
+// TestGeometry.h
+//
+// Geometry helpers shared by the tests and benchmarks: a loader for the Models/*.txt
+// meshes that keeps plain float positions, a scalar ray/triangle reference, and
+// reproducible random rays aimed at a mesh.
+//***************************************************************************************
+
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace TestGeometry
+{
+	struct Mesh
+	{
+		// x, y, z of every vertex.
+		std::vector<float> Positions;
+		std::vector<std::uint32_t> Indices;
+
+		std::uint32_t TriangleCount()const { return (std::uint32_t)(Indices.size() / 3); }
+
+		// Position of corner k (0..2) of triangle tri.
+		const float* Corner(std::uint32_t tri, std::uint32_t k)const { return &Positions[3*Indices[tri*3 + k]]; }
+	};
+
+	///<summary>
+	/// Reads the positions and indices of a Models/*.txt mesh.  Returns false if the file
+	/// is missing or cut short.
+	///</summary>
+	inline bool LoadModel(const std::string& fileName, Mesh& mesh)
+	{
+		std::ifstream fin(fileName);
+		if(!fin)
+			return false;
+
+		std::uint32_t vcount = 0;
+		std::uint32_t tcount = 0;
+		std::string ignore;
+
+		fin >> ignore >> vcount;
+		fin >> ignore >> tcount;
+		fin >> ignore >> ignore >> ignore >> ignore;
+
+		mesh.Positions.resize(3*vcount);
+		for(std::uint32_t i = 0; i < vcount; ++i)
+		{
+			float normal[3];
+			fin >> mesh.Positions[3*i + 0] >> mesh.Positions[3*i + 1] >> mesh.Positions[3*i + 2];
+			fin >> normal[0] >> normal[1] >> normal[2];
+		}
+
+		fin >> ignore;
+		fin >> ignore;
+		fin >> ignore;
+
+		mesh.Indices.resize(3*tcount);
+		for(std::uint32_t i = 0; i < 3*tcount; ++i)
+			fin >> mesh.Indices[i];
+
+		return !fin.fail();
+	}
+
+	///<summary>
+	/// Scalar two sided ray/triangle test, transcribed from XNA::IntersectRayTriangle
+	/// (TriangleTests::Intersects in DirectXCollision).  Returns true with the ray
+	/// parameter of the hit in t when t >= 0.  dir should be unit length.
+	///</summary>
+	inline bool ReferenceIntersect(const float origin[3], const float dir[3],
+		const float v0[3], const float v1[3], const float v2[3], float& t)
+	{
+		const float epsilon = 1e-20f;
+
+		auto cross = [](const float a[3], const float b[3], float r[3])
+		{
+			r[0] = a[1]*b[2] - a[2]*b[1];
+			r[1] = a[2]*b[0] - a[0]*b[2];
+			r[2] = a[0]*b[1] - a[1]*b[0];
+		};
+		auto dot = [](const float a[3], const float b[3])
+		{
+			return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+		};
+
+		float e1[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+		float e2[3] = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+		float s[3] = { origin[0] - v0[0], origin[1] - v0[1], origin[2] - v0[2] };
+
+		float p[3];
+		cross(dir, e2, p);
+		float det = dot(e1, p);
+
+		float q[3];
+		if(det >= epsilon)
+		{
+			float u = dot(s, p);
+			if(u < 0.0f || u > det)
+				return false;
+
+			cross(s, e1, q);
+			float v = dot(dir, q);
+			if(v < 0.0f || u + v > det)
+				return false;
+
+			t = dot(e2, q);
+			if(t < 0.0f)
+				return false;
+		}
+		else if(det <= -epsilon)
+		{
+			float u = dot(s, p);
+			if(u > 0.0f || u < det)
+				return false;
+
+			cross(s, e1, q);
+			float v = dot(dir, q);
+			if(v > 0.0f || u + v < det)
+				return false;
+
+			t = dot(e2, q);
+			if(t > 0.0f)
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+
+		t /= det;
+		return true;
+	}
+
+	///<summary>
+	/// rayCount rays from a sphere around the mesh towards random points inside its
+	/// bounds, so most of them hit.  The directions are unit length and the sequence
+	/// is the same on every run for a given seed.
+	///</summary>
+	inline void MakeRaysTowardMesh(const Mesh& mesh, std::uint32_t rayCount, std::uint32_t seed,
+		std::vector<float>& origins, std::vector<float>& dirs)
+	{
+		float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for(size_t i = 0; i < mesh.Positions.size(); ++i)
+		{
+			boundsMin[i%3] = std::fmin(boundsMin[i%3], mesh.Positions[i]);
+			boundsMax[i%3] = std::fmax(boundsMax[i%3], mesh.Positions[i]);
+		}
+
+		float center[3], extents[3];
+		for(int k = 0; k < 3; ++k)
+		{
+			center[k] = 0.5f*(boundsMin[k] + boundsMax[k]);
+			extents[k] = 0.5f*(boundsMax[k] - boundsMin[k]);
+		}
+		float radius = 2.0f*std::sqrt(extents[0]*extents[0] + extents[1]*extents[1] + extents[2]*extents[2]);
+
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> signedUnit(-1.0f, 1.0f);
+
+		origins.resize(3*rayCount);
+		dirs.resize(3*rayCount);
+		for(std::uint32_t r = 0; r < rayCount; ++r)
+		{
+			// A random point on the unit sphere by rejection.
+			float n[3];
+			float lengthSq;
+			do
+			{
+				n[0] = signedUnit(random);
+				n[1] = signedUnit(random);
+				n[2] = signedUnit(random);
+				lengthSq = n[0]*n[0] + n[1]*n[1] + n[2]*n[2];
+			} while(lengthSq > 1.0f || lengthSq < 1.0e-4f);
+
+			float invLength = 1.0f / std::sqrt(lengthSq);
+			float d[3];
+			for(int k = 0; k < 3; ++k)
+			{
+				float target = center[k] + extents[k]*signedUnit(random);
+				origins[3*r + k] = center[k] + radius*n[k]*invLength;
+				d[k] = target - origins[3*r + k];
+			}
+
+			float invDirLength = 1.0f / std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+			for(int k = 0; k < 3; ++k)
+				dirs[3*r + k] = d[k]*invDirLength;
+		}
+	}
+
+	///<summary>
+	/// Packs the triangles of mesh into RayTriangleSimd blocks of width lanes; the unused
+	/// lanes of the last block are zeroed.
+	///</summary>
+	template<typename Block>
+	void PackTriangles(const Mesh& mesh, std::uint32_t width, std::vector<Block>& blocks)
+	{
+		std::uint32_t triCount = mesh.TriangleCount();
+		blocks.resize((triCount + width - 1) / width);
+		for(Block& block : blocks)
+			ClearBlock(block);
+
+		for(std::uint32_t i = 0; i < triCount; ++i)
+			SetTriangle(blocks[i/width], (int)(i%width), mesh.Corner(i, 0), mesh.Corner(i, 1), mesh.Corner(i, 2));
+	}
+
+	// True if two hit distances agree to within rounding.
+	inline bool SameDistance(float a, float b)
+	{
+		return std::fabs(a - b) <= 1.0e-4f*std::fmax(1.0f, std::fabs(b));
+	}
+}
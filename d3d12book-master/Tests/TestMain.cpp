@@ -0,0 +1,58 @@
+//***************************************************************************************
+// TestMain.cpp
+//
+// Runs every registered test, or only those whose name contains one of the command
+// line arguments.  Exits with 1 if any check failed.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include <cstring>
+#include <exception>
+
+static bool IsSelected(const char* name, int argc, char* argv[])
+{
+	if(argc < 2)
+		return true;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strstr(name, argv[i]) != nullptr)
+			return true;
+	}
+	return false;
+}
+
+int main(int argc, char* argv[])
+{
+	int run = 0;
+	int failed = 0;
+	for(const TestFramework::TestCase& test : TestFramework::Tests())
+	{
+		if(!IsSelected(test.Name, argc, argv))
+			continue;
+
+		TestFramework::FailureCount() = 0;
+		try
+		{
+			test.Run();
+		}
+		catch(const std::exception& e)
+		{
+			TestFramework::ReportFailure(__FILE__, __LINE__, std::string("unexpected exception: ") + e.what());
+		}
+
+		run++;
+		if(TestFramework::FailureCount() > 0)
+		{
+			failed++;
+			std::printf("FAILED  %s\n", test.Name);
+		}
+		else
+		{
+			std::printf("passed  %s\n", test.Name);
+		}
+	}
+
+	std::printf("%d of %d tests passed\n", run - failed, run);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+//***************************************************************************************
+// UploadRingBench.cpp
+//
+// Times UploadRing over system memory with three frames in flight, each frame writing
+// a pass constant buffer, a constant buffer per object and a dynamic vertex buffer, as
+// LandAndWavesApp does.  A second run fills every allocation with its frame's number
+// and checks it when the frame is reclaimed, so memory handed out twice fails the run.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/UploadRing.h"
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+	struct Written
+	{
+		std::uint8_t* Data;
+		UploadRing::uint64 Size;
+	};
+
+	bool StillHolds(const std::vector<Written>& frame, std::uint8_t value)
+	{
+		for(const Written& w : frame)
+		{
+			for(UploadRing::uint64 i = 0; i < w.Size; ++i)
+			{
+				if(w.Data[i] != value)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+namespace
+{
+	const int FramesInFlight = 3;
+	const int ObjectCount = 22;
+	const UploadRing::uint64 ObjectCBBytes = 256;
+	const UploadRing::uint64 PassCBBytes = 512;
+	const UploadRing::uint64 VertexBytes = 128*128*28;
+
+	// One frame's allocations; write is called with each.
+	template<typename Write>
+	void AllocateFrame(UploadRing& ring, Write write)
+	{
+		write(ring.Allocate(PassCBBytes));
+		for(int i = 0; i < ObjectCount; ++i)
+			write(ring.Allocate(ObjectCBBytes));
+		write(ring.Allocate(VertexBytes, 16));
+	}
+}
+
+BENCHMARK(UploadRing)
+{
+	const int frameCount = 20000;
+	const UploadRing::uint64 frameBytes = PassCBBytes + ObjectCount*ObjectCBBytes + VertexBytes + 16;
+	UploadRing ring((FramesInFlight + 1)*frameBytes);
+
+	// Allocation alone.
+	int failures = 0;
+	auto start = std::chrono::steady_clock::now();
+	for(int f = 1; f <= frameCount; ++f)
+	{
+		if(f > FramesInFlight)
+			ring.Reclaim(f - FramesInFlight);
+
+		AllocateFrame(ring, [&](const UploadRing::Allocation& a) { failures += a.IsValid() ? 0 : 1; });
+		ring.FinishFrame(f);
+	}
+	Milliseconds allocateTime = std::chrono::steady_clock::now() - start;
+	ring.Reclaim(frameCount);
+
+	// Again, filling every allocation and checking it when its frame is reclaimed.
+	// Fence values carry on from the first run.
+	std::deque<std::vector<Written>> frames;
+	int corrupted = 0;
+	for(int f = frameCount + 1; f <= 2*frameCount; ++f)
+	{
+		if(f > frameCount + FramesInFlight)
+		{
+			ring.Reclaim(f - FramesInFlight);
+			if(!StillHolds(frames.front(), (std::uint8_t)(f - FramesInFlight)))
+				corrupted++;
+			frames.pop_front();
+		}
+
+		std::vector<Written> frame;
+		AllocateFrame(ring, [&](const UploadRing::Allocation& a)
+		{
+			if(!a.IsValid())
+			{
+				failures++;
+				return;
+			}
+			std::memset(a.CpuAddress, (std::uint8_t)f, (size_t)a.Size);
+			Written w = { a.CpuAddress, a.Size };
+			frame.push_back(w);
+		});
+
+		ring.FinishFrame(f);
+		frames.push_back(frame);
+	}
+
+	int allocationsPerFrame = ObjectCount + 2;
+	std::printf("%d frames of %d allocations, %.1f KB ring\n",
+		frameCount, allocationsPerFrame, ring.GetCapacity()/1024.0);
+	std::printf("    %8.2f ms, %.1f ns an allocation\n",
+		allocateTime.count(), allocateTime.count()*1.0e6/((double)frameCount*allocationsPerFrame));
+	std::printf("    peak frame %llu bytes, %d failed allocations, %d overwritten frames\n",
+		(unsigned long long)ring.GetPeakFrameBytes(), failures, corrupted);
+
+	return failures == 0 && corrupted == 0;
+}
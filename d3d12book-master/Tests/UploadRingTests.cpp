@@ -0,0 +1,185 @@
+//***************************************************************************************
+// UploadRingTests.cpp
+//
+// Exercises UploadRing over system memory: alignment, wrapping, running full, and
+// recycling frames by fence value.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../Common/UploadRing.h"
+#include <deque>
+#include <vector>
+
+namespace
+{
+	struct Range
+	{
+		UploadRing::uint64 Begin;
+		UploadRing::uint64 End;
+	};
+
+	bool Overlaps(const std::vector<Range>& live, const UploadRing::Allocation& a)
+	{
+		for(const Range& r : live)
+		{
+			if(a.Offset < r.End && r.Begin < a.Offset + a.Size)
+				return true;
+		}
+		return false;
+	}
+}
+
+TEST(UploadRing_AllocationsAreAlignedAndAddressed)
+{
+	std::vector<std::uint8_t> memory(4096);
+	const UploadRing::uint64 gpuBase = 0x10000;
+	UploadRing ring(memory.data(), gpuBase, memory.size());
+
+	UploadRing::Allocation a = ring.Allocate(10, 16);
+	UploadRing::Allocation b = ring.Allocate(100);
+	UploadRing::Allocation c = ring.AllocateArray<double>(3);
+	REQUIRE(a.IsValid() && b.IsValid() && c.IsValid());
+
+	CHECK_EQUAL(0u, a.Offset);
+	CHECK_EQUAL(256u, b.Offset);
+	CHECK_EQUAL(368u, c.Offset);
+	CHECK_EQUAL(24u, c.Size);
+	CHECK(b.CpuAddress == memory.data() + b.Offset);
+	CHECK_EQUAL(gpuBase + b.Offset, b.GpuAddress);
+
+	// Padding counts as used: 10 + 246 + 100 + 12 + 24 bytes.
+	CHECK_EQUAL(392u, ring.GetUsedBytes());
+	CHECK_EQUAL(392u, ring.GetFrameBytes());
+
+	struct Constants { float Values[5]; };
+	Constants constants = { { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f } };
+	UploadRing::Allocation d = ring.AllocateConstants(constants);
+	REQUIRE(d.IsValid());
+	CHECK_EQUAL(512u, d.Offset);
+	CHECK_EQUAL(256u, d.Size);
+	CHECK(d.Data<Constants>()->Values[4] == 5.0f);
+
+	CHECK(!ring.Allocate(0).IsValid());
+	CHECK(!ring.Allocate(4097).IsValid());
+}
+
+TEST(UploadRing_FramesAreFreedOnlyWhenTheirFenceCompletes)
+{
+	UploadRing ring(1024);
+
+	REQUIRE(ring.Allocate(512).IsValid());
+	ring.FinishFrame(1);
+	REQUIRE(ring.Allocate(512).IsValid());
+	ring.FinishFrame(2);
+	CHECK_EQUAL(2u, ring.GetFramesInFlight());
+
+	// Full until the GPU passes frame 1.
+	CHECK(!ring.Allocate(256).IsValid());
+	ring.Reclaim(0);
+	CHECK(!ring.Allocate(256).IsValid());
+
+	ring.Reclaim(1);
+	CHECK_EQUAL(1u, ring.GetFramesInFlight());
+	CHECK_EQUAL(512u, ring.GetUsedBytes());
+
+	// The free space is at the front, so the next allocation wraps.
+	UploadRing::Allocation a = ring.Allocate(256);
+	REQUIRE(a.IsValid());
+	CHECK_EQUAL(0u, a.Offset);
+
+	ring.FinishFrame(3);
+	ring.Reclaim(3);
+	CHECK_EQUAL(0u, ring.GetUsedBytes());
+	CHECK_EQUAL(0u, ring.GetFramesInFlight());
+	CHECK_EQUAL(512u, ring.GetPeakFrameBytes());
+}
+
+TEST(UploadRing_WrapPaddingIsHeldUntilTheFrameIsFreed)
+{
+	UploadRing ring(1024);
+
+	REQUIRE(ring.Allocate(256).IsValid());
+	ring.FinishFrame(1);
+	REQUIRE(ring.Allocate(512).IsValid());
+	ring.FinishFrame(2);
+	ring.Reclaim(1);
+
+	// 256 bytes are free at the end and 256 at the front: 300 fits in neither.
+	CHECK(!ring.Allocate(300).IsValid());
+
+	// 200 bytes skip nothing; the next 200 do not fit at the end and wrap.
+	UploadRing::Allocation a = ring.Allocate(200, 8);
+	UploadRing::Allocation b = ring.Allocate(200, 8);
+	REQUIRE(a.IsValid() && b.IsValid());
+	CHECK_EQUAL(768u, a.Offset);
+	CHECK_EQUAL(0u, b.Offset);
+	CHECK_EQUAL(512u + 200u + 56u + 200u, ring.GetUsedBytes());
+	ring.FinishFrame(3);
+
+	ring.Reclaim(2);
+	CHECK_EQUAL(456u, ring.GetUsedBytes());
+	ring.Reclaim(3);
+	CHECK_EQUAL(0u, ring.GetUsedBytes());
+
+	// An empty ring starts over at the front.
+	UploadRing::Allocation c = ring.Allocate(1024);
+	REQUIRE(c.IsValid());
+	CHECK_EQUAL(0u, c.Offset);
+}
+
+TEST(UploadRing_FramesInFlightNeverShareMemory)
+{
+	// Three frames in flight, sized the way LandAndWavesApp sizes its ring: one frame's
+	// worth more than the frames in flight, so wrapping never starves a frame.
+	const int framesInFlight = 3;
+	const UploadRing::uint64 frameBytes = 4096;
+	UploadRing ring((framesInFlight + 1)*frameBytes);
+
+	std::deque<std::vector<Range>> frames;
+	std::vector<Range> live;
+	int failures = 0;
+	int overlaps = 0;
+
+	for(UploadRing::uint64 fence = 1; fence <= 1000; ++fence)
+	{
+		if(fence > framesInFlight)
+		{
+			ring.Reclaim(fence - framesInFlight);
+			frames.pop_front();
+			live.clear();
+			for(const std::vector<Range>& f : frames)
+				live.insert(live.end(), f.begin(), f.end());
+		}
+
+		// Up to frameBytes a frame in varied sizes and alignments.
+		std::vector<Range> frame;
+		UploadRing::uint64 budget = frameBytes;
+		for(UploadRing::uint64 k = 0; ; ++k)
+		{
+			UploadRing::uint64 size = 16 + (fence*37 + k*101) % 700;
+			UploadRing::uint64 alignment = k % 3 == 0 ? 256 : 16;
+			if(size + alignment > budget)
+				break;
+			budget -= size + alignment;
+
+			UploadRing::Allocation a = ring.Allocate(size, alignment);
+			if(!a.IsValid())
+			{
+				failures++;
+				continue;
+			}
+			if(a.Offset % alignment != 0 || a.Offset + a.Size > ring.GetCapacity() || Overlaps(live, a))
+				overlaps++;
+
+			Range r = { a.Offset, a.Offset + a.Size };
+			live.push_back(r);
+			frame.push_back(r);
+		}
+
+		ring.FinishFrame(fence);
+		frames.push_back(frame);
+	}
+
+	CHECK_EQUAL(0, failures);
+	CHECK_EQUAL(0, overlaps);
+}